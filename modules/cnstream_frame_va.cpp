@@ -114,6 +114,11 @@ CNInferAttr CNInferObject::GetAttribute(const std::string& key) {
   return CNInferAttr();
 }
 
+std::vector<std::pair<std::string, CNInferAttr>> CNInferObject::GetAttributes() {
+  std::lock_guard<std::mutex> lk(attribute_mutex_);
+  return std::vector<std::pair<std::string, CNInferAttr>>(attributes_.begin(), attributes_.end());
+}
+
 bool CNInferObject::AddExtraAttribute(const std::string& key, const std::string& value) {
   std::lock_guard<std::mutex> lk(attribute_mutex_);
   if (extra_attributes_.find(key) != extra_attributes_.end()) return false;
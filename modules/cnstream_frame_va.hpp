@@ -183,6 +183,15 @@ class CNInferObject {
    */
   CNInferAttr GetAttribute(const std::string& key);
 
+  /**
+   * @brief Gets all attributes of an object.
+   *
+   * @return Returns all attributes.
+   *
+   * @note This is a thread-safe function.
+   */
+  std::vector<std::pair<std::string, CNInferAttr>> GetAttributes();
+
   /**
    * @brief Adds the key of the extended attribute to a specified object.
    *
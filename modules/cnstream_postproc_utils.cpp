@@ -0,0 +1,445 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "cnstream_postproc_utils.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CNS_POSTPROC_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define CNS_POSTPROC_NEON 1
+#endif
+
+namespace cnstream {
+
+namespace postproc {
+
+namespace {
+
+// cephes expf, the input is clamped so that 2^n is always a normal number
+constexpr float kExpHi = 88.f;
+constexpr float kExpLo = -87.f;
+constexpr float kLog2e = 1.44269504088896341f;
+constexpr float kLn2Hi = 0.693359375f;
+constexpr float kLn2Lo = -2.12194440e-4f;
+constexpr float kP0 = 1.9875691500e-4f;
+constexpr float kP1 = 1.3981999507e-3f;
+constexpr float kP2 = 8.3334519073e-3f;
+constexpr float kP3 = 4.1665795894e-2f;
+constexpr float kP4 = 1.6666665459e-1f;
+constexpr float kP5 = 5.0000001201e-1f;
+
+void ExpC(const float *src, float *dst, int n) {
+  for (int i = 0; i < n; ++i) dst[i] = FastExp(src[i]);
+}
+
+void SigmoidC(const float *src, float *dst, int n) {
+  for (int i = 0; i < n; ++i) dst[i] = FastSigmoid(src[i]);
+}
+
+#ifdef CNS_POSTPROC_X86
+__attribute__((target("avx2,fma"))) inline __m256 Exp8(__m256 x) {
+  x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(kExpLo)), _mm256_set1_ps(kExpHi));
+  __m256 fx = _mm256_floor_ps(_mm256_fmadd_ps(x, _mm256_set1_ps(kLog2e), _mm256_set1_ps(0.5f)));
+  x = _mm256_fnmadd_ps(fx, _mm256_set1_ps(kLn2Hi), x);
+  x = _mm256_fnmadd_ps(fx, _mm256_set1_ps(kLn2Lo), x);
+  __m256 z = _mm256_mul_ps(x, x);
+  __m256 y = _mm256_set1_ps(kP0);
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(kP1));
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(kP2));
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(kP3));
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(kP4));
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(kP5));
+  y = _mm256_add_ps(_mm256_fmadd_ps(y, z, x), _mm256_set1_ps(1.f));
+  __m256i e = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvttps_epi32(fx), _mm256_set1_epi32(127)), 23);
+  return _mm256_mul_ps(y, _mm256_castsi256_ps(e));
+}
+
+__attribute__((target("avx2,fma"))) void ExpAvx2(const float *src, float *dst, int n) {
+  int i = 0;
+  for (; i + 8 <= n; i += 8) _mm256_storeu_ps(dst + i, Exp8(_mm256_loadu_ps(src + i)));
+  ExpC(src + i, dst + i, n - i);
+}
+
+__attribute__((target("avx2,fma"))) void SigmoidAvx2(const float *src, float *dst, int n) {
+  const __m256 one = _mm256_set1_ps(1.f);
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256 e = Exp8(_mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(src + i)));
+    _mm256_storeu_ps(dst + i, _mm256_div_ps(one, _mm256_add_ps(one, e)));
+  }
+  SigmoidC(src + i, dst + i, n - i);
+}
+
+bool CpuSupportsAvx2() {
+  static const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+  return supported;
+}
+#endif  // CNS_POSTPROC_X86
+
+#ifdef CNS_POSTPROC_NEON
+inline float32x4_t Exp4(float32x4_t x) {
+  x = vminq_f32(vmaxq_f32(x, vdupq_n_f32(kExpLo)), vdupq_n_f32(kExpHi));
+  float32x4_t fx = vrndmq_f32(vmlaq_n_f32(vdupq_n_f32(0.5f), x, kLog2e));
+  x = vmlsq_n_f32(x, fx, kLn2Hi);
+  x = vmlsq_n_f32(x, fx, kLn2Lo);
+  float32x4_t z = vmulq_f32(x, x);
+  float32x4_t y = vdupq_n_f32(kP0);
+  y = vmlaq_f32(vdupq_n_f32(kP1), y, x);
+  y = vmlaq_f32(vdupq_n_f32(kP2), y, x);
+  y = vmlaq_f32(vdupq_n_f32(kP3), y, x);
+  y = vmlaq_f32(vdupq_n_f32(kP4), y, x);
+  y = vmlaq_f32(vdupq_n_f32(kP5), y, x);
+  y = vaddq_f32(vmlaq_f32(x, y, z), vdupq_n_f32(1.f));
+  int32x4_t e = vshlq_n_s32(vaddq_s32(vcvtq_s32_f32(fx), vdupq_n_s32(127)), 23);
+  return vmulq_f32(y, vreinterpretq_f32_s32(e));
+}
+
+void ExpNeon(const float *src, float *dst, int n) {
+  int i = 0;
+  for (; i + 4 <= n; i += 4) vst1q_f32(dst + i, Exp4(vld1q_f32(src + i)));
+  ExpC(src + i, dst + i, n - i);
+}
+
+void SigmoidNeon(const float *src, float *dst, int n) {
+  const float32x4_t one = vdupq_n_f32(1.f);
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    float32x4_t e = Exp4(vnegq_f32(vld1q_f32(src + i)));
+    vst1q_f32(dst + i, vdivq_f32(one, vaddq_f32(one, e)));
+  }
+  SigmoidC(src + i, dst + i, n - i);
+}
+#endif  // CNS_POSTPROC_NEON
+
+inline float Clip(float x) { return x < 0 ? 0 : (x > 1 ? 1 : x); }
+
+inline float Area(const Detection &d) { return std::max(0.f, d.x1 - d.x0) * std::max(0.f, d.y1 - d.y0); }
+
+inline float IoUWithAreas(const Detection &a, const Detection &b, float area_a, float area_b) {
+  float iw = std::min(a.x1, b.x1) - std::max(a.x0, b.x0);
+  float ih = std::min(a.y1, b.y1) - std::max(a.y0, b.y0);
+  if (iw <= 0 || ih <= 0) return 0.f;
+  float inter = iw * ih;
+  float uni = area_a + area_b - inter;
+  return uni > 0 ? inter / uni : 0.f;
+}
+
+void HardNms(const std::vector<Detection> &dets, const NmsParams &params, int begin, int end, NmsScratch *s) {
+  const int *order = s->order.data();
+  const float *areas = s->areas.data();
+  uint8_t *removed = s->removed.data();
+  for (int i = begin; i < end; ++i) {
+    int idx = order[i];
+    if (removed[idx]) continue;
+    s->kept.push_back(dets[idx]);
+    for (int j = i + 1; j < end; ++j) {
+      int jdx = order[j];
+      if (removed[jdx]) continue;
+      if (IoUWithAreas(dets[idx], dets[jdx], areas[idx], areas[jdx]) > params.iou_threshold) removed[jdx] = 1;
+    }
+  }
+}
+
+void SoftNms(std::vector<Detection> *dets, const NmsParams &params, int begin, int end, NmsScratch *s) {
+  std::vector<Detection> &d = *dets;
+  int *order = s->order.data();
+  const float *areas = s->areas.data();
+  for (int i = begin; i < end; ++i) {
+    int best = i;
+    for (int j = i + 1; j < end; ++j) {
+      if (d[order[j]].score > d[order[best]].score) best = j;
+    }
+    std::swap(order[i], order[best]);
+    int idx = order[i];
+    if (d[idx].score < params.score_threshold) break;  // the others are even lower
+    s->kept.push_back(d[idx]);
+    for (int j = i + 1; j < end; ++j) {
+      int jdx = order[j];
+      float iou = IoUWithAreas(d[idx], d[jdx], areas[idx], areas[jdx]);
+      if (params.gaussian) {
+        d[jdx].score *= std::exp(-iou * iou / params.sigma);
+      } else if (iou > params.iou_threshold) {
+        d[jdx].score *= 1.f - iou;
+      }
+    }
+  }
+}
+
+}  // namespace
+
+float FastExp(float x) {
+  x = std::min(std::max(x, kExpLo), kExpHi);
+  float fx = std::floor(x * kLog2e + 0.5f);
+  x = x - fx * kLn2Hi;
+  x = x - fx * kLn2Lo;
+  float z = x * x;
+  float y = kP0;
+  y = y * x + kP1;
+  y = y * x + kP2;
+  y = y * x + kP3;
+  y = y * x + kP4;
+  y = y * x + kP5;
+  y = y * z + x + 1.f;
+  int32_t e = (static_cast<int32_t>(fx) + 127) << 23;
+  float scale;
+  memcpy(&scale, &e, sizeof(scale));
+  return y * scale;
+}
+
+float FastSigmoid(float x) { return 1.f / (1.f + FastExp(-x)); }
+
+void Exp(const float *src, float *dst, int n) {
+#ifdef CNS_POSTPROC_X86
+  if (CpuSupportsAvx2()) return ExpAvx2(src, dst, n);
+#endif
+#ifdef CNS_POSTPROC_NEON
+  return ExpNeon(src, dst, n);
+#endif
+  ExpC(src, dst, n);
+}
+
+void Sigmoid(const float *src, float *dst, int n) {
+#ifdef CNS_POSTPROC_X86
+  if (CpuSupportsAvx2()) return SigmoidAvx2(src, dst, n);
+#endif
+#ifdef CNS_POSTPROC_NEON
+  return SigmoidNeon(src, dst, n);
+#endif
+  SigmoidC(src, dst, n);
+}
+
+const char *GetPostprocIsa() {
+#ifdef CNS_POSTPROC_X86
+  if (CpuSupportsAvx2()) return "avx2";
+#endif
+#ifdef CNS_POSTPROC_NEON
+  return "neon";
+#endif
+  return "c";
+}
+
+int PruneByScore(const float *data, int num, int stride, int score_offset, float threshold,
+                 std::vector<int> *indices) {
+  indices->resize(std::max(num, 0));
+  int *out = indices->data();
+  const float *score = data + score_offset;
+  int count = 0;
+  // branchless compaction
+  for (int i = 0; i < num; ++i, score += stride) {
+    out[count] = i;
+    count += !(*score < threshold);
+  }
+  indices->resize(count);
+  return count;
+}
+
+int DecodeDetectionOutput(const float *data, int num, const DetectionOutputParams &params,
+                          std::vector<Detection> *dets, std::vector<int> *scratch) {
+  constexpr int kRecordSize = 7;
+  std::vector<int> local;
+  std::vector<int> &indices = scratch ? *scratch : local;
+  if (params.threshold > 0) {
+    PruneByScore(data, num, kRecordSize, 2, params.threshold, &indices);
+  } else {
+    indices.resize(std::max(num, 0));
+    std::iota(indices.begin(), indices.end(), 0);
+  }
+
+  auto range_w = [&params](float v) { return std::max(.0f, std::min(params.input_w, v)); };
+  auto range_h = [&params](float v) { return std::max(.0f, std::min(params.input_h, v)); };
+  int appended = 0;
+  for (int i : indices) {
+    const float *rec = data + static_cast<size_t>(i) * kRecordSize;
+    float l = Clip((range_w(rec[3]) / params.input_w - 0.5f) * params.letterbox_w + 0.5f);
+    float t = Clip((range_h(rec[4]) / params.input_h - 0.5f) * params.letterbox_h + 0.5f);
+    float r = Clip((range_w(rec[5]) / params.input_w - 0.5f) * params.letterbox_w + 0.5f);
+    float b = Clip((range_h(rec[6]) / params.input_h - 0.5f) * params.letterbox_h + 0.5f);
+    if (r <= l || b <= t) continue;
+    Detection det;
+    det.x0 = l;
+    det.y0 = t;
+    det.x1 = r;
+    det.y1 = b;
+    det.score = rec[2];
+    det.label = static_cast<int>(rec[1]);
+    det.batch_idx = static_cast<int>(rec[0]);
+    dets->push_back(det);
+    ++appended;
+  }
+  return appended;
+}
+
+int DecodeYoloHead(const float *head, const YoloHeadParams &params, int batch_idx, std::vector<Detection> *dets,
+                   YoloDecodeScratch *scratch) {
+  const int num_anchors = static_cast<int>(params.anchors.size() / 2);
+  if (!head || !dets || params.grid_w <= 0 || params.grid_h <= 0 || params.stride <= 0 || num_anchors == 0 ||
+      params.anchors.size() % 2 || params.num_classes <= 0 || params.threshold <= 0 || params.threshold >= 1) {
+    return -1;
+  }
+  YoloDecodeScratch local;
+  YoloDecodeScratch &s = scratch ? *scratch : local;
+  const int plane = params.grid_w * params.grid_h;
+  const int channels = 5 + params.num_classes;
+  // objectness * class score >= threshold requires sigmoid(objectness) >= threshold
+  const float obj_logit = std::log(params.threshold / (1.f - params.threshold));
+
+  int appended = 0;
+  for (int a = 0; a < num_anchors; ++a) {
+    const float *base = head + static_cast<size_t>(a) * channels * plane;
+    const int n = PruneByScore(base + 4 * plane, plane, 1, 0, obj_logit, &s.cells);
+    if (!n) continue;
+
+    s.labels.resize(n);
+    for (auto &v : s.values) v.resize(n);
+    float *obj = s.values[0].data(), *cls = s.values[1].data();
+    float *tx = s.values[2].data(), *ty = s.values[3].data(), *tw = s.values[4].data(), *th = s.values[5].data();
+    const float *cls_base = base + 5 * plane;
+    for (int k = 0; k < n; ++k) {
+      const int cell = s.cells[k];
+      // sigmoid is monotonic, the best class is found on the logits
+      const float *c = cls_base + cell;
+      float best = c[0];
+      int label = 0;
+      for (int j = 1; j < params.num_classes; ++j) {
+        float v = c[static_cast<size_t>(j) * plane];
+        if (v > best) {
+          best = v;
+          label = j;
+        }
+      }
+      s.labels[k] = label;
+      cls[k] = best;
+      obj[k] = base[4 * plane + cell];
+      tx[k] = base[cell];
+      ty[k] = base[plane + cell];
+      tw[k] = base[2 * plane + cell];
+      th[k] = base[3 * plane + cell];
+    }
+    Sigmoid(obj, obj, n);
+    Sigmoid(cls, cls, n);
+    Sigmoid(tx, tx, n);
+    Sigmoid(ty, ty, n);
+    if (params.yolov5) {
+      Sigmoid(tw, tw, n);
+      Sigmoid(th, th, n);
+    } else {
+      Exp(tw, tw, n);
+      Exp(th, th, n);
+    }
+
+    const float anchor_w = params.anchors[2 * a], anchor_h = params.anchors[2 * a + 1];
+    const float stride = static_cast<float>(params.stride);
+    for (int k = 0; k < n; ++k) {
+      float score = obj[k] * cls[k];
+      if (score < params.threshold) continue;
+      const int gx = s.cells[k] % params.grid_w, gy = s.cells[k] / params.grid_w;
+      float cx, cy, w, h;
+      if (params.yolov5) {
+        cx = (tx[k] * 2.f - 0.5f + gx) * stride;
+        cy = (ty[k] * 2.f - 0.5f + gy) * stride;
+        w = tw[k] * tw[k] * 4.f * anchor_w;
+        h = th[k] * th[k] * 4.f * anchor_h;
+      } else {
+        cx = (tx[k] + gx) * stride;
+        cy = (ty[k] + gy) * stride;
+        w = tw[k] * anchor_w;
+        h = th[k] * anchor_h;
+      }
+      Detection det;
+      det.x0 = cx - w * 0.5f;
+      det.y0 = cy - h * 0.5f;
+      det.x1 = cx + w * 0.5f;
+      det.y1 = cy + h * 0.5f;
+      det.score = score;
+      det.label = s.labels[k];
+      det.batch_idx = batch_idx;
+      dets->push_back(det);
+      ++appended;
+    }
+  }
+  return appended;
+}
+
+float IoU(const Detection &a, const Detection &b) { return IoUWithAreas(a, b, Area(a), Area(b)); }
+
+int Nms(std::vector<Detection> *dets, const NmsParams &params, NmsScratch *scratch) {
+  NmsScratch local;
+  NmsScratch &s = scratch ? *scratch : local;
+  std::vector<Detection> &d = *dets;
+  const int n = static_cast<int>(d.size());
+
+  // group by image (and class), then by descending score, ties keep the input order
+  auto same_group = [&d, &params](int a, int b) {
+    return d[a].batch_idx == d[b].batch_idx && (!params.class_aware || d[a].label == d[b].label);
+  };
+  s.order.resize(n);
+  std::iota(s.order.begin(), s.order.end(), 0);
+  std::sort(s.order.begin(), s.order.end(), [&d, &params](int a, int b) {
+    if (d[a].batch_idx != d[b].batch_idx) return d[a].batch_idx < d[b].batch_idx;
+    if (params.class_aware && d[a].label != d[b].label) return d[a].label < d[b].label;
+    if (d[a].score != d[b].score) return d[a].score > d[b].score;
+    return a < b;
+  });
+  s.areas.resize(n);
+  for (int i = 0; i < n; ++i) s.areas[i] = Area(d[i]);
+  s.removed.assign(n, 0);
+  s.kept.clear();
+
+  for (int begin = 0; begin < n;) {
+    int end = begin + 1;
+    while (end < n && same_group(s.order[begin], s.order[end])) ++end;
+    if (params.soft) {
+      SoftNms(dets, params, begin, end, &s);
+    } else {
+      HardNms(d, params, begin, end, &s);
+    }
+    begin = end;
+  }
+
+  std::stable_sort(s.kept.begin(), s.kept.end(), [](const Detection &a, const Detection &b) {
+    if (a.batch_idx != b.batch_idx) return a.batch_idx < b.batch_idx;
+    return a.score > b.score;
+  });
+  if (params.max_output >= 0) {
+    size_t out = 0;
+    int count = 0;
+    for (size_t i = 0; i < s.kept.size(); ++i) {
+      if (i && s.kept[i].batch_idx != s.kept[i - 1].batch_idx) count = 0;
+      if (count++ < params.max_output) s.kept[out++] = s.kept[i];
+    }
+    s.kept.resize(out);
+  }
+  // the buffer of the input is reused as the scratch of the next call
+  dets->swap(s.kept);
+  return static_cast<int>(dets->size());
+}
+
+}  // namespace postproc
+
+}  // namespace cnstream
@@ -0,0 +1,213 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_POSTPROC_UTILS_HPP_
+#define CNSTREAM_POSTPROC_UTILS_HPP_
+
+/**
+ * @file cnstream_postproc_utils.hpp
+ *
+ * This file contains the helpers shared by the detection postprocessors: fast exp and sigmoid, score pruning,
+ * decoding of detection outputs and raw yolo heads, and non-maximum suppression.
+ */
+
+#include <cstdint>
+#include <vector>
+
+namespace cnstream {
+
+namespace postproc {
+
+/**
+ * @brief Computes exp(x) with a polynomial approximation, the relative error is less than 5e-7.
+ */
+float FastExp(float x);
+/**
+ * @brief Computes 1 / (1 + exp(-x)) based on FastExp.
+ */
+float FastSigmoid(float x);
+/**
+ * @brief Computes exp of n values. AVX2 or NEON is used if the cpu supports it.
+ */
+void Exp(const float *src, float *dst, int n);
+/**
+ * @brief Computes sigmoid of n values. AVX2 or NEON is used if the cpu supports it. src and dst can be the same.
+ */
+void Sigmoid(const float *src, float *dst, int n);
+
+/**
+ * @struct Detection
+ *
+ * @brief Detection is a structure describing an axis aligned box with its class and score.
+ */
+struct Detection {
+  float x0 = 0.f;     /*!< The left of the box. */
+  float y0 = 0.f;     /*!< The top of the box. */
+  float x1 = 0.f;     /*!< The right of the box. */
+  float y1 = 0.f;     /*!< The bottom of the box. */
+  float score = 0.f;  /*!< The confidence. */
+  int label = 0;      /*!< The class id. */
+  int batch_idx = 0;  /*!< The index in batch of the image the box belongs to. */
+};
+
+/**
+ * @brief Collects the indices of the records whose score is not less than the threshold.
+ *
+ * It runs over the score field only, so that the records pruned are never decoded.
+ *
+ * @param[in] data The records.
+ * @param[in] num The number of records.
+ * @param[in] stride The number of floats of each record.
+ * @param[in] score_offset The index of the score in a record.
+ * @param[in] threshold The score threshold.
+ * @param[out] indices The indices of the records kept.
+ *
+ * @return Returns the number of the records kept.
+ */
+int PruneByScore(const float *data, int num, int stride, int score_offset, float threshold, std::vector<int> *indices);
+
+/**
+ * @struct DetectionOutputParams
+ *
+ * @brief DetectionOutputParams describes how to decode the detection output records.
+ */
+struct DetectionOutputParams {
+  float threshold = 0.f;     /*!< Records with score less than threshold are ignored. It is valid if greater than 0. */
+  float input_w = 1.f;       /*!< Coordinates are clamped to [0, input_w] and divided by input_w. */
+  float input_h = 1.f;       /*!< Coordinates are clamped to [0, input_h] and divided by input_h. */
+  float letterbox_w = 1.f;   /*!< The horizontal scaling factor to remove the letterbox padding. */
+  float letterbox_h = 1.f;   /*!< The vertical scaling factor to remove the letterbox padding. */
+};
+
+/**
+ * @brief Decodes the detection output records, [batch_idx, label, score, left, top, right, bottom] for each.
+ *
+ * The boxes are mapped back to the original image and normalized to [0, 1], empty boxes are dropped.
+ *
+ * @param[in] data The records.
+ * @param[in] num The number of records.
+ * @param[in] params The decoding parameters.
+ * @param[out] dets The detections decoded are appended to it.
+ * @param[in] scratch The buffer of indices reused between calls, it could be nullptr.
+ *
+ * @return Returns the number of the detections appended.
+ */
+int DecodeDetectionOutput(const float *data, int num, const DetectionOutputParams &params,
+                          std::vector<Detection> *dets, std::vector<int> *scratch = nullptr);
+
+/**
+ * @struct YoloHeadParams
+ *
+ * @brief YoloHeadParams describes a raw yolo head, the output of the last convolution in NCHW order,
+ * [num_anchors * (5 + num_classes), grid_h, grid_w].
+ */
+struct YoloHeadParams {
+  int grid_w = 0;               /*!< The width of the grid. */
+  int grid_h = 0;               /*!< The height of the grid. */
+  int stride = 0;               /*!< The number of input pixels of a grid cell. */
+  std::vector<float> anchors;   /*!< The width and height of each anchor in input pixels. */
+  int num_classes = 80;         /*!< The number of classes. */
+  float threshold = 0.25f;      /*!< The threshold of objectness * class score. */
+  bool yolov5 = true;           /*!< Decodes the boxes as yolov5 if true, otherwise as yolov3. */
+};
+
+/**
+ * @struct YoloDecodeScratch
+ *
+ * @brief YoloDecodeScratch holds the buffers used by DecodeYoloHead, reuse it to avoid allocations.
+ */
+struct YoloDecodeScratch {
+  std::vector<int> cells;
+  std::vector<int> labels;
+  std::vector<float> values[6];
+};
+
+/**
+ * @brief Decodes a raw yolo head to boxes in input pixels, with the best class of each anchor.
+ *
+ * The objectness is compared against logit(threshold) before any exp is computed, only the surviving anchors are
+ * decoded, with vectorized sigmoid and exp.
+ *
+ * @param[in] head The head of one image.
+ * @param[in] params The head parameters.
+ * @param[in] batch_idx The batch index set to the detections.
+ * @param[out] dets The detections decoded are appended to it.
+ * @param[in] scratch The buffers reused between calls, it could be nullptr.
+ *
+ * @return Returns the number of the detections appended, or -1 if the parameters are invalid.
+ */
+int DecodeYoloHead(const float *head, const YoloHeadParams &params, int batch_idx, std::vector<Detection> *dets,
+                   YoloDecodeScratch *scratch = nullptr);
+
+/**
+ * @brief Computes the intersection over union of two boxes.
+ */
+float IoU(const Detection &a, const Detection &b);
+
+/**
+ * @struct NmsParams
+ *
+ * @brief NmsParams is a structure describing the parameters of non-maximum suppression.
+ */
+struct NmsParams {
+  float iou_threshold = 0.45f;   /*!< Boxes overlapping a kept one more than this are suppressed. */
+  bool class_aware = true;       /*!< Only boxes of the same class suppress each other if true. */
+  int max_output = -1;           /*!< The maximum number of boxes kept of each image, -1 means no limit. */
+  bool soft = false;             /*!< Decays the scores of the overlapping boxes instead of removing them. */
+  bool gaussian = true;          /*!< Soft-NMS decay, score * exp(-iou^2 / sigma) if true, otherwise linear. */
+  float sigma = 0.5f;            /*!< The sigma of the gaussian decay. */
+  float score_threshold = 0.001f;  /*!< Boxes with decayed score less than this are removed by soft-NMS. */
+};
+
+/**
+ * @struct NmsScratch
+ *
+ * @brief NmsScratch holds the buffers used by Nms, reuse it to avoid allocations.
+ */
+struct NmsScratch {
+  std::vector<int> order;
+  std::vector<float> areas;
+  std::vector<uint8_t> removed;
+  std::vector<Detection> kept;
+};
+
+/**
+ * @brief Non-maximum suppression of the detections of a batch, boxes of different images never suppress each other.
+ *
+ * @param[inout] dets The detections, replaced by the ones kept, sorted by batch index and descending score.
+ * @param[in] params The parameters.
+ * @param[in] scratch The buffers reused between calls, it could be nullptr.
+ *
+ * @return Returns the number of the detections kept.
+ */
+int Nms(std::vector<Detection> *dets, const NmsParams &params, NmsScratch *scratch = nullptr);
+
+/**
+ * @brief Gets the instruction set used by Exp and Sigmoid.
+ *
+ * @return Returns "avx2", "neon" or "c".
+ */
+const char *GetPostprocIsa();
+
+}  // namespace postproc
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_POSTPROC_UTILS_HPP_
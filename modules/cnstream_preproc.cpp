@@ -34,6 +34,7 @@ extern "C" {
 };
 #endif
 #include "cnstream_logging.hpp"
+#include "sws_context_cache.hpp"
 
 namespace cnstream {
 
@@ -128,9 +129,12 @@ void YUV420spToRGBx(uint8_t *src_y, uint8_t *src_uv, int src_w, int src_h, int s
   unsigned char *inaddr[4] = {src_y, src_uv, 0, 0};
   unsigned char *outaddr[4] = {dst_rgbx, 0, 0, 0};
   SwsContext *sws_ctx =
-      sws_getContext(src_w, src_h, src_av_fmt, dst_w, dst_h, dst_av_fmt, SWS_BILINEAR, NULL, NULL, NULL);
+      SwsContextCache::Instance().Get(src_w, src_h, src_av_fmt, dst_w, dst_h, dst_av_fmt, SWS_BILINEAR);
+  if (!sws_ctx) {
+    LOGE(PREPROC) << "YUV420spToRGBx(): Get SwsContext failed";
+    return;
+  }
   sws_scale(sws_ctx, inaddr, yuv_linesize, 0, src_h, outaddr, rgb_linesize);
-  sws_freeContext(sws_ctx);
 }
 
 void NV12ToBGR24(uint8_t *src_y, uint8_t *src_uv, int src_w, int src_h, int src_stride, uint8_t *dst_bgr24, int dst_w,
@@ -183,6 +183,54 @@ void NV21ToBGR24(uint8_t *src_y, uint8_t *src_uv, int src_w, int src_h, int src_
 void YUV420spToRGBx(uint8_t *src_y, uint8_t *src_uv, int src_w, int src_h, int src_y_stride, int srv_uv_stride,
                     CnedkBufSurfaceColorFormat src_fmt, uint8_t *dst_rgbx, int dst_w, int dst_h, int dst_stride,
                     CnedkBufSurfaceColorFormat dst_fmt);
+
+/**
+ * @struct CpuPreprocParams
+ *
+ * @brief The CpuPreprocParams is a structure describing the output tensor of YUV420spToTensorCpu.
+ */
+struct CpuPreprocParams {
+  CnedkBufSurfaceColorFormat dst_fmt = CNEDK_BUF_COLOR_FORMAT_RGB;  /*!< The channel order, RGB or BGR. */
+  infer_server::DataType dtype = infer_server::DataType::FLOAT32;   /*!< The data type, UINT8 or FLOAT32. */
+  bool planar = false;             /*!< Writes the tensor in CHW order if true, otherwise in HWC order. */
+  bool keep_aspect_ratio = true;   /*!< Keeps the aspect ratio of the source and pads the borders. */
+  int pad_value = 0;               /*!< The value of the padded pixels before normalization. */
+  bool mean_std = false;           /*!< Normalizes each channel by (x - mean) / std. It is valid for FLOAT32. */
+  float mean[3] = {0.f, 0.f, 0.f};  /*!< The mean of each channel of the destination. */
+  float std[3] = {1.f, 1.f, 1.f};   /*!< The std of each channel of the destination. */
+  bool use_simd = true;            /*!< Uses AVX2 or NEON if the cpu supports it. */
+};
+
+/**
+ * @brief Converts image from YUV420sp NV12/NV21 format to a 3-channel network input tensor on CPU.
+ *
+ * Color conversion, bilinear resizing, letterboxing and normalization are done in one pass, without intermediate
+ * images.
+ *
+ * @param[in] src_y The y plane pointer of the source.
+ * @param[in] src_uv The uv plane pointer of the source.
+ * @param[in] src_w The width of the source, it should be even.
+ * @param[in] src_h The height of the source, it should be even.
+ * @param[in] src_y_stride The stride of y plane of the source.
+ * @param[in] src_uv_stride The stride of uv plane of the source.
+ * @param[in] src_fmt The pixel format of the source, NV12 or NV21.
+ * @param[out] dst The data pointer of the destination tensor.
+ * @param[in] dst_w The width of the destination.
+ * @param[in] dst_h The height of the destination.
+ * @param[in] params The parameters of the destination tensor.
+ *
+ * @return Returns 0 if this function has run successfully. Otherwise returns -1.
+ */
+int YUV420spToTensorCpu(const uint8_t *src_y, const uint8_t *src_uv, int src_w, int src_h, int src_y_stride,
+                        int src_uv_stride, CnedkBufSurfaceColorFormat src_fmt, void *dst, int dst_w, int dst_h,
+                        const CpuPreprocParams &params);
+
+/**
+ * @brief Gets the instruction set used by YUV420spToTensorCpu.
+ *
+ * @return Returns "avx2", "neon" or "c".
+ */
+const char *GetCpuPreprocIsa();
 }  // namespace cnstream
 
 #endif  // CNSTREAM_INFERENCE_PREPROC_HPP_
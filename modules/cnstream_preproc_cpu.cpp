@@ -0,0 +1,374 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CNS_PREPROC_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define CNS_PREPROC_NEON 1
+#endif
+
+#include "cnstream_logging.hpp"
+#include "cnstream_preproc.hpp"
+#include "tensor_buffer_pool.hpp"
+
+namespace cnstream {
+
+namespace {
+
+// bilinear weights in fixed point
+constexpr int kShift = 11;
+constexpr int kOne = 1 << kShift;
+
+// BT.601 limited range, the same as libswscale by default
+constexpr float kYScale = 1.164383f;
+constexpr float kRV = 1.596027f;
+constexpr float kGU = 0.391762f;
+constexpr float kGV = 0.812968f;
+constexpr float kBU = 2.017232f;
+
+struct AxisCoefs {
+  int *ofs0, *ofs1, *wts;
+};
+
+// Maps dst to src with the pixel centers aligned, src is in units of `step` bytes. `storage` holds 3 * dst_len ints.
+void BuildCoefs(int src_len, int dst_len, int step, int *storage, AxisCoefs *coefs) {
+  coefs->ofs0 = storage;
+  coefs->ofs1 = storage + dst_len;
+  coefs->wts = storage + 2 * dst_len;
+  float scale = static_cast<float>(src_len) / dst_len;
+  for (int d = 0; d < dst_len; ++d) {
+    float s = std::max((d + 0.5f) * scale - 0.5f, 0.f);
+    int i = std::min(static_cast<int>(s), src_len - 1);
+    coefs->ofs0[d] = i * step;
+    coefs->ofs1[d] = std::min(i + 1, src_len - 1) * step;
+    coefs->wts[d] = static_cast<int>((s - i) * kOne + 0.5f);
+  }
+}
+
+inline uint8_t Lerp(const uint8_t *r0, const uint8_t *r1, int o0, int o1, int wx, int wy) {
+  int top = r0[o0] * (kOne - wx) + r0[o1] * wx;
+  int bottom = r1[o0] * (kOne - wx) + r1[o1] * wx;
+  return static_cast<uint8_t>((top * (kOne - wy) + bottom * wy + (1 << (2 * kShift - 1))) >> (2 * kShift));
+}
+
+// out[c] = round(clamp(rgb[c], 0, 255)) * scale[c] + bias[c], outputs are in R, G, B order.
+void ConvertRowC(const uint8_t *y, const uint8_t *u, const uint8_t *v, int n, const float *scale,
+                 const float *bias, float *const out[3]) {
+  for (int i = 0; i < n; ++i) {
+    float yf = (y[i] - 16.f) * kYScale;
+    float uf = u[i] - 128.f;
+    float vf = v[i] - 128.f;
+    float rgb[3] = {yf + kRV * vf, yf - kGU * uf - kGV * vf, yf + kBU * uf};
+    for (int c = 0; c < 3; ++c) {
+      float x = std::nearbyint(std::min(std::max(rgb[c], 0.f), 255.f));
+      out[c][i] = x * scale[c] + bias[c];
+    }
+  }
+}
+
+#ifdef CNS_PREPROC_X86
+__attribute__((target("avx2,fma")))
+void ConvertRowAvx2(const uint8_t *y, const uint8_t *u, const uint8_t *v, int n, const float *scale,
+                    const float *bias, float *const out[3]) {
+  const __m256 k16 = _mm256_set1_ps(16.f), k128 = _mm256_set1_ps(128.f);
+  const __m256 k_y = _mm256_set1_ps(kYScale), k_rv = _mm256_set1_ps(kRV), k_gu = _mm256_set1_ps(kGU);
+  const __m256 k_gv = _mm256_set1_ps(kGV), k_bu = _mm256_set1_ps(kBU);
+  const __m256 zero = _mm256_setzero_ps(), k255 = _mm256_set1_ps(255.f);
+  __m256 s[3], b[3];
+  for (int c = 0; c < 3; ++c) {
+    s[c] = _mm256_set1_ps(scale[c]);
+    b[c] = _mm256_set1_ps(bias[c]);
+  }
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256 yf = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(y + i))));
+    __m256 uf = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(u + i))));
+    __m256 vf = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(v + i))));
+    yf = _mm256_mul_ps(_mm256_sub_ps(yf, k16), k_y);
+    uf = _mm256_sub_ps(uf, k128);
+    vf = _mm256_sub_ps(vf, k128);
+    __m256 rgb[3];
+    rgb[0] = _mm256_fmadd_ps(vf, k_rv, yf);
+    rgb[1] = _mm256_fnmadd_ps(vf, k_gv, _mm256_fnmadd_ps(uf, k_gu, yf));
+    rgb[2] = _mm256_fmadd_ps(uf, k_bu, yf);
+    for (int c = 0; c < 3; ++c) {
+      __m256 x = _mm256_min_ps(_mm256_max_ps(rgb[c], zero), k255);
+      x = _mm256_round_ps(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+      _mm256_storeu_ps(out[c] + i, _mm256_fmadd_ps(x, s[c], b[c]));
+    }
+  }
+  if (i < n) {
+    float *const tail[3] = {out[0] + i, out[1] + i, out[2] + i};
+    ConvertRowC(y + i, u + i, v + i, n - i, scale, bias, tail);
+  }
+}
+
+bool CpuSupportsAvx2() {
+  static const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+  return supported;
+}
+#endif  // CNS_PREPROC_X86
+
+#ifdef CNS_PREPROC_NEON
+inline void Convert4Neon(float32x4_t yf, float32x4_t uf, float32x4_t vf, const float32x4_t *s, const float32x4_t *b,
+                         float *const out[3], int i) {
+  const float32x4_t zero = vdupq_n_f32(0.f), k255 = vdupq_n_f32(255.f);
+  yf = vmulq_n_f32(vsubq_f32(yf, vdupq_n_f32(16.f)), kYScale);
+  uf = vsubq_f32(uf, vdupq_n_f32(128.f));
+  vf = vsubq_f32(vf, vdupq_n_f32(128.f));
+  float32x4_t rgb[3];
+  rgb[0] = vmlaq_n_f32(yf, vf, kRV);
+  rgb[1] = vmlsq_n_f32(vmlsq_n_f32(yf, uf, kGU), vf, kGV);
+  rgb[2] = vmlaq_n_f32(yf, uf, kBU);
+  for (int c = 0; c < 3; ++c) {
+    float32x4_t x = vrndnq_f32(vminq_f32(vmaxq_f32(rgb[c], zero), k255));
+    vst1q_f32(out[c] + i, vmlaq_f32(b[c], x, s[c]));
+  }
+}
+
+void ConvertRowNeon(const uint8_t *y, const uint8_t *u, const uint8_t *v, int n, const float *scale,
+                    const float *bias, float *const out[3]) {
+  float32x4_t s[3], b[3];
+  for (int c = 0; c < 3; ++c) {
+    s[c] = vdupq_n_f32(scale[c]);
+    b[c] = vdupq_n_f32(bias[c]);
+  }
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    uint16x8_t y16 = vmovl_u8(vld1_u8(y + i));
+    uint16x8_t u16 = vmovl_u8(vld1_u8(u + i));
+    uint16x8_t v16 = vmovl_u8(vld1_u8(v + i));
+    Convert4Neon(vcvtq_f32_u32(vmovl_u16(vget_low_u16(y16))), vcvtq_f32_u32(vmovl_u16(vget_low_u16(u16))),
+                 vcvtq_f32_u32(vmovl_u16(vget_low_u16(v16))), s, b, out, i);
+    Convert4Neon(vcvtq_f32_u32(vmovl_u16(vget_high_u16(y16))), vcvtq_f32_u32(vmovl_u16(vget_high_u16(u16))),
+                 vcvtq_f32_u32(vmovl_u16(vget_high_u16(v16))), s, b, out, i + 4);
+  }
+  if (i < n) {
+    float *const tail[3] = {out[0] + i, out[1] + i, out[2] + i};
+    ConvertRowC(y + i, u + i, v + i, n - i, scale, bias, tail);
+  }
+}
+#endif  // CNS_PREPROC_NEON
+
+using ConvertRowFunc = void (*)(const uint8_t *, const uint8_t *, const uint8_t *, int, const float *, const float *,
+                                float *const[3]);
+
+ConvertRowFunc GetConvertRow(bool use_simd) {
+  if (use_simd) {
+#ifdef CNS_PREPROC_X86
+    if (CpuSupportsAvx2()) return ConvertRowAvx2;
+#endif
+#ifdef CNS_PREPROC_NEON
+    return ConvertRowNeon;
+#endif
+  }
+  return ConvertRowC;
+}
+
+// Writes `n` pixels of the given values (in destination channel order) starting from pixel `offset` of row `row`.
+template <typename T>
+void FillPixels(T *dst, int dst_w, int dst_h, bool planar, int row, int offset, int n, const T *value) {
+  if (n <= 0) return;
+  if (planar) {
+    for (int c = 0; c < 3; ++c) {
+      std::fill_n(dst + (static_cast<size_t>(c) * dst_h + row) * dst_w + offset, n, value[c]);
+    }
+  } else {
+    T *p = dst + (static_cast<size_t>(row) * dst_w + offset) * 3;
+    for (int i = 0; i < n; ++i, p += 3) {
+      p[0] = value[0];
+      p[1] = value[1];
+      p[2] = value[2];
+    }
+  }
+}
+
+// Stores the R, G, B rows to the destination in its channel order.
+template <typename T>
+void StoreRow(float *const rgb[3], int n, const int *dst_channel, T *dst, int dst_w, int dst_h, bool planar, int row,
+              int offset) {
+  if (planar) {
+    for (int c = 0; c < 3; ++c) {
+      T *p = dst + (static_cast<size_t>(dst_channel[c]) * dst_h + row) * dst_w + offset;
+      if (std::is_same<T, float>::value && reinterpret_cast<void *>(p) == reinterpret_cast<void *>(rgb[c])) continue;
+      for (int i = 0; i < n; ++i) p[i] = static_cast<T>(rgb[c][i]);
+    }
+  } else {
+    T *p = dst + (static_cast<size_t>(row) * dst_w + offset) * 3;
+    const float *r = rgb[0], *g = rgb[1], *b = rgb[2];
+    T *pr = p + dst_channel[0], *pg = p + dst_channel[1], *pb = p + dst_channel[2];
+    for (int i = 0; i < n; ++i) {
+      pr[i * 3] = static_cast<T>(r[i]);
+      pg[i * 3] = static_cast<T>(g[i]);
+      pb[i * 3] = static_cast<T>(b[i]);
+    }
+  }
+}
+
+template <typename T>
+int Process(const uint8_t *src_y, const uint8_t *src_uv, int src_w, int src_h, int src_y_stride, int src_uv_stride,
+             bool nv21, T *dst, int dst_w, int dst_h, const CnedkTransformRect &roi, const CpuPreprocParams &params) {
+  // channel index in the destination of R, G and B
+  const bool bgr = params.dst_fmt == CNEDK_BUF_COLOR_FORMAT_BGR;
+  const int dst_channel[3] = {bgr ? 2 : 0, 1, bgr ? 0 : 2};
+  float scale[3] = {1.f, 1.f, 1.f}, bias[3] = {0.f, 0.f, 0.f};
+  T pad[3];
+  for (int c = 0; c < 3; ++c) {
+    int dc = dst_channel[c];
+    if (std::is_same<T, float>::value && params.mean_std) {
+      scale[c] = 1.f / params.std[dc];
+      bias[c] = -params.mean[dc] / params.std[dc];
+    }
+    pad[dc] = static_cast<T>(params.pad_value * scale[c] + bias[c]);
+  }
+
+  const int roi_w = roi.width, roi_h = roi.height;
+  // float planar rows are written in place
+  const bool in_place = std::is_same<T, float>::value && params.planar;
+  // coefficients, rgb rows and yuv rows share one scratch buffer borrowed from the pool, not allocated per call
+  const size_t coef_num = 6 * static_cast<size_t>(roi_w + roi_h);
+  const size_t rgb_num = in_place ? 0 : 3 * static_cast<size_t>(roi_w);
+  TensorBuffer scratch = TensorBufferPool::Instance().Borrow((coef_num + rgb_num) * 4 + 3 * roi_w);
+  if (!scratch) {
+    LOGE(PREPROC) << "[YUV420spToTensorCpu] Borrow scratch buffer failed";
+    return -1;
+  }
+  int *coef_buf = static_cast<int *>(scratch.Data());
+  AxisCoefs xc, yc, uvxc, uvyc;
+  BuildCoefs(src_w, roi_w, 1, coef_buf, &xc);
+  BuildCoefs(src_h, roi_h, 1, coef_buf + 3 * roi_w, &yc);
+  BuildCoefs(src_w / 2, roi_w, 2, coef_buf + 3 * (roi_w + roi_h), &uvxc);
+  BuildCoefs(src_h / 2, roi_h, 1, coef_buf + 3 * (2 * roi_w + roi_h), &uvyc);
+
+  float *rgb_buf = reinterpret_cast<float *>(coef_buf + coef_num);
+  uint8_t *y_row = reinterpret_cast<uint8_t *>(rgb_buf + rgb_num), *u_row = y_row + roi_w, *v_row = u_row + roi_w;
+  const int u_idx = nv21 ? 1 : 0, v_idx = nv21 ? 0 : 1;
+  ConvertRowFunc convert = GetConvertRow(params.use_simd);
+
+  for (int row = 0; row < dst_h; ++row) {
+    int r = row - static_cast<int>(roi.top);
+    if (r < 0 || r >= roi_h) {
+      FillPixels(dst, dst_w, dst_h, params.planar, row, 0, dst_w, pad);
+      continue;
+    }
+    FillPixels(dst, dst_w, dst_h, params.planar, row, 0, roi.left, pad);
+    FillPixels(dst, dst_w, dst_h, params.planar, row, roi.left + roi_w, dst_w - roi.left - roi_w, pad);
+
+    const uint8_t *y0 = src_y + static_cast<size_t>(yc.ofs0[r]) * src_y_stride;
+    const uint8_t *y1 = src_y + static_cast<size_t>(yc.ofs1[r]) * src_y_stride;
+    const uint8_t *uv0 = src_uv + static_cast<size_t>(uvyc.ofs0[r]) * src_uv_stride;
+    const uint8_t *uv1 = src_uv + static_cast<size_t>(uvyc.ofs1[r]) * src_uv_stride;
+    int wy = yc.wts[r], uvwy = uvyc.wts[r];
+    for (int i = 0; i < roi_w; ++i) {
+      y_row[i] = Lerp(y0, y1, xc.ofs0[i], xc.ofs1[i], xc.wts[i], wy);
+      u_row[i] = Lerp(uv0 + u_idx, uv1 + u_idx, uvxc.ofs0[i], uvxc.ofs1[i], uvxc.wts[i], uvwy);
+      v_row[i] = Lerp(uv0 + v_idx, uv1 + v_idx, uvxc.ofs0[i], uvxc.ofs1[i], uvxc.wts[i], uvwy);
+    }
+
+    float *rgb[3];
+    for (int c = 0; c < 3; ++c) {
+      if (in_place) {
+        rgb[c] = reinterpret_cast<float *>(dst) + (static_cast<size_t>(dst_channel[c]) * dst_h + row) * dst_w +
+                 roi.left;
+      } else {
+        rgb[c] = rgb_buf + c * roi_w;
+      }
+    }
+    convert(y_row, u_row, v_row, roi_w, scale, bias, rgb);
+    StoreRow(rgb, roi_w, dst_channel, dst, dst_w, dst_h, params.planar, row, roi.left);
+  }
+  return 0;
+}
+
+}  // namespace
+
+const char *GetCpuPreprocIsa() {
+#ifdef CNS_PREPROC_X86
+  if (CpuSupportsAvx2()) return "avx2";
+#endif
+#ifdef CNS_PREPROC_NEON
+  return "neon";
+#endif
+  return "c";
+}
+
+int YUV420spToTensorCpu(const uint8_t *src_y, const uint8_t *src_uv, int src_w, int src_h, int src_y_stride,
+                        int src_uv_stride, CnedkBufSurfaceColorFormat src_fmt, void *dst, int dst_w, int dst_h,
+                        const CpuPreprocParams &params) {
+  if (!src_y || !src_uv || !dst || src_w < 2 || src_h < 2 || dst_w <= 0 || dst_h <= 0) {
+    LOGE(PREPROC) << "[YUV420spToTensorCpu] Invalid parameters";
+    return -1;
+  }
+  if ((src_fmt != CNEDK_BUF_COLOR_FORMAT_NV12 && src_fmt != CNEDK_BUF_COLOR_FORMAT_NV21) ||
+      (params.dst_fmt != CNEDK_BUF_COLOR_FORMAT_RGB && params.dst_fmt != CNEDK_BUF_COLOR_FORMAT_BGR)) {
+    LOGE(PREPROC) << "[YUV420spToTensorCpu] Unsupported pixel format convertion";
+    return -1;
+  }
+  if (params.mean_std && (params.std[0] == 0 || params.std[1] == 0 || params.std[2] == 0)) {
+    LOGE(PREPROC) << "[YUV420spToTensorCpu] std must not be zero";
+    return -1;
+  }
+
+  CnedkTransformRect roi;
+  if (params.keep_aspect_ratio) {
+    roi = KeepAspectRatio(src_w, src_h, dst_w, dst_h);
+    // validate bbox
+    roi.left -= roi.left & 1;
+    roi.top -= roi.top & 1;
+    roi.width -= roi.width & 1;
+    roi.height -= roi.height & 1;
+    while (roi.left + roi.width > static_cast<uint32_t>(dst_w)) roi.width -= 2;
+    while (roi.top + roi.height > static_cast<uint32_t>(dst_h)) roi.height -= 2;
+    if (roi.width == 0 || roi.height == 0) {
+      roi.left = roi.top = 0;
+      roi.width = dst_w;
+      roi.height = dst_h;
+    }
+  } else {
+    roi.left = 0;
+    roi.top = 0;
+    roi.width = dst_w;
+    roi.height = dst_h;
+  }
+
+  bool nv21 = src_fmt == CNEDK_BUF_COLOR_FORMAT_NV21;
+  src_w -= src_w & 1;
+  src_h -= src_h & 1;
+  if (params.dtype == infer_server::DataType::FLOAT32) {
+    return Process(src_y, src_uv, src_w, src_h, src_y_stride, src_uv_stride, nv21, static_cast<float *>(dst), dst_w,
+                   dst_h, roi, params);
+  } else if (params.dtype == infer_server::DataType::UINT8) {
+    if (params.mean_std) {
+      LOGW(PREPROC) << "[YUV420spToTensorCpu] not support uint8 with mean std.";
+    }
+    return Process(src_y, src_uv, src_w, src_h, src_y_stride, src_uv_stride, nv21, static_cast<uint8_t *>(dst),
+                   dst_w, dst_h, roi, params);
+  }
+  LOGE(PREPROC) << "[YUV420spToTensorCpu] Only support UINT8 and FLOAT32";
+  return -1;
+}
+
+}  // namespace cnstream
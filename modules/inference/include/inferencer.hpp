@@ -63,17 +63,81 @@ typedef struct InferParams {
 
   std::string postproc_name = "";
   float threshold = 0.f;
+  uint32_t postproc_thread_num = 0;  ///< 0 to postprocess on the response path of the backend
+  uint32_t postproc_queue_size = 8;  ///< the number of batches waiting for the postprocessing threads at most
 
   std::string filter_name = "";
   std::vector<std::string> filter_categories;
   std::unordered_map<std::string, std::string> custom_preproc_params;
   std::unordered_map<std::string, std::string> custom_postproc_params;
+
+  std::string backend = "infer_server";  ///< infer_server or cpu_mock
+  /**
+   * Parameters of the cpu_mock backend:
+   *   batch_size: the batch size of the mock model, 4 by default.
+   *   latency_ms, item_latency_ms: the inference of a batch takes latency_ms + item_latency_ms * batch size.
+   *   input_shape, input_order, input_dtype: the input of the mock model without the batch dimension,
+   *     [640, 640, 3], NHWC and UINT8 by default.
+   *   output_shapes: the outputs of the mock model without the batch dimension, [[1024, 7], [1]] by default.
+   *   objects: the number of synthetic boxes written to each detection output, 0 by default.
+   *   hugepage: backs the input and output tensors by huge pages, false by default.
+   */
+  std::unordered_map<std::string, std::string> backend_params;
+
+  /**
+   * Infers frames at an interval adapted to the motion of the scene and the number of objects instead of interval:
+   *   min_interval, max_interval: the bounds of the interval, 1 and 8 by default.
+   *   motion_threshold: the mean absolute difference of the luma thumbnails regarded as motion, 2 by default.
+   *   static_threshold: the mean absolute difference regarded as static, the interval backs off below it, 0.5 by
+   *     default.
+   *   thumbnail_width: the width of the luma thumbnails, 64 by default.
+   *   streams: {stream_id: [min_interval, max_interval]}, the bounds of the streams.
+   */
+  std::unordered_map<std::string, std::string> adaptive_interval;
+
+  /**
+   * For secondary inference only. The objects of different frames and streams are batched together by Inferencer
+   * regardless of batch_strategy, a batch is sent when it is full, or as the scheduler decides. Each frame is
+   * transmitted in order once all its objects are inferred.
+   */
+  bool roi_batching = false;
+
+  /**
+   * For secondary inference only. Caches the results of the objects by (stream_id, track_id), tracked objects are
+   * inferred again only when their results are refreshed:
+   *   refresh_interval: the number of frames after which a result is refreshed, 10 by default, 0 to disable.
+   *   size_growth: the relative growth of the area of the box that refreshes a result, 0.2 by default, 0 to disable.
+   *   score_drop: the drop of the detection score that refreshes a result, 0.2 by default, 0 to disable.
+   *   max_lost: the number of frames a track is not seen before its result is evicted, 25 by default.
+   */
+  std::unordered_map<std::string, std::string> result_cache;
+
+  /**
+   * arrival: batches are formed by infer_server as batch_strategy.
+   * deadline: batches are formed across streams by Inferencer, each frame is batched within batch_timeout after it
+   *   arrived, the waiting time adapts to the arrival rate and the processing time observed.
+   */
+  std::string scheduler = "arrival";
+  /**
+   * Parameters of the deadline scheduler:
+   *   stream_priority: {stream_id: priority}, frames of streams with higher priority are batched first.
+   *   default_priority: the priority of the streams not listed, 0 by default.
+   */
+  std::unordered_map<std::string, std::string> scheduler_params;
 } InferParams;
 
-class InferObserver;
+class InferBackend;
+class AdaptiveInterval;
+struct CachedObjectResult;
+template <typename T>
+class TrackResultCache;
+using InferResultCache = TrackResultCache<std::shared_ptr<const CachedObjectResult>>;
+template <typename T>
+class PostprocPool;
+using InferPostprocPool = PostprocPool<CNFrameInfo>;
 
 /**
- * @brief for inference based on infer_server.
+ * @brief for inference based on infer_server, or the cpu_mock backend without MLU.
  */
 class Inferencer : public ModuleEx,
                    public ModuleCreator<Inferencer>,
@@ -144,15 +208,20 @@ class Inferencer : public ModuleEx,
                  const infer_server::ModelIO &model_output,
                  const infer_server::ModelInfo *model_info) override;
 
-  void OnProcessDone(const CNFrameInfoPtr data) {
-    this->TransmitData(data);
-  }
+  void OnProcessDone(const CNFrameInfoPtr data);
 
  private:
+  bool CreateAdaptiveInterval(const std::unordered_map<std::string, std::string>& params);
+  bool CreateResultCache(const std::unordered_map<std::string, std::string>& params);
+  bool LookupResultCache(const CNFrameInfoPtr& data, uint64_t frame_id, const CNInferObjectPtr& obj);
+  int ExecutePostproc(const NetOutputs& net_outputs, const infer_server::ModelInfo* model_info,
+                      const std::vector<CNFrameInfoPtr>& packages, const std::vector<CNInferObjectPtr>& objects);
+
   std::unique_ptr<ModuleParamsHelper<InferParams>> param_helper_ = nullptr;
-  std::unique_ptr<infer_server::InferServer> server_ = nullptr;
-  infer_server::Session_t session_ = nullptr;
-  std::shared_ptr<InferObserver> observer_ = nullptr;
+  std::unique_ptr<InferBackend> backend_ = nullptr;
+  std::unique_ptr<AdaptiveInterval> adaptive_interval_ = nullptr;
+  std::unique_ptr<InferResultCache> result_cache_ = nullptr;
+  std::unique_ptr<InferPostprocPool> postproc_pool_ = nullptr;
   std::shared_ptr<ObjectFilterVideo> filter_ = nullptr;
   std::shared_ptr<Preproc> preproc_ = nullptr;
   std::shared_ptr<Postproc> postproc_ = nullptr;
@@ -0,0 +1,162 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "adaptive_interval.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cnstream {
+
+AdaptiveInterval::AdaptiveInterval(const Params &params) : params_(params) {
+  params_.min_interval = std::max(params_.min_interval, 1u);
+  params_.max_interval = std::max(params_.max_interval, params_.min_interval);
+  params_.thumbnail_width = std::max(params_.thumbnail_width, 8u);
+  params_.static_threshold = std::min(params_.static_threshold, params_.motion_threshold);
+}
+
+void AdaptiveInterval::SetStreamBounds(const std::string &stream_id, uint32_t min_interval, uint32_t max_interval) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  min_interval = std::max(min_interval, 1u);
+  max_interval = std::max(max_interval, min_interval);
+  bounds_[stream_id] = std::make_pair(min_interval, max_interval);
+  auto iter = states_.find(stream_id);
+  if (iter != states_.end()) {
+    iter->second.min_interval = min_interval;
+    iter->second.max_interval = max_interval;
+    iter->second.interval = std::min(std::max(iter->second.interval, min_interval), max_interval);
+  }
+}
+
+AdaptiveInterval::StreamState &AdaptiveInterval::GetState(const std::string &stream_id) {
+  auto iter = states_.find(stream_id);
+  if (iter != states_.end()) return iter->second;
+  StreamState &state = states_[stream_id];
+  auto bounds = bounds_.find(stream_id);
+  if (bounds != bounds_.end()) {
+    state.min_interval = bounds->second.first;
+    state.max_interval = bounds->second.second;
+  } else {
+    state.min_interval = params_.min_interval;
+    state.max_interval = params_.max_interval;
+  }
+  state.interval = state.min_interval;
+  // the first frame is always inferred
+  state.frames_since_infer = state.max_interval;
+  return state;
+}
+
+void AdaptiveInterval::MakeThumbnail(const uint8_t *luma, int width, int height, int stride, uint32_t thumbnail_width,
+                                     std::vector<uint8_t> *thumbnail, int *thumbnail_height) {
+  int step = std::max(1, width / static_cast<int>(thumbnail_width));
+  int thumb_w = width / step;
+  int thumb_h = height / step;
+  // a few rows of each block are enough for the average, and keep the cost far below a full pass
+  int row_step = std::max(1, step / 4);
+  int rows = (step + row_step - 1) / row_step;
+  thumbnail->resize(static_cast<size_t>(thumb_w) * thumb_h);
+  std::vector<uint32_t> sums(thumb_w);
+  for (int ty = 0; ty < thumb_h; ++ty) {
+    std::fill(sums.begin(), sums.end(), 0);
+    for (int r = 0; r < rows; ++r) {
+      const uint8_t *row = luma + static_cast<size_t>(ty * step + r * row_step) * stride;
+      for (int tx = 0; tx < thumb_w; ++tx) {
+        const uint8_t *block = row + tx * step;
+        uint32_t sum = 0;
+        for (int x = 0; x < step; ++x) sum += block[x];
+        sums[tx] += sum;
+      }
+    }
+    uint32_t count = rows * step;
+    uint8_t *dst = thumbnail->data() + static_cast<size_t>(ty) * thumb_w;
+    for (int tx = 0; tx < thumb_w; ++tx) dst[tx] = (sums[tx] + count / 2) / count;
+  }
+  *thumbnail_height = thumb_h;
+}
+
+float AdaptiveInterval::MeanAbsDiff(const uint8_t *a, const uint8_t *b, size_t size) {
+  if (!size) return 0.f;
+  uint64_t sad = 0;
+  for (size_t i = 0; i < size; ++i) sad += std::abs(static_cast<int>(a[i]) - static_cast<int>(b[i]));
+  return static_cast<float>(sad) / size;
+}
+
+bool AdaptiveInterval::ShouldInfer(const std::string &stream_id, const uint8_t *luma, int width, int height,
+                                   int stride) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  StreamState &state = GetState(stream_id);
+  ++state.stats.frames;
+  ++state.frames_since_infer;
+
+  float score = params_.motion_threshold;
+  bool has_thumbnail = false;
+  if (luma && width > 0 && height > 0) {
+    int thumbnail_height = 0;
+    MakeThumbnail(luma, width, height, stride, params_.thumbnail_width, &state.thumbnail, &thumbnail_height);
+    // compares with the frame inferred last, so that slow motion is accumulated
+    if (thumbnail_height == state.thumbnail_height && state.thumbnail.size() == state.ref_thumbnail.size()) {
+      score = MeanAbsDiff(state.thumbnail.data(), state.ref_thumbnail.data(), state.thumbnail.size());
+    }
+    state.thumbnail_height = thumbnail_height;
+    has_thumbnail = true;
+  }
+  if (score >= params_.motion_threshold) state.interval = state.min_interval;
+  state.max_score_since_infer = std::max(state.max_score_since_infer, score);
+
+  if (state.frames_since_infer < state.interval) return false;
+
+  // backs off after each inference of a static scene, holds the interval on small changes
+  if (state.max_score_since_infer < params_.static_threshold) {
+    state.interval = std::min(state.interval * 2, state.max_interval);
+  }
+  state.frames_since_infer = 0;
+  state.max_score_since_infer = 0;
+  if (has_thumbnail) state.thumbnail.swap(state.ref_thumbnail);
+  ++state.stats.inferred;
+  return true;
+}
+
+void AdaptiveInterval::OnResult(const std::string &stream_id, uint32_t object_num) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  auto iter = states_.find(stream_id);
+  if (iter == states_.end()) return;
+  StreamState &state = iter->second;
+  if (object_num > state.object_num) state.interval = state.min_interval;
+  state.object_num = object_num;
+}
+
+AdaptiveInterval::Stats AdaptiveInterval::GetStats(const std::string &stream_id) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  auto iter = states_.find(stream_id);
+  if (iter == states_.end()) return Stats();
+  Stats stats = iter->second.stats;
+  stats.interval = iter->second.interval;
+  return stats;
+}
+
+void AdaptiveInterval::RemoveStream(const std::string &stream_id) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  states_.erase(stream_id);
+}
+
+}  // namespace cnstream
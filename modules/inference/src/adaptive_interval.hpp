@@ -0,0 +1,111 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_INFERENCE_ADAPTIVE_INTERVAL_HPP_
+#define MODULES_INFERENCE_ADAPTIVE_INTERVAL_HPP_
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace cnstream {
+
+/**
+ * AdaptiveInterval decides which frames of each stream are inferred, as a replacement of the fixed interval.
+ *
+ * The luma plane of each frame is reduced to a thumbnail by block averaging, and the mean absolute difference
+ * between the thumbnails of the frame and the frame inferred last is the motion score. Motion above the threshold,
+ * or an increase of the number of objects detected, drops the interval to its minimum. Each inference made on a
+ * static scene since the previous one doubles the interval, up to its maximum, and small changes hold it.
+ */
+class AdaptiveInterval {
+ public:
+  struct Params {
+    uint32_t min_interval = 1;
+    uint32_t max_interval = 8;
+    float motion_threshold = 2.f;    // mean absolute difference of the thumbnails regarded as motion, in luma levels
+    float static_threshold = 0.5f;   // mean absolute difference of the thumbnails regarded as static
+    uint32_t thumbnail_width = 64;
+  };
+
+  struct Stats {
+    uint64_t frames = 0;
+    uint64_t inferred = 0;
+    uint32_t interval = 1;
+  };
+
+  explicit AdaptiveInterval(const Params &params);
+
+  // Overrides the bounds of the interval of a stream.
+  void SetStreamBounds(const std::string &stream_id, uint32_t min_interval, uint32_t max_interval);
+
+  /**
+   * @brief Decides whether a frame should be inferred.
+   *
+   * @param stream_id The stream the frame belongs to.
+   * @param luma The luma plane of the frame, nullptr if not available, then the motion is unknown and treated as high.
+   * @param width The width of the frame.
+   * @param height The height of the frame.
+   * @param stride The stride of the luma plane.
+   *
+   * @return Returns true if the frame should be inferred.
+   */
+  bool ShouldInfer(const std::string &stream_id, const uint8_t *luma, int width, int height, int stride);
+
+  // Reports the number of objects detected in the last frame inferred of a stream.
+  void OnResult(const std::string &stream_id, uint32_t object_num);
+
+  Stats GetStats(const std::string &stream_id);
+
+  void RemoveStream(const std::string &stream_id);
+
+  // Exposed for tests.
+  static void MakeThumbnail(const uint8_t *luma, int width, int height, int stride, uint32_t thumbnail_width,
+                            std::vector<uint8_t> *thumbnail, int *thumbnail_height);
+  static float MeanAbsDiff(const uint8_t *a, const uint8_t *b, size_t size);
+
+ private:
+  struct StreamState {
+    uint32_t min_interval;
+    uint32_t max_interval;
+    uint32_t interval;
+    uint32_t frames_since_infer = 0;
+    float max_score_since_infer = 0;
+    uint32_t object_num = 0;
+    std::vector<uint8_t> thumbnail;
+    std::vector<uint8_t> ref_thumbnail;
+    int thumbnail_height = 0;
+    Stats stats;
+  };
+
+  StreamState &GetState(const std::string &stream_id);
+
+  Params params_;
+  std::mutex mutex_;
+  std::unordered_map<std::string, StreamState> states_;
+  std::unordered_map<std::string, std::pair<uint32_t, uint32_t>> bounds_;
+};  // class AdaptiveInterval
+
+}  // namespace cnstream
+
+#endif  // MODULES_INFERENCE_ADAPTIVE_INTERVAL_HPP_
@@ -0,0 +1,179 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "infer_backend.hpp"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cnrt.h"
+#include "cnstream_logging.hpp"
+
+namespace cnstream {
+
+class InferObserver : public infer_server::Observer {
+ public:
+  explicit InferObserver(std::function<void(const CNFrameInfoPtr)> callback) : callback_(callback) {}
+  void Response(infer_server::Status status, infer_server::PackagePtr result,
+                infer_server::any user_data) noexcept override {
+    callback_(infer_server::any_cast<const CNFrameInfoPtr>(user_data));
+  }
+ private:
+  std::function<void(const CNFrameInfoPtr)> callback_;
+};
+
+InferRequestBatcher::Params GetBatcherParams(const InferParams &params, uint32_t batch_size) {
+  InferRequestBatcher::Params batcher_params;
+  if (params.scheduler == "deadline") {
+    batcher_params.policy = InferRequestBatcher::Policy::DEADLINE;
+  } else if (params.batch_strategy == InferBatchStrategy::STATIC && !params.roi_batching) {
+    batcher_params.policy = InferRequestBatcher::Policy::STATIC;
+  } else {
+    batcher_params.policy = InferRequestBatcher::Policy::DYNAMIC;
+  }
+  batcher_params.batch_size = batch_size;
+  batcher_params.batch_timeout = params.batch_timeout;
+  batcher_params.engine_num = params.engine_num;
+  return batcher_params;
+}
+
+void PrintBatcherStats(const std::string &name, const InferRequestBatcher::Stats &stats) {
+  LOGI(Inferencer) << "[" << name << "] " << stats.batches << " batches, " << stats.items << " items, fill ratio "
+                   << stats.FillRatio() << ", " << stats.full_batches << " full batches, queueing delay avg "
+                   << stats.AverageQueueMs() << " ms max " << stats.max_queue_ms << " ms, " << stats.late_items
+                   << " items late, " << stats.discarded_items << " items discarded.";
+}
+
+/**
+ * With the deadline scheduler or roi_batching, batches are formed by InferBatcher and sent to a sync session of
+ * infer_server with STATIC strategy, so that infer_server runs them as they are.
+ */
+class InferServerBackend : public InferBackend {
+ public:
+  ~InferServerBackend() { Close(); }
+
+  bool Open(const InferBackendDesc &desc) override {
+    desc_ = desc;
+    const InferParams &params = desc.params;
+    cnrtSetDevice(params.device_id);
+    server_.reset(new infer_server::InferServer(params.device_id));
+
+    infer_server::SessionDesc session_desc;
+    session_desc.name = desc.name;
+    session_desc.strategy = params.batch_strategy;
+    session_desc.batch_timeout = params.batch_timeout;
+    session_desc.priority = params.priority;
+    session_desc.engine_num = params.engine_num;
+    session_desc.show_perf = params.show_stats;
+    session_desc.model = server_->LoadModel(params.model_path);
+    if (!session_desc.model) {
+      LOGE(Inferencer) << "[" << desc.name << "] Load model failed: " << params.model_path;
+      return false;
+    }
+    session_desc.model_input_format = params.input_format;
+    session_desc.preproc = infer_server::Preprocessor::Create();
+    infer_server::SetPreprocHandler(session_desc.model->GetKey(), desc.preproc);
+    session_desc.postproc = infer_server::Postprocessor::Create();
+    infer_server::SetPostprocHandler(session_desc.model->GetKey(), desc.postproc);
+
+    if (params.scheduler != "deadline" && !params.roi_batching) {
+      observer_ = std::make_shared<InferObserver>(desc.callback);
+      session_ = server_->CreateSession(session_desc, observer_);
+      return session_ != nullptr;
+    }
+
+    session_desc.strategy = InferBatchStrategy::STATIC;
+    session_ = server_->CreateSyncSession(session_desc);
+    if (!session_) return false;
+    batcher_.reset(new InferRequestBatcher(
+        GetBatcherParams(params, session_desc.model->BatchSize()),
+        std::bind(&InferServerBackend::Process, this, std::placeholders::_1),
+        [this](const InferRequestBatcher::TaskPtr &task) { desc_.callback(task->payload.second); }));
+    batcher_->Start();
+    return true;
+  }
+
+  void Close() override {
+    if (batcher_) {
+      batcher_->Stop();
+      if (desc_.params.show_stats) PrintBatcherStats(desc_.name, batcher_->GetStats());
+      batcher_.reset();
+    }
+    if (server_ && session_) {
+      infer_server::RemovePreprocHandler(server_->GetModel(session_)->GetKey());
+      infer_server::RemovePostprocHandler(server_->GetModel(session_)->GetKey());
+      server_->DestroySession(session_);
+      session_ = nullptr;
+    }
+    server_.reset();
+  }
+
+  bool Request(infer_server::PackagePtr pack, const CNFrameInfoPtr &data) override {
+    if (batcher_) {
+      uint32_t size = pack->data.size();
+      return batcher_->Submit(pack->tag, std::make_pair(pack, data), size, desc_.GetPriority(pack->tag));
+    }
+    return server_->Request(session_, pack, data, -1);
+  }
+
+  void DiscardTask(const std::string &tag) override {
+    if (batcher_) {
+      batcher_->Discard(tag);
+    } else {
+      server_->DiscardTask(session_, tag);
+    }
+  }
+
+  void WaitTaskDone(const std::string &tag) override {
+    if (batcher_) {
+      batcher_->WaitTaskDone(tag);
+    } else {
+      server_->WaitTaskDone(session_, tag);
+    }
+  }
+
+ private:
+  void Process(const std::vector<InferRequestBatcher::Item> &batch) {
+    infer_server::PackagePtr input = std::make_shared<infer_server::Package>();
+    input->tag = batch[0].task->tag;
+    for (auto &item : batch) input->data.push_back(item.task->payload.first->data[item.index]);
+    infer_server::PackagePtr output = std::make_shared<infer_server::Package>();
+    infer_server::Status status = infer_server::Status::SUCCESS;
+    if (!server_->RequestSync(session_, input, &status, output, -1) || status != infer_server::Status::SUCCESS) {
+      LOGE(Inferencer) << "[" << desc_.name << "] Inference failed, status: " << static_cast<int>(status);
+    }
+  }
+
+  InferBackendDesc desc_;
+  std::unique_ptr<InferRequestBatcher> batcher_ = nullptr;
+  std::unique_ptr<infer_server::InferServer> server_ = nullptr;
+  infer_server::Session_t session_ = nullptr;
+  std::shared_ptr<InferObserver> observer_ = nullptr;
+};  // class InferServerBackend
+
+InferBackend *InferBackend::Create(const std::string &name) {
+  if (name.empty() || name == "infer_server") return new (std::nothrow) InferServerBackend;
+  if (name == "cpu_mock") return CreateCpuMockBackend();
+  return nullptr;
+}
+
+}  // namespace cnstream
@@ -0,0 +1,99 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_INFERENCE_INFER_BACKEND_HPP_
+#define MODULES_INFERENCE_INFER_BACKEND_HPP_
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "cnis/infer_server.h"
+#include "cnis/processor.h"
+
+#include "cnstream_frame.hpp"
+#include "infer_batcher.hpp"
+#include "inferencer.hpp"
+
+namespace cnstream {
+
+/**
+ * @brief The description of an inference backend.
+ */
+struct InferBackendDesc {
+  std::string name;                                      /*!< The name of the module, used in logs. */
+  InferParams params;                                    /*!< The parameters of the module. */
+  infer_server::IPreproc *preproc = nullptr;             /*!< Called to preprocess the data of each batch. */
+  infer_server::IPostproc *postproc = nullptr;           /*!< Called to postprocess the outputs of each batch. */
+  std::function<void(const CNFrameInfoPtr)> callback;    /*!< Called once for each request, in request order. */
+  std::unordered_map<std::string, int> stream_priority;  /*!< The stream priorities of the deadline scheduler. */
+  int default_priority = 0;                              /*!< The priority of the streams not listed. */
+
+  int GetPriority(const std::string &stream_id) const {
+    auto iter = stream_priority.find(stream_id);
+    return iter == stream_priority.end() ? default_priority : iter->second;
+  }
+};
+
+using InferRequestBatcher = InferBatcher<std::pair<infer_server::PackagePtr, CNFrameInfoPtr>>;
+
+/**
+ * @brief Gets the parameters of the batcher used by the backends as the parameters of the module.
+ */
+InferRequestBatcher::Params GetBatcherParams(const InferParams &params, uint32_t batch_size);
+
+/**
+ * @brief Logs the batching statistics.
+ */
+void PrintBatcherStats(const std::string &name, const InferRequestBatcher::Stats &stats);
+
+/**
+ * @brief InferBackend runs the requests of Inferencer.
+ *
+ * "infer_server" runs the offline model on MLU by infer_server. "cpu_mock" emits synthetic outputs at a configurable
+ * latency on the host, with the same batching semantics, so that the pipeline could be run and benchmarked without
+ * MLU. See InferParams::backend_params for its parameters.
+ */
+class InferBackend {
+ public:
+  virtual ~InferBackend() = default;
+  /**
+   * @brief Creates a backend by name.
+   *
+   * @return Returns the backend, or nullptr if the name is unknown.
+   */
+  static InferBackend *Create(const std::string &name);
+
+  virtual bool Open(const InferBackendDesc &desc) = 0;
+  virtual void Close() = 0;
+  /**
+   * @brief Sends a request. A request with no data is responded in order without being inferred.
+   */
+  virtual bool Request(infer_server::PackagePtr pack, const CNFrameInfoPtr &data) = 0;
+  virtual void DiscardTask(const std::string &tag) = 0;
+  virtual void WaitTaskDone(const std::string &tag) = 0;
+};  // class InferBackend
+
+InferBackend *CreateCpuMockBackend();
+
+}  // namespace cnstream
+
+#endif  // MODULES_INFERENCE_INFER_BACKEND_HPP_
@@ -0,0 +1,375 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "rapidjson/document.h"
+
+#include "cnstream_frame_va.hpp"
+#include "cnstream_logging.hpp"
+#include "infer_backend.hpp"
+#include "tensor_buffer_pool.hpp"
+
+namespace cnstream {
+
+namespace {
+
+class MockModelInfo : public infer_server::ModelInfo {
+ public:
+  const infer_server::Shape &InputShape(int index) const noexcept override { return input_shape_; }
+  const infer_server::Shape &OutputShape(int index) const noexcept override { return output_shapes_[index]; }
+  const infer_server::DataLayout &InputLayout(int index) const noexcept override { return input_layout_; }
+  const infer_server::DataLayout &OutputLayout(int index) const noexcept override { return output_layout_; }
+  uint32_t InputNum() const noexcept override { return 1; }
+  uint32_t OutputNum() const noexcept override { return output_shapes_.size(); }
+  uint32_t BatchSize() const noexcept override { return batch_size_; }
+  bool FixedOutputShape() noexcept override { return true; }
+  std::string GetKey() const noexcept override { return "cpu_mock"; }
+
+  uint32_t batch_size_ = 4;
+  infer_server::Shape input_shape_;
+  infer_server::DataLayout input_layout_;
+  infer_server::DataLayout output_layout_;
+  std::vector<infer_server::Shape> output_shapes_;
+};  // class MockModelInfo
+
+bool ParseShape(const rapidjson::Value &value, uint32_t batch_size, infer_server::Shape *shape) {
+  if (!value.IsArray() || value.Empty()) return false;
+  std::vector<int64_t> dims{batch_size};
+  for (auto &dim : value.GetArray()) {
+    if (!dim.IsInt() || dim.GetInt() <= 0) return false;
+    dims.push_back(dim.GetInt());
+  }
+  *shape = infer_server::Shape(dims);
+  return true;
+}
+
+}  // namespace
+
+/**
+ * CpuMockBackend runs the preprocessing and the postprocessing of Inferencer on the host, and replaces the inference
+ * by a sleep of latency_ms + item_latency_ms * batch size. The outputs are zero-filled, except that `objects`
+ * synthetic boxes are written if the outputs are the detection output, [batch_idx, label, score, l, t, r, b] records
+ * and the number of records.
+ *
+ * The input and output tensors are contiguous batch arenas borrowed from a pool of the backend, reserved on Open, so
+ * that they are not allocated for each batch.
+ */
+class CpuMockBackend : public InferBackend {
+  using Batcher = InferRequestBatcher;
+
+ public:
+  ~CpuMockBackend() { Close(); }
+
+  bool Open(const InferBackendDesc &desc) override {
+    desc_ = desc;
+    if (!ParseParams(desc.params.backend_params)) return false;
+
+    infer_server::CnPreprocTensorParams tensor_params;
+    tensor_params.input_order = model_.input_layout_.order;
+    tensor_params.input_shape = model_.input_shape_;
+    tensor_params.input_dtype = model_.input_layout_.dtype;
+    tensor_params.input_format = desc.params.input_format;
+    if (desc.preproc->OnTensorParams(&tensor_params) != 0) {
+      LOGE(Inferencer) << "[" << desc.name << "] cpu_mock: OnTensorParams failed.";
+      return false;
+    }
+
+    TensorBufferPool::Params pool_params;
+    pool_params.hugepage = hugepage_;
+    pool_.SetParams(pool_params);
+    // the inputs and outputs of the batch processed and the batch postprocessed
+    pool_.Reserve(InputItemSize() * model_.batch_size_, 2);
+    for (auto &shape : model_.output_shapes_) pool_.Reserve(shape.DataCount() * sizeof(float), 2);
+
+    batcher_.reset(new Batcher(GetBatcherParams(desc.params, model_.batch_size_),
+                               std::bind(&CpuMockBackend::Process, this, std::placeholders::_1),
+                               [this](const Batcher::TaskPtr &task) { desc_.callback(task->payload.second); }));
+    batcher_->Start();
+    return true;
+  }
+
+  void Close() override {
+    if (!batcher_) return;
+    batcher_->Stop();
+    if (desc_.params.show_stats) PrintBatcherStats(desc_.name, batcher_->GetStats());
+    batcher_.reset();
+  }
+
+  bool Request(infer_server::PackagePtr pack, const CNFrameInfoPtr &data) override {
+    uint32_t size = pack->data.size();
+    return batcher_->Submit(pack->tag, std::make_pair(pack, data), size, desc_.GetPriority(pack->tag));
+  }
+
+  void DiscardTask(const std::string &tag) override { batcher_->Discard(tag); }
+
+  void WaitTaskDone(const std::string &tag) override { batcher_->WaitTaskDone(tag); }
+
+ private:
+  bool ParseParams(const std::unordered_map<std::string, std::string> &params) {
+    rapidjson::Document doc;
+    auto parse = [&](const std::string &key) -> const rapidjson::Value * {
+      auto iter = params.find(key);
+      if (iter == params.end()) return nullptr;
+      if (doc.Parse(iter->second.c_str()).HasParseError()) {
+        LOGE(Inferencer) << "[" << desc_.name << "] cpu_mock: parse " << key << " failed: " << iter->second;
+        return nullptr;
+      }
+      return &doc;
+    };
+    auto get_number = [&](const std::string &key, double *value) -> bool {
+      if (!params.count(key)) return true;
+      const rapidjson::Value *v = parse(key);
+      if (!v || !v->IsNumber() || v->GetDouble() < 0) return false;
+      *value = v->GetDouble();
+      return true;
+    };
+
+    double batch_size = 4, objects = 0;
+    if (!get_number("batch_size", &batch_size) || batch_size < 1 || !get_number("latency_ms", &latency_ms_) ||
+        !get_number("item_latency_ms", &item_latency_ms_) || !get_number("objects", &objects)) {
+      LOGE(Inferencer) << "[" << desc_.name << "] cpu_mock: batch_size, latency_ms, item_latency_ms and objects "
+                       << "must be non-negative numbers, and batch_size must be positive.";
+      return false;
+    }
+    model_.batch_size_ = static_cast<uint32_t>(batch_size);
+    objects_ = static_cast<int>(objects);
+    hugepage_ = params.count("hugepage") && params.at("hugepage") == "true";
+
+    auto dtype = params.count("input_dtype") ? params.at("input_dtype") : "UINT8";
+    if (dtype == "UINT8") {
+      model_.input_layout_.dtype = infer_server::DataType::UINT8;
+    } else if (dtype == "FLOAT32") {
+      model_.input_layout_.dtype = infer_server::DataType::FLOAT32;
+    } else {
+      LOGE(Inferencer) << "[" << desc_.name << "] cpu_mock: unsupported input_dtype " << dtype;
+      return false;
+    }
+    auto order = params.count("input_order") ? params.at("input_order") : "NHWC";
+    if (order == "NHWC") {
+      model_.input_layout_.order = infer_server::DimOrder::NHWC;
+    } else if (order == "NCHW") {
+      model_.input_layout_.order = infer_server::DimOrder::NCHW;
+    } else {
+      LOGE(Inferencer) << "[" << desc_.name << "] cpu_mock: unsupported input_order " << order;
+      return false;
+    }
+    model_.output_layout_.dtype = infer_server::DataType::FLOAT32;
+    model_.output_layout_.order = infer_server::DimOrder::NHWC;
+
+    // [h, w, c] or [c, h, w] as input_order, without the batch dimension
+    const rapidjson::Value *v = nullptr;
+    if (params.count("input_shape") && !(v = parse("input_shape"))) return false;
+    if (!v) {
+      doc.Parse(order == "NHWC" ? "[640, 640, 3]" : "[3, 640, 640]");
+      v = &doc;
+    }
+    if (!ParseShape(*v, model_.batch_size_, &model_.input_shape_) || model_.input_shape_.Size() != 4) {
+      LOGE(Inferencer) << "[" << desc_.name << "] cpu_mock: input_shape must be 3 positive dims.";
+      return false;
+    }
+
+    // default as the detection output, [max_boxes, 7] records and the number of records
+    v = nullptr;
+    if (params.count("output_shapes") && !(v = parse("output_shapes"))) return false;
+    if (!v) {
+      doc.Parse("[[1024, 7], [1]]");
+      v = &doc;
+    }
+    model_.output_shapes_.clear();
+    if (v->IsArray()) {
+      for (auto &shape_value : v->GetArray()) {
+        infer_server::Shape shape;
+        if (!ParseShape(shape_value, model_.batch_size_, &shape)) break;
+        model_.output_shapes_.push_back(shape);
+      }
+    }
+    if (model_.output_shapes_.empty() || model_.output_shapes_.size() != v->Size()) {
+      LOGE(Inferencer) << "[" << desc_.name << "] cpu_mock: output_shapes must be an array of shapes.";
+      return false;
+    }
+    const infer_server::Shape &records = model_.output_shapes_[0];
+    write_objects_ = objects_ > 0 && model_.output_shapes_.size() >= 2 && records.Size() == 3 && records[2] == 7;
+    if (objects_ > 0 && !write_objects_) {
+      LOGW(Inferencer) << "[" << desc_.name << "] cpu_mock: outputs are not the detection output, objects ignored.";
+    }
+    objects_ = std::min<int64_t>(objects_, records[1]);
+    return true;
+  }
+
+  // A batch tensor on the host, the arena is returned to the pool with the wrapper.
+  struct HostTensor {
+    TensorArena arena;
+    std::vector<CnedkBufSurfaceParams> surface_params;
+    CnedkBufSurface surf;
+    std::unique_ptr<cnedk::BufSurfaceWrapper> wrapper;
+  };
+
+  cnedk::BufSurfWrapperPtr CreateTensor(uint32_t c, uint32_t h, uint32_t w, size_t elem_size,
+                                        TensorArena::Layout layout) {
+    std::shared_ptr<HostTensor> tensor = std::make_shared<HostTensor>();
+    tensor->arena = TensorArena(model_.batch_size_, c, h, w, elem_size, layout, &pool_);
+    if (!tensor->arena.Valid()) return nullptr;
+    tensor->surface_params.resize(model_.batch_size_);
+    for (uint32_t i = 0; i < model_.batch_size_; ++i) {
+      CnedkBufSurfaceParams &params = tensor->surface_params[i];
+      memset(&params, 0, sizeof(params));
+      params.color_format = CNEDK_BUF_COLOR_FORMAT_TENSOR;
+      params.data_size = tensor->arena.ItemSize();
+      params.data_ptr = tensor->arena.Item(i);
+    }
+    memset(&tensor->surf, 0, sizeof(tensor->surf));
+    tensor->surf.mem_type = CNEDK_BUF_MEM_SYSTEM;
+    tensor->surf.device_id = desc_.params.device_id;
+    tensor->surf.batch_size = model_.batch_size_;
+    tensor->surf.num_filled = model_.batch_size_;
+    tensor->surf.surface_list = tensor->surface_params.data();
+    tensor->wrapper.reset(new cnedk::BufSurfaceWrapper(&tensor->surf, false));
+    return cnedk::BufSurfWrapperPtr(tensor, tensor->wrapper.get());
+  }
+
+  static size_t DataTypeSize(infer_server::DataType dtype) {
+    return dtype == infer_server::DataType::FLOAT32 ? sizeof(float) : sizeof(uint8_t);
+  }
+
+  size_t InputItemSize() const {
+    return model_.input_shape_.DataCount() / model_.batch_size_ * DataTypeSize(model_.input_layout_.dtype);
+  }
+
+  void WriteObjects(float *records, int *num, int batch_idx, uint64_t frame_id) {
+    const infer_server::Shape &shape = model_.input_shape_;
+    bool nhwc = model_.input_layout_.order == infer_server::DimOrder::NHWC;
+    float w = nhwc ? shape[2] : shape[3];
+    float h = nhwc ? shape[1] : shape[2];
+    // boxes on a grid, moving right slowly to be tracked
+    int cols = std::max(1, static_cast<int>(std::ceil(std::sqrt(objects_))));
+    float cell_w = w / cols, cell_h = h / cols;
+    float shift = (frame_id % 64) / 64.f * cell_w * 0.25f;
+    for (int i = 0; i < objects_; ++i) {
+      float *record = records + i * 7;
+      record[0] = batch_idx;
+      record[1] = i % 80;
+      record[2] = 0.9f;
+      record[3] = (i % cols) * cell_w + cell_w * 0.1f + shift;
+      record[4] = (i / cols) * cell_h + cell_h * 0.1f;
+      record[5] = record[3] + cell_w * 0.6f;
+      record[6] = record[4] + cell_h * 0.8f;
+    }
+    *num = objects_;
+  }
+
+  void Process(const std::vector<Batcher::Item> &batch) {
+    auto start = std::chrono::steady_clock::now();
+    uint32_t n = batch.size();
+    std::vector<infer_server::InferData *> data_vec(n);
+    std::vector<CnedkBufSurfaceParams> surface_params(n);
+    std::vector<CnedkTransformRect> rects;
+    CnedkBufSurface src_surf;
+    memset(&src_surf, 0, sizeof(src_surf));
+    for (uint32_t i = 0; i < n; ++i) {
+      data_vec[i] = batch[i].task->payload.first->data[batch[i].index].get();
+      infer_server::PreprocInput input = data_vec[i]->Get<infer_server::PreprocInput>();
+      CnedkBufSurface *surf = input.surf->GetBufSurface();
+      surface_params[i] = surf->surface_list[0];
+      src_surf.mem_type = surf->mem_type;
+      src_surf.device_id = surf->device_id;
+      if (input.has_bbox) {
+        rects.resize(n);
+        CnedkTransformRect &rect = rects[i];
+        rect.left = input.bbox.x * surface_params[i].width;
+        rect.top = input.bbox.y * surface_params[i].height;
+        rect.width = input.bbox.w * surface_params[i].width;
+        rect.height = input.bbox.h * surface_params[i].height;
+      }
+    }
+    // frames without bbox are preprocessed entirely if others have
+    for (uint32_t i = 0; i < rects.size(); ++i) {
+      if (rects[i].width && rects[i].height) continue;
+      rects[i].left = rects[i].top = 0;
+      rects[i].width = surface_params[i].width;
+      rects[i].height = surface_params[i].height;
+    }
+    src_surf.surface_list = surface_params.data();
+    src_surf.batch_size = n;
+    src_surf.num_filled = n;
+    auto src = std::make_shared<cnedk::BufSurfaceWrapper>(&src_surf, false);
+
+    const infer_server::Shape &shape = model_.input_shape_;
+    bool nhwc = model_.input_layout_.order == infer_server::DimOrder::NHWC;
+    auto input = nhwc ? CreateTensor(shape[3], shape[1], shape[2], DataTypeSize(model_.input_layout_.dtype),
+                                     TensorArena::Layout::NHWC)
+                      : CreateTensor(shape[1], shape[2], shape[3], DataTypeSize(model_.input_layout_.dtype),
+                                     TensorArena::Layout::NCHW);
+    if (!input || desc_.preproc->OnPreproc(src, input, rects) != 0) {
+      LOGE(Inferencer) << "[" << desc_.name << "] cpu_mock: preprocessing failed.";
+      return;
+    }
+
+    infer_server::ModelIO outputs;
+    for (auto &output_shape : model_.output_shapes_) {
+      size_t count = output_shape.DataCount() / model_.batch_size_;
+      auto output = CreateTensor(1, 1, count, sizeof(float), TensorArena::Layout::NCHW);
+      if (!output) {
+        LOGE(Inferencer) << "[" << desc_.name << "] cpu_mock: create output failed.";
+        return;
+      }
+      for (uint32_t i = 0; i < n; ++i) memset(output->GetHostData(0, i), 0, count * sizeof(float));
+      outputs.surfs.push_back(output);
+      outputs.shapes.push_back(output_shape);
+    }
+    if (write_objects_) {
+      for (uint32_t i = 0; i < n; ++i) {
+        auto frame = batch[i].task->payload.second->collection.Get<CNDataFramePtr>(kCNDataFrameTag);
+        WriteObjects(static_cast<float *>(outputs.surfs[0]->GetHostData(0, i)),
+                     static_cast<int *>(outputs.surfs[1]->GetHostData(0, i)), i, frame->frame_id);
+      }
+    }
+
+    double latency_ms = latency_ms_ + item_latency_ms_ * n;
+    std::this_thread::sleep_until(start + std::chrono::microseconds(static_cast<int64_t>(latency_ms * 1e3)));
+
+    if (desc_.postproc->OnPostproc(data_vec, outputs, &model_) != 0) {
+      LOGE(Inferencer) << "[" << desc_.name << "] cpu_mock: postprocessing failed.";
+    }
+  }
+
+  InferBackendDesc desc_;
+  MockModelInfo model_;
+  double latency_ms_ = 10;
+  double item_latency_ms_ = 0;
+  int objects_ = 0;
+  bool write_objects_ = false;
+  bool hugepage_ = false;
+  TensorBufferPool pool_;
+  std::unique_ptr<Batcher> batcher_ = nullptr;
+};  // class CpuMockBackend
+
+InferBackend *CreateCpuMockBackend() { return new (std::nothrow) CpuMockBackend; }
+
+}  // namespace cnstream
@@ -0,0 +1,390 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_INFERENCE_INFER_BATCHER_HPP_
+#define MODULES_INFERENCE_INFER_BATCHER_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace cnstream {
+
+/**
+ * InferBatcher batches the data of requests the same way as infer_server does, so that backends other than
+ * infer_server share its semantics:
+ *
+ * - STATIC: each request is split into batches by itself, batches never wait.
+ * - DYNAMIC: data of different requests are merged, a batch is sent when it is full or batch_timeout after its
+ *   first data arrived.
+ * - DEADLINE: data of different requests are merged, each data must be processed within batch_timeout after it
+ *   arrived. A batch is sent when it is full, or when its oldest data can not wait any longer considering the
+ *   observed processing time. It is sent early if the observed arrival rate can not bring more data before that.
+ *   Data of requests with higher priority are batched first.
+ * - engine_num: the number of batches processed concurrently.
+ *
+ * Requests are responded in the order they are submitted. Requests with no data are responded in order too.
+ */
+template <typename T>
+class InferBatcher {
+ public:
+  enum class Policy { STATIC, DYNAMIC, DEADLINE };
+
+  struct Params {
+    Policy policy = Policy::DYNAMIC;
+    uint32_t batch_size = 1;
+    uint32_t batch_timeout = 300;  // ms
+    uint32_t engine_num = 1;
+  };
+
+  struct Task {
+    std::string tag;
+    T payload;
+    uint32_t size = 0;
+    int priority = 0;
+    std::chrono::steady_clock::time_point arrival;
+    std::atomic<uint32_t> done{0};
+    std::atomic<bool> discarded{false};
+  };
+  using TaskPtr = std::shared_ptr<Task>;
+
+  struct Item {
+    TaskPtr task;
+    uint32_t index;
+  };
+
+  struct Stats {
+    uint64_t batches = 0;
+    uint64_t items = 0;
+    uint64_t full_batches = 0;
+    uint64_t discarded_items = 0;
+    uint64_t late_items = 0;       // items batched later than batch_timeout after they arrived
+    double total_queue_ms = 0;     // the sum of the time items waited to be batched
+    double max_queue_ms = 0;
+    uint32_t batch_size = 1;
+
+    double FillRatio() const { return batches ? static_cast<double>(items) / (batches * batch_size) : 0; }
+    double AverageQueueMs() const { return items ? total_queue_ms / items : 0; }
+  };
+
+  // Processes a batch, called by engine threads.
+  using ProcessFunc = std::function<void(const std::vector<Item> &)>;
+  // Called once for each request, in submission order.
+  using ResponseFunc = std::function<void(const TaskPtr &)>;
+
+  InferBatcher(const Params &params, ProcessFunc process, ResponseFunc response)
+      : params_(params), process_(std::move(process)), response_(std::move(response)) {
+    params_.batch_size = std::max(params_.batch_size, 1u);
+    params_.engine_num = std::max(params_.engine_num, 1u);
+    stats_.batch_size = params_.batch_size;
+  }
+  ~InferBatcher() { Stop(); }
+
+  void Start() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (running_) return;
+    running_ = true;
+    batcher_ = std::thread(&InferBatcher::BatchLoop, this);
+    for (uint32_t i = 0; i < params_.engine_num; ++i) engines_.emplace_back(&InferBatcher::EngineLoop, this);
+  }
+
+  // Processes all the data submitted, then stops the threads.
+  void Stop() {
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      if (!running_) return;
+      running_ = false;
+    }
+    pending_cond_.notify_all();
+    if (batcher_.joinable()) batcher_.join();
+    batch_cond_.notify_all();
+    for (auto &engine : engines_) engine.join();
+    engines_.clear();
+  }
+
+  // Data of requests with higher priority are batched first by the DEADLINE policy.
+  bool Submit(const std::string &tag, T payload, uint32_t size, int priority = 0) {
+    TaskPtr task = std::make_shared<Task>();
+    task->tag = tag;
+    task->payload = std::move(payload);
+    task->size = size;
+    task->priority = priority;
+    task->arrival = std::chrono::steady_clock::now();
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      if (!running_) return false;
+      std::lock_guard<std::mutex> order_lk(order_mutex_);
+      order_.push_back(task);
+    }
+    if (!size) {
+      Respond();
+      return true;
+    }
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      for (uint32_t i = 0; i < size; ++i) pending_.push_back({task, i});
+      if (pending_.size() == size) first_arrival_ = task->arrival;
+      // the interval between the arrivals of data
+      if (last_arrival_ != std::chrono::steady_clock::time_point()) {
+        double interval = std::chrono::duration<double, std::milli>(task->arrival - last_arrival_).count() / size;
+        interval_ms_ = interval_ms_ < 0 ? interval : interval_ms_ * 0.9 + interval * 0.1;
+      }
+      last_arrival_ = task->arrival;
+    }
+    pending_cond_.notify_one();
+    return true;
+  }
+
+  // The data of the requests with the tag not batched yet are skipped, the requests are still responded.
+  void Discard(const std::string &tag) {
+    std::lock_guard<std::mutex> lk(order_mutex_);
+    for (auto &task : order_) {
+      if (task->tag == tag) task->discarded = true;
+    }
+  }
+
+  // Waits until all the requests with the tag are responded.
+  void WaitTaskDone(const std::string &tag) {
+    std::unique_lock<std::mutex> lk(order_mutex_);
+    done_cond_.wait(lk, [&]() {
+      return std::none_of(order_.begin(), order_.end(), [&tag](const TaskPtr &task) { return task->tag == tag; });
+    });
+  }
+
+  Stats GetStats() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return stats_;
+  }
+
+ private:
+  void BatchLoop() {
+    std::unique_lock<std::mutex> lk(mutex_);
+    while (true) {
+      // drop the data discarded
+      while (!pending_.empty() && pending_.front().task->discarded) {
+        Item item = pending_.front();
+        pending_.pop_front();
+        ++stats_.discarded_items;
+        lk.unlock();
+        FinishItem(item);
+        lk.lock();
+      }
+      if (pending_.empty()) {
+        if (!running_) break;
+        pending_cond_.wait(lk);
+        continue;
+      }
+
+      std::vector<Item> batch;
+      if (params_.policy == Policy::STATIC) {
+        // only the data of the same request are batched
+        const Task *task = pending_.front().task.get();
+        while (!pending_.empty() && pending_.front().task.get() == task && batch.size() < params_.batch_size) {
+          batch.push_back(pending_.front());
+          pending_.pop_front();
+        }
+      } else if (params_.policy == Policy::DEADLINE) {
+        auto now = std::chrono::steady_clock::now();
+        if (running_ && pending_.size() < params_.batch_size) {
+          auto wake_up = DeadlineWakeUp(now);
+          if (wake_up > now) {
+            pending_cond_.wait_until(lk, wake_up);
+            continue;
+          }
+        }
+        SelectByPriority(&batch);
+      } else {
+        auto deadline = first_arrival_ + std::chrono::milliseconds(params_.batch_timeout);
+        if (running_ && pending_.size() < params_.batch_size && std::chrono::steady_clock::now() < deadline) {
+          pending_cond_.wait_until(lk, deadline);
+          continue;
+        }
+        while (!pending_.empty() && batch.size() < params_.batch_size) {
+          if (!pending_.front().task->discarded) {
+            batch.push_back(pending_.front());
+          } else {
+            ++stats_.discarded_items;
+            discarded_.push_back(pending_.front());
+          }
+          pending_.pop_front();
+        }
+        // the data left, e.g. the rest objects of a frame, do not wait another batch_timeout
+        if (!pending_.empty()) first_arrival_ = pending_.front().task->arrival;
+      }
+      if (!batch.empty()) {
+        ++stats_.batches;
+        stats_.items += batch.size();
+        if (batch.size() == params_.batch_size) ++stats_.full_batches;
+        auto now = std::chrono::steady_clock::now();
+        for (auto &item : batch) {
+          double queue_ms = std::chrono::duration<double, std::milli>(now - item.task->arrival).count();
+          stats_.total_queue_ms += queue_ms;
+          stats_.max_queue_ms = std::max(stats_.max_queue_ms, queue_ms);
+          if (queue_ms > params_.batch_timeout) ++stats_.late_items;
+        }
+        {
+          std::lock_guard<std::mutex> batch_lk(batch_mutex_);
+          batches_.push_back(std::move(batch));
+        }
+        batch_cond_.notify_one();
+      }
+      if (!discarded_.empty()) {
+        std::vector<Item> discarded;
+        discarded.swap(discarded_);
+        lk.unlock();
+        for (auto &item : discarded) FinishItem(item);
+        lk.lock();
+      }
+    }
+    lk.unlock();
+    {
+      std::lock_guard<std::mutex> batch_lk(batch_mutex_);
+      batcher_done_ = true;
+    }
+    batch_cond_.notify_all();
+  }
+
+  void EngineLoop() {
+    while (true) {
+      std::vector<Item> batch;
+      {
+        std::unique_lock<std::mutex> lk(batch_mutex_);
+        batch_cond_.wait(lk, [this]() { return !batches_.empty() || batcher_done_; });
+        if (batches_.empty()) break;
+        batch = std::move(batches_.front());
+        batches_.pop_front();
+      }
+      auto start = std::chrono::steady_clock::now();
+      process_(batch);
+      double cost = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+      {
+        std::lock_guard<std::mutex> lk(mutex_);
+        cost_ms_ = cost_ms_ < 0 ? cost : cost_ms_ * 0.8 + cost * 0.2;
+      }
+      for (auto &item : batch) FinishItem(item);
+    }
+  }
+
+  // Returns the time to send the batch in DEADLINE policy, called with mutex_ locked.
+  std::chrono::steady_clock::time_point DeadlineWakeUp(std::chrono::steady_clock::time_point now) const {
+    using ms = std::chrono::duration<double, std::milli>;
+    // the oldest data has the earliest deadline, leave time to process it and to wake up
+    constexpr double kWakeUpMs = 1;
+    auto reserved =
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(ms(std::max(cost_ms_, 0.0) + kWakeUpMs));
+    auto latest = pending_.front().task->arrival + std::chrono::milliseconds(params_.batch_timeout) - reserved;
+    if (now >= latest) return now;
+    if (interval_ms_ < 0) return latest;
+    double slack_ms = ms(latest - now).count();
+    double fill_ms = (params_.batch_size - pending_.size()) * interval_ms_;
+    // expected to be full in time, arrivals wake it up earlier
+    if (fill_ms <= slack_ms) {
+      return now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(ms(fill_ms));
+    }
+    // not full by the deadline, waits only if more data are expected
+    return interval_ms_ < slack_ms ? latest : now;
+  }
+
+  // Takes the data of the highest priority first, the oldest first of the same priority. Called with mutex_ locked.
+  void SelectByPriority(std::vector<Item> *batch) {
+    std::vector<Item> items(pending_.begin(), pending_.end());
+    pending_.clear();
+    std::stable_sort(items.begin(), items.end(),
+                     [](const Item &a, const Item &b) { return a.task->priority > b.task->priority; });
+    for (auto &item : items) {
+      if (item.task->discarded) {
+        ++stats_.discarded_items;
+        discarded_.push_back(item);
+      } else if (batch->size() < params_.batch_size) {
+        batch->push_back(item);
+      } else {
+        pending_.push_back(item);
+      }
+    }
+    // keep the arrival order for the data left
+    std::stable_sort(pending_.begin(), pending_.end(),
+                     [](const Item &a, const Item &b) { return a.task->arrival < b.task->arrival; });
+  }
+
+  void FinishItem(const Item &item) {
+    if (++item.task->done == item.task->size) Respond();
+  }
+
+  void Respond() {
+    // responses are serialized to keep them in order
+    std::lock_guard<std::mutex> respond_lk(respond_mutex_);
+    while (true) {
+      TaskPtr task;
+      {
+        std::lock_guard<std::mutex> lk(order_mutex_);
+        if (order_.empty() || order_.front()->done != order_.front()->size) break;
+        task = order_.front();
+      }
+      response_(task);
+      {
+        std::lock_guard<std::mutex> lk(order_mutex_);
+        order_.pop_front();
+      }
+      done_cond_.notify_all();
+    }
+  }
+
+  Params params_;
+  ProcessFunc process_;
+  ResponseFunc response_;
+
+  std::mutex mutex_;
+  std::condition_variable pending_cond_;
+  bool running_ = false;
+  std::deque<Item> pending_;
+  std::vector<Item> discarded_;
+  std::chrono::steady_clock::time_point first_arrival_;
+  std::chrono::steady_clock::time_point last_arrival_;
+  double interval_ms_ = -1;  // moving average of the interval between the arrivals of data, -1 if unknown
+  double cost_ms_ = -1;      // moving average of the processing time of a batch, -1 if unknown
+  Stats stats_;
+
+  std::mutex batch_mutex_;
+  std::condition_variable batch_cond_;
+  std::deque<std::vector<Item>> batches_;
+  bool batcher_done_ = false;
+
+  std::mutex order_mutex_;
+  std::condition_variable done_cond_;
+  std::list<TaskPtr> order_;
+  std::mutex respond_mutex_;
+
+  std::thread batcher_;
+  std::vector<std::thread> engines_;
+};  // class InferBatcher
+
+}  // namespace cnstream
+
+#endif  // MODULES_INFERENCE_INFER_BATCHER_HPP_
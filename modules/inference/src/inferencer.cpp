@@ -34,21 +34,68 @@
 #include "rapidjson/writer.h"
 
 
+#include "adaptive_interval.hpp"
+#include "infer_backend.hpp"
+#include "postproc_pool.hpp"
 #include "private/cnstream_param.hpp"
+#include "track_result_cache.hpp"
 
 namespace cnstream {
 
-class InferObserver : public infer_server::Observer {
- public:
-  explicit InferObserver(std::function<void(const CNFrameInfoPtr)> callback) : callback_(callback) {}
-  void Response(infer_server::Status status, infer_server::PackagePtr result,
-                infer_server::any user_data) noexcept override {
-    callback_(infer_server::any_cast<const CNFrameInfoPtr>(user_data));
-  }
- private:
-  std::function<void(const CNFrameInfoPtr)> callback_;
+static constexpr char kASYNC_POSTPROC_PROFILER_NAME[] = "ASYNC_POSTPROC";
+
+/**
+ * The results of secondary inference added to an object, cached by its track.
+ */
+struct CachedObjectResult {
+  std::vector<std::pair<std::string, CNInferAttr>> attributes;
+  StringPairs extra_attributes;
+  CNInferFeatures features;
 };
 
+// Gets the results of an object, except the ones with the keys in exclude.
+static CachedObjectResult GetObjectResult(const CNInferObjectPtr& obj, const CachedObjectResult* exclude) {
+  auto excluded = [](const std::string& key, const std::vector<std::string>& keys) {
+    return std::find(keys.begin(), keys.end(), key) != keys.end();
+  };
+  std::vector<std::string> attribute_keys, extra_attribute_keys, feature_keys;
+  if (exclude) {
+    for (auto& attribute : exclude->attributes) attribute_keys.push_back(attribute.first);
+    for (auto& attribute : exclude->extra_attributes) extra_attribute_keys.push_back(attribute.first);
+    for (auto& feature : exclude->features) feature_keys.push_back(feature.first);
+  }
+  CachedObjectResult result;
+  for (auto& attribute : obj->GetAttributes()) {
+    if (!excluded(attribute.first, attribute_keys)) result.attributes.push_back(attribute);
+  }
+  for (auto& attribute : obj->GetExtraAttributes()) {
+    if (!excluded(attribute.first, extra_attribute_keys)) result.extra_attributes.push_back(attribute);
+  }
+  for (auto& feature : obj->GetFeatures()) {
+    if (!excluded(feature.first, feature_keys)) result.features.push_back(feature);
+  }
+  return result;
+}
+
+static bool IsTracked(const CNInferObjectPtr& obj) { return !obj->track_id.empty() && obj->track_id != "-1"; }
+
+static bool ParseStreamPriority(const std::unordered_map<std::string, std::string>& params,
+                                std::unordered_map<std::string, int>* priorities, int* default_priority) {
+  auto iter = params.find("default_priority");
+  if (iter != params.end() && !ModuleParamParser<int>::Parser({}, "default_priority", iter->second, default_priority)) {
+    return false;
+  }
+  iter = params.find("stream_priority");
+  if (iter == params.end()) return true;
+  rapidjson::Document doc;
+  if (doc.Parse(iter->second.c_str()).HasParseError() || !doc.IsObject()) return false;
+  for (auto member = doc.MemberBegin(); member != doc.MemberEnd(); ++member) {
+    if (!member->value.IsInt()) return false;
+    (*priorities)[member->name.GetString()] = member->value.GetInt();
+  }
+  return true;
+}
+
 Inferencer::Inferencer(const std::string& name) : ModuleEx(name) {
   param_register_.SetModuleDesc(
       "Inferencer is a module for running offline model inference, preprocessing and "
@@ -138,6 +185,20 @@ Inferencer::Inferencer(const std::string& name) : ModuleEx(name) {
         return false;
       }
     }
+    if (params_map.find("thread_num") != params_map.end()) {
+      size_t offset = OFFSET(InferParams, postproc_thread_num);
+      if (!ModuleParamParser<uint32_t>::Parser(param_set, "thread_num", params_map["thread_num"],
+                                               (reinterpret_cast<char*>(result) + offset))) {
+        return false;
+      }
+    }
+    if (params_map.find("queue_size") != params_map.end()) {
+      size_t offset = OFFSET(InferParams, postproc_queue_size);
+      if (!ModuleParamParser<uint32_t>::Parser(param_set, "queue_size", params_map["queue_size"],
+                                               (reinterpret_cast<char*>(result) + offset))) {
+        return false;
+      }
+    }
     return true;
   };
 
@@ -229,8 +290,8 @@ Inferencer::Inferencer(const std::string& name) : ModuleEx(name) {
        "For using Custom preproc RGB24/BGR24/GRAY/TENSOR are supported. ",
        PARAM_OPTIONAL, OFFSET(InferParams, input_format), model_input_pixel_format_parser, "InferVideoPixelFmt"},
 
-      {"model_path", "", "The path of the offline model.", PARAM_REQUIRED, OFFSET(InferParams, model_path),
-       ModuleParamParser<std::string>::Parser, "string"},
+      {"model_path", "", "The path of the offline model. Required by the infer_server backend.", PARAM_OPTIONAL,
+       OFFSET(InferParams, model_path), ModuleParamParser<std::string>::Parser, "string"},
 
       {"label_path", "", "The label path for model.", PARAM_OPTIONAL, OFFSET(InferParams, label_path),
        ModuleParamParser<std::string>::VectorParser, "std::vector<string>"},
@@ -246,7 +307,11 @@ Inferencer::Inferencer(const std::string& name) : ModuleEx(name) {
        "Required. Parameters related to postprocessing including name and threshold."
        "name : Required. The class name for postprocess. The class specified by this name "
        "must inherit from class cnstream::Postproc."
-       "threshold : Optional. The threshold will be set to postprocessing.",
+       "threshold : Optional. The threshold will be set to postprocessing."
+       "thread_num : Optional, default 0. The number of threads postprocessing the batches, decoupled from the "
+       "inference. 0 means the postprocessing runs on the response path of the backend. Frames are transmitted in "
+       "order of each stream either way, Postproc::Execute may be called concurrently for different batches."
+       "queue_size : Optional, default 8. The number of batches waiting for the postprocessing threads at most.",
        PARAM_REQUIRED, 0, postproc_parser, "PostProcParam"},
 
       {"filter", "",
@@ -270,7 +335,55 @@ Inferencer::Inferencer(const std::string& name) : ModuleEx(name) {
        "must inherit from class cnstream::ObjectFilterVideo. "
        "categories : Optional. The categories for object filter."
        "-1 or all/ALL means all the objects of the frame will be the inputs",
-       PARAM_OPTIONAL, OFFSET(InferParams, custom_postproc_params), json_parser, "CustomPostprocParams"}};
+       PARAM_OPTIONAL, OFFSET(InferParams, custom_postproc_params), json_parser, "CustomPostprocParams"},
+
+      {"backend", "infer_server",
+       "Optional. The inference backend. infer_server: runs the offline model on MLU. "
+       "cpu_mock: emits synthetic outputs at a configurable latency on the host, with the same batching "
+       "semantics, the preprocessing is always done on cpu.",
+       PARAM_OPTIONAL, OFFSET(InferParams, backend), ModuleParamParser<std::string>::Parser, "string"},
+
+      {"backend_params", "",
+       "Optional. The parameters of the backend in json. For cpu_mock, batch_size, latency_ms, item_latency_ms, "
+       "input_shape, input_order, input_dtype, output_shapes, objects and hugepage are supported. See InferParams.",
+       PARAM_OPTIONAL, OFFSET(InferParams, backend_params), json_parser, "BackendParams"},
+
+      {"adaptive_interval", "",
+       "Optional. Infers frames at an interval adapted to the motion of the scene and the number of objects, "
+       "instead of [interval], in json. min_interval and max_interval: the bounds of the interval, 1 and 8 by "
+       "default. motion_threshold and static_threshold: the mean absolute difference of the luma thumbnails "
+       "regarded as motion and as static, 2 and 0.5 by default. thumbnail_width: 64 by default. "
+       "streams: {stream_id: [min_interval, max_interval]}.",
+       PARAM_OPTIONAL, OFFSET(InferParams, adaptive_interval), json_parser, "AdaptiveIntervalParams"},
+
+      {"roi_batching", "false",
+       "Optional. For secondary inference only, which is enabled by [filter]. Whether the objects of different "
+       "frames and streams are batched together by Inferencer regardless of batch_strategy. A batch is sent when "
+       "it is full, or batch_timeout after its first object arrived, or as the deadline scheduler decides. "
+       "Frames are transmitted in order once all their objects are inferred.",
+       PARAM_OPTIONAL, OFFSET(InferParams, roi_batching), ModuleParamParser<bool>::Parser, "bool"},
+
+      {"result_cache", "",
+       "Optional. For secondary inference only, which is enabled by [filter]. Caches the results of the objects by "
+       "their tracks in json, tracked objects are inferred again only when their results are refreshed. "
+       "refresh_interval: the number of frames after which a result is refreshed, 10 by default. "
+       "size_growth: the relative growth of the area of the box that refreshes a result, 0.2 by default. "
+       "score_drop: the drop of the detection score that refreshes a result, 0.2 by default. "
+       "0 disables each of them. max_lost: the number of frames a track is not seen before its result is "
+       "evicted, 25 by default. The hits and misses are reported as processes of the profiler.",
+       PARAM_OPTIONAL, OFFSET(InferParams, result_cache), json_parser, "ResultCacheParams"},
+
+      {"scheduler", "arrival",
+       "Optional. How batches are formed. arrival: by infer_server as batch_strategy. "
+       "deadline: across streams by Inferencer, each frame is batched within batch_timeout after it arrived, "
+       "the waiting time adapts to the arrival rate and the processing time observed.",
+       PARAM_OPTIONAL, OFFSET(InferParams, scheduler), ModuleParamParser<std::string>::Parser, "string"},
+
+      {"scheduler_params", "",
+       "Optional. The parameters of the deadline scheduler in json. "
+       "stream_priority: {stream_id: priority}, frames of streams with higher priority are batched first. "
+       "default_priority: the priority of the streams not listed, 0 by default.",
+       PARAM_OPTIONAL, OFFSET(InferParams, scheduler_params), json_parser, "SchedulerParams"}};
 
   param_helper_->Register(register_param, &param_register_);
 }
@@ -283,15 +396,17 @@ bool Inferencer::Open(ModuleParamSet raw_params) {
   }
 
   auto params = param_helper_->GetParams();
-  uint32_t dev_cnt = 0;
-  if (cnrtGetDeviceCount(&dev_cnt) != cnrtSuccess || params.device_id < 0 ||
-      static_cast<uint32_t>(params.device_id) >= dev_cnt) {
-    LOGE(Inferencer) << "[" << GetName() << "] device " << params.device_id << " does not exist.";
-    return false;
+  bool use_mlu = params.backend != "cpu_mock";
+  if (use_mlu) {
+    uint32_t dev_cnt = 0;
+    if (cnrtGetDeviceCount(&dev_cnt) != cnrtSuccess || params.device_id < 0 ||
+        static_cast<uint32_t>(params.device_id) >= dev_cnt) {
+      LOGE(Inferencer) << "[" << GetName() << "] device " << params.device_id << " does not exist.";
+      return false;
+    }
+    cnrtSetDevice(params.device_id);
   }
 
-  cnrtSetDevice(params.device_id);
-
   preproc_ = std::shared_ptr<Preproc>(Preproc::Create(params.preproc_name));
   if (!preproc_) {
     LOGE(Inferencer) << "Can not find Preproc implemention by name: " << params.preproc_name;
@@ -301,7 +416,7 @@ bool Inferencer::Open(ModuleParamSet raw_params) {
     LOGE(Inferencer) << "Preprocessor init failed.";
     return false;
   }
-  preproc_->hw_accel_ = (params.preproc_use_cpu == false);
+  preproc_->hw_accel_ = use_mlu && (params.preproc_use_cpu == false);
 
   postproc_ = std::shared_ptr<Postproc>(Postproc::Create(params.postproc_name));
   if (!postproc_) {
@@ -313,6 +428,27 @@ bool Inferencer::Open(ModuleParamSet raw_params) {
     return false;
   }
   postproc_->threshold_ = params.threshold;
+  if (params.postproc_thread_num) {
+    InferPostprocPool::Params pool_params;
+    pool_params.thread_num = params.postproc_thread_num;
+    pool_params.max_queue = params.postproc_queue_size;
+    postproc_pool_.reset(
+        new InferPostprocPool(pool_params, [this](const CNFrameInfoPtr& data) { this->TransmitData(data); }));
+    ModuleProfiler* profiler = GetProfiler();
+    if (profiler && profiler->RegisterProcessName(kASYNC_POSTPROC_PROFILER_NAME)) {
+      // the ongoing frames of the process are the frames waiting for the postprocessing threads
+      postproc_pool_->SetFrameCallbacks(
+          [profiler](const CNFrameInfoPtr& data) {
+            profiler->RecordProcessStart(kASYNC_POSTPROC_PROFILER_NAME,
+                                         std::make_pair(data->stream_id, data->timestamp));
+          },
+          [profiler](const CNFrameInfoPtr& data) {
+            profiler->RecordProcessEnd(kASYNC_POSTPROC_PROFILER_NAME,
+                                       std::make_pair(data->stream_id, data->timestamp));
+          });
+    }
+    postproc_pool_->Start();
+  }
 
   if (!params.filter_name.empty() || !params.filter_categories.empty()) {
     if (params.filter_name.empty()) {
@@ -342,7 +478,7 @@ bool Inferencer::Open(ModuleParamSet raw_params) {
     }
   }
 
-  params.model_path = GetPathRelativeToTheJSONFile(params.model_path, raw_params);
+  if (!params.model_path.empty()) params.model_path = GetPathRelativeToTheJSONFile(params.model_path, raw_params);
   if (!params.label_path.empty()) {
     for (auto& p : params.label_path) {
       std::string path = GetPathRelativeToTheJSONFile(p, raw_params);
@@ -365,37 +501,121 @@ bool Inferencer::Open(ModuleParamSet raw_params) {
     }
   }
 
-  cnrtSetDevice(params.device_id);
-  server_.reset(new infer_server::InferServer(params.device_id));
+  if (!params.adaptive_interval.empty() && !CreateAdaptiveInterval(params.adaptive_interval)) {
+    LOGE(Inferencer) << "[" << GetName() << "] Parse adaptive_interval failed.";
+    return false;
+  }
+
+  if (!params.result_cache.empty()) {
+    if (!filter_) {
+      LOGW(Inferencer) << "[" << GetName() << "] result_cache is ignored without filter.";
+    } else if (!CreateResultCache(params.result_cache)) {
+      LOGE(Inferencer) << "[" << GetName() << "] Parse result_cache failed.";
+      return false;
+    }
+  }
 
-  infer_server::SessionDesc desc;
+  backend_.reset(InferBackend::Create(params.backend));
+  if (!backend_) {
+    LOGE(Inferencer) << "[" << GetName() << "] Unknown backend: " << params.backend;
+    return false;
+  }
+  InferBackendDesc desc;
   desc.name = this->GetName();
-  desc.strategy = params.batch_strategy;
-  desc.batch_timeout = params.batch_timeout;
-  desc.priority = params.priority;
-  desc.engine_num = params.engine_num;
-  desc.show_perf = params.show_stats;
-  desc.model = server_->LoadModel(params.model_path);
-  desc.model_input_format = params.input_format;
-  desc.preproc = infer_server::Preprocessor::Create();
-  infer_server::SetPreprocHandler(desc.model->GetKey(), this);
-  desc.postproc = infer_server::Postprocessor::Create();
-  infer_server::SetPostprocHandler(desc.model->GetKey(), this);
-
-  observer_ = std::make_shared<InferObserver>(std::bind(&Inferencer::OnProcessDone, this, std::placeholders::_1));
-  session_ = server_->CreateSession(desc, observer_);
-  if (!session_) return false;
+  desc.params = params;
+  if (params.roi_batching && !filter_) {
+    LOGW(Inferencer) << "[" << GetName() << "] roi_batching is ignored without filter, frames are batched instead.";
+    desc.params.roi_batching = false;
+  }
+  desc.preproc = this;
+  desc.postproc = this;
+  desc.callback = std::bind(&Inferencer::OnProcessDone, this, std::placeholders::_1);
+  if (!ParseStreamPriority(params.scheduler_params, &desc.stream_priority, &desc.default_priority)) {
+    LOGE(Inferencer) << "[" << GetName() << "] Parse scheduler_params failed.";
+    return false;
+  }
+  if (!backend_->Open(desc)) {
+    backend_.reset();
+    return false;
+  }
+  return true;
+}
+
+bool Inferencer::CreateAdaptiveInterval(const std::unordered_map<std::string, std::string>& params) {
+  AdaptiveInterval::Params interval_params;
+  auto get_value = [&params](const std::string& key, decltype(ModuleParamDesc::parser) parser, void* value) {
+    auto iter = params.find(key);
+    return iter == params.end() || parser({}, key, iter->second, value);
+  };
+  if (!get_value("min_interval", ModuleParamParser<uint32_t>::Parser, &interval_params.min_interval) ||
+      !get_value("max_interval", ModuleParamParser<uint32_t>::Parser, &interval_params.max_interval) ||
+      !get_value("motion_threshold", ModuleParamParser<float>::Parser, &interval_params.motion_threshold) ||
+      !get_value("static_threshold", ModuleParamParser<float>::Parser, &interval_params.static_threshold) ||
+      !get_value("thumbnail_width", ModuleParamParser<uint32_t>::Parser, &interval_params.thumbnail_width)) {
+    return false;
+  }
+  adaptive_interval_.reset(new AdaptiveInterval(interval_params));
+
+  auto iter = params.find("streams");
+  if (iter == params.end()) return true;
+  rapidjson::Document doc;
+  if (doc.Parse(iter->second.c_str()).HasParseError() || !doc.IsObject()) return false;
+  for (auto member = doc.MemberBegin(); member != doc.MemberEnd(); ++member) {
+    const rapidjson::Value& bounds = member->value;
+    if (!bounds.IsArray() || bounds.Size() != 2 || !bounds[0].IsUint() || !bounds[1].IsUint()) return false;
+    adaptive_interval_->SetStreamBounds(member->name.GetString(), bounds[0].GetUint(), bounds[1].GetUint());
+  }
+  return true;
+}
+
+bool Inferencer::CreateResultCache(const std::unordered_map<std::string, std::string>& params) {
+  InferResultCache::Params cache_params;
+  auto get_value = [&params](const std::string& key, decltype(ModuleParamDesc::parser) parser, void* value) {
+    auto iter = params.find(key);
+    return iter == params.end() || parser({}, key, iter->second, value);
+  };
+  if (!get_value("refresh_interval", ModuleParamParser<uint32_t>::Parser, &cache_params.refresh_interval) ||
+      !get_value("size_growth", ModuleParamParser<float>::Parser, &cache_params.size_growth) ||
+      !get_value("score_drop", ModuleParamParser<float>::Parser, &cache_params.score_drop) ||
+      !get_value("max_lost", ModuleParamParser<uint32_t>::Parser, &cache_params.max_lost)) {
+    return false;
+  }
+  result_cache_.reset(new InferResultCache(cache_params));
+  return true;
+}
+
+bool Inferencer::LookupResultCache(const CNFrameInfoPtr& data, uint64_t frame_id, const CNInferObjectPtr& obj) {
+  if (!IsTracked(obj)) return false;
+  std::shared_ptr<const CachedObjectResult> result;
+  bool hit = result_cache_->Lookup(data->stream_id, obj->track_id, frame_id, obj->bbox.w * obj->bbox.h, obj->score,
+                                   &result);
+  // the hits are counted by the cache, reported with show_stats at the end of the stream
+  if (!hit) return false;
+  if (result) {
+    for (auto& attribute : result->attributes) obj->AddAttribute(attribute);
+    for (auto& attribute : result->extra_attributes) obj->AddExtraAttribute(attribute.first, attribute.second);
+    for (auto& feature : result->features) obj->AddFeature(feature.first, feature.second);
+  }
   return true;
 }
 
 void Inferencer::Close() {
-  if (server_ && session_) {
-    infer_server::RemovePreprocHandler(server_->GetModel(session_)->GetKey());
-    infer_server::RemovePostprocHandler(server_->GetModel(session_)->GetKey());
-    server_->DestroySession(session_);
-    session_ = nullptr;
-    server_.reset();
+  // the jobs waiting are run before the model is released
+  if (postproc_pool_) postproc_pool_->Stop();
+  if (backend_) {
+    backend_->Close();
+    backend_.reset();
   }
+  if (postproc_pool_) {
+    if (param_helper_->GetParams().show_stats) {
+      auto stats = postproc_pool_->GetStats();
+      LOGI(Inferencer) << "[" << GetName() << "] postprocessing threads: " << stats.jobs << " batches, max queue depth "
+                       << stats.max_queue_depth << ".";
+    }
+    postproc_pool_.reset();
+  }
+  adaptive_interval_.reset();
+  result_cache_.reset();
 }
 
 int Inferencer::Process(std::shared_ptr<CNFrameInfo> data) {
@@ -406,17 +626,35 @@ int Inferencer::Process(std::shared_ptr<CNFrameInfo> data) {
 
   if (data->IsEos()) {
     if (IsStreamRemoved(data->stream_id)) {
-      server_->DiscardTask(session_, data->stream_id);
-      server_->WaitTaskDone(session_, data->stream_id);
+      backend_->DiscardTask(data->stream_id);
+      backend_->WaitTaskDone(data->stream_id);
     } else {
-      server_->WaitTaskDone(session_, data->stream_id);
+      backend_->WaitTaskDone(data->stream_id);
     }
+    if (postproc_pool_) postproc_pool_->WaitStream(data->stream_id);
     TransmitData(data);
     std::unique_lock<std::mutex> lock(drop_cnt_map_mtx_);
     if (drop_cnt_map_.count(data->stream_id) != 0) {
       drop_cnt_map_.erase(data->stream_id);
     }
     lock.unlock();
+    if (adaptive_interval_) {
+      if (param_helper_->GetParams().show_stats) {
+        auto stats = adaptive_interval_->GetStats(data->stream_id);
+        LOGI(Inferencer) << "[" << GetName() << "] stream " << data->stream_id << ": " << stats.inferred << " of "
+                         << stats.frames << " frames inferred.";
+      }
+      adaptive_interval_->RemoveStream(data->stream_id);
+    }
+    if (result_cache_) {
+      if (param_helper_->GetParams().show_stats) {
+        auto stats = result_cache_->GetStats(data->stream_id);
+        LOGI(Inferencer) << "[" << GetName() << "] stream " << data->stream_id << ": result cache hit rate "
+                         << stats.HitRate() << ", " << stats.hits << " of " << stats.lookups << " objects, "
+                         << stats.evicted << " tracks evicted.";
+      }
+      result_cache_->RemoveStream(data->stream_id);
+    }
     return 0;
   }
   if (data->IsRemoved()) { /* discard packets from removed-stream */
@@ -426,33 +664,42 @@ int Inferencer::Process(std::shared_ptr<CNFrameInfo> data) {
   auto frame = data->collection.Get<CNDataFramePtr>(kCNDataFrameTag);
 
   auto params = param_helper_->GetParams();
-  if (params.interval > 0) {
+  bool drop_data = false;
+  if (adaptive_interval_) {
+    // the motion is computed on the luma plane, it is unknown for other formats and the frame is inferred
+    const uint8_t* luma = nullptr;
+    auto fmt = frame->buf_surf->GetColorFormat();
+    if (fmt == CNEDK_BUF_COLOR_FORMAT_NV12 || fmt == CNEDK_BUF_COLOR_FORMAT_NV21) {
+      CnedkBufSurfaceSyncForCpu(frame->buf_surf->GetBufSurface(), -1, -1);
+      luma = static_cast<const uint8_t*>(frame->buf_surf->GetHostData(0));
+    }
+    drop_data = !adaptive_interval_->ShouldInfer(data->stream_id, luma, frame->buf_surf->GetWidth(),
+                                                 frame->buf_surf->GetHeight(), frame->buf_surf->GetStride(0));
+  } else if (params.interval > 0) {
     // for interval
     uint32_t interval = params.interval;
     std::unique_lock<std::mutex> lock(drop_cnt_map_mtx_);
     if (drop_cnt_map_.count(data->stream_id) == 0) {
       drop_cnt_map_.insert(std::make_pair(data->stream_id, interval - 1));
     }
-    bool drop_data = drop_cnt_map_[data->stream_id]++ != interval - 1;
-    lock.unlock();
+    drop_data = drop_cnt_map_[data->stream_id]++ != interval - 1;
+    if (!drop_data) drop_cnt_map_[data->stream_id] = 0;
+  }
 
-    if (drop_data) {
-      // to keep data in sequence, we pass empty package to infer_server, with CNFrameInfo as user data.
-      // frame won't be inferred, and CNFrameInfo will be responsed in sequence
-      infer_server::PackagePtr in = infer_server::Package::Create(0, data->stream_id);
-      if (!server_->Request(session_, in, data, -1)) {
-        LOGE(INFERENCER) << "[" << this->GetName() << "] Process failed."
-                        << " stream id: " << data->stream_id << " frame id: " << frame->frame_id;
-        return -1;
-      }
-      return 0;
+  if (drop_data) {
+    // to keep data in sequence, we pass empty package to the backend, with CNFrameInfo as user data.
+    // frame won't be inferred, and CNFrameInfo will be responsed in sequence
+    infer_server::PackagePtr in = infer_server::Package::Create(0, data->stream_id);
+    if (!backend_->Request(in, data)) {
+      LOGE(INFERENCER) << "[" << this->GetName() << "] Process failed."
+                      << " stream id: " << data->stream_id << " frame id: " << frame->frame_id;
+      return -1;
     }
-
-    drop_cnt_map_[data->stream_id] = 0;
+    return 0;
   }
 
   // Async inference:
-  // 1. send data to the inferserver
+  // 1. send data to the backend
   // 2. the infer-result will be notified via OnPostproc()
   // 3. process_done() will be invoked when finished
   infer_server::PackagePtr request = std::make_shared<infer_server::Package>();
@@ -465,6 +712,8 @@ int Inferencer::Process(std::shared_ptr<CNFrameInfo> data) {
       auto& objs = objs_holder->objs_;
       for (auto& obj : objs) {
         if (!filter_->Filter(data, obj)) continue;
+        // the results cached are copied to the object instead of inferring it
+        if (result_cache_ && LookupResultCache(data, frame->frame_id, obj)) continue;
         infer_server::PreprocInput tmp;
         tmp.surf = frame->buf_surf;
         tmp.bbox = GetFullFovBbox(obj.get());
@@ -482,6 +731,7 @@ int Inferencer::Process(std::shared_ptr<CNFrameInfo> data) {
         request_data->SetUserData(std::make_pair(data, obj));
       }
     }
+    if (result_cache_) result_cache_->Evict(data->stream_id, frame->frame_id);
   } else {
     request->data.emplace_back(new infer_server::InferData);
     auto& request_data = request->data.back();
@@ -492,7 +742,7 @@ int Inferencer::Process(std::shared_ptr<CNFrameInfo> data) {
     request_data->SetUserData(std::make_pair(data, CNInferObjectPtr(nullptr)));
   }
 
-  if (!server_->Request(session_, request, data, -1)) {
+  if (!backend_->Request(request, data)) {
     LOGE(INFERENCER) << "[" << this->GetName() << "] Process failed."
                      << " stream id: " << data->stream_id << " frame id: " << frame->frame_id;
     return -1;
@@ -521,9 +771,20 @@ bool Inferencer::CheckParamSet(const ModuleParamSet& param_set) const {
     ret = false;
   }
 
+  if (params.scheduler != "arrival" && params.scheduler != "deadline") {
+    LOGE(Inferencer) << "[scheduler] : " << params.scheduler << " is not supported. arrival or deadline expected.";
+    ret = false;
+  }
+
+  if (params.backend != "infer_server" && params.backend != "cpu_mock") {
+    LOGE(Inferencer) << "[backend] : " << params.backend << " is not supported. infer_server or cpu_mock expected.";
+    ret = false;
+  }
+
   ParametersChecker checker;
 
-  if (!checker.CheckPath(params.model_path, param_set)) {
+  if (params.backend != "cpu_mock" &&
+      (params.model_path.empty() || !checker.CheckPath(params.model_path, param_set))) {
     LOGE(Inferencer) << "[model_path] : " << params.model_path << " non-existence.";
     ret = false;
   }
@@ -531,14 +792,20 @@ bool Inferencer::CheckParamSet(const ModuleParamSet& param_set) const {
   return ret;
 }
 
+void Inferencer::OnProcessDone(const CNFrameInfoPtr data) {
+  if (postproc_pool_) {
+    // transmitted once the postprocessing of the frame is done
+    postproc_pool_->Done(data->stream_id, data);
+  } else {
+    this->TransmitData(data);
+  }
+}
+
 int Inferencer::OnPostproc(const std::vector<infer_server::InferData*>& data_vec,
                            const infer_server::ModelIO& model_output,
                            const infer_server::ModelInfo* model_info) {
   if (!data_vec.size()) return 0;
 
-  auto params = param_helper_->GetParams();
-  cnrtSetDevice(params.device_id);
-
   NetOutputs net_outputs;
   for (size_t i = 0; i < model_output.surfs.size(); i++) {
     net_outputs.emplace_back(model_output.surfs[i], model_output.shapes[i]);
@@ -552,11 +819,51 @@ int Inferencer::OnPostproc(const std::vector<infer_server::InferData*>& data_vec
     if (user_data.second) objects.push_back(user_data.second);
   }
 
+  if (!postproc_pool_) return ExecutePostproc(net_outputs, model_info, packages, objects);
+  // the outputs are held by the job until it is done, the model is released after the pool is stopped
+  postproc_pool_->Submit(packages, [this, net_outputs, model_info, packages, objects]() {
+    if (ExecutePostproc(net_outputs, model_info, packages, objects) != 0) {
+      LOGE(Inferencer) << "[" << GetName() << "] Postprocessing failed.";
+    }
+  });
+  return 0;
+}
+
+int Inferencer::ExecutePostproc(const NetOutputs& net_outputs, const infer_server::ModelInfo* model_info,
+                                const std::vector<CNFrameInfoPtr>& packages,
+                                const std::vector<CNInferObjectPtr>& objects) {
+  auto params = param_helper_->GetParams();
+  if (params.backend != "cpu_mock") cnrtSetDevice(params.device_id);
+
   if (postproc_) {
     if (objects.size()) {
-      return postproc_->Execute(net_outputs, *model_info, packages, objects, label_strings_);
+      if (!result_cache_) return postproc_->Execute(net_outputs, *model_info, packages, objects, label_strings_);
+      // caches the results added by the postprocessing
+      std::vector<CachedObjectResult> existing;
+      for (auto& obj : objects) existing.push_back(GetObjectResult(obj, nullptr));
+      int ret = postproc_->Execute(net_outputs, *model_info, packages, objects, label_strings_);
+      for (size_t i = 0; i < objects.size(); ++i) {
+        if (!IsTracked(objects[i])) continue;
+        std::shared_ptr<const CachedObjectResult> result =
+            std::make_shared<CachedObjectResult>(GetObjectResult(objects[i], &existing[i]));
+        result_cache_->Update(packages[i]->stream_id, objects[i]->track_id, std::move(result));
+      }
+      return ret;
+    }
+    int ret = postproc_->Execute(net_outputs, *model_info, packages, label_strings_);
+    if (adaptive_interval_) {
+      // more objects raise the inference rate
+      for (auto& package : packages) {
+        uint32_t object_num = 0;
+        if (package->collection.HasValue(kCNInferObjsTag)) {
+          auto objs_holder = package->collection.Get<CNInferObjsPtr>(kCNInferObjsTag);
+          std::lock_guard<std::mutex> lk(objs_holder->mutex_);
+          object_num = objs_holder->objs_.size();
+        }
+        adaptive_interval_->OnResult(package->stream_id, object_num);
+      }
     }
-    return postproc_->Execute(net_outputs, *model_info, packages, label_strings_);
+    return ret;
   }
   return -1;
 }
@@ -0,0 +1,238 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_INFERENCE_POSTPROC_POOL_HPP_
+#define MODULES_INFERENCE_POSTPROC_POOL_HPP_
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace cnstream {
+
+/**
+ * PostprocPool runs the postprocessing of the batches on its own threads, so that the response path of the backend
+ * is not stalled by heavy postprocessing.
+ *
+ * A job is submitted with the frames it writes results to. The frames responded by the backend are passed to Done in
+ * the order of each stream, and transmitted in that order once all their jobs are done. Jobs of different batches may
+ * run concurrently, the same as the postprocessing with several engines.
+ *
+ * Submit blocks while max_queue jobs are waiting, which bounds the outputs of the model held by the jobs.
+ */
+template <typename T>
+class PostprocPool {
+ public:
+  using FramePtr = std::shared_ptr<T>;
+  using FrameCallback = std::function<void(const FramePtr &)>;
+
+  struct Params {
+    uint32_t thread_num = 1;
+    uint32_t max_queue = 8;
+  };
+
+  struct Stats {
+    uint64_t jobs = 0;             // jobs done
+    uint32_t queue_depth = 0;      // jobs waiting
+    uint32_t max_queue_depth = 0;
+    uint32_t pending_frames = 0;   // frames responded, waiting for their jobs or the frames before
+  };
+
+  /**
+   * @param transmit Called with the frames in order of each stream, on the thread finishing the last job of a frame
+   *                 or calling Done.
+   */
+  PostprocPool(const Params &params, FrameCallback transmit) : params_(params), transmit_(std::move(transmit)) {
+    params_.thread_num = std::max(params_.thread_num, 1u);
+    params_.max_queue = std::max(params_.max_queue, 1u);
+  }
+
+  ~PostprocPool() { Stop(); }
+
+  // Called when the first job of a frame is submitted and when its last job is done, set before Start.
+  void SetFrameCallbacks(FrameCallback on_start, FrameCallback on_end) {
+    on_start_ = std::move(on_start);
+    on_end_ = std::move(on_end);
+  }
+
+  void Start() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (running_) return;
+    running_ = true;
+    for (uint32_t i = 0; i < params_.thread_num; ++i) workers_.emplace_back(&PostprocPool::WorkLoop, this);
+  }
+
+  // Runs the jobs waiting and stops the threads, jobs submitted later are run by the calling thread.
+  void Stop() {
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      if (!running_) return;
+      running_ = false;
+    }
+    not_empty_.notify_all();
+    not_full_.notify_all();
+    for (auto &worker : workers_) worker.join();
+    workers_.clear();
+  }
+
+  void Submit(const std::vector<FramePtr> &frames, std::function<void()> job) {
+    Job item;
+    item.frames = frames;
+    std::sort(item.frames.begin(), item.frames.end(),
+              [](const FramePtr &a, const FramePtr &b) { return a.get() < b.get(); });
+    item.frames.erase(std::unique(item.frames.begin(), item.frames.end()), item.frames.end());
+    item.func = std::move(job);
+
+    std::unique_lock<std::mutex> lk(mutex_);
+    not_full_.wait(lk, [this] { return queue_.size() < params_.max_queue || !running_; });
+    for (auto &frame : item.frames) {
+      if (outstanding_[frame.get()]++ == 0 && on_start_) on_start_(frame);
+    }
+    if (!running_) {
+      lk.unlock();
+      item.func();
+      lk.lock();
+      Finish(item, &lk);
+      return;
+    }
+    queue_.push_back(std::move(item));
+    stats_.max_queue_depth = std::max<uint32_t>(stats_.max_queue_depth, queue_.size());
+    not_empty_.notify_one();
+  }
+
+  // Called with the frames of each stream in order, after the jobs of the frame are submitted.
+  void Done(const std::string &stream_id, const FramePtr &frame) {
+    std::unique_lock<std::mutex> lk(mutex_);
+    streams_[stream_id].frames.push_back(frame);
+    Flush(stream_id, &lk);
+  }
+
+  // Waits until the frames of a stream passed to Done are transmitted.
+  void WaitStream(const std::string &stream_id) {
+    std::unique_lock<std::mutex> lk(mutex_);
+    flushed_.wait(lk, [&] {
+      auto iter = streams_.find(stream_id);
+      return iter == streams_.end() || (iter->second.frames.empty() && !iter->second.flushing);
+    });
+    streams_.erase(stream_id);
+  }
+
+  Stats GetStats() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    Stats stats = stats_;
+    stats.queue_depth = queue_.size();
+    for (auto &stream : streams_) stats.pending_frames += stream.second.frames.size();
+    return stats;
+  }
+
+ private:
+  struct Job {
+    std::vector<FramePtr> frames;
+    std::function<void()> func;
+  };
+
+  struct StreamQueue {
+    std::deque<FramePtr> frames;
+    bool flushing = false;
+  };
+
+  void WorkLoop() {
+    std::unique_lock<std::mutex> lk(mutex_);
+    while (true) {
+      not_empty_.wait(lk, [this] { return !queue_.empty() || !running_; });
+      if (queue_.empty()) return;
+      Job job = std::move(queue_.front());
+      queue_.pop_front();
+      not_full_.notify_one();
+      lk.unlock();
+      job.func();
+      lk.lock();
+      Finish(job, &lk);
+    }
+  }
+
+  void Finish(const Job &job, std::unique_lock<std::mutex> *lk) {
+    ++stats_.jobs;
+    bool frame_done = false;
+    for (auto &frame : job.frames) {
+      auto iter = outstanding_.find(frame.get());
+      if (--iter->second) continue;
+      outstanding_.erase(iter);
+      if (on_end_) on_end_(frame);
+      frame_done = true;
+    }
+    if (!frame_done) return;
+    // the streams may wait for the frames done, ids are copied as the lock is released while transmitting
+    std::vector<std::string> ready;
+    for (auto &stream : streams_) {
+      if (!stream.second.flushing && Ready(stream.second)) ready.push_back(stream.first);
+    }
+    for (auto &stream_id : ready) Flush(stream_id, lk);
+  }
+
+  bool Ready(const StreamQueue &queue) const {
+    return !queue.frames.empty() && !outstanding_.count(queue.frames.front().get());
+  }
+
+  // Transmits the frames at the front of a stream done, by one thread at a time to keep the order.
+  void Flush(const std::string &stream_id, std::unique_lock<std::mutex> *lk) {
+    auto iter = streams_.find(stream_id);
+    if (iter == streams_.end() || iter->second.flushing) return;
+    StreamQueue &queue = iter->second;
+    queue.flushing = true;
+    while (Ready(queue)) {
+      FramePtr frame = std::move(queue.frames.front());
+      queue.frames.pop_front();
+      lk->unlock();
+      transmit_(frame);
+      lk->lock();
+    }
+    queue.flushing = false;
+    flushed_.notify_all();
+  }
+
+  Params params_;
+  FrameCallback transmit_;
+  FrameCallback on_start_;
+  FrameCallback on_end_;
+  bool running_ = false;
+  std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+  std::condition_variable flushed_;
+  std::deque<Job> queue_;
+  std::unordered_map<const T *, uint32_t> outstanding_;  // the number of jobs not done of each frame
+  std::unordered_map<std::string, StreamQueue> streams_;
+  std::vector<std::thread> workers_;
+  Stats stats_;
+};  // class PostprocPool
+
+}  // namespace cnstream
+
+#endif  // MODULES_INFERENCE_POSTPROC_POOL_HPP_
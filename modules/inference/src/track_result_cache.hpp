@@ -0,0 +1,164 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_INFERENCE_TRACK_RESULT_CACHE_HPP_
+#define MODULES_INFERENCE_TRACK_RESULT_CACHE_HPP_
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace cnstream {
+
+/**
+ * TrackResultCache caches the results of secondary inference by the track of the objects, (stream_id, track_id), so
+ * that a tracked object is not inferred on each frame. The result of a track is refreshed:
+ *
+ * - refresh_interval frames after the track was inferred last, 0 to disable,
+ * - when the area of its box grew by size_growth since then, as the object is seen better, 0 to disable,
+ * - when its detection score dropped by score_drop since then, 0 to disable.
+ *
+ * Until the first result of a track is stored, the track is inferred on each frame. Tracks not seen for max_lost
+ * frames are regarded as lost and evicted.
+ */
+template <typename T>
+class TrackResultCache {
+ public:
+  struct Params {
+    uint32_t refresh_interval = 10;
+    float size_growth = 0.2f;  // relative to the area of the box
+    float score_drop = 0.2f;
+    uint32_t max_lost = 25;
+  };
+
+  struct Stats {
+    uint64_t lookups = 0;
+    uint64_t hits = 0;
+    uint64_t evicted = 0;
+
+    double HitRate() const { return lookups ? static_cast<double>(hits) / lookups : 0; }
+  };
+
+  explicit TrackResultCache(const Params &params) : params_(params) {}
+
+  /**
+   * @brief Looks up the result of a track on a frame.
+   *
+   * @param area The area of the box of the object, normalized.
+   * @param score The detection score of the object.
+   * @param result The result cached, set on hit.
+   *
+   * @return Returns true if the result cached is still valid. Otherwise the object is expected to be inferred and
+   *         its result to be stored by Update, the frame becomes the reference of the next refresh.
+   */
+  bool Lookup(const std::string &stream_id, const std::string &track_id, uint64_t frame_id, float area, float score,
+              T *result) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    StreamCache &cache = streams_[stream_id];
+    ++cache.stats.lookups;
+    Entry &entry = cache.entries[track_id];
+    entry.last_seen = frame_id;
+    if (entry.has_result && !NeedRefresh(entry, frame_id, area, score)) {
+      ++cache.stats.hits;
+      *result = entry.result;
+      return true;
+    }
+    entry.infer_frame = frame_id;
+    entry.infer_area = area;
+    entry.infer_score = score;
+    return false;
+  }
+
+  // Stores the result of a track inferred. Ignored if the track has been evicted.
+  void Update(const std::string &stream_id, const std::string &track_id, T result) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto cache = streams_.find(stream_id);
+    if (cache == streams_.end()) return;
+    auto entry = cache->second.entries.find(track_id);
+    if (entry == cache->second.entries.end()) return;
+    entry->second.result = std::move(result);
+    entry->second.has_result = true;
+  }
+
+  // Evicts the tracks of a stream not seen for max_lost frames before frame_id.
+  void Evict(const std::string &stream_id, uint64_t frame_id) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto cache = streams_.find(stream_id);
+    if (cache == streams_.end()) return;
+    auto &entries = cache->second.entries;
+    for (auto iter = entries.begin(); iter != entries.end();) {
+      if (frame_id > iter->second.last_seen + params_.max_lost) {
+        iter = entries.erase(iter);
+        ++cache->second.stats.evicted;
+      } else {
+        ++iter;
+      }
+    }
+  }
+
+  Stats GetStats(const std::string &stream_id) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto cache = streams_.find(stream_id);
+    return cache == streams_.end() ? Stats() : cache->second.stats;
+  }
+
+  size_t Size(const std::string &stream_id) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto cache = streams_.find(stream_id);
+    return cache == streams_.end() ? 0 : cache->second.entries.size();
+  }
+
+  void RemoveStream(const std::string &stream_id) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    streams_.erase(stream_id);
+  }
+
+ private:
+  struct Entry {
+    T result;
+    bool has_result = false;
+    uint64_t last_seen = 0;
+    uint64_t infer_frame = 0;
+    float infer_area = 0;
+    float infer_score = 0;
+  };
+
+  struct StreamCache {
+    std::unordered_map<std::string, Entry> entries;
+    Stats stats;
+  };
+
+  bool NeedRefresh(const Entry &entry, uint64_t frame_id, float area, float score) const {
+    if (params_.refresh_interval && frame_id >= entry.infer_frame + params_.refresh_interval) return true;
+    if (params_.size_growth > 0 && area > entry.infer_area * (1 + params_.size_growth)) return true;
+    if (params_.score_drop > 0 && score < entry.infer_score - params_.score_drop) return true;
+    return false;
+  }
+
+  Params params_;
+  std::mutex mutex_;
+  std::unordered_map<std::string, StreamCache> streams_;
+};  // class TrackResultCache
+
+}  // namespace cnstream
+
+#endif  // MODULES_INFERENCE_TRACK_RESULT_CACHE_HPP_
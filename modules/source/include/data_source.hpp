@@ -24,11 +24,12 @@
  *  @file data_source.hpp
  *
  *  This file contains a declaration of the DataSourceParam and ESPacket struct, and the DataSource, FileHandler,
- *  RtspHandler, ESMemHandler, ESJpegMemHandler and RawImgMemHandler class.
+ *  RtspHandler, ESMemHandler, ESJpegMemHandler, RawImgMemHandler and ImageDirHandler class.
  */
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "cnstream_frame.hpp"
 #include "cnstream_frame_va.hpp"
@@ -102,6 +103,22 @@ class DataSource : public SourceModule, public ModuleCreator<DataSource> {
    */
   bool CheckParamSet(const ModuleParamSet &param_set) const override;
 
+  /*!
+   * @brief Seeks a file stream to the given time.
+   *
+   * The stream is demuxed from the previous key frame of the given time, the frames before the given time are decoded
+   * but not sent to the next modules. The frames pending in the decoder when seeking are dropped. The timestamps of
+   * the frames after a seek go on from the last sent one instead of restarting from the file timestamps, so they
+   * keep increasing even if the stream is seeked backward.
+   *
+   * @param[in] stream_id The stream identifier.
+   * @param[in] timestamp The time in milliseconds, relative to the beginning of the file.
+   *
+   * @return Returns 0 if the request is accepted, otherwise returns -1. The possible reason is the stream does not
+   *         exist or it is not created by a FileSourceParam.
+   */
+  int Seek(const std::string &stream_id, int64_t timestamp);
+
   /*!
    * @brief Gets the parameters of the DataSource module.
    *
@@ -174,11 +191,23 @@ struct ImageFrame {
  */
 struct FileSourceParam {
   std::string filename;       /*!< The filename of the stream. */
-  int framerate;              /*!< The framerate of feeding the stream. */
+  int framerate;              /*!< The framerate of feeding the stream. 0 means as fast as possible. */
+  double speed = 0;           /*!< Feeds the stream by its timestamps, 1 means realtime and n means n times speed.
+                                   It overrides framerate if it is greater than 0. */
   bool loop = false;          /*!< Whether loop the stream. */
   Resolution max_res;         /*!< The maximum input resolution. */
   Resolution out_res;         /*!< The output resolution. */
   bool only_key_frame = false;    /*!< Only decode key frame. */
+  uint32_t sample_interval = 1;   /*!< Keeps about one frame every n frames before decoding. Frames which are not
+                                       kept and not referenced by others are not sent to the decoder. */
+  double sample_framerate = 0;    /*!< The target framerate of sampling before decoding. It overrides
+                                       sample_interval if the framerate of the stream is known. 0 means disabled. */
+  int64_t start_time = 0;         /*!< The start of the playback range in milliseconds. */
+  int64_t end_time = -1;          /*!< The end of the playback range in milliseconds. -1 means the end of the file. */
+  int64_t start_frame = -1;       /*!< The start of the playback range in frames. It overrides start_time if it is not
+                                       negative. It is converted to time by the framerate of the stream. */
+  int64_t end_frame = -1;         /*!< The end of the playback range in frames. It overrides end_time if it is not
+                                       negative. It is converted to time by the framerate of the stream. */
 };  // FileSourceParam
 /*!
  * @struct RtspSourceParam
@@ -189,12 +218,45 @@ struct RtspSourceParam {
   std::string url_name;              /*!< The url of the stream. */
   Resolution max_res;                /*!< The maximum input resolution. */
   bool use_ffmpeg = false;           /*!< Uses ffmpeg demuxer if it is true, otherwise uses live555 demuxer. */
-  int reconnect = 10;                /*!< It is valid when "use_ffmpeg" set false. -1 means reconnect endless. */
+  int reconnect = 10;                /*!< The maximum number of reconnections in a row, it is reset once the stream
+                                          is recovered. -1 means reconnect endless. */
   uint32_t interval = 0;             /*!< Interval, 3 means keep a frame every 3 frames. */
   bool only_key_frame = false;       /*!< Only decode key frame. */
   std::function<void(ESPacket, std::string)> callback = nullptr;  /*!< The callback for getting h264/h265 video. */
   Resolution out_res;                /*!< The output resolution. */
+  uint32_t sample_interval = 1;      /*!< Keeps about one frame every n frames before decoding. Frames which are not
+                                          kept and not referenced by others are not sent to the decoder. */
+  double sample_framerate = 0;       /*!< The target framerate of sampling before decoding. It overrides
+                                          sample_interval if the framerate of the stream is known.
+                                          0 means disabled. */
+  uint32_t buffer_size = 60;         /*!< The number of frames buffered between receiving and decoding. When it is
+                                          full, frames are dropped until the next key frame instead of blocking the
+                                          receiving. */
+  uint32_t reorder_time = 100;       /*!< It is valid when "use_ffmpeg" set false. The time in milliseconds to wait
+                                          for out-of-order RTP packets (over UDP) before they are treated as lost. */
+  uint32_t reconnect_min_interval = 500;   /*!< The delay before the first reconnection in milliseconds. It is
+                                                doubled after each failed reconnection. */
+  uint32_t reconnect_max_interval = 8000;  /*!< The maximum delay between reconnections in milliseconds. */
 };  // RtspSourceParam
+/*!
+ * @struct RtspStats
+ *
+ * @brief The RtspStats is a structure describing the statistics of a RtspHandler.
+ */
+struct RtspStats {
+  uint32_t reconnect_count = 0;       /*!< The number of successful reconnections. */
+  uint32_t decoder_recreate_count = 0;  /*!< The number of reconnections with changed codec parameters. The decoder
+                                             is reused for the other reconnections. */
+  double last_reconnect_time = 0;     /*!< The time from losing the connection to receiving the first frame again,
+                                           in milliseconds. */
+  double max_reconnect_time = 0;      /*!< The maximum reconnect time in milliseconds. */
+  uint64_t packets_received = 0;      /*!< The number of RTP packets received. It is valid when "use_ffmpeg" set
+                                           false. */
+  uint64_t packets_lost = 0;          /*!< The number of RTP packets lost. It is valid when "use_ffmpeg" set false. */
+  uint64_t frames_received = 0;       /*!< The number of frames received. */
+  uint64_t frames_dropped = 0;        /*!< The number of frames dropped before decoding, because the buffer is full
+                                           or the frames are waiting for a key frame. */
+};  // RtspStats
 /*!
  * @struct SensorSourceParam
  *
@@ -242,6 +304,22 @@ struct ESJpegMemSourceParam {
 struct ImageFrameSourceParam {
   Resolution out_res;  /*!< The output resolution. */
 };  // ImageFrameSourceParam
+/*!
+ * @struct ImageDirSourceParam
+ *
+ * @brief The ImageDirSourceParam is a structure describing the parameters to create a ImageDirHandler.
+ */
+struct ImageDirSourceParam {
+  std::string dir;                  /*!< The directory of the images. The files are sorted by name. */
+  std::string suffix = ".jpg";      /*!< Only the files with the suffix are read. Empty means all regular files. */
+  std::vector<std::string> files;   /*!< The list of image files. It overrides dir if it is not empty. */
+  bool loop = false;                /*!< Whether loop the images. */
+  int framerate = 0;                /*!< The framerate of feeding the images. 0 means as fast as possible. */
+  uint32_t decode_threads = 4;      /*!< The number of CPU decoding threads. */
+  uint32_t prefetch = 16;           /*!< The number of images read ahead of the output. It is limited by
+                                         bufpool_size of the DataSource module. */
+  Resolution out_res;               /*!< The output resolution. 0 means the resolution of the first image. */
+};  // ImageDirSourceParam
 
 // group: Source Function
 /*!
@@ -327,6 +405,21 @@ std::shared_ptr<SourceHandler> CreateSource(DataSource *module, const std::strin
  */
 std::shared_ptr<SourceHandler> CreateSource(DataSource *module, const std::string &stream_id,
                                             const ImageFrameSourceParam &param);
+// group: Source Function
+/*!
+ * @brief Creates a ImageDirHandler.
+ *
+ * @param[in] module A pointer to DataSource module.
+ * @param[in] stream_id The unique identity for this stream.
+ * @param[in] param The parameter for creating the handler.
+ *
+ * @return Returns handler smart pointer if this function has run successfully, othersize returns nullptr.
+ *
+ * @note The images are decoded on CPU and converted to YUV420spNV12. All images are scaled to out_res,
+ *       or to the resolution of the first image if out_res is not set.
+ */
+std::shared_ptr<SourceHandler> CreateSource(DataSource *module, const std::string &stream_id,
+                                            const ImageDirSourceParam &param);
 
 // group: Source Function
 /*!
@@ -380,6 +473,16 @@ int Write(std::shared_ptr<SourceHandler>handler, ESJpegPacket* pkt);
  *       If the first frame written is not YUV420spNV21 format, do not write YUV420spNV21 afterwards.
  */
 int Write(std::shared_ptr<SourceHandler>handler, ImageFrame* frame);
+// group: Source Function
+/*!
+ * @brief Gets the statistics of RtspHandler.
+ *
+ * @param[in] handler A smart pointer to RtspHandler.
+ * @param[out] stats The statistics.
+ *
+ * @return Returns 0 if this function gets the statistics successfully, otherwise returns -1.
+ */
+int GetRtspStats(std::shared_ptr<SourceHandler> handler, RtspStats *stats);
 
 }  // namespace cnstream
 
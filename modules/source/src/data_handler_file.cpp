@@ -17,6 +17,7 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
  * THE SOFTWARE.
  *************************************************************************/
+#include <algorithm>
 #include <chrono>
 #include <memory>
 #include <sstream>
@@ -37,6 +38,7 @@
 #include "profiler/pipeline_profiler.hpp"
 #include "video_decoder.hpp"
 #include "video_parser.hpp"
+#include "video_sampler.hpp"
 
 namespace cnstream {
 
@@ -53,6 +55,7 @@ class FileHandlerImpl : public IParserResult, public IDecodeResult, public Sourc
   bool Open();
   void Stop();
   void Close();
+  bool Seek(int64_t timestamp);
 
  private:
   DataSource *module_ = nullptr;
@@ -68,6 +71,10 @@ class FileHandlerImpl : public IParserResult, public IDecodeResult, public Sourc
   void ClearResources(bool demux_only = false);
   bool Process();
   void Loop();
+  bool SeekRange(int64_t timestamp);
+  void ResetDecoder();
+  bool CreateDecoder();
+  int64_t FrameToTime(double frame_index) const;
 
   // IParserResult methods
   void OnParserInfo(VideoInfo *info) override;
@@ -92,7 +99,10 @@ class FileHandlerImpl : public IParserResult, public IDecodeResult, public Sourc
 
  private:
   FFParser parser_;
+  VideoSampler sampler_;
   std::shared_ptr<Decoder> decoder_ = nullptr;
+  VideoInfo video_info_;
+  std::atomic<bool> resetting_decoder_{false};
   cnedk::BufPool pool_;
   bool pool_created_ = false;
   std::mutex mutex_;
@@ -105,6 +115,15 @@ class FileHandlerImpl : public IParserResult, public IDecodeResult, public Sourc
   bool first_pts_set_ = false;
   uint64_t first_pts_ = 0;
   uint64_t pts_gap_ = 3003;  // FIXME
+  bool rebase_pts_ = false;     // set by a runtime seek, the pts are rebased as the loop case
+  uint64_t max_timestamp_ = 0;  // the latest in range pts sent to the decoder
+
+  double stream_framerate_ = 0;
+  std::atomic<int64_t> seek_time_{-1};
+  int64_t range_start_pts_ = -1;  // frames before it are decoded and discarded
+  int64_t range_end_pts_ = -1;    // frames after it are decoded and discarded
+  bool pts_parsed_ = false;
+  uint64_t last_pts_ = 0;         // for pacing, in decode order
   ModuleProfiler *module_profiler_ = nullptr;
   PipelineProfiler *pipeline_profiler_ = nullptr;
 };  // class FileHandlerImpl
@@ -158,6 +177,13 @@ void FileHandler::Close() {
   }
 }
 
+bool FileHandler::Seek(int64_t timestamp) {
+  if (impl_) {
+    return impl_->Seek(timestamp);
+  }
+  return false;
+}
+
 bool FileHandlerImpl::Open() {
   DataSource *source = dynamic_cast<DataSource *>(module_);
   param_ = source->GetSourceParam();
@@ -215,6 +241,51 @@ void FileHandlerImpl::Close() {
   DestroyPool();
 }
 
+bool FileHandlerImpl::Seek(int64_t timestamp) {
+  if (!running_.load() || timestamp < 0) {
+    LOGW(SOURCE) << "[FileHandlerImpl] Seek(): [" << stream_id_ << "]: Stream is not running or invalid timestamp";
+    return false;
+  }
+  seek_time_.store(timestamp);
+  return true;
+}
+
+int64_t FileHandlerImpl::FrameToTime(double frame_index) const {
+  if (stream_framerate_ <= 0) {
+    LOGW(SOURCE) << "[FileHandlerImpl] FrameToTime(): [" << stream_id_ << "]: Unknown framerate, frame index ignored";
+    return -1;
+  }
+  return static_cast<int64_t>(frame_index * 1000 / stream_framerate_);
+}
+
+bool FileHandlerImpl::SeekRange(int64_t timestamp) {
+  int64_t target_pts = -1;
+  if (parser_.Seek(timestamp, &target_pts) < 0) {
+    return false;
+  }
+  range_start_pts_ = target_pts;
+  VLOG1(SOURCE) << "[FileHandlerImpl] SeekRange(): [" << stream_id_ << "]: Seek to " << timestamp << "ms";
+  return true;
+}
+
+void FileHandlerImpl::ResetDecoder() {
+  if (!decoder_) return;
+  // The frames pending in the decoder are before the seek point, they are released with the decoder instead of
+  // being sent. The timestamps after the seek are rebased on the latest one sent, so they keep increasing even if
+  // the stream is seeked backward.
+  resetting_decoder_.store(true);
+  decoder_->Destroy();
+  resetting_decoder_.store(false);
+  decoder_.reset();
+  rebase_pts_ = true;
+  first_pts_ = range_start_pts_ >= 0 ? range_start_pts_ : 0;
+  first_pts_set_ = true;
+  timestamp_base_ = max_timestamp_ + pts_gap_;
+  if (!CreateDecoder()) {
+    LOGE(SOURCE) << "[FileHandlerImpl] ResetDecoder(): [" << stream_id_ << "]: Recreate decoder failed";
+  }
+}
+
 void FileHandlerImpl::Loop() {
   cnrtSetDevice(param_.device_id);
   if (!PrepareResources()) {
@@ -234,15 +305,21 @@ void FileHandlerImpl::Loop() {
 
   set_thread_name("demux_decode");
 
-  FrController controller(handle_param_.framerate);
-  if (handle_param_.framerate > 0) controller.Start();
+  FrController controller(handle_param_.framerate > 0 ? handle_param_.framerate : 0);
+  controller.SetSpeed(handle_param_.speed);
+  controller.Start();
 
   VLOG1(SOURCE) << "[FileHandlerImpl] Loop(): [" << stream_id_ << "]: DecoderLoop";
   while (running_.load()) {
     if (!Process()) {
       break;
     }
-    if (handle_param_.framerate > 0) controller.Control();
+    if (handle_param_.speed > 0) {
+      if (pts_parsed_) controller.Control(last_pts_);
+      pts_parsed_ = false;
+    } else if (handle_param_.framerate > 0) {
+      controller.Control();
+    }
   }
 
   VLOG1(SOURCE) << "[FileHandlerImpl] Loop(): [" << stream_id_ << "]: DecoderLoop Exit.";
@@ -256,6 +333,18 @@ bool FileHandlerImpl::PrepareResources(bool demux_only) {
   if (ret < 0 || dec_create_failed_) {
     return false;
   }
+
+  // half a frame margin for the timestamps rounding
+  int64_t start_time = handle_param_.start_frame >= 0 ? FrameToTime(handle_param_.start_frame - 0.5)
+                                                      : handle_param_.start_time;
+  int64_t end_time = handle_param_.end_frame >= 0 ? FrameToTime(handle_param_.end_frame + 0.5)
+                                                  : handle_param_.end_time;
+  range_start_pts_ = -1;
+  if (start_time > 0 && !SeekRange(start_time)) {
+    LOGW(SOURCE) << "[FileHandlerImpl] PrepareResources(): [" << stream_id_ << "]: Seek to start time failed, "
+                 << "play from the beginning";
+  }
+  parser_.SetEndTime(end_time, &range_end_pts_);
   return true;
 }
 
@@ -270,6 +359,14 @@ void FileHandlerImpl::ClearResources(bool demux_only) {
 }
 
 bool FileHandlerImpl::Process() {
+  int64_t seek_time = seek_time_.exchange(-1);
+  if (seek_time >= 0) {
+    if (SeekRange(seek_time)) {
+      ResetDecoder();
+    } else {
+      LOGW(SOURCE) << "[FileHandlerImpl] Process(): [" << stream_id_ << "]: Seek to " << seek_time << "ms failed";
+    }
+  }
   parser_.Parse();
   if (eos_reached_) {
     if (this->handle_param_.loop) {
@@ -291,6 +388,7 @@ bool FileHandlerImpl::Process() {
       }
       eos_reached_ = false;
       timestamp_base_ = timestamp_ + pts_gap_;
+      first_pts_set_ = false;
       return true;
     } else {
       LOGI(SOURCE) << "[FileHandlerImpl] Process(): loop false, eos_reached";
@@ -312,6 +410,16 @@ void FileHandlerImpl::OnParserInfo(VideoInfo *info) {
     return;  // for the case:  loop and reset demux only
   }
   LOGI(SOURCE) << "[FileHandlerImpl] OnParserInfo(): [" << stream_id_ << "]: Got video info.";
+  video_info_ = *info;  // kept to recreate the decoder on seeking
+  stream_framerate_ = info->framerate;
+  sampler_.SetCodec(info->codec_id);
+  if (!sampler_.SetFramerate(handle_param_.sample_framerate, info->framerate)) {
+    sampler_.SetInterval(handle_param_.sample_interval);
+  }
+  CreateDecoder();
+}
+
+bool FileHandlerImpl::CreateDecoder() {
   dec_create_failed_ = false;
   decoder_ = std::make_shared<MluDecoder>(stream_id_, this, this);
 
@@ -321,13 +429,14 @@ void FileHandlerImpl::OnParserInfo(VideoInfo *info) {
     extra.device_id = param_.device_id;
     extra.max_width = handle_param_.max_res.width;
     extra.max_height = handle_param_.max_res.height;
-    bool ret = decoder_->Create(info, &extra);
+    bool ret = decoder_->Create(&video_info_, &extra);
     if (ret != true) {
-      LOGE(SOURCE) << "[FileHandlerImpl] OnParserInfo(): Create decoder failed, ret = " << ret;
+      LOGE(SOURCE) << "[FileHandlerImpl] CreateDecoder(): Create decoder failed, ret = " << ret;
       dec_create_failed_ = true;
-      return;
+      return false;
     }
   }
+  return true;
 }
 
 void FileHandlerImpl::OnParserFrame(VideoEsFrame *frame) {
@@ -340,8 +449,10 @@ void FileHandlerImpl::OnParserFrame(VideoEsFrame *frame) {
   pkt.data = frame->data;
   pkt.len = frame->len;
   pkt.pts = frame->pts;
+  bool out_of_range = (range_start_pts_ >= 0 && frame->pts < range_start_pts_) ||
+                      (range_end_pts_ >= 0 && frame->pts > range_end_pts_);
 
-  if (this->handle_param_.loop) {
+  if (this->handle_param_.loop || rebase_pts_) {
     if (!first_pts_set_) {
       first_pts_ = pkt.pts, first_pts_set_ = true;
     }
@@ -349,6 +460,25 @@ void FileHandlerImpl::OnParserFrame(VideoEsFrame *frame) {
     timestamp_ = timestamp_base_ + (pkt.pts - first_pts_);
     pkt.pts = timestamp_;
   }
+  if (!out_of_range) {
+    // the packets discarded out of the range are not paced
+    last_pts_ = pkt.pts;
+    pts_parsed_ = true;
+    max_timestamp_ = std::max(max_timestamp_, static_cast<uint64_t>(pkt.pts));
+  }
+
+  if (out_of_range) {
+    // frames out of the playback range are decoded only if they are referenced by others
+    if (sampler_.IsDroppable(pkt.data, pkt.len)) return;
+    sampler_.MarkDiscard(pkt.pts);
+  } else {
+    VideoSampler::Decision decision = sampler_.Sample(pkt.data, pkt.len);
+    if (decision == VideoSampler::Decision::DROP) {
+      return;
+    } else if (decision == VideoSampler::Decision::DECODE_ONLY) {
+      sampler_.MarkDiscard(pkt.pts);
+    }
+  }
 
   if (module_profiler_) {
     auto record_key = std::make_pair(stream_id_, pkt.pts);
@@ -379,6 +509,12 @@ void FileHandlerImpl::OnDecodeError(DecodeErrorCode error_code) {
 }
 
 void FileHandlerImpl::OnDecodeFrame(cnedk::BufSurfWrapperPtr wrapper) {
+  if (resetting_decoder_.load()) {
+    return;  // flushed by a seek
+  }
+  if (sampler_.CheckDiscard(wrapper->GetPts())) {
+    return;  // decoded for reference only
+  }
   if (frame_count_++ % param_.interval != 0) {
     // LOGI(SOURCE) << "frames are discarded" << frame_count_;
     return;  // discard frames
@@ -406,6 +542,9 @@ void FileHandlerImpl::OnDecodeFrame(cnedk::BufSurfWrapperPtr wrapper) {
 }
 
 void FileHandlerImpl::OnDecodeEos() {
+  if (resetting_decoder_.load()) {
+    return;  // the stream goes on with the new decoder
+  }
   this->SendFlowEos();
   LOGI(SOURCE) << "[FileHandlerImpl] OnDecodeEos(): called";
 }
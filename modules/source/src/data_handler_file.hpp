@@ -69,6 +69,15 @@ class FileHandler : public SourceHandler {
    * @return No return value
    */
   void Close() override;
+  /*!
+   * @brief Seeks the stream to the given time. The seek is done in the demux thread before the next packet is read.
+   *        The decoder is recreated, so the frames pending in it are dropped.
+   *
+   * @param[in] timestamp The time in milliseconds, relative to the beginning of the file.
+   *
+   * @return Returns true if the request is accepted, otherwise returns false.
+   */
+  bool Seek(int64_t timestamp);
 
  private:
   FileHandlerImpl *impl_ = nullptr;
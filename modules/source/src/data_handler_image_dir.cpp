@@ -0,0 +1,478 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "opencv2/core/core.hpp"
+#include "opencv2/imgcodecs/imgcodecs.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+
+#include "cnedk_platform.h"
+#include "cnedk_buf_surface_util.hpp"
+#include "cnrt.h"
+#include "cnstream_common.hpp"
+#include "cnstream_logging.hpp"
+#include "data_handler_image_dir.hpp"
+#include "data_handler_util.hpp"
+#include "data_source.hpp"
+#include "libyuv.h"
+#include "platform_utils.hpp"
+#include "profiler/module_profiler.hpp"
+#include "profiler/pipeline_profiler.hpp"
+
+namespace cnstream {
+
+namespace {
+
+// A read-only mapping of a whole file. The pages are populated when it is mapped, so the reading is done by the
+// prefetching thread instead of the decoding threads.
+class MappedFile {
+ public:
+  static std::shared_ptr<MappedFile> Map(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return nullptr;
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size <= 0) {
+      close(fd);
+      return nullptr;
+    }
+    int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    flags |= MAP_POPULATE;
+#endif
+    void *addr = mmap(nullptr, st.st_size, PROT_READ, flags, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) return nullptr;
+    return std::shared_ptr<MappedFile>(new MappedFile(addr, st.st_size));
+  }
+  ~MappedFile() { munmap(addr_, size_); }
+
+  const uint8_t *Data() const { return static_cast<const uint8_t *>(addr_); }
+  size_t Size() const { return size_; }
+
+ private:
+  MappedFile(void *addr, size_t size) : addr_(addr), size_(size) {}
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  void *addr_;
+  size_t size_;
+};  // class MappedFile
+
+std::vector<std::string> ListFiles(const std::string &dir, const std::string &suffix) {
+  std::vector<std::string> files;
+  DIR *dp = opendir(dir.c_str());
+  if (!dp) return files;
+  struct dirent *entry;
+  while ((entry = readdir(dp)) != nullptr) {
+    std::string name(entry->d_name);
+    if (name == "." || name == "..") continue;
+    if (entry->d_type != DT_REG && entry->d_type != DT_UNKNOWN && entry->d_type != DT_LNK) continue;
+    if (!suffix.empty() &&
+        (name.size() < suffix.size() || name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0)) {
+      continue;
+    }
+    files.push_back(dir + "/" + name);
+  }
+  closedir(dp);
+  std::sort(files.begin(), files.end());
+  return files;
+}
+
+}  // namespace
+
+class ImageDirHandlerImpl : public SourceRender {
+ public:
+  explicit ImageDirHandlerImpl(DataSource *module, const ImageDirSourceParam &param, ImageDirHandler *handler)
+      : SourceRender(handler),
+        module_(module),
+        handle_param_(param),
+        handler_(*handler),
+        stream_id_(handler->GetStreamId()) {}
+  ~ImageDirHandlerImpl() { Close(); }
+
+  bool Open();
+  void Stop();
+  void Close();
+
+ private:
+  struct Job {
+    uint64_t index;
+    std::string path;
+    std::shared_ptr<MappedFile> file;
+  };
+
+  void ReadLoop();
+  void DecodeLoop();
+  void SendLoop();
+  cnedk::BufSurfWrapperPtr Decode(const Job &job);
+
+ private:
+  DataSource *module_ = nullptr;
+  DataSourceParam param_;
+  ImageDirSourceParam handle_param_;
+  ImageDirHandler &handler_;
+  std::string stream_id_;
+  CnedkPlatformInfo platform_info_;
+
+  std::vector<std::string> files_;
+  int width_ = 0;
+  int height_ = 0;
+  // the number of images read but not sent yet, it is less than bufpool_size, otherwise the decoding threads
+  // could hold all buffers for the images behind the next one to be sent.
+  uint64_t window_ = 1;
+
+  std::atomic<bool> running_{false};
+  std::thread read_thread_;
+  std::thread send_thread_;
+  std::vector<std::thread> decode_threads_;
+  std::unique_ptr<BoundedQueue<std::shared_ptr<Job>>> job_queue_;
+
+  std::mutex done_mutex_;
+  std::condition_variable done_cond_;    // an image is decoded or all images are read
+  std::condition_variable window_cond_;  // an image is sent
+  std::map<uint64_t, cnedk::BufSurfWrapperPtr> done_;  // nullptr if the image is failed to decode
+  uint64_t next_index_ = 0;
+  uint64_t end_index_ = 0;
+  bool read_done_ = false;
+
+  cnedk::BufPool pool_;
+  bool pool_created_ = false;
+  std::mutex pool_mutex_;
+
+  ModuleProfiler *module_profiler_ = nullptr;
+  PipelineProfiler *pipeline_profiler_ = nullptr;
+};  // class ImageDirHandlerImpl
+
+std::shared_ptr<SourceHandler> CreateSource(DataSource *module, const std::string &stream_id,
+                                            const ImageDirSourceParam &param) {
+  if (!module || stream_id.empty() || (param.dir.empty() && param.files.empty())) {
+    LOGE(SOURCE) << "CreateSource(): Create ImageDirHandler failed."
+                 << " source module, stream id and image directory must not be empty.";
+    return nullptr;
+  }
+  return std::make_shared<ImageDirHandler>(module, stream_id, param);
+}
+
+ImageDirHandler::ImageDirHandler(DataSource *module, const std::string &stream_id, const ImageDirSourceParam &param)
+    : SourceHandler(module, stream_id) {
+  impl_ = new (std::nothrow) ImageDirHandlerImpl(module, param, this);
+}
+
+ImageDirHandler::~ImageDirHandler() {
+  if (impl_) {
+    delete impl_, impl_ = nullptr;
+  }
+}
+
+bool ImageDirHandler::Open() {
+  if (!this->module_) {
+    LOGE(SOURCE) << "[ImageDirHandler] Open(): [" << stream_id_ << "]: module_ is null";
+    return false;
+  }
+  if (!impl_) {
+    LOGE(SOURCE) << "[ImageDirHandler] Open(): [" << stream_id_ << "]: no memory left";
+    return false;
+  }
+
+  if (stream_index_ == kInvalidStreamIdx) {
+    LOGE(SOURCE) << "[ImageDirHandler] Open(): [" << stream_id_ << "]: invalid stream_idx";
+    return false;
+  }
+
+  return impl_->Open();
+}
+
+void ImageDirHandler::Stop() {
+  if (impl_) {
+    impl_->Stop();
+  }
+}
+
+void ImageDirHandler::Close() {
+  if (impl_) {
+    impl_->Close();
+  }
+}
+
+bool ImageDirHandlerImpl::Open() {
+  DataSource *source = dynamic_cast<DataSource *>(module_);
+  if (nullptr == source) {
+    LOGE(SOURCE) << "[ImageDirHandlerImpl] Open(): [" << stream_id_ << "]: source module is null";
+    return false;
+  }
+  param_ = source->GetSourceParam();
+  cnrtSetDevice(param_.device_id);
+  if (CnedkPlatformGetInfo(param_.device_id, &platform_info_) < 0) {
+    LOGE(SOURCE) << "[ImageDirHandlerImpl] Open(): Get platform information failed";
+    return false;
+  }
+  std::string platform(platform_info_.name);
+
+  files_ = handle_param_.files.empty() ? ListFiles(handle_param_.dir, handle_param_.suffix) : handle_param_.files;
+  if (files_.empty()) {
+    LOGE(SOURCE) << "[ImageDirHandlerImpl] Open(): [" << stream_id_ << "]: no image found in " << handle_param_.dir;
+    return false;
+  }
+
+  if (handle_param_.out_res.width > 0 && handle_param_.out_res.height > 0) {
+    width_ = handle_param_.out_res.width;
+    height_ = handle_param_.out_res.height;
+  } else {
+    cv::Mat first = cv::imread(files_[0], cv::IMREAD_COLOR);
+    if (first.empty()) {
+      LOGE(SOURCE) << "[ImageDirHandlerImpl] Open(): [" << stream_id_ << "]: failed to decode " << files_[0];
+      return false;
+    }
+    width_ = first.cols;
+    height_ = first.rows;
+  }
+  // YUV420sp requires even width and height
+  width_ &= ~1;
+  height_ &= ~1;
+  if (width_ <= 0 || height_ <= 0) {
+    LOGE(SOURCE) << "[ImageDirHandlerImpl] Open(): [" << stream_id_ << "]: invalid resolution";
+    return false;
+  }
+
+  CnedkBufSurfaceCreateParams create_params;
+  memset(&create_params, 0, sizeof(create_params));
+  create_params.device_id = param_.device_id;
+  create_params.batch_size = 1;
+  create_params.color_format = CNEDK_BUF_COLOR_FORMAT_NV12;
+  create_params.width = width_;
+  create_params.height = height_;
+  if (IsEdgePlatform(platform)) {
+    create_params.mem_type = CNEDK_BUF_MEM_VB_CACHED;
+  } else {
+    create_params.mem_type = CNEDK_BUF_MEM_DEVICE;
+  }
+  {
+    std::unique_lock<std::mutex> lk(pool_mutex_);
+    if (pool_.CreatePool(&create_params, param_.bufpool_size)) {
+      LOGE(SOURCE) << "[ImageDirHandlerImpl] Open(): Create pool failed";
+      return false;
+    }
+    pool_created_ = true;
+  }
+
+  if (!module_profiler_) {
+    if (module_) module_profiler_ = module_->GetProfiler();
+    if (!pipeline_profiler_) {
+      if (module_->GetContainer()) pipeline_profiler_ = module_->GetContainer()->GetProfiler();
+    }
+  }
+
+  uint32_t decode_threads = std::max(1u, handle_param_.decode_threads);
+  window_ = std::max(1u, std::min(handle_param_.prefetch, param_.bufpool_size - 1));
+  job_queue_.reset(new BoundedQueue<std::shared_ptr<Job>>(window_));
+  next_index_ = 0;
+  end_index_ = 0;
+  read_done_ = false;
+  done_.clear();
+  eos_sent_ = false;
+  interrupt_.store(false);
+  VLOG1(SOURCE) << "[ImageDirHandlerImpl] Open(): [" << stream_id_ << "]: " << files_.size() << " images, "
+                << decode_threads << " decoding threads, prefetch " << window_;
+
+  running_.store(true);
+  read_thread_ = std::thread(&ImageDirHandlerImpl::ReadLoop, this);
+  for (uint32_t i = 0; i < decode_threads; ++i) {
+    decode_threads_.emplace_back(&ImageDirHandlerImpl::DecodeLoop, this);
+  }
+  send_thread_ = std::thread(&ImageDirHandlerImpl::SendLoop, this);
+  return true;
+}
+
+void ImageDirHandlerImpl::Stop() {
+  if (running_.load()) {
+    {
+      std::lock_guard<std::mutex> lk(done_mutex_);
+      running_.store(false);
+      interrupt_.store(true);
+    }
+    done_cond_.notify_all();
+    window_cond_.notify_all();
+  }
+  if (read_thread_.joinable()) read_thread_.join();
+  for (auto &thread : decode_threads_) {
+    if (thread.joinable()) thread.join();
+  }
+  decode_threads_.clear();
+  if (send_thread_.joinable()) send_thread_.join();
+  job_queue_.reset();
+  std::lock_guard<std::mutex> lk(done_mutex_);
+  done_.clear();
+}
+
+void ImageDirHandlerImpl::Close() {
+  Stop();
+  std::unique_lock<std::mutex> lk(pool_mutex_);
+  if (pool_created_) {
+    LOGI(SOURCE) << "[ImageDirHandlerImpl] Close(): this(" << this << ") Destroy pool";
+    pool_.DestroyPool(5000);
+    pool_created_ = false;
+  }
+}
+
+void ImageDirHandlerImpl::ReadLoop() {
+  set_thread_name("image_read");
+  uint64_t index = 0;
+  size_t file_idx = 0;
+  while (running_.load()) {
+    if (file_idx == files_.size()) {
+      if (!handle_param_.loop) break;
+      file_idx = 0;
+    }
+    const std::string &path = files_[file_idx++];
+    if (frame_count_++ % param_.interval != 0) {
+      continue;  // discard images before reading them
+    }
+    {
+      std::unique_lock<std::mutex> lk(done_mutex_);
+      window_cond_.wait(lk, [&]() { return !running_.load() || index - next_index_ < window_; });
+      if (!running_.load()) break;
+    }
+    std::shared_ptr<Job> job = std::make_shared<Job>();
+    job->index = index++;
+    job->path = path;
+    job->file = MappedFile::Map(path);
+    if (!job->file) {
+      LOGW(SOURCE) << "[ImageDirHandlerImpl] ReadLoop(): [" << stream_id_ << "]: failed to read " << path;
+    }
+    if (module_profiler_) {
+      auto record_key = std::make_pair(stream_id_, static_cast<int64_t>(job->index));
+      module_profiler_->RecordProcessStart(kPROCESS_PROFILER_NAME, record_key);
+      if (pipeline_profiler_) {
+        pipeline_profiler_->RecordInput(record_key);
+      }
+    }
+    // never blocks, the number of images in flight is limited by the window
+    job_queue_->Push(job);
+  }
+  std::lock_guard<std::mutex> lk(done_mutex_);
+  end_index_ = index;
+  read_done_ = true;
+  done_cond_.notify_one();
+}
+
+void ImageDirHandlerImpl::DecodeLoop() {
+  set_thread_name("image_decode");
+  std::shared_ptr<Job> job;
+  while (running_.load()) {
+    if (!job_queue_->Pop(100, job)) continue;
+    cnedk::BufSurfWrapperPtr wrapper = Decode(*job);
+    std::lock_guard<std::mutex> lk(done_mutex_);
+    done_[job->index] = std::move(wrapper);
+    if (job->index == next_index_) done_cond_.notify_one();
+  }
+}
+
+cnedk::BufSurfWrapperPtr ImageDirHandlerImpl::Decode(const Job &job) {
+  if (!job.file) return nullptr;
+  cv::Mat raw(1, static_cast<int>(job.file->Size()), CV_8UC1, const_cast<uint8_t *>(job.file->Data()));
+  cv::Mat bgr = cv::imdecode(raw, cv::IMREAD_COLOR);
+  if (bgr.empty()) {
+    LOGW(SOURCE) << "[ImageDirHandlerImpl] Decode(): [" << stream_id_ << "]: failed to decode " << job.path;
+    return nullptr;
+  }
+  if (bgr.cols != width_ || bgr.rows != height_) {
+    cv::Mat resized;
+    cv::resize(bgr, resized, cv::Size(width_, height_));
+    bgr = resized;
+  }
+
+  cnedk::BufSurfWrapperPtr wrapper;
+  {
+    std::unique_lock<std::mutex> lk(pool_mutex_);
+    wrapper = pool_.GetBufSurfaceWrapper(5000);
+  }
+  if (!wrapper) {
+    LOGW(SOURCE) << "[ImageDirHandlerImpl] Decode(): [" << stream_id_ << "]: get buffer failed, " << job.path
+                 << " is dropped";
+    return nullptr;
+  }
+  uint8_t *dst_y = static_cast<uint8_t *>(wrapper->GetHostData(0));
+  uint8_t *dst_uv = static_cast<uint8_t *>(wrapper->GetHostData(1));
+  // BGR24 in opencv is RGB24 in libyuv
+  libyuv::RGB24ToNV12(bgr.data, bgr.step, dst_y, wrapper->GetStride(0), dst_uv, wrapper->GetStride(1), width_,
+                      height_);
+  wrapper->SyncHostToDevice();
+  wrapper->SetPts(job.index);
+  return wrapper;
+}
+
+void ImageDirHandlerImpl::SendLoop() {
+  set_thread_name("image_send");
+  FrController controller(handle_param_.framerate > 0 ? handle_param_.framerate : 0);
+  controller.Start();
+  while (running_.load()) {
+    cnedk::BufSurfWrapperPtr wrapper;
+    {
+      std::unique_lock<std::mutex> lk(done_mutex_);
+      done_cond_.wait(lk, [this]() {
+        return !running_.load() || done_.count(next_index_) || (read_done_ && next_index_ == end_index_);
+      });
+      if (!running_.load()) break;
+      if (read_done_ && next_index_ == end_index_) {
+        lk.unlock();
+        SendFlowEos();
+        break;
+      }
+      auto iter = done_.find(next_index_);
+      wrapper = std::move(iter->second);
+      done_.erase(iter);
+      ++next_index_;
+    }
+    window_cond_.notify_one();
+    if (!wrapper) continue;  // failed to read or decode
+
+    if (handle_param_.framerate > 0) controller.Control();
+    std::shared_ptr<CNFrameInfo> data = this->CreateFrameInfo();
+    if (!data) {
+      LOGW(SOURCE) << "[ImageDirHandlerImpl] SendLoop(): failed to create FrameInfo.";
+      continue;
+    }
+    data->timestamp = wrapper->GetPts();
+    int ret = SourceRender::Process(data, std::move(wrapper), frame_id_++, param_);
+    if (ret < 0) {
+      LOGE(SOURCE) << "[ImageDirHandlerImpl] SendLoop(): [" << stream_id_ << "]: Render frame failed";
+      continue;
+    }
+    this->SendFrameInfo(data);
+  }
+}
+
+}  // namespace cnstream
@@ -0,0 +1,83 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_SOURCE_HANDLER_IMAGE_DIR_HPP_
+#define MODULES_SOURCE_HANDLER_IMAGE_DIR_HPP_
+
+#include <string>
+
+#include "data_handler_util.hpp"
+#include "data_source.hpp"
+
+namespace cnstream {
+
+class ImageDirHandlerImpl;
+/*!
+ * @class ImageDirHandler
+ *
+ * @brief ImageDirHandler is a class of source handler for a directory (or a list) of image files.
+ *
+ * The files are read ahead by a reader thread and decoded by a pool of CPU decoding threads into pooled
+ * YUV420spNV12 surfaces. The frames are sent in the order of the files.
+ */
+class ImageDirHandler : public SourceHandler {
+ public:
+  /*!
+   * @brief A constructor to construct a ImageDirHandler object.
+   *
+   * @param[in] module The data source module.
+   * @param[in] stream_id The stream id of the stream.
+   * @param[in] param The parameters of the handler.
+   *
+   * @return No return value.
+   */
+  explicit ImageDirHandler(DataSource *module, const std::string &stream_id, const ImageDirSourceParam &param);
+  /*!
+   * @brief The destructor of ImageDirHandler.
+   *
+   * @return No return value.
+   */
+  ~ImageDirHandler();
+  /*!
+   * @brief Opens source handler.
+   *
+   * @return Returns true if the source handler is opened successfully, otherwise returns false.
+   */
+  bool Open() override;
+  /*!
+   * @brief Stops source handler.
+   *
+   * @return No return value
+   */
+  void Stop() override;
+  /*!
+   * @brief Closes source handler.
+   *
+   * @return No return value.
+   */
+  void Close() override;
+
+ private:
+  ImageDirHandlerImpl *impl_ = nullptr;
+};  // class ImageDirHandler
+
+}  // namespace cnstream
+
+#endif  // MODULES_SOURCE_HANDLER_IMAGE_DIR_HPP_
@@ -28,11 +28,14 @@ extern "C" {
 }
 #endif
 
+#include <algorithm>
+#include <chrono>
 #include <memory>
 #include <sstream>
 #include <string>
 #include <thread>
 #include <utility>
+#include <vector>
 
 #include "cnrt.h"
 
@@ -47,9 +50,113 @@ extern "C" {
 #include "rtsp_client.hpp"
 #include "util/cnstream_queue.hpp"
 #include "video_decoder.hpp"
+#include "video_sampler.hpp"
 
 namespace cnstream {
 
+namespace rtsp_detail {
+struct StatsRecorder {
+  std::mutex mutex;
+  RtspStats stats;
+};
+
+class IDemuxer {
+ public:
+  IDemuxer(const std::string &stream_id, EsJitterBuffer *queue, StatsRecorder *recorder)
+      : stream_id_(stream_id), queue_(queue), recorder_(recorder) {}
+  virtual ~IDemuxer() {}
+  virtual bool PrepareResources(std::atomic<int> &exit_flag) = 0;  // NOLINT
+  virtual void ClearResources(std::atomic<int> &exit_flag) = 0;   // NOLINT
+  virtual bool Process() = 0;  // process one frame
+  bool GetInfo(VideoInfo &info) {  // NOLINT
+    std::unique_lock<std::mutex> lk(mutex_);
+    if (info_set_) {
+      info = info_;
+      return true;
+    }
+    return false;
+  }
+ protected:
+  void SetInfo(VideoInfo &info) {  // NOLINT
+    std::unique_lock<std::mutex> lk(mutex_);
+    info_ = info;
+    info_set_ = true;
+    lk.unlock();
+    // every connection starts from a key frame, and the decoder checks the stream info of it
+    if (queue_) queue_->NewSession(info);
+    new_session_ = true;
+  }
+  void OnDisconnected() {
+    if (!disconnected_) {
+      disconnected_ = true;
+      disconnect_time_ = std::chrono::steady_clock::now();
+    }
+  }
+  // Called from a single thread, the timestamps of a new connection continue from the previous connection.
+  void PushPacket(ESPacket *pkt) {
+    if (!(pkt->flags & static_cast<size_t>(ESPacket::FLAG::FLAG_EOS))) {
+      int64_t pts = static_cast<int64_t>(pkt->pts);
+      if (new_session_) {
+        new_session_ = false;
+        if (has_pts_) {
+          std::unique_lock<std::mutex> lk(mutex_);
+          int64_t step = info_.framerate > 0 ? static_cast<int64_t>(90000 / info_.framerate) : 3600;
+          pts_offset_ = max_pts_ + step - pts;
+        }
+      }
+      pts += pts_offset_;
+      max_pts_ = has_pts_ ? std::max(max_pts_, pts) : pts;
+      has_pts_ = true;
+      pkt->pts = static_cast<uint64_t>(pts);
+      RecordFrame();
+    }
+    if (queue_ && !queue_->Push(pkt)) {
+      std::lock_guard<std::mutex> lk(recorder_->mutex);
+      ++recorder_->stats.frames_dropped;
+    }
+    // sometimes users want to save the es packet data by themselves.
+    if (save_packet_cb_) {
+      save_packet_cb_(*pkt, stream_id_);
+    }
+  }
+  void RecordPackets(uint64_t received, uint64_t lost) {
+    std::lock_guard<std::mutex> lk(recorder_->mutex);
+    recorder_->stats.packets_received += received;
+    recorder_->stats.packets_lost += lost;
+  }
+
+  std::string stream_id_;
+  EsJitterBuffer *queue_ = nullptr;
+  std::function<void(cnstream::ESPacket, std::string)> save_packet_cb_ = nullptr;
+  std::mutex mutex_;
+  VideoInfo info_;
+  bool info_set_ = false;
+
+ private:
+  void RecordFrame() {
+    std::lock_guard<std::mutex> lk(recorder_->mutex);
+    ++recorder_->stats.frames_received;
+    if (disconnected_) {
+      disconnected_ = false;
+      auto elapsed = std::chrono::steady_clock::now() - disconnect_time_;
+      double ms = std::chrono::duration<double, std::milli>(elapsed).count();
+      ++recorder_->stats.reconnect_count;
+      recorder_->stats.last_reconnect_time = ms;
+      recorder_->stats.max_reconnect_time = std::max(recorder_->stats.max_reconnect_time, ms);
+      LOGI(SOURCE) << "[" << stream_id_ << "]: Reconnected, the stream is recovered in " << ms << " ms";
+    }
+  }
+
+  StatsRecorder *recorder_ = nullptr;
+  bool new_session_ = false;
+  bool has_pts_ = false;
+  int64_t max_pts_ = 0;
+  int64_t pts_offset_ = 0;
+  bool disconnected_ = false;
+  std::chrono::steady_clock::time_point disconnect_time_;
+};
+}  // namespace rtsp_detail
+
 class RtspHandlerImpl : public IDecodeResult, public SourceRender, public IUserPool {
  public:
   explicit RtspHandlerImpl(DataSource *module, const RtspSourceParam &param, RtspHandler *handler)
@@ -62,6 +169,7 @@ class RtspHandlerImpl : public IDecodeResult, public SourceRender, public IUserP
   bool Open();
   void Stop();
   void Close();
+  bool GetStats(RtspStats *stats);
 
  private:
   DataSource *module_ = nullptr;
@@ -87,9 +195,17 @@ class RtspHandlerImpl : public IDecodeResult, public SourceRender, public IUserP
  private:
   void DemuxLoop();
   void DecodeLoop();
+  std::unique_ptr<Decoder> CreateDecoder(VideoInfo *info);
+
+  struct RetiredPool {
+    CnedkBufSurfaceCreateParams params;
+    std::unique_ptr<cnedk::BufPool> pool;
+  };
 
   std::shared_ptr<Decoder> decoder_ = nullptr;
-  cnedk::BufPool pool_;
+  std::unique_ptr<cnedk::BufPool> pool_{new cnedk::BufPool};
+  // the pools replaced on a buffer info change, the frames sent may still hold their buffers
+  std::vector<RetiredPool> retired_pools_;
   bool pool_created_ = false;
   std::mutex mutex_;
   std::atomic<int> demux_exit_flag_ {0};
@@ -99,10 +215,13 @@ class RtspHandlerImpl : public IDecodeResult, public SourceRender, public IUserP
   std::atomic<bool> stream_info_set_{false};
   std::mutex stream_info_mutex_;
   VideoInfo stream_info_{};
-  BoundedQueue<std::shared_ptr<EsPacket>> *queue_ = nullptr;
+  EsJitterBuffer *queue_ = nullptr;
   std::mutex stop_mutex_;
+  std::atomic<bool> recreating_decoder_{false};
+  rtsp_detail::StatsRecorder stats_recorder_;
 
   uint32_t interval_ = 1;
+  VideoSampler sampler_;
   ModuleProfiler *module_profiler_ = nullptr;
   PipelineProfiler *pipeline_profiler_ = nullptr;
 };  // class RtspHandlerImpl
@@ -127,49 +246,30 @@ RtspHandler::~RtspHandler() {
   if (impl_) delete impl_, impl_ = nullptr;
 }
 
-namespace rtsp_detail {
-class IDemuxer {
- public:
-  virtual ~IDemuxer() {}
-  virtual bool PrepareResources(std::atomic<int> &exit_flag) = 0;  // NOLINT
-  virtual void ClearResources(std::atomic<int> &exit_flag) = 0;   // NOLINT
-  virtual bool Process() = 0;  // process one frame
-  bool GetInfo(VideoInfo &info) {  // NOLINT
-    std::unique_lock<std::mutex> lk(mutex_);
-    if (info_set_) {
-      info = info_;
-      return true;
-    }
-    return false;
-  }
- protected:
-  void SetInfo(VideoInfo &info) {  // NOLINT
-    std::unique_lock<std::mutex> lk(mutex_);
-    info_ = info;
-    info_set_ = true;
-  }
-  std::function<void(cnstream::ESPacket, std::string)> save_packet_cb_ = nullptr;
-  std::mutex mutex_;
-  VideoInfo info_;
-  bool info_set_ = false;
-};
-}  // namespace rtsp_detail
+int GetRtspStats(std::shared_ptr<SourceHandler> handler, RtspStats *stats) {
+  auto handle = std::dynamic_pointer_cast<RtspHandler>(handler);
+  if (!handle || !stats) return -1;
+  return handle->GetStats(stats) ? 0 : -1;
+}
 
 class FFmpegDemuxer : public rtsp_detail::IDemuxer, public IParserResult {
  public:
-  FFmpegDemuxer(const std::string &stream_id, FrameQueue *queue, const std::string &url,
-                bool only_key_frame, std::function<void(ESPacket, std::string)> cb = nullptr)
-      : rtsp_detail::IDemuxer(),
-        queue_(queue),
-        url_name_(url),
+  FFmpegDemuxer(const std::string &stream_id, EsJitterBuffer *queue, rtsp_detail::StatsRecorder *recorder,
+                const RtspSourceParam &param)
+      : rtsp_detail::IDemuxer(stream_id, queue, recorder),
+        url_name_(param.url_name),
         parser_(stream_id),
-        only_key_frame_(only_key_frame) {
-    save_packet_cb_ = cb;
+        only_key_frame_(param.only_key_frame),
+        reconnect_(param.reconnect),
+        min_interval_(std::max<uint32_t>(param.reconnect_min_interval, 10)),
+        max_interval_(std::max(param.reconnect_max_interval, min_interval_)) {
+    save_packet_cb_ = param.callback;
   }
 
   ~FFmpegDemuxer() { }
 
   bool PrepareResources(std::atomic<int> &exit_flag) override {
+    exit_flag_ = &exit_flag;
     if (parser_.Open(url_name_, this, only_key_frame_) == 0) {
       eos_reached_ = false;
       return true;
@@ -183,10 +283,13 @@ class FFmpegDemuxer : public rtsp_detail::IDemuxer, public IParserResult {
 
   bool Process() override {
     parser_.Parse();
-    if (eos_reached_) {
-      return false;
+    if (!eos_reached_ || Reconnect() || *exit_flag_) {
+      return true;
     }
-    return true;
+    ESPacket pkt;
+    pkt.flags = static_cast<size_t>(ESPacket::FLAG::FLAG_EOS);
+    PushPacket(&pkt);
+    return false;
   }
 
   // IParserResult methods
@@ -203,38 +306,51 @@ class FFmpegDemuxer : public rtsp_detail::IDemuxer, public IParserResult {
       if (frame->flags & AV_PKT_FLAG_KEY) {
         pkt.flags |= static_cast<size_t>(ESPacket::FLAG::FLAG_KEY_FRAME);
       }
+      PushPacket(&pkt);
     } else {
-      pkt.flags = static_cast<size_t>(ESPacket::FLAG::FLAG_EOS);
+      // the end of a live stream means the connection is lost, EOS is sent if it could not be reconnected
       eos_reached_ = true;
     }
-    if (queue_) {
-      queue_->Push(std::make_shared<EsPacket>(&pkt));
-    }
-    // sometimes users want to save the es packet data by themselves.
-    if (save_packet_cb_) {
-      save_packet_cb_(pkt, parser_.GetStreamID());
-    }
   }
 
  private:
-  FrameQueue *queue_ = nullptr;
+  bool Reconnect() {
+    OnDisconnected();
+    uint32_t interval = min_interval_;
+    for (int retry = 0; reconnect_ < 0 || retry < reconnect_; ++retry) {
+      LOGW(SOURCE) << "[FFmpegDemuxer] Reconnect(): [" << stream_id_ << "]: Reconnect in " << interval << " ms";
+      auto wake = std::chrono::steady_clock::now() + std::chrono::milliseconds(interval);
+      while (std::chrono::steady_clock::now() < wake) {
+        if (*exit_flag_) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+      parser_.Close();
+      if (parser_.Open(url_name_, this, only_key_frame_) == 0) {
+        eos_reached_ = false;
+        return true;
+      }
+      interval = std::min(interval * 2, max_interval_);
+    }
+    LOGE(SOURCE) << "[FFmpegDemuxer] Reconnect(): [" << stream_id_ << "]: Reconnect failed";
+    return false;
+  }
+
   std::string url_name_;
   FFParser parser_;
   bool eos_reached_ = false;
   bool only_key_frame_ = false;
+  int reconnect_ = 0;
+  uint32_t min_interval_;
+  uint32_t max_interval_;
+  std::atomic<int> *exit_flag_ = nullptr;
 };  // class FFmpegDemuxer
 
 class Live555Demuxer : public rtsp_detail::IDemuxer, public IRtspCB {
  public:
-  Live555Demuxer(const std::string &stream_id, FrameQueue *queue, const std::string &url, int reconnect,
-                 bool only_key_frame, std::function<void(ESPacket, std::string)> cb = nullptr)
-      : rtsp_detail::IDemuxer(),
-        stream_id_(stream_id),
-        queue_(queue),
-        url_(url),
-        reconnect_(reconnect),
-        only_key_frame_(only_key_frame) {
-    save_packet_cb_ = cb;
+  Live555Demuxer(const std::string &stream_id, EsJitterBuffer *queue, rtsp_detail::StatsRecorder *recorder,
+                 const RtspSourceParam &param)
+      : rtsp_detail::IDemuxer(stream_id, queue, recorder), param_(param) {
+    save_packet_cb_ = param.callback;
   }
 
   virtual ~Live555Demuxer() {}
@@ -243,9 +359,12 @@ class Live555Demuxer : public rtsp_detail::IDemuxer, public IRtspCB {
     VLOG1(SOURCE) << "[Live555Demuxer] PrepareResources(): [" << stream_id_ << "]: Begin";
     // start rtsp_client
     cnstream::OpenParam param;
-    param.url = url_;
-    param.reconnect = reconnect_;
-    param.only_key_frame = only_key_frame_;
+    param.url = param_.url_name;
+    param.reconnect = param_.reconnect;
+    param.reconnectMinIntervalMs = param_.reconnect_min_interval;
+    param.reconnectMaxIntervalMs = param_.reconnect_max_interval;
+    param.reorderTimeMs = param_.reorder_time;
+    param.only_key_frame = param_.only_key_frame;
     param.cb = dynamic_cast<IRtspCB*>(this);
     rtsp_session_.Open(param);
 
@@ -259,6 +378,7 @@ class Live555Demuxer : public rtsp_detail::IDemuxer, public IRtspCB {
       if (connect_failed_) {
         return false;
       }
+      usleep(1000);
     }
     if (exit_flag) {
       return false;
@@ -307,24 +427,21 @@ class Live555Demuxer : public rtsp_detail::IDemuxer, public IRtspCB {
         connect_failed_.store(true);
       }
     }
-    if (queue_) {
-      queue_->Push(std::make_shared<EsPacket>(&pkt));
-    }
+    PushPacket(&pkt);
+  }
 
-    // sometimes users want to save the es packet data by themselves.
-    if (save_packet_cb_) {
-      save_packet_cb_(pkt, stream_id_);
+  void OnRtspEvent(int type) override {
+    if (type == RTSP_EVENT_DISCONNECTED) {
+      OnDisconnected();
     }
   }
 
-  void OnRtspEvent(int type) override {}
+  void OnRtspStats(uint64_t received, uint64_t lost) override {
+    RecordPackets(received, lost);
+  }
 
  private:
-  std::string stream_id_;
-  FrameQueue *queue_ = nullptr;
-  std::string url_;
-  int reconnect_ = 0;
-  bool only_key_frame_ = false;
+  RtspSourceParam param_;
   RtspSession rtsp_session_;
   std::atomic<bool> connect_done_{false};
   std::atomic<bool> connect_failed_{false};
@@ -362,6 +479,13 @@ void RtspHandler::Close() {
   }
 }
 
+bool RtspHandler::GetStats(RtspStats *stats) {
+  if (impl_) {
+    return impl_->GetStats(stats);
+  }
+  return false;
+}
+
 bool RtspHandlerImpl::Open() {
   DataSource *source = dynamic_cast<DataSource *>(module_);
   param_ = source->GetSourceParam();
@@ -401,8 +525,7 @@ bool RtspHandlerImpl::Open() {
 
   interval_ = handle_param_.interval ? handle_param_.interval : param_.interval;
 
-  size_t maxSize = 60;  // FIXME
-  queue_ = new FrameQueue(maxSize);
+  queue_ = new (std::nothrow) EsJitterBuffer(handle_param_.buffer_size);
   if (!queue_) {
     return false;
   }
@@ -437,19 +560,31 @@ void RtspHandlerImpl::Stop() {
 
 void RtspHandlerImpl::Close() {
   Stop();
+  RtspStats stats;
+  GetStats(&stats);
+  LOGI(SOURCE) << "[RtspHandlerImpl] Close(): [" << stream_id_ << "]: frames received " << stats.frames_received
+               << ", dropped " << stats.frames_dropped << ", RTP packets received " << stats.packets_received
+               << ", lost " << stats.packets_lost << ", reconnected " << stats.reconnect_count
+               << " times (max " << stats.max_reconnect_time << " ms), decoder recreated "
+               << stats.decoder_recreate_count << " times";
   LOGI(SOURCE) << "[RtspHandlerImpl] Close(): this(" << this << ") Destroy pool";
   DestroyPool();
 }
 
+bool RtspHandlerImpl::GetStats(RtspStats *stats) {
+  if (!stats) return false;
+  std::lock_guard<std::mutex> lk(stats_recorder_.mutex);
+  *stats = stats_recorder_.stats;
+  return true;
+}
+
 void RtspHandlerImpl::DemuxLoop() {
   VLOG1(SOURCE) << "[RtspHandlerImpl] DemuxLoop(): [" << stream_id_ << "]: Create demuxer...";
   std::unique_ptr<rtsp_detail::IDemuxer> demuxer;
   if (handle_param_.use_ffmpeg) {
-    demuxer.reset(new FFmpegDemuxer(stream_id_, queue_, handle_param_.url_name,
-                                    handle_param_.only_key_frame, handle_param_.callback));
+    demuxer.reset(new FFmpegDemuxer(stream_id_, queue_, &stats_recorder_, handle_param_));
   } else {
-    demuxer.reset(new Live555Demuxer(stream_id_, queue_, handle_param_.url_name, handle_param_.reconnect,
-                                     handle_param_.only_key_frame, handle_param_.callback));
+    demuxer.reset(new Live555Demuxer(stream_id_, queue_, &stats_recorder_, handle_param_));
   }
   if (!demuxer) {
     LOGE(SOURCE) << "[RtspHandlerImpl] DemuxLoop(): [" << stream_id_ << "]: Failed to create demuxer";
@@ -495,6 +630,51 @@ void RtspHandlerImpl::DemuxLoop() {
   demuxer->ClearResources(demux_exit_flag_);
 }
 
+namespace {
+// The decoder is reused after reconnecting unless these parameters changed.
+bool IsSameCodec(const VideoInfo &a, const VideoInfo &b) {
+  return a.codec_id == b.codec_id && a.width == b.width && a.height == b.height && a.progressive == b.progressive &&
+         a.extra_data == b.extra_data;
+}
+}  // namespace
+
+std::unique_ptr<Decoder> RtspHandlerImpl::CreateDecoder(VideoInfo *info) {
+  std::unique_ptr<Decoder> decoder(new (std::nothrow) MluDecoder(stream_id_, this, this));
+  if (!decoder) {
+    LOGE(SOURCE) << "[RtspHandlerImpl] CreateDecoder(): New decoder failed.";
+    return nullptr;
+  }
+
+  decoder->SetPlatformName(platform_info_.name);
+  ExtraDecoderInfo extra;
+  extra.device_id = param_.device_id;
+  extra.max_width = handle_param_.max_res.width;
+  extra.max_height = handle_param_.max_res.height;
+  if (!decoder->Create(info, &extra)) {
+    LOGE(SOURCE) << "[RtspHandlerImpl] CreateDecoder(): Create decoder failed.";
+    decoder->Destroy();
+    return nullptr;
+  }
+
+  sampler_.SetCodec(info->codec_id);
+  if (!sampler_.SetFramerate(handle_param_.sample_framerate, info->framerate)) {
+    sampler_.SetInterval(handle_param_.sample_interval);
+  }
+
+  // feed extradata first
+  if (info->extra_data.size()) {
+    VideoEsPacket pkt;
+    pkt.data = info->extra_data.data();
+    pkt.len = info->extra_data.size();
+    pkt.pts = 0;
+    if (!decoder->Process(&pkt)) {
+      decoder->Destroy();
+      return nullptr;
+    }
+  }
+  return decoder;
+}
+
 void RtspHandlerImpl::DecodeLoop() {
   cnrtSetDevice(param_.device_id);
 
@@ -509,52 +689,44 @@ void RtspHandlerImpl::DecodeLoop() {
     return;
   }
 
-  std::unique_ptr<Decoder> decoder_ = nullptr;
-  decoder_.reset(new MluDecoder(stream_id_, this, this));
-  if (!decoder_) {
-    LOGE(SOURCE) << "[RtspHandlerImpl] DecodeLoop(): New decoder failed.";
-    return;
+  VideoInfo info;
+  {
+    std::lock_guard<std::mutex> lk(stream_info_mutex_);
+    info = stream_info_;
   }
-
-  decoder_->SetPlatformName(platform_info_.name);
-  ExtraDecoderInfo extra;
-  extra.device_id = param_.device_id;
-  extra.max_width = handle_param_.max_res.width;
-  extra.max_height = handle_param_.max_res.height;
-  std::unique_lock<std::mutex> lk(stream_info_mutex_);
-  bool ret = decoder_->Create(&stream_info_, &extra);
-  if (!ret) {
-    LOGE(SOURCE) << "[RtspHandlerImpl] DecodeLoop(): Create decoder failed.";
-    decoder_->Destroy();
+  std::unique_ptr<Decoder> decoder = CreateDecoder(&info);
+  if (!decoder) {
     return;
   }
 
-
-  // feed extradata first
-  if (stream_info_.extra_data.size()) {
-    VideoEsPacket pkt;
-    pkt.data = stream_info_.extra_data.data();
-    pkt.len = stream_info_.extra_data.size();
-    pkt.pts = 0;
-    if (!decoder_->Process(&pkt)) {
-      return;
-    }
-  }
-  lk.unlock();
-
-  using EsPacketPtr = std::shared_ptr<EsPacket>;
   while (!decode_exit_flag_) {
-    EsPacketPtr in;
+    EsJitterBuffer::Entry entry;
     int timeoutMs = 1000;
-    bool ret = this->queue_->Pop(timeoutMs, in);
-    if (!ret) {
+    if (!this->queue_->Pop(timeoutMs, &entry)) {
       VLOG1(SOURCE) << "[RtspHandlerImpl] DecodeLoop(): [" << stream_id_ << "]: Read packet Timeout";
       continue;
     }
 
+    if (entry.info && !IsSameCodec(*entry.info, info)) {
+      LOGI(SOURCE) << "[RtspHandlerImpl] DecodeLoop(): [" << stream_id_ << "]: Codec parameters changed, "
+                   << "recreate decoder";
+      recreating_decoder_.store(true);
+      decoder->Destroy();
+      recreating_decoder_.store(false);
+      info = *entry.info;
+      decoder = CreateDecoder(&info);
+      if (!decoder) {
+        OnDecodeError(DecodeErrorCode::ERROR_FAILED_TO_START);
+        return;
+      }
+      std::lock_guard<std::mutex> lk(stats_recorder_.mutex);
+      ++stats_recorder_.stats.decoder_recreate_count;
+    }
+
+    std::shared_ptr<EsPacket> in = std::move(entry.pkt);
     if (in->pkt_.flags & static_cast<size_t>(ESPacket::FLAG::FLAG_EOS)) {
       LOGI(SOURCE) << "[RtspHandlerImpl] DecodeLoop(): [" << stream_id_ << "]: EOS reached";
-      decoder_->Process(nullptr);
+      decoder->Process(nullptr);
       break;
     }  // if (eos)
 
@@ -563,6 +735,13 @@ void RtspHandlerImpl::DecodeLoop() {
     pkt.len = in->pkt_.size;
     pkt.pts = in->pkt_.pts;
 
+    VideoSampler::Decision decision = sampler_.Sample(pkt.data, pkt.len);
+    if (decision == VideoSampler::Decision::DROP) {
+      continue;
+    } else if (decision == VideoSampler::Decision::DECODE_ONLY) {
+      sampler_.MarkDiscard(pkt.pts);
+    }
+
     if (module_profiler_) {
       auto record_key = std::make_pair(stream_id_, pkt.pts);
       module_profiler_->RecordProcessStart(kPROCESS_PROFILER_NAME, record_key);
@@ -571,15 +750,15 @@ void RtspHandlerImpl::DecodeLoop() {
       }
     }
 
-    if (!decoder_->Process(&pkt)) {
+    if (!decoder->Process(&pkt)) {
       break;
     }
     std::this_thread::yield();
   }
 
   VLOG1(SOURCE) << "[RtspHandlerImpl] DecodeLoop(): [" << stream_id_ << "]: Exit";
-  if (decoder_.get()) {
-    decoder_->Destroy();
+  if (decoder.get()) {
+    decoder->Destroy();
   }
 }
 
@@ -599,6 +778,9 @@ void RtspHandlerImpl::OnDecodeError(DecodeErrorCode error_code) {
 }
 
 void RtspHandlerImpl::OnDecodeFrame(cnedk::BufSurfWrapperPtr wrapper) {
+  if (sampler_.Enabled() && sampler_.CheckDiscard(wrapper->GetPts())) {
+    return;  // decoded for reference only
+  }
   if (frame_count_++ % interval_ != 0) {
     return;  // discard frames
   }
@@ -625,6 +807,9 @@ void RtspHandlerImpl::OnDecodeFrame(cnedk::BufSurfWrapperPtr wrapper) {
 }
 
 void RtspHandlerImpl::OnDecodeEos() {
+  if (recreating_decoder_) {
+    return;  // the stream goes on with the new decoder
+  }
   this->SendFlowEos();
   LOGI(SOURCE) << "[RtspHandlerImpl] OnDecodeEos(): called";
 }
@@ -632,7 +817,7 @@ void RtspHandlerImpl::OnDecodeEos() {
 
 int RtspHandlerImpl::CreatePool(CnedkBufSurfaceCreateParams *params, uint32_t block_count) {
   std::unique_lock<std::mutex> lk(mutex_);
-  if (!pool_.CreatePool(params, block_count)) {
+  if (!pool_->CreatePool(params, block_count)) {
     pool_created_ = true;
     return 0;
   }
@@ -642,27 +827,54 @@ int RtspHandlerImpl::CreatePool(CnedkBufSurfaceCreateParams *params, uint32_t bl
 
 void RtspHandlerImpl::DestroyPool() {
   std::unique_lock<std::mutex> lk(mutex_);
-  pool_.DestroyPool(5000);
+  pool_->DestroyPool(5000);
+  for (auto &retired : retired_pools_) retired.pool->DestroyPool(5000);
+  retired_pools_.clear();
 }
 
 void RtspHandlerImpl::OnBufInfo(int width, int height, CnedkBufSurfaceColorFormat fmt) {
-  // TODO(liujian): we create according to the first time (ignore Buffer Info changing).
   std::string platform(platform_info_.name);
   if (IsEdgePlatform(platform)) {
-    std::unique_lock<std::mutex> lk(mutex_);
-    if (pool_created_) return;
-    LOGI(SOURCE) << "[RtspHandlerImpl] OnBufInfo() Create pool";
-    memset(&create_params_, 0, sizeof(CnedkBufSurfaceCreateParams));
-    create_params_.device_id = param_.device_id;
-    create_params_.batch_size = 1;
+    CnedkBufSurfaceCreateParams params;
+    memset(&params, 0, sizeof(CnedkBufSurfaceCreateParams));
+    params.device_id = param_.device_id;
+    params.batch_size = 1;
     if (fmt != CNEDK_BUF_COLOR_FORMAT_NV12 && fmt == CNEDK_BUF_COLOR_FORMAT_NV21) {
-      create_params_.color_format = CNEDK_BUF_COLOR_FORMAT_NV12;
+      params.color_format = CNEDK_BUF_COLOR_FORMAT_NV12;
     }
-    create_params_.width = width;
-    create_params_.height = height;
-    create_params_.mem_type = CNEDK_BUF_MEM_VB_CACHED;
+    params.width = width;
+    params.height = height;
+    params.mem_type = CNEDK_BUF_MEM_VB_CACHED;
 
-    if (!pool_.CreatePool(&create_params_, param_.bufpool_size)) {
+    std::unique_lock<std::mutex> lk(mutex_);
+    if (pool_created_) {
+      // the pool of out_res is kept, so is the pool of the same buffer info after the decoder is recreated
+      if (handle_param_.out_res.width > 0 && handle_param_.out_res.height > 0) return;
+      if (params.width == create_params_.width && params.height == create_params_.height &&
+          params.color_format == create_params_.color_format) {
+        return;
+      }
+      // The frames sent may still hold the buffers of the pool, so it is not destroyed in the decode loop. It is
+      // kept until the handler is closed, or reused if the buffer info changes back.
+      LOGI(SOURCE) << "[RtspHandlerImpl] OnBufInfo() Buffer info changed to " << width << "x" << height
+                   << ", switch pool";
+      retired_pools_.push_back({create_params_, std::move(pool_)});
+      pool_created_ = false;
+      for (auto iter = retired_pools_.begin(); iter != retired_pools_.end(); ++iter) {
+        if (iter->params.width == params.width && iter->params.height == params.height &&
+            iter->params.color_format == params.color_format) {
+          create_params_ = iter->params;
+          pool_ = std::move(iter->pool);
+          retired_pools_.erase(iter);
+          pool_created_ = true;
+          return;
+        }
+      }
+      pool_.reset(new cnedk::BufPool);
+    }
+    LOGI(SOURCE) << "[RtspHandlerImpl] OnBufInfo() Create pool";
+    create_params_ = params;
+    if (!pool_->CreatePool(&create_params_, param_.bufpool_size)) {
       pool_created_ = true;
     } else {
       LOGE(SOURCE) << "[RtspHandlerImpl] OnBufInfo() Create pool failed";
@@ -683,11 +895,11 @@ cnedk::BufSurfWrapperPtr RtspHandlerImpl::GetBufSurface(int timeout_ms) {
   std::string platform(platform_info_.name);
   if (IsEdgePlatform(platform)) {
     std::unique_lock<std::mutex> lk(mutex_);
-    return pool_.GetBufSurfaceWrapper(timeout_ms);
+    return pool_->GetBufSurfaceWrapper(timeout_ms);
   } else if (IsCloudPlatform(platform)) {
     if (pool_created_) {
       std::unique_lock<std::mutex> lk(mutex_);
-      return pool_.GetBufSurfaceWrapper(timeout_ms);
+      return pool_->GetBufSurfaceWrapper(timeout_ms);
     }
     CnedkBufSurface *surf = nullptr;
     if (CnedkBufSurfaceCreate(&surf, &create_params_) < 0) {
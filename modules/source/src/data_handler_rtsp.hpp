@@ -70,6 +70,14 @@ class RtspHandler : public SourceHandler {
    * @return No return value
    */
   void Close() override;
+  /*!
+   * @brief Gets the statistics of the stream.
+   *
+   * @param[out] stats The statistics.
+   *
+   * @return Returns true if the statistics are got successfully, otherwise returns false.
+   */
+  bool GetStats(RtspStats *stats);
 
  private:
   RtspHandlerImpl *impl_ = nullptr;
@@ -21,6 +21,8 @@
 #include <memory>
 #include <utility>
 
+#include "cnstream_common.hpp"
+
 #include "private/cnstream_allocator.hpp"
 
 namespace cnstream {
@@ -46,4 +48,75 @@ int SourceRender::Process(std::shared_ptr<CNFrameInfo> frame_info, cnedk::BufSur
   return 0;
 }
 
+constexpr std::chrono::milliseconds FrController::kMaxLag;
+constexpr double FrController::kMaxPtsJump;
+constexpr double FrController::kMaxPtsReorder;
+
+// the timer thread spins for the last part of a wait, sleeping is not accurate enough.
+// It does not spin on a single core, where it would only delay the threads to be woken up.
+static constexpr std::chrono::microseconds kSpinTime{300};
+
+PacingTimer &PacingTimer::Instance() {
+  static PacingTimer instance;
+  return instance;
+}
+
+PacingTimer::PacingTimer() { thread_ = std::thread(&PacingTimer::Loop, this); }
+
+PacingTimer::~PacingTimer() {
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    exit_ = true;
+  }
+  cond_.notify_one();
+  if (thread_.joinable()) thread_.join();
+}
+
+void PacingTimer::WaitUntil(const Clock::time_point &deadline) {
+  if (Clock::now() >= deadline) return;
+  Waiter waiter;
+  waiter.deadline = deadline;
+  std::unique_lock<std::mutex> lk(mutex_);
+  if (exit_) {
+    lk.unlock();
+    std::this_thread::sleep_until(deadline);
+    return;
+  }
+  bool earliest = waiters_.empty() || deadline < waiters_.top()->deadline;
+  waiters_.push(&waiter);
+  if (earliest) cond_.notify_one();
+  waiter.cond.wait(lk, [&waiter]() { return waiter.done; });
+}
+
+void PacingTimer::Loop() {
+  set_thread_name("pacing_timer");
+  const std::chrono::microseconds spin_time =
+      std::thread::hardware_concurrency() > 1 ? kSpinTime : std::chrono::microseconds(0);
+  std::unique_lock<std::mutex> lk(mutex_);
+  while (!exit_ || !waiters_.empty()) {
+    if (waiters_.empty()) {
+      cond_.wait(lk, [this]() { return exit_ || !waiters_.empty(); });
+      continue;
+    }
+    Clock::time_point deadline = waiters_.top()->deadline;
+    if (!exit_ && Clock::now() + spin_time < deadline) {
+      // woken up earlier if a new earliest deadline comes
+      cond_.wait_until(lk, deadline - spin_time);
+      continue;
+    }
+    lk.unlock();
+    while (Clock::now() < deadline) {
+      std::this_thread::yield();
+    }
+    lk.lock();
+    Clock::time_point now = Clock::now();
+    while (!waiters_.empty() && (exit_ || waiters_.top()->deadline <= now)) {
+      Waiter *waiter = waiters_.top();
+      waiters_.pop();
+      waiter->done = true;
+      waiter->cond.notify_one();
+    }
+  }
+}
+
 }  // namespace cnstream
@@ -26,6 +26,7 @@
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <deque>
 #include <iostream>
 #include <memory>
 #include <mutex>
@@ -33,6 +34,7 @@
 #include <sstream>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include "cnstream_frame_va.hpp"
 #include "cnstream_logging.hpp"
@@ -143,6 +145,88 @@ class BoundedQueue {
 };
 using FrameQueue = BoundedQueue<std::shared_ptr<EsPacket>>;
 
+/***********************************************************************
+ * @brief EsJitterBuffer buffers the packets of a live stream between receiving and decoding.
+ *
+ * Push never blocks, so a slow decoder does not stall the receiving, where the packets would be lost at the socket.
+ * When the buffer is full, the packet and the following ones are dropped until the next key frame, so that the
+ * decoder always gets a decodable stream. Each session (connection) also starts from a key frame, and the stream
+ * information of the session is delivered with its first packet.
+ ***********************************************************************/
+class EsJitterBuffer {
+ public:
+  struct Entry {
+    std::shared_ptr<EsPacket> pkt;
+    std::shared_ptr<VideoInfo> info;  // set on the first packet of a session
+  };
+
+  explicit EsJitterBuffer(size_t depth) : depth_(std::max<size_t>(depth, 1)) {}
+  EsJitterBuffer(const EsJitterBuffer &) = delete;
+  EsJitterBuffer &operator=(const EsJitterBuffer &) = delete;
+
+  /* Returns false if the packet is dropped. EOS is never dropped. */
+  bool Push(ESPacket *pkt) {
+    bool eos = !pkt->data || !pkt->size || (pkt->flags & static_cast<uint32_t>(ESPacket::FLAG::FLAG_EOS));
+    bool key = pkt->flags & static_cast<uint32_t>(ESPacket::FLAG::FLAG_KEY_FRAME);
+    std::unique_lock<std::mutex> lk(mutex_);
+    if (!eos) {
+      if (wait_key_ && !key) {
+        ++dropped_;
+        return false;
+      }
+      if (queue_.size() >= depth_) {
+        wait_key_ = true;
+        ++dropped_;
+        return false;
+      }
+      wait_key_ = false;
+    }
+    Entry entry;
+    entry.pkt = std::make_shared<EsPacket>(pkt);
+    entry.info = std::move(pending_info_);
+    queue_.push_back(std::move(entry));
+    lk.unlock();
+    cond_.notify_one();
+    return true;
+  }
+
+  /* Starts a new session, the packets are dropped until the first key frame of the session. */
+  void NewSession(const VideoInfo &info) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    wait_key_ = true;
+    pending_info_ = std::make_shared<VideoInfo>(info);
+  }
+
+  bool Pop(int timeout_ms, Entry *entry) {
+    std::unique_lock<std::mutex> lk(mutex_);
+    if (!cond_.wait_for(lk, std::chrono::milliseconds(timeout_ms), [this]() { return !queue_.empty(); })) {
+      return false;
+    }
+    *entry = std::move(queue_.front());
+    queue_.pop_front();
+    return true;
+  }
+
+  uint64_t GetDroppedCount() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return dropped_;
+  }
+
+  size_t Size() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return queue_.size();
+  }
+
+ private:
+  mutable std::mutex mutex_;
+  std::condition_variable cond_;
+  std::deque<Entry> queue_;
+  size_t depth_;
+  bool wait_key_ = true;
+  std::shared_ptr<VideoInfo> pending_info_;
+  uint64_t dropped_ = 0;
+};  // class EsJitterBuffer
+
 class SourceRender {
  public:
   explicit SourceRender(SourceHandler *handler) : handler_(handler) {}
@@ -202,36 +286,127 @@ class SourceRender {
                      const DataSourceParam &param_);
 };
 
+/***********************************************************************
+ * @brief PacingTimer is a timer shared by all streams to wake up the threads waiting for their deadlines.
+ *
+ * One timer thread sleeps until the earliest deadline and spins for the last few hundred microseconds,
+ * so that the waiting threads are woken up precisely instead of relying on the accuracy of their own sleeps.
+ ***********************************************************************/
+class PacingTimer {
+ public:
+  using Clock = std::chrono::steady_clock;
+  static PacingTimer &Instance();
+  ~PacingTimer();
+  /* Blocks the caller until the deadline. Returns immediately if the deadline has passed. */
+  void WaitUntil(const Clock::time_point &deadline);
+
+ private:
+  PacingTimer();
+  PacingTimer(const PacingTimer &) = delete;
+  PacingTimer &operator=(const PacingTimer &) = delete;
+  void Loop();
+
+  struct Waiter {
+    Clock::time_point deadline;
+    std::condition_variable cond;
+    bool done = false;
+  };
+  struct WaiterCompare {
+    bool operator()(const Waiter *lhs, const Waiter *rhs) const { return lhs->deadline > rhs->deadline; }
+  };
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::priority_queue<Waiter *, std::vector<Waiter *>, WaiterCompare> waiters_;
+  bool exit_ = false;
+  std::thread thread_;
+};  // class PacingTimer
+
 /***********************************************************************
  * @brief FrController is used to control the frequency of sending data.
+ *
+ * Frames are scheduled on a monotonic clock relative to an anchor, either by a fixed frame rate (``Control()``)
+ * or by the timestamps of the stream and a speed (``Control(pts)``), so the sleep jitter does not accumulate.
+ * Packets come in decode order, so timestamps are paced by their running maximum, and the timestamps stepping
+ * back a little, B-frames, are not waited for. The schedule is re-anchored when the stream falls behind too much
+ * or the timestamps jump, far forward or back.
  ***********************************************************************/
 class FrController {
  public:
+  using Clock = PacingTimer::Clock;
   FrController() {}
   explicit FrController(uint32_t frame_rate) : frame_rate_(frame_rate) {}
-  void Start() { start_ = std::chrono::steady_clock::now(); }
+  void Start() {
+    start_ = Clock::now();
+    frame_count_ = 0;
+    pts_anchored_ = false;
+  }
+  /* Paces by the frame rate. */
   void Control() {
     if (0 == frame_rate_) return;
-    double delay = 1000.0 / frame_rate_;
-    end_ = std::chrono::steady_clock::now();
-    std::chrono::duration<double, std::milli> diff = end_ - start_;
-    auto gap = delay - diff.count() - time_gap_;
-    if (gap > 0) {
-      std::chrono::duration<double, std::milli> dura(gap);
-      std::this_thread::sleep_for(dura);
-      time_gap_ = 0;
-    } else {
-      time_gap_ = -gap;
+    ++frame_count_;
+    Clock::time_point deadline =
+        start_ + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(
+                     static_cast<double>(frame_count_) / frame_rate_));
+    if (Clock::now() - deadline > kMaxLag) {
+      Start();  // too late to catch up
+      return;
     }
-    Start();
+    PacingTimer::Instance().WaitUntil(deadline);
+  }
+  /* Paces by the presentation timestamp in 90khz, the speed must be greater than 0. */
+  void Control(uint64_t pts) {
+    if (speed_ <= 0) return;
+    Clock::time_point now = Clock::now();
+    if (!pts_anchored_) {
+      Anchor(now, pts);
+      return;
+    }
+    double step = static_cast<double>(static_cast<int64_t>(pts - max_pts_)) / 90000;
+    if (step < -kMaxPtsReorder || step > kMaxPtsJump) {
+      Anchor(now, pts);  // timestamps jump
+      return;
+    }
+    if (step <= 0) return;  // reordered, the latest timestamp has been paced
+    max_pts_ = pts;
+    double offset = static_cast<double>(pts - anchor_pts_) / 90000 / speed_;
+    Clock::time_point deadline =
+        anchor_ + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(offset));
+    if (now - deadline > kMaxLag) {
+      Anchor(now, pts);  // too late to catch up
+      return;
+    }
+    PacingTimer::Instance().WaitUntil(deadline);
   }
   inline uint32_t GetFrameRate() const { return frame_rate_; }
-  inline void SetFrameRate(uint32_t frame_rate) { frame_rate_ = frame_rate; }
+  inline void SetFrameRate(uint32_t frame_rate) {
+    frame_rate_ = frame_rate;
+    Start();
+  }
+  inline double GetSpeed() const { return speed_; }
+  inline void SetSpeed(double speed) {
+    speed_ = speed;
+    pts_anchored_ = false;
+  }
 
  private:
+  void Anchor(const Clock::time_point &now, uint64_t pts) {
+    anchor_ = now;
+    anchor_pts_ = pts;
+    max_pts_ = pts;
+    pts_anchored_ = true;
+  }
+
+  static constexpr std::chrono::milliseconds kMaxLag{1000};
+  static constexpr double kMaxPtsJump = 10.0;  // seconds between two frames
+  static constexpr double kMaxPtsReorder = 1.0;  // seconds a timestamp may be behind the latest, in decode order
   uint32_t frame_rate_ = 0;
-  double time_gap_ = 0;
-  std::chrono::time_point<std::chrono::steady_clock> start_, end_;
+  uint64_t frame_count_ = 0;
+  Clock::time_point start_;
+  double speed_ = 0;
+  bool pts_anchored_ = false;
+  uint64_t anchor_pts_ = 0;
+  uint64_t max_pts_ = 0;
+  Clock::time_point anchor_;
 };  // class FrController
 
 }  // namespace cnstream
@@ -22,6 +22,7 @@
 
 #include "data_source.hpp"
 #include "cnstream_logging.hpp"
+#include "data_handler_file.hpp"
 
 namespace cnstream {
 
@@ -64,6 +65,15 @@ bool DataSource::Open(ModuleParamSet param_set) {
 
 void DataSource::Close() { RemoveSources(); }
 
+int DataSource::Seek(const std::string &stream_id, int64_t timestamp) {
+  std::shared_ptr<FileHandler> handler = std::dynamic_pointer_cast<FileHandler>(GetSourceHandler(stream_id));
+  if (!handler) {
+    LOGE(SOURCE) << "[" << GetName() << "] Seek(): [" << stream_id << "]: stream does not exist or is not a file.";
+    return -1;
+  }
+  return handler->Seek(timestamp) ? 0 : -1;
+}
+
 bool DataSource::CheckParamSet(const ModuleParamSet &param_set) const {
   std::string err_msg;
   if (!param_helper_->ParseParams(param_set)) {
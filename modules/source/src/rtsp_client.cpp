@@ -19,6 +19,8 @@
  *************************************************************************/
 
 #include "rtsp_client.hpp"
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <string>
 #include <thread>
@@ -101,8 +103,10 @@ class ourRTSPClient : public RTSPClient {
   bool streammingOverTcp = true;
   bool setupOk = false;
   char* eventLoopWatchVariable = nullptr;
+  bool* frameReceived = nullptr;  // set once a frame is received in this session
   StreamClientState scs;
   bool only_key_frame = false;
+  unsigned reorderTimeUs = 100000;
 
   // Use a timer to check liveness
   //
@@ -149,6 +153,7 @@ class DummySink : public MediaSink, public cnstream::IParserResult {
   // redefined virtual functions:
   Boolean continuePlaying() override;
   bool FindKeyFrame(unsigned char *buf, unsigned size, bool isH264);
+  void ReportStats(cnstream::IRtspCB *cb);
 
  private:
   std::unique_ptr<u_int8_t[]> fReceiveBuffer = nullptr;
@@ -162,6 +167,8 @@ class DummySink : public MediaSink, public cnstream::IParserResult {
   bool only_key_frame = false;
   cnstream::EsParser parser_;
   bool is_valid_video_ = false;
+  unsigned packetsReceived = 0;
+  unsigned packetsExpected = 0;
 };
 
 // Implementation of the RTSP 'response handlers':
@@ -228,6 +235,11 @@ void setupNextSubsession(RTSPClient* rtspClient) {
       }
       env << ")\n";
 
+      // Wait a while for out-of-order packets (over UDP) before treating the missing ones as lost
+      if (scs.subsession->rtpSource() != NULL) {
+        scs.subsession->rtpSource()->setPacketReorderingThresholdTime(client->reorderTimeUs);
+      }
+
       // Continue setting up this subsession, by sending a RTSP "SETUP" command:
       Boolean streamUsingTCP = (client->streammingPreferTcp && client->streammingOverTcp);
       rtspClient->sendSetupCommand(*scs.subsession, continueAfterSETUP, False, streamUsingTCP, false);
@@ -580,6 +592,8 @@ void DummySink::afterGettingFrame(unsigned frameSize, unsigned numTruncatedBytes
     ourRTSPClient* client = reinterpret_cast<ourRTSPClient*>(fSubsession.miscPtr);
     // start to check liveness for livestream, FIXME
     client->resetLivenessTimer();
+    if (client->frameReceived) *client->frameReceived = true;
+    if (client->cb_) ReportStats(client->cb_);
 
     if (client->cb_ && frameSize) {
       /*H264/H265, video frame*/
@@ -606,6 +620,26 @@ void DummySink::afterGettingFrame(unsigned frameSize, unsigned numTruncatedBytes
   continuePlaying();
 }
 
+void DummySink::ReportStats(cnstream::IRtspCB *cb) {
+  RTPSource* src = fSubsession.rtpSource();
+  if (src == NULL) return;
+  unsigned received = 0, expected = 0;
+  RTPReceptionStatsDB::Iterator iter(src->receptionStatsDB());
+  RTPReceptionStats* stats = NULL;
+  while ((stats = iter.next(True)) != NULL) {
+    received += stats->totNumPacketsReceived();
+    expected += stats->totNumPacketsExpected();
+  }
+  if (received == packetsReceived && expected == packetsExpected) return;
+  uint64_t lost = 0;
+  if (expected - packetsExpected > received - packetsReceived) {
+    lost = (expected - packetsExpected) - (received - packetsReceived);
+  }
+  cb->OnRtspStats(received - packetsReceived, lost);
+  packetsReceived = received;
+  packetsExpected = expected;
+}
+
 void DummySink::OnParserInfo(cnstream::VideoInfo *info) {
   ourRTSPClient* client = reinterpret_cast<ourRTSPClient*>(fSubsession.miscPtr);
   if (client && client->cb_ && info) {
@@ -664,17 +698,33 @@ class RtspSessionImpl {
  private:
   void TaskRoutine() {
     int reconnect = param_.reconnect;
+    int min_interval = std::max(param_.reconnectMinIntervalMs, 10);
+    int interval = min_interval;
     while (!exit_flag_) {
+      frame_received_ = false;
       TaskRoutine_();
+      if (exit_flag_) break;
 
-      // FIXME, apply reconnect strategy
+      // a session which has received frames is a new start, otherwise the attempt failed
+      if (frame_received_) {
+        reconnect = param_.reconnect;
+        interval = min_interval;
+      }
       if (param_.reconnect >= 0) {
         if (reconnect <= 0) {
           break;
         }
         --reconnect;
       }
-      std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+      if (param_.cb) {
+        param_.cb->OnRtspEvent(RTSP_EVENT_DISCONNECTED);
+      }
+      LOGW(SOURCE) << "[RtspSessionImpl] TaskRoutine(): Reconnect in " << interval << " ms";
+      auto wake = std::chrono::steady_clock::now() + std::chrono::milliseconds(interval);
+      while (!exit_flag_ && std::chrono::steady_clock::now() < wake) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+      interval = std::min(interval * 2, std::max(param_.reconnectMaxIntervalMs, min_interval));
     }
 
     LOGI(SOURCE) << "[RtspSessionImpl] TaskRoutine(): Exit";
@@ -705,6 +755,8 @@ class RtspSessionImpl {
 
     this->eventLoopWatchVariable = 0;
     reinterpret_cast<ourRTSPClient*>(rtspClient)->eventLoopWatchVariable = &this->eventLoopWatchVariable;
+    reinterpret_cast<ourRTSPClient*>(rtspClient)->frameReceived = &this->frame_received_;
+    reinterpret_cast<ourRTSPClient*>(rtspClient)->reorderTimeUs = std::max(param_.reorderTimeMs, 0) * 1000;
     reinterpret_cast<ourRTSPClient*>(rtspClient)->livenessTimeoutMs = param_.livenessTimeoutMs;
     reinterpret_cast<ourRTSPClient*>(rtspClient)->streammingPreferTcp = param_.streammingPreferTcp;
     reinterpret_cast<ourRTSPClient*>(rtspClient)->only_key_frame = param_.only_key_frame;
@@ -743,6 +795,7 @@ class RtspSessionImpl {
   // by default, print verbose output from each "RTSPClient"
   int RTSP_CLIENT_VERBOSITY_LEVEL = 1;
   char eventLoopWatchVariable = 0;
+  bool frame_received_ = false;
 };
 
 RtspSession::RtspSession() {}
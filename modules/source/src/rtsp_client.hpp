@@ -20,15 +20,22 @@
 #ifndef CNSTREAM_RTSP_CLIENT_H_
 #define CNSTREAM_RTSP_CLIENT_H_
 
+#include <cstdint>
 #include <string>
 #include "video_parser.hpp"
 
 namespace cnstream {
 
+enum RtspEventType {
+  RTSP_EVENT_DISCONNECTED = 0,  // the connection is lost, the session will be reconnected
+};
+
 struct IRtspCB {
   virtual void OnRtspInfo(VideoInfo *info) = 0;
   virtual void OnRtspFrame(VideoEsFrame *frame) = 0;
   virtual void OnRtspEvent(int type) = 0;
+  // increments of the RTP packets received and lost since the last call
+  virtual void OnRtspStats(uint64_t received, uint64_t lost) {}
   virtual ~IRtspCB() {}
 };
 
@@ -38,6 +45,9 @@ struct OpenParam {
                     */
   bool streammingPreferTcp = true;
   int reconnect = 0;
+  int reconnectMinIntervalMs = 500;   // doubled after each failed reconnection
+  int reconnectMaxIntervalMs = 8000;
+  int reorderTimeMs = 100;            // the time to wait for out-of-order RTP packets over UDP
   int livenessTimeoutMs = 2000;
   IRtspCB *cb = nullptr;
   bool only_key_frame = false;
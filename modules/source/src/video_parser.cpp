@@ -167,17 +167,17 @@ class FFParserImpl {
     info->codec_id = st->codecpar->codec_id;
 #ifdef HAVE_FFMPEG_AVDEVICE  // for usb camera
     info->format = st->codecpar->format;
+#endif
     info->width = st->codecpar->width;
     info->height = st->codecpar->height;
-#endif
     int field_order = st->codecpar->field_order;
 #else
     info->codec_id = st->codec->codec_id;
 #ifdef HAVE_FFMPEG_AVDEVICE  // for usb camera
     info->format = st->codec->format;
+#endif
     info->width = st->codec->width;
     info->height = st->codec->height;
-#endif
     int field_order = st->codec->field_order;
 #endif
 
@@ -205,6 +205,12 @@ class FFParserImpl {
     int extradata_size = st->codec->extradata_size;
 #endif
 
+    if (st->avg_frame_rate.num > 0 && st->avg_frame_rate.den > 0) {
+      info->framerate = av_q2d(st->avg_frame_rate);
+    } else if (st->r_frame_rate.num > 0 && st->r_frame_rate.den > 0) {
+      info->framerate = av_q2d(st->r_frame_rate);
+    }
+
     if (extradata && extradata_size) {
       info->extra_data.resize(extradata_size);
       memcpy(info->extra_data.data(), extradata, extradata_size);
@@ -254,6 +260,45 @@ class FFParserImpl {
     first_frame_ = true;
     eos_reached_ = false;
     open_success_ = false;
+    end_pts_ = -1;
+  }
+
+  int Seek(int64_t timestamp, int64_t* target_pts) {
+    std::unique_lock<std::mutex> guard(mutex_);
+    if (!open_success_ || rtsp_source_ || timestamp < 0) {
+      return -1;
+    }
+    AVStream* vstream = fmt_ctx_->streams[video_index_];
+    int64_t ts = StreamTimestamp(vstream, timestamp);
+    // seek to the previous key frame, frames before the target are decoded and discarded by the caller
+    int ret = av_seek_frame(fmt_ctx_, video_index_, ts, AVSEEK_FLAG_BACKWARD);
+    if (ret < 0) {
+      LOGW(SOURCE) << "[" << stream_id_ << "]: Seek to " << timestamp << "ms failed -- " << url_name_;
+      return -1;
+    }
+    first_frame_ = true;
+    eos_reached_ = false;
+    if (target_pts) {
+      *target_pts = av_rescale_q(ts, vstream->time_base, {1, 90000});
+    }
+    return 0;
+  }
+
+  int SetEndTime(int64_t timestamp, int64_t* end_pts) {
+    std::unique_lock<std::mutex> guard(mutex_);
+    if (!open_success_) {
+      return -1;
+    }
+    if (timestamp < 0) {
+      end_pts_ = -1;
+    } else {
+      AVStream* vstream = fmt_ctx_->streams[video_index_];
+      end_pts_ = av_rescale_q(StreamTimestamp(vstream, timestamp), vstream->time_base, {1, 90000});
+    }
+    if (end_pts) {
+      *end_pts = end_pts_;
+    }
+    return 0;
   }
 
   int Parse() {
@@ -309,6 +354,25 @@ class FFParserImpl {
         packet_.pts = pts_, pts_ += 3003;  // FIXME
       }
 
+      if (end_pts_ >= 0) {
+        // frames presented before the end time are all decoded before the first frame decoded after it
+        int64_t dts = packet_.pts;
+        if (find_pts_ && AV_NOPTS_VALUE != packet_.dts) {
+          dts = av_rescale_q(packet_.dts, vstream->time_base, {1, 90000});
+        }
+        if (dts > end_pts_) {
+          if (bsf_ctx_) {
+            av_freep(&packet_.data);
+          }
+          av_packet_unref(&packet_);
+          if (result_) {
+            result_->OnParserFrame(nullptr);
+          }
+          eos_reached_ = true;
+          return -1;
+        }
+      }
+
       if (result_) {
         VideoEsFrame frame;
         frame.flags = packet_.flags;
@@ -340,6 +404,11 @@ class FFParserImpl {
   std::string GetStreamID() { return stream_id_; }
 
  private:
+  static int64_t StreamTimestamp(AVStream* vstream, int64_t timestamp_ms) {
+    int64_t start_time = vstream->start_time != AV_NOPTS_VALUE ? vstream->start_time : 0;
+    return start_time + av_rescale_q(timestamp_ms, {1, 1000}, vstream->time_base);
+  }
+
   AVFormatContext* fmt_ctx_ = nullptr;
   AVBitStreamFilterContext* bsf_ctx_ = nullptr;
   AVDictionary* options_ = NULL;
@@ -358,6 +427,7 @@ class FFParserImpl {
   bool rtsp_source_ = false;
   std::mutex mutex_;
   bool only_key_frame_ = false;
+  int64_t end_pts_ = -1;
 };  // class FFmpegDemuxerImpl  // NOLINT
 
 FFParser::FFParser(const std::string& stream_id) { impl_ = new FFParserImpl(stream_id); }
@@ -386,6 +456,20 @@ int FFParser::Parse() {
   return -1;
 }
 
+int FFParser::Seek(int64_t timestamp, int64_t* target_pts) {
+  if (impl_) {
+    return impl_->Seek(timestamp, target_pts);
+  }
+  return -1;
+}
+
+int FFParser::SetEndTime(int64_t timestamp, int64_t* end_pts) {
+  if (impl_) {
+    return impl_->SetEndTime(timestamp, end_pts);
+  }
+  return -1;
+}
+
 std::string FFParser::GetStreamID() { return impl_->GetStreamID(); }
 
 
@@ -584,8 +668,8 @@ int EsParserImpl::Parse(const VideoEsPacket &pkt) {
         break;
       }
 
-      // info.width = codec_ctx_->width;
-      // info.height = codec_ctx_->height;
+      info.width = codec_ctx_->width;
+      info.height = codec_ctx_->height;
 
       info.extra_data = paramset_;
 
@@ -46,10 +46,11 @@ struct VideoInfo {
   AVCodecID codec_id;
 #ifdef HAVE_FFMPEG_AVDEVICE  // for usb camera
   int format;
-  int width;
-  int height;
 #endif
+  int width = 0;  // 0 means unknown
+  int height = 0;
   int progressive;
+  double framerate = 0.0;  // 0 means unknown
   std::vector<unsigned char> extra_data;
 };
 
@@ -91,6 +92,10 @@ class FFParser {
   int Open(const std::string& url, IParserResult* result, bool only_key_frame = false);
   void Close();
   int Parse();
+  /* Seeks to the previous key frame of timestamp (ms), target_pts is the timestamp in 90khz */
+  int Seek(int64_t timestamp, int64_t* target_pts = nullptr);
+  /* Reaches eos after timestamp (ms), negative means the end of the stream. end_pts is the timestamp in 90khz */
+  int SetEndTime(int64_t timestamp, int64_t* end_pts = nullptr);
   std::string GetStreamID();
 
  private:
@@ -0,0 +1,213 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "video_sampler.hpp"
+
+#include <algorithm>
+
+namespace cnstream {
+
+namespace {
+
+// the maximum number of pts kept for DECODE_ONLY frames, in case the decoder drops some of them
+static constexpr size_t kMaxDiscardPts = 256;
+
+// Find the next nal unit in annex-b bitstream, returns the offset of the nal header or len if not found.
+size_t FindNalStart(const uint8_t *data, size_t len, size_t pos) {
+  while (pos + 3 <= len) {
+    if (data[pos] == 0 && data[pos + 1] == 0 && data[pos + 2] == 1) {
+      return pos + 3;
+    }
+    ++pos;
+  }
+  return len;
+}
+
+// Bit reader for the first bytes of a slice header, emulation prevention bytes are skipped.
+class BitReader {
+ public:
+  BitReader(const uint8_t *data, size_t len) : data_(data), len_(len) {}
+
+  bool ReadBit(uint32_t *bit) {
+    if (bit_pos_ == 0) {
+      if (pos_ >= len_) return false;
+      if (pos_ >= 2 && data_[pos_] == 0x03 && data_[pos_ - 1] == 0 && data_[pos_ - 2] == 0) {
+        if (++pos_ >= len_) return false;
+      }
+    }
+    *bit = (data_[pos_] >> (7 - bit_pos_)) & 0x01;
+    if (++bit_pos_ == 8) {
+      bit_pos_ = 0;
+      ++pos_;
+    }
+    return true;
+  }
+
+  bool ReadUe(uint32_t *value) {
+    int leading_zeros = 0;
+    uint32_t bit = 0;
+    while (true) {
+      if (!ReadBit(&bit)) return false;
+      if (bit) break;
+      if (++leading_zeros > 31) return false;
+    }
+    uint32_t suffix = 0;
+    for (int i = 0; i < leading_zeros; ++i) {
+      if (!ReadBit(&bit)) return false;
+      suffix = (suffix << 1) | bit;
+    }
+    *value = (1u << leading_zeros) - 1 + suffix;
+    return true;
+  }
+
+ private:
+  const uint8_t *data_;
+  size_t len_;
+  size_t pos_ = 0;
+  int bit_pos_ = 0;
+};
+
+}  // namespace
+
+bool VideoSampler::ParseH264(const uint8_t *data, size_t len, EsFrameInfo *info) {
+  if (!data || !len || !info) return false;
+  bool all_intra = true;
+  size_t pos = FindNalStart(data, len, 0);
+  while (pos < len) {
+    size_t next = FindNalStart(data, len, pos);
+    size_t nal_end = next < len ? next - 3 : len;
+    int nal_ref_idc = (data[pos] >> 5) & 0x03;
+    int nal_type = data[pos] & 0x1f;
+    if (nal_type == 1 || nal_type == 5) {
+      info->has_vcl = true;
+      if (nal_ref_idc) info->is_reference = true;
+      if (nal_type == 5) info->is_idr = true;
+      BitReader reader(data + pos + 1, nal_end - pos - 1);
+      uint32_t first_mb = 0, slice_type = 0;
+      if (reader.ReadUe(&first_mb) && reader.ReadUe(&slice_type)) {
+        slice_type %= 5;
+        if (slice_type != 2 && slice_type != 4) all_intra = false;  // I and SI
+      } else {
+        all_intra = false;
+      }
+    } else if (nal_type == 7 || nal_type == 8) {
+      info->has_param_set = true;
+    }
+    pos = next;
+  }
+  info->is_intra = info->has_vcl && all_intra;
+  return info->has_vcl || info->has_param_set;
+}
+
+bool VideoSampler::ParseH265(const uint8_t *data, size_t len, EsFrameInfo *info) {
+  if (!data || !len || !info) return false;
+  bool sub_layer_non_ref = true;
+  size_t pos = FindNalStart(data, len, 0);
+  while (pos + 1 < len) {
+    int nal_type = (data[pos] >> 1) & 0x3f;
+    int temporal_id = (data[pos + 1] & 0x07) - 1;
+    if (nal_type < 32) {
+      info->has_vcl = true;
+      info->temporal_id = std::max(info->temporal_id, temporal_id);
+      // TRAIL_N, TSA_N, STSA_N, RADL_N, RASL_N and RSV_VCL_N10/12/14 are sub-layer non-reference pictures
+      if (nal_type > 14 || (nal_type & 0x01)) sub_layer_non_ref = false;
+      if (nal_type >= 16 && nal_type <= 23) info->is_idr = true;
+    } else if (nal_type >= 32 && nal_type <= 34) {
+      info->has_param_set = true;
+      if (nal_type == 33 && pos + 2 < len) {
+        // sps_video_parameter_set_id u(4), sps_max_sub_layers_minus1 u(3)
+        info->max_temporal_id = (data[pos + 2] >> 1) & 0x07;
+      }
+    }
+    pos = FindNalStart(data, len, pos);
+  }
+  info->is_reference = info->has_vcl && !sub_layer_non_ref;
+  info->is_intra = info->is_idr;
+  return info->has_vcl || info->has_param_set;
+}
+
+void VideoSampler::SetInterval(uint32_t interval) {
+  ratio_ = interval > 1 ? 1.0 / interval : 1.0;
+  credit_ = 1.0 - ratio_;
+}
+
+bool VideoSampler::SetFramerate(double target_fps, double stream_fps) {
+  if (target_fps <= 0 || stream_fps <= 0) return false;
+  ratio_ = std::min(1.0, target_fps / stream_fps);
+  credit_ = 1.0 - ratio_;
+  return true;
+}
+
+bool VideoSampler::IsDroppable(const uint8_t *data, size_t len) {
+  EsFrameInfo info;
+  bool parsed = false;
+  if (codec_id_ == AV_CODEC_ID_H264) {
+    parsed = ParseH264(data, len, &info);
+  } else if (codec_id_ == AV_CODEC_ID_HEVC) {
+    parsed = ParseH265(data, len, &info);
+    if (info.max_temporal_id >= 0) max_temporal_id_ = info.max_temporal_id;
+  }
+
+  // Parameter sets and intra pictures are always sent to the decoder, frames we failed to parse are never dropped.
+  bool droppable = parsed && info.has_vcl && !info.has_param_set && !info.is_reference && !info.is_intra;
+  if (droppable && codec_id_ == AV_CODEC_ID_HEVC && max_temporal_id_ >= 0) {
+    // a sub-layer non-reference picture could still be referenced by the higher sub-layers
+    droppable = info.temporal_id >= max_temporal_id_;
+  }
+  return droppable;
+}
+
+VideoSampler::Decision VideoSampler::Sample(const uint8_t *data, size_t len) {
+  if (!Enabled()) return Decision::DECODE;
+
+  bool droppable = IsDroppable(data, len);
+  credit_ += ratio_;
+  // Reference frames have to be decoded anyway, take them up to half a slot earlier to save the next droppable one.
+  double threshold = droppable ? 1.0 : 0.5;
+  if (credit_ >= threshold) {
+    credit_ -= 1.0;
+    ++sampled_;
+    return Decision::DECODE;
+  }
+  if (droppable) {
+    ++dropped_;
+    return Decision::DROP;
+  }
+  ++decode_only_;
+  return Decision::DECODE_ONLY;
+}
+
+void VideoSampler::MarkDiscard(uint64_t pts) {
+  std::lock_guard<std::mutex> lk(discard_mutex_);
+  discard_pts_.insert(pts);
+  if (discard_pts_.size() > kMaxDiscardPts) {
+    discard_pts_.erase(discard_pts_.begin());
+  }
+}
+
+bool VideoSampler::CheckDiscard(uint64_t pts) {
+  std::lock_guard<std::mutex> lk(discard_mutex_);
+  auto iter = discard_pts_.find(pts);
+  if (iter == discard_pts_.end()) return false;
+  discard_pts_.erase(iter);
+  return true;
+}
+
+}  // namespace cnstream
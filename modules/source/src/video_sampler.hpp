@@ -0,0 +1,105 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_VIDEO_SAMPLER_HPP_
+#define CNSTREAM_VIDEO_SAMPLER_HPP_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <libavcodec/avcodec.h>
+#ifdef __cplusplus
+}
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <set>
+
+namespace cnstream {
+
+/* Bitstream information of one H264/H265 access unit (annex-b) */
+struct EsFrameInfo {
+  bool has_vcl = false;        // contains at least one slice
+  bool has_param_set = false;  // contains VPS/SPS/PPS
+  bool is_idr = false;         // IDR/IRAP picture
+  bool is_reference = false;   // referenced by other pictures
+  bool is_intra = false;       // all slices are I slices
+  int temporal_id = 0;         // H265 only
+  int max_temporal_id = -1;    // H265 only, parsed from SPS if the access unit contains one
+};
+
+/**
+ * VideoSampler decides which access units are sent to the decoder, it works on the demuxed bitstream.
+ *
+ * Frames are sampled to keep about one frame every `interval` frames (or `ratio` of the frames).
+ * Non-reference frames which are not sampled are dropped before decoding, reference frames which are not sampled are
+ * decoded but their outputs are discarded. Reference frames are preferred when the sampling slot allows it, so that
+ * more non-reference frames could be dropped.
+ */
+class VideoSampler {
+ public:
+  enum class Decision {
+    DECODE,       // decode and output
+    DECODE_ONLY,  // decode but discard the output, the frame is referenced by others
+    DROP          // do not send to decoder
+  };
+
+  VideoSampler() = default;
+  ~VideoSampler() = default;
+
+  /* interval <= 1 disables sampling */
+  void SetInterval(uint32_t interval);
+  /* target_fps / stream_fps, returns false if either is invalid */
+  bool SetFramerate(double target_fps, double stream_fps);
+  bool Enabled() const { return ratio_ < 1.0; }
+  void SetCodec(AVCodecID codec_id) { codec_id_ = codec_id; }
+
+  Decision Sample(const uint8_t *data, size_t len);
+  /* Whether the access unit is not referenced by others and could be dropped without sampling */
+  bool IsDroppable(const uint8_t *data, size_t len);
+
+  /* Bookkeeping of DECODE_ONLY frames, called from the parser thread and the decoder callback thread. */
+  void MarkDiscard(uint64_t pts);
+  bool CheckDiscard(uint64_t pts);
+
+  uint64_t GetDroppedCount() const { return dropped_; }
+  uint64_t GetDecodeOnlyCount() const { return decode_only_; }
+  uint64_t GetSampledCount() const { return sampled_; }
+
+  static bool ParseH264(const uint8_t *data, size_t len, EsFrameInfo *info);
+  static bool ParseH265(const uint8_t *data, size_t len, EsFrameInfo *info);
+
+ private:
+  AVCodecID codec_id_ = AV_CODEC_ID_NONE;
+  double ratio_ = 1.0;
+  double credit_ = 0.0;
+  int max_temporal_id_ = -1;
+  uint64_t dropped_ = 0;
+  uint64_t decode_only_ = 0;
+  uint64_t sampled_ = 0;
+  std::mutex discard_mutex_;
+  std::set<uint64_t> discard_pts_;
+};  // class VideoSampler
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_VIDEO_SAMPLER_HPP_
@@ -26,9 +26,11 @@
  *  This file contains a declaration of struct Tracker
  */
 
-#include <map>
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 
 #include "cnstream_frame.hpp"
 #include "cnstream_module.hpp"
@@ -43,20 +45,49 @@ namespace cnstream {
 
 using InferVideoPixelFmt = infer_server::NetworkInputFormat;
 
+/**
+ * @brief The hyperparameters of the trackers, each tracker uses those it knows. The parameters of the module are the
+ *   default profile, and the named profiles of [profiles] override them for the streams selecting them.
+ */
+struct TrackProfile {
+  float max_cosine_distance = 0.2;
+  uint32_t nn_budget = 100;  ///< the latest features kept by each track
+  float max_iou_distance = 0.7;
+  uint32_t max_age = 30;  ///< frames a track is kept after it is lost
+  uint32_t n_init = 3;  ///< frames a track is matched before confirmed
+  float high_score_thresh = 0.5;  ///< ByteTrack only, detections above it are matched first and start tracks
+  float low_score_thresh = 0.1;  ///< ByteTrack only, detections below it are ignored
+};
+
 typedef struct TrackParams {
   uint32_t device_id = 0;
   InferVideoPixelFmt input_format = infer_server::NetworkInputFormat::RGB;
   uint32_t priority = 0;
   uint32_t engine_num = 1;
+  uint32_t cpu_thread_num = 1;  ///< threads extracting the features of a frame on CPU
+  uint32_t track_thread_num = 0;  ///< threads tracking the streams, 0 to track on the threads of the module
   uint32_t batch_timeout = 1000;  ///< only support in dynamic batch strategy
   bool show_stats = false;
   float max_cosine_distance = 0.2;
+  uint32_t nn_budget = 100;
+  float max_iou_distance = 0.7;
+  uint32_t max_age = 30;
+  uint32_t n_init = 3;
+  float high_score_thresh = 0.5;
+  float low_score_thresh = 0.1;
+  std::string profiles = "";  ///< {name: {hyperparameter: value}} in json
+  std::string stream_profiles = "";  ///< {stream_id: name} in json
+  std::string record_trace = "";  ///< path of the detection trace recorded, empty to disable
+  std::string feature_precision = "float32";
+  std::string assignment_method = "hungarian";
   std::string model_path = "";
   std::string track_name = "";
 } TrackParams;
 
 
 struct TrackerContext;
+class TrackPool;
+class TraceWriter;
 
 /**
  * @class Tracker
@@ -120,15 +151,34 @@ class Tracker : public ModuleEx, public ModuleCreator<Tracker> {
    */
   bool CheckParamSet(const ModuleParamSet& param_set) const override;
 
+  /**
+   * @brief Selects the profile of the tracker of a stream, one of [profiles], or "default" for the parameters of the
+   *   module. The tracker of a stream is created on its first frame, so the profile is selected after the module is
+   *   opened and before the first frame of the stream, e.g. when the stream is added by DataSource::AddSource.
+   *
+   * @param stream_id The stream.
+   * @param profile The name of the profile.
+   *
+   * @return Returns false if the profile is not found.
+   */
+  bool SetStreamProfile(const std::string &stream_id, const std::string &profile);
+
  private:
   std::unique_ptr<ModuleParamsHelper<TrackParams>> param_helper_ = nullptr;
   bool InitFeatureExtractor(const CNFrameInfoPtr &data);
   TrackerContext *GetContext(const CNFrameInfoPtr &data);
-  std::map<int, TrackerContext *> contexts_;
+  void TrackFrame(const CNFrameInfoPtr &data);
+  // indexed by stream index, created on the first frame of the stream and released on its EOS
+  std::unique_ptr<std::atomic<TrackerContext *>[]> contexts_;
+  uint32_t context_num_ = 0;
+  std::unique_ptr<TrackPool> track_pool_;
+  std::unique_ptr<TraceWriter> trace_writer_;
   std::shared_ptr<infer_server::ModelInfo> model_ = nullptr;
-  std::mutex mutex_;
   std::function<void(const CNFrameInfoPtr, bool)> match_func_;
   bool need_feature_ = true;
+  std::mutex profile_mutex_;
+  std::unordered_map<std::string, TrackProfile> profiles_;
+  std::unordered_map<std::string, std::string> stream_profiles_;
 };  // class Tracker
 extern int tracker_priority_;
 
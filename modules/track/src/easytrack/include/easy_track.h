@@ -20,13 +20,14 @@
 
 /**
  * @file easy_track.h
- * This file contains FeatureMatchTrack class and KcfTrack class.
+ * This file contains FeatureMatchTrack class and ByteTrack class.
  * Its purpose is to achieve object tracking.
  */
 
 #ifndef EASYTRACK_EASY_TRACK_H_
 #define EASYTRACK_EASY_TRACK_H_
 
+#include <cstdint>
 #include <memory>
 #include <vector>
 #include <ostream>
@@ -62,13 +63,38 @@ struct DetectObject {
    * @attention The dimension of the feature vector is 128.
    */
   std::vector<float> feature;
-  /// internal
-  mutable float feat_mold;
 };
 
 /// Alias of vector stored DetectObject
 using Objects = std::vector<DetectObject>;
 
+/**
+ * @brief Precision of the features stored by the tracks.
+ */
+enum class FeaturePrecision {
+  FLOAT32,  ///< 32-bit float
+  INT8      ///< 8-bit integer, quantized per feature, which cuts the memory traffic of matching by 4
+};
+
+/**
+ * @brief Solver of the assignment of the detections to the tracks.
+ */
+enum class AssignmentMethod {
+  HUNGARIAN,  ///< Munkres algorithm
+  LAPJV,      ///< Jonker-Volgenant shortest augmenting path, optimal as HUNGARIAN and several times faster
+  GREEDY      ///< lowest costs first, not optimal, for very large scenes
+};
+
+/**
+ * @brief Statistics of the assignments solved by a tracker, for benchmarking.
+ */
+struct MatchStats {
+  uint64_t solves = 0;         ///< Number of the assignment problems solved
+  uint64_t cost_elements = 0;  ///< Sum of rows * cols of the cost matrices
+  uint32_t max_rows = 0;       ///< Rows of the largest cost matrix, the tracks
+  uint32_t max_cols = 0;       ///< Cols of the largest cost matrix, the detections
+  double solve_ms = 0;         ///< Time spent in the solver
+};
 
 /**
  * @brief EasyTrack class, help for tracking objects.
@@ -87,6 +113,11 @@ class EasyTrack {
    * @param tracks Tracked objects
    */
   virtual void UpdateFrame(const Objects &detects, Objects *tracks) noexcept(false) = 0;
+
+  /**
+   * @brief Get the statistics of the assignments solved since the tracker was created.
+   */
+  virtual MatchStats GetMatchStats() const { return MatchStats(); }
 };  // class EasyTrack
 
 class FeatureMatchPrivate;
@@ -120,6 +151,18 @@ class FeatureMatchTrack : public EasyTrack {
    */
   void SetParams(float max_cosine_distance, int nn_budget, float max_iou_distance, int max_age, int n_init);
 
+  /**
+   * @brief Set the precision of the features stored by the tracks, FLOAT32 by default.
+   *
+   * @note Call it before the first frame.
+   */
+  void SetFeaturePrecision(FeaturePrecision precision) { feature_precision_ = precision; }
+
+  /**
+   * @brief Set the solver of the assignments, HUNGARIAN by default.
+   */
+  void SetAssignmentMethod(AssignmentMethod method) { assignment_method_ = method; }
+
   /**
    * @brief Update object status and do tracking using cascade matching and IOU matching.
    *
@@ -128,6 +171,11 @@ class FeatureMatchTrack : public EasyTrack {
    */
   void UpdateFrame(const Objects &detects, Objects *tracks) override;
 
+  /**
+   * @brief Get the statistics of the cascade and IoU assignments solved since the tracker was created.
+   */
+  MatchStats GetMatchStats() const override;
+
  private:
   FeatureMatchPrivate *fm_p_;
   friend class FeatureMatchPrivate;
@@ -136,8 +184,65 @@ class FeatureMatchTrack : public EasyTrack {
   int max_age_ = 30;
   int n_init_ = 3;
   uint32_t nn_budget_ = 100;
+  FeaturePrecision feature_precision_ = FeaturePrecision::FLOAT32;
+  AssignmentMethod assignment_method_ = AssignmentMethod::HUNGARIAN;
 };  // class FeatureMatchTrack
 
+class ByteTrackPrivate;
+
+/**
+ * @brief Track objects by motion only, with the two-stage association of ByteTrack.
+ *
+ * @note The detections of high score are matched to all the tracks by IoU first, then the detections of low score,
+ *       occluded or blurred objects mostly, are matched to the tracks left, which keeps their tracks alive without
+ *       starting new ones. Features are not used.
+ */
+class ByteTrack : public EasyTrack {
+ public:
+  /**
+   * @brief Constructor of the ByteTrack class.
+   */
+  ByteTrack();
+
+  /**
+   * @brief Destroy the ByteTrack object.
+   */
+  ~ByteTrack();
+
+  /**
+   * @brief Set params related to Tracking algorithm.
+   *
+   * @param high_score_thresh Detections of score above it are matched first, and may start new tracks
+   * @param low_score_thresh Detections of score below it are ignored
+   * @param max_iou_distance Threshold of iou distance of the first association
+   * @param max_age Object stay alive for [max_age] after disappeared
+   * @param n_init After matched [n_init] times in a row, object is turned from TENTATIVE to CONFIRMED
+   */
+  void SetParams(float high_score_thresh, float low_score_thresh, float max_iou_distance, int max_age, int n_init);
+
+  /**
+   * @brief Update object status and do tracking using two-stage IoU matching.
+   *
+   * @param detects Detected objects
+   * @param tracks Tracked objects, one for each of the detections
+   */
+  void UpdateFrame(const Objects &detects, Objects *tracks) override;
+
+  /**
+   * @brief Get the statistics of the assignments of both associations solved since the tracker was created.
+   */
+  MatchStats GetMatchStats() const override;
+
+ private:
+  ByteTrackPrivate *bt_p_;
+  friend class ByteTrackPrivate;
+  float high_score_thresh_ = 0.5;
+  float low_score_thresh_ = 0.1;
+  float max_iou_distance_ = 0.8;
+  int max_age_ = 30;
+  int n_init_ = 1;
+};  // class ByteTrack
+
 /**
  * @brief Insert DetectObject into the ostream
  *
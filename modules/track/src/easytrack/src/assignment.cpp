@@ -0,0 +1,182 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "assignment.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "cnstream_logging.hpp"
+
+namespace cnstream {
+
+std::unique_ptr<AssignmentSolver> AssignmentSolver::Create(AssignmentMethod method) {
+  switch (method) {
+    case AssignmentMethod::LAPJV:
+      return std::unique_ptr<AssignmentSolver>(new LapjvSolver);
+    case AssignmentMethod::GREEDY:
+      return std::unique_ptr<AssignmentSolver>(new GreedySolver);
+    default:
+      return std::unique_ptr<AssignmentSolver>(new HungarianSolver);
+  }
+}
+
+void AssignmentSolver::Assign(const Matrix &cost_matrix, std::vector<int> *assignment, MatchStats *stats) {
+  auto start = std::chrono::steady_clock::now();
+  Solve(cost_matrix, assignment);
+  stats->solve_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  ++stats->solves;
+  stats->cost_elements += static_cast<uint64_t>(cost_matrix.Rows()) * cost_matrix.Cols();
+  stats->max_rows = std::max(stats->max_rows, static_cast<uint32_t>(cost_matrix.Rows()));
+  stats->max_cols = std::max(stats->max_cols, static_cast<uint32_t>(cost_matrix.Cols()));
+}
+
+void HungarianSolver::Solve(const Matrix &cost_matrix, std::vector<int> *assignment) {
+  size_t size = hungarian_.GetWorkspaceSize(cost_matrix.Rows(), cost_matrix.Cols());
+  if (workspace_.size() < size) workspace_.resize(size);
+  hungarian_.Solve(cost_matrix, assignment, workspace_.data());
+}
+
+void LapjvSolver::Solve(const Matrix &cost_matrix, std::vector<int> *assignment) {
+  int rows = cost_matrix.Rows();
+  int cols = cost_matrix.Cols();
+  assignment->assign(rows, -1);
+  if (!rows || !cols) return;
+  const float *cost = &cost_matrix(0, 0);
+  if (rows <= cols) {
+    SolveWide(cost, rows, cols, assignment);
+    return;
+  }
+  // more rows than columns, assign the rows to the columns
+  transposed_.resize(static_cast<size_t>(rows) * cols);
+  for (int r = 0; r < rows; ++r) {
+    const float *cost_row = cost + static_cast<size_t>(r) * cols;
+    for (int c = 0; c < cols; ++c) transposed_[static_cast<size_t>(c) * rows + r] = cost_row[c];
+  }
+  SolveWide(transposed_.data(), cols, rows, &col4row_);
+  for (int c = 0; c < cols; ++c) (*assignment)[col4row_[c]] = c;
+}
+
+void LapjvSolver::SolveWide(const float *cost, int rows, int cols, std::vector<int> *col4row) {
+  constexpr double kInf = std::numeric_limits<double>::infinity();
+  u_.assign(rows, 0);
+  v_.assign(cols, 0);
+  shortest_.resize(cols);
+  path_.resize(cols);
+  row4col_.assign(cols, -1);
+  col4row->assign(rows, -1);
+  remaining_.resize(cols);
+  row_visited_.resize(rows);
+  col_visited_.resize(cols);
+  int *row4col = row4col_.data();
+  int *assigned = col4row->data();
+
+  for (int cur_row = 0; cur_row < rows; ++cur_row) {
+    // shortest augmenting path from cur_row to a free column, on the reduced costs
+    std::fill(shortest_.begin(), shortest_.end(), kInf);
+    std::fill(row_visited_.begin(), row_visited_.end(), 0);
+    std::fill(col_visited_.begin(), col_visited_.end(), 0);
+    int num_remaining = cols;
+    for (int c = 0; c < cols; ++c) remaining_[c] = cols - 1 - c;
+    double min_val = 0;
+    int row = cur_row;
+    int sink = -1;
+    while (sink < 0) {
+      row_visited_[row] = 1;
+      const float *cost_row = cost + static_cast<size_t>(row) * cols;
+      double base = min_val - u_[row];
+      double lowest = kInf;
+      int index = -1;
+      for (int it = 0; it < num_remaining; ++it) {
+        int c = remaining_[it];
+        double reduced = base + cost_row[c] - v_[c];
+        if (reduced < shortest_[c]) {
+          path_[c] = row;
+          shortest_[c] = reduced;
+        }
+        // prefers free columns on ties, which ends the search earlier
+        if (shortest_[c] < lowest || (shortest_[c] == lowest && row4col[c] < 0)) {
+          lowest = shortest_[c];
+          index = it;
+        }
+      }
+      if (index < 0) {
+        // not finite costs
+        LOGE(TRACK) << "LAPJV: no augmenting path, costs must be finite";
+        return;
+      }
+      min_val = lowest;
+      int col = remaining_[index];
+      col_visited_[col] = 1;
+      remaining_[index] = remaining_[--num_remaining];
+      if (row4col[col] < 0) {
+        sink = col;
+      } else {
+        row = row4col[col];
+      }
+    }
+
+    // updates the dual variables
+    u_[cur_row] += min_val;
+    for (int r = 0; r < rows; ++r) {
+      if (row_visited_[r] && r != cur_row) u_[r] += min_val - shortest_[assigned[r]];
+    }
+    for (int c = 0; c < cols; ++c) {
+      if (col_visited_[c]) v_[c] -= min_val - shortest_[c];
+    }
+
+    // augments along the path
+    int col = sink;
+    while (true) {
+      int r = path_[col];
+      row4col[col] = r;
+      std::swap(assigned[r], col);
+      if (r == cur_row) break;
+    }
+  }
+}
+
+void GreedySolver::Solve(const Matrix &cost_matrix, std::vector<int> *assignment) {
+  uint32_t rows = cost_matrix.Rows();
+  uint32_t cols = cost_matrix.Cols();
+  assignment->assign(rows, -1);
+  if (!rows || !cols) return;
+  const float *cost = &cost_matrix(0, 0);
+  uint32_t size = rows * cols;
+  order_.resize(size);
+  for (uint32_t i = 0; i < size; ++i) order_[i] = i;
+  std::sort(order_.begin(), order_.end(),
+            [cost](uint32_t a, uint32_t b) { return cost[a] < cost[b] || (cost[a] == cost[b] && a < b); });
+  col_assigned_.assign(cols, 0);
+  uint32_t remained = std::min(rows, cols);
+  for (uint32_t i = 0; i < size && remained; ++i) {
+    uint32_t row = order_[i] / cols;
+    uint32_t col = order_[i] % cols;
+    if ((*assignment)[row] >= 0 || col_assigned_[col]) continue;
+    (*assignment)[row] = col;
+    col_assigned_[col] = 1;
+    --remained;
+  }
+}
+
+}  // namespace cnstream
@@ -0,0 +1,115 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+/**
+ * @file assignment.h
+ *
+ * This file contains a declaration of the AssignmentSolver interface and its implementations.
+ */
+
+#ifndef EASYTRACK_ASSIGNMENT_H_
+#define EASYTRACK_ASSIGNMENT_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "../include/easy_track.h"
+#include "hungarian.h"
+#include "matrix.h"
+
+namespace cnstream {
+
+/**
+ * @brief Solver of the rectangular linear assignment problem: each row is assigned at most one column and each
+ *        column at most one row, min(rows, cols) pairs in total, so that the sum of their costs is minimal.
+ *
+ * Gated pairs are expected to have a large finite cost, and to be rejected by the caller after the assignment.
+ * A solver keeps its buffers across calls, and is not thread safe.
+ */
+class AssignmentSolver {
+ public:
+  virtual ~AssignmentSolver() = default;
+
+  /**
+   * @brief Solve the assignment.
+   *
+   * @param cost_matrix The costs, rows x cols.
+   * @param assignment The column assigned to each row, -1 if none.
+   */
+  virtual void Solve(const Matrix &cost_matrix, std::vector<int> *assignment) = 0;
+
+  /**
+   * @brief Solve the assignment, and accumulate the size of the cost matrix and the time of the solver to stats.
+   */
+  void Assign(const Matrix &cost_matrix, std::vector<int> *assignment, MatchStats *stats);
+
+  static std::unique_ptr<AssignmentSolver> Create(AssignmentMethod method);
+};  // class AssignmentSolver
+
+/**
+ * @brief The Munkres algorithm of HungarianAlgorithm, O(n^3) with a large constant.
+ */
+class HungarianSolver : public AssignmentSolver {
+ public:
+  void Solve(const Matrix &cost_matrix, std::vector<int> *assignment) override;
+
+ private:
+  HungarianAlgorithm hungarian_;
+  std::vector<uint8_t> workspace_;
+};  // class HungarianSolver
+
+/**
+ * @brief The shortest augmenting path algorithm of Jonker and Volgenant, in the rectangular form of Crouse.
+ *
+ * Rows are assigned one by one along the shortest alternating path on the reduced costs, found by a Dijkstra-like
+ * search over the columns, then the dual variables are updated. It is optimal as the Hungarian algorithm, in
+ * O(rows^2 * cols) with rows <= cols, the matrix being transposed otherwise.
+ */
+class LapjvSolver : public AssignmentSolver {
+ public:
+  void Solve(const Matrix &cost_matrix, std::vector<int> *assignment) override;
+
+ private:
+  // rows <= cols, cost row major
+  void SolveWide(const float *cost, int rows, int cols, std::vector<int> *col4row);
+
+  std::vector<float> transposed_;
+  std::vector<double> u_, v_, shortest_;
+  std::vector<int> path_, row4col_, col4row_, remaining_;
+  std::vector<uint8_t> row_visited_, col_visited_;
+};  // class LapjvSolver
+
+/**
+ * @brief Greedy assignment, the pair of the lowest cost first. Not optimal, in O(rows * cols * log(rows * cols)),
+ *        for very large problems.
+ */
+class GreedySolver : public AssignmentSolver {
+ public:
+  void Solve(const Matrix &cost_matrix, std::vector<int> *assignment) override;
+
+ private:
+  std::vector<uint32_t> order_;
+  std::vector<uint8_t> col_assigned_;
+};  // class GreedySolver
+
+}  // namespace cnstream
+
+#endif  // EASYTRACK_ASSIGNMENT_H_
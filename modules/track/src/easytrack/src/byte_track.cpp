@@ -0,0 +1,244 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "../include/easy_track.h"
+#include "assignment.h"
+#include "cnstream_logging.hpp"
+#include "kalmanfilter.h"
+#include "match.h"
+#include "matrix.h"
+#include "track_data_type.h"
+
+namespace cnstream {
+
+// thresholds of iou distance of the low score detections and of the tentative tracks, as ByteTrack
+constexpr float kLowMaxIouDistance = 0.5;
+constexpr float kTentativeMaxIouDistance = 0.7;
+// new tracks are started by detections of score above high_score_thresh + kNewTrackScoreMargin
+constexpr float kNewTrackScoreMargin = 0.1;
+
+struct ByteTrackObject {
+  Rect pos;
+  int track_id = -1;
+  TrackState state = TrackState::TENTATIVE;
+  int age = 1;
+  int time_since_last_update = 0;
+};
+
+class ByteTrackPrivate {
+ private:
+  explicit ByteTrackPrivate(ByteTrack *bt) : bt_(bt), solver_(AssignmentSolver::Create(AssignmentMethod::LAPJV)) {
+    match_algo_ = MatchAlgorithm::Instance();
+  }
+  void Associate(const std::vector<int> &detect_indices, const std::vector<int> &track_indices, float max_distance,
+                 MatchResult *res);
+  void UpdateMatched(const MatchResult &res);
+  void UpdateFrame(const Objects &detects, Objects *tracks);
+
+  ByteTrack *bt_;
+
+  MatchAlgorithm *match_algo_;
+  std::unique_ptr<AssignmentSolver> solver_;
+  std::vector<ByteTrackObject> tracks_;
+  // states of the Kalman filters, indexed as tracks_
+  KalmanFilterBatch kf_;
+  std::vector<int> high_detections_;
+  std::vector<int> low_detections_;
+  std::vector<int> confirmed_track_;
+  std::vector<int> tentative_track_;
+  std::vector<int> remained_track_;
+  std::vector<int> assignments_;
+  std::vector<Rect> det_rects_;
+  std::vector<Rect> tra_rects_;
+  std::vector<uint8_t> detect_matched_;
+  std::vector<int> detect_track_id_;
+  std::vector<uint8_t> keep_;
+  MatchResult res_high_;
+  MatchResult res_low_;
+  MatchResult res_tentative_;
+  MatchStats match_stats_;
+  const Objects *detects_ = nullptr;
+
+  uint64_t next_id_ = 0;
+  friend class ByteTrack;
+};  // class ByteTrackPrivate
+
+ByteTrack::ByteTrack() { bt_p_ = new ByteTrackPrivate(this); }
+
+ByteTrack::~ByteTrack() { delete bt_p_; }
+
+void ByteTrack::SetParams(float high_score_thresh, float low_score_thresh, float max_iou_distance, int max_age,
+                          int n_init) {
+  // clang-format off
+  VLOG1(TRACK) << "ByteTrack Params -----\n"
+               << "\n\t high score threshold: " << high_score_thresh
+               << "\n\t low score threshold: " << low_score_thresh
+               << "\n\t max IoU distance: " << max_iou_distance
+               << "\n\t max age: " << max_age
+               << "\n\t n_init: " << n_init;
+  // clang-format on
+  high_score_thresh_ = high_score_thresh;
+  low_score_thresh_ = low_score_thresh;
+  max_iou_distance_ = max_iou_distance;
+  max_age_ = max_age;
+  n_init_ = n_init;
+}
+
+void ByteTrackPrivate::Associate(const std::vector<int> &detect_indices, const std::vector<int> &track_indices,
+                                 float max_distance, MatchResult *res) {
+  res->Clean();
+  if (detect_indices.empty() || track_indices.empty()) {
+    res->unmatched_detections = detect_indices;
+    res->unmatched_tracks = track_indices;
+    return;
+  }
+  const Objects &det_objs = *detects_;
+  det_rects_.clear();
+  tra_rects_.clear();
+  for (int idx : detect_indices) det_rects_.emplace_back(BoundingBox2Rect(det_objs[idx].bbox));
+  for (int idx : track_indices) tra_rects_.emplace_back(tracks_[idx].pos);
+  Matrix cost_matrix = match_algo_->IoUCost(tra_rects_, det_rects_);
+  solver_->Assign(cost_matrix, &assignments_, &match_stats_);
+
+  detect_matched_.assign(detect_indices.size(), 0);
+  for (size_t i = 0; i < assignments_.size(); ++i) {
+    if (assignments_[i] < 0 || cost_matrix(i, assignments_[i]) > max_distance) {
+      res->unmatched_tracks.push_back(track_indices[i]);
+    } else {
+      res->matches.emplace_back(std::make_pair(detect_indices[assignments_[i]], track_indices[i]));
+      detect_matched_[assignments_[i]] = 1;
+    }
+  }
+  for (size_t j = 0; j < detect_indices.size(); ++j) {
+    if (!detect_matched_[j]) res->unmatched_detections.push_back(detect_indices[j]);
+  }
+}
+
+void ByteTrackPrivate::UpdateMatched(const MatchResult &res) {
+  const Objects &det_objs = *detects_;
+  for (auto &pair : res.matches) {
+    ByteTrackObject &track = tracks_[pair.second];
+    kf_.Update(pair.second, to_xyah(det_objs[pair.first].bbox));
+    track.time_since_last_update = 0;
+    track.age++;
+    if (track.state == TrackState::TENTATIVE && track.age > bt_->n_init_) {
+      VLOG4(TRACK) << "new track: " << next_id_;
+      track.state = TrackState::CONFIRMED;
+      track.track_id = next_id_++;
+    }
+    detect_track_id_[pair.first] = track.track_id;
+  }
+}
+
+void ByteTrackPrivate::UpdateFrame(const Objects &detects, Objects *tracks) {
+  detects_ = &detects;
+  uint32_t detect_num = detects.size();
+  VLOG5(TRACK) << "ByteTrack) Track scale, detects " << detect_num << " tracks " << tracks_.size();
+
+  high_detections_.clear();
+  low_detections_.clear();
+  for (uint32_t i = 0; i < detect_num; ++i) {
+    if (detects[i].score >= bt_->high_score_thresh_) {
+      high_detections_.push_back(i);
+    } else if (detects[i].score >= bt_->low_score_thresh_) {
+      low_detections_.push_back(i);
+    }
+  }
+  detect_track_id_.assign(detect_num, -1);
+
+  confirmed_track_.clear();
+  tentative_track_.clear();
+  kf_.Predict();
+  for (size_t i = 0; i < tracks_.size(); ++i) {
+    if (tracks_[i].state == TrackState::CONFIRMED) {
+      confirmed_track_.push_back(i);
+    } else {
+      tentative_track_.push_back(i);
+    }
+    tracks_[i].time_since_last_update++;
+    tracks_[i].pos = BoundingBox2Rect(to_tlwh(kf_.GetCurPos(i)));
+  }
+
+  // the detections of high score to the confirmed tracks, lost ones included
+  Associate(high_detections_, confirmed_track_, bt_->max_iou_distance_, &res_high_);
+  UpdateMatched(res_high_);
+
+  // the detections of low score to the tracks left, which were tracked on the last frame
+  remained_track_.clear();
+  for (int idx : res_high_.unmatched_tracks) {
+    if (tracks_[idx].time_since_last_update == 1) remained_track_.push_back(idx);
+  }
+  Associate(low_detections_, remained_track_, kLowMaxIouDistance, &res_low_);
+  UpdateMatched(res_low_);
+
+  // the detections of high score left to the tentative tracks, which are deleted on miss
+  Associate(res_high_.unmatched_detections, tentative_track_, kTentativeMaxIouDistance, &res_tentative_);
+  UpdateMatched(res_tentative_);
+  for (int idx : res_tentative_.unmatched_tracks) tracks_[idx].state = TrackState::DELETED;
+  VLOG5(TRACK) << "ByteTrack) matched high " << res_high_.matches.size() << " low " << res_low_.matches.size()
+               << " tentative " << res_tentative_.matches.size();
+
+  // erase dead track object, and its Kalman filter
+  keep_.resize(tracks_.size());
+  size_t kept = 0;
+  for (size_t i = 0; i < tracks_.size(); ++i) {
+    keep_[i] = tracks_[i].state != TrackState::DELETED && tracks_[i].time_since_last_update <= bt_->max_age_;
+    if (!keep_[i]) {
+      VLOG4(TRACK) << "delete track: " << tracks_[i].track_id;
+      continue;
+    }
+    if (kept != i) tracks_[kept] = tracks_[i];
+    ++kept;
+  }
+  tracks_.resize(kept);
+  kf_.Retain(keep_);
+
+  // unmatched detections of high score: init new track
+  float new_track_thresh = bt_->high_score_thresh_ + kNewTrackScoreMargin;
+  for (int idx : res_tentative_.unmatched_detections) {
+    if (detects[idx].score < new_track_thresh) continue;
+    ByteTrackObject obj;
+    obj.pos = BoundingBox2Rect(detects[idx].bbox);
+    kf_.Initiate(to_xyah(detects[idx].bbox));
+    tracks_.push_back(obj);
+  }
+
+  tracks->reserve(tracks->size() + detect_num);
+  for (uint32_t i = 0; i < detect_num; ++i) {
+    tracks->emplace_back(detects[i]);
+    tracks->rbegin()->track_id = detect_track_id_[i];
+    tracks->rbegin()->detect_id = i;
+  }
+}
+
+void ByteTrack::UpdateFrame(const Objects &detects, Objects *tracks) {
+  if (!tracks) {
+    LOGF(TRACK) << "parameter 'tracks' is nullptr";
+  }
+  bt_p_->UpdateFrame(detects, tracks);
+}
+
+MatchStats ByteTrack::GetMatchStats() const { return bt_p_->match_stats_; }
+
+}  // namespace cnstream
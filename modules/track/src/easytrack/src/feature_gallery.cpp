@@ -0,0 +1,294 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "feature_gallery.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define EASYTRACK_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define EASYTRACK_NEON 1
+#endif
+
+namespace cnstream {
+
+namespace {
+
+// several accumulators, so that the compiler vectorizes the loop without reassociating the sum
+float DotProductC(const float *a, const float *b, int dim) {
+  float acc[8] = {0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f};
+  int i = 0;
+  for (; i + 8 <= dim; i += 8) {
+    for (int l = 0; l < 8; ++l) acc[l] += a[i + l] * b[i + l];
+  }
+  float sum = ((acc[0] + acc[4]) + (acc[1] + acc[5])) + ((acc[2] + acc[6]) + (acc[3] + acc[7]));
+  for (; i < dim; ++i) sum += a[i] * b[i];
+  return sum;
+}
+
+int32_t DotProductC(const int8_t *a, const int8_t *b, int dim) {
+  int32_t sum = 0;
+  for (int i = 0; i < dim; ++i) sum += static_cast<int32_t>(a[i]) * b[i];
+  return sum;
+}
+
+#ifdef EASYTRACK_X86
+__attribute__((target("avx2,fma"))) float DotProductAvx2(const float *a, const float *b, int dim) {
+  // independent accumulators hide the latency of fma
+  __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+  __m256 acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+  int i = 0;
+  for (; i + 32 <= dim; i += 32) {
+    acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+    acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+    acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 16), _mm256_loadu_ps(b + i + 16), acc2);
+    acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 24), _mm256_loadu_ps(b + i + 24), acc3);
+  }
+  for (; i + 8 <= dim; i += 8) {
+    acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+  }
+  __m256 acc = _mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3));
+  __m128 sum4 = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+  sum4 = _mm_add_ps(sum4, _mm_movehl_ps(sum4, sum4));
+  sum4 = _mm_add_ss(sum4, _mm_shuffle_ps(sum4, sum4, 1));
+  float sum = _mm_cvtss_f32(sum4);
+  for (; i < dim; ++i) sum += a[i] * b[i];
+  return sum;
+}
+
+__attribute__((target("avx2"))) int32_t DotProductAvx2(const int8_t *a, const int8_t *b, int dim) {
+  __m256i acc = _mm256_setzero_si256();
+  int i = 0;
+  for (; i + 16 <= dim; i += 16) {
+    __m256i va = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i)));
+    __m256i vb = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i)));
+    acc = _mm256_add_epi32(acc, _mm256_madd_epi16(va, vb));
+  }
+  __m128i sum4 = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+  sum4 = _mm_add_epi32(sum4, _mm_shuffle_epi32(sum4, _MM_SHUFFLE(1, 0, 3, 2)));
+  sum4 = _mm_add_epi32(sum4, _mm_shuffle_epi32(sum4, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtsi128_si32(sum4) + DotProductC(a + i, b + i, dim - i);
+}
+
+bool CpuSupportsAvx2() {
+  static const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+  return supported;
+}
+#endif  // EASYTRACK_X86
+
+#ifdef EASYTRACK_NEON
+float DotProductNeon(const float *a, const float *b, int dim) {
+  float32x4_t acc0 = vdupq_n_f32(0.f), acc1 = vdupq_n_f32(0.f);
+  int i = 0;
+  for (; i + 8 <= dim; i += 8) {
+    acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+    acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+  }
+  float sum = vaddvq_f32(vaddq_f32(acc0, acc1));
+  for (; i < dim; ++i) sum += a[i] * b[i];
+  return sum;
+}
+
+int32_t DotProductNeon(const int8_t *a, const int8_t *b, int dim) {
+  int32x4_t acc = vdupq_n_s32(0);
+  int i = 0;
+  for (; i + 16 <= dim; i += 16) {
+    int8x16_t va = vld1q_s8(a + i), vb = vld1q_s8(b + i);
+    acc = vpadalq_s16(acc, vmull_s8(vget_low_s8(va), vget_low_s8(vb)));
+    acc = vpadalq_s16(acc, vmull_s8(vget_high_s8(va), vget_high_s8(vb)));
+  }
+  return vaddvq_s32(acc) + DotProductC(a + i, b + i, dim - i);
+}
+#endif  // EASYTRACK_NEON
+
+}  // namespace
+
+float DotProduct(const float *a, const float *b, int dim) {
+#if defined(EASYTRACK_X86)
+  if (CpuSupportsAvx2()) return DotProductAvx2(a, b, dim);
+#elif defined(EASYTRACK_NEON)
+  return DotProductNeon(a, b, dim);
+#endif
+  return DotProductC(a, b, dim);
+}
+
+int32_t DotProduct(const int8_t *a, const int8_t *b, int dim) {
+#if defined(EASYTRACK_X86)
+  if (CpuSupportsAvx2()) return DotProductAvx2(a, b, dim);
+#elif defined(EASYTRACK_NEON)
+  return DotProductNeon(a, b, dim);
+#endif
+  return DotProductC(a, b, dim);
+}
+
+void FeatureGallery::Clear(int dim) {
+  dim_ = dim;
+  size_ = 0;
+  head_ = 0;
+  data_.clear();
+  qdata_.clear();
+  scales_.clear();
+}
+
+void FeatureGallery::SetCapacity(size_t capacity) {
+  if (capacity == capacity_) return;
+  FeatureGallery gallery(precision_);
+  gallery.capacity_ = capacity;
+  gallery.dim_ = dim_;
+  size_t first = capacity && size_ > capacity ? size_ - capacity : 0;
+  for (size_t row = first; row < size_; ++row) gallery.Append(*this, row);
+  *this = std::move(gallery);
+}
+
+size_t FeatureGallery::NewRow() {
+  size_t slot;
+  if (!capacity_) {
+    slot = size_++;
+  } else if (size_ < capacity_) {
+    slot = (head_ + size_++) % capacity_;
+  } else {
+    slot = head_;
+    head_ = (head_ + 1) % capacity_;
+  }
+  // all the slots of a ring buffer are allocated with the first row
+  const size_t slots = capacity_ ? capacity_ : size_;
+  if (precision_ == FeaturePrecision::FLOAT32) {
+    if (data_.size() < slots * dim_) data_.resize(slots * dim_);
+  } else {
+    if (qdata_.size() < slots * dim_) qdata_.resize(slots * dim_);
+    if (scales_.size() < slots) scales_.resize(slots);
+  }
+  return slot;
+}
+
+bool FeatureGallery::Add(const std::vector<float> &feature) {
+  const int dim = static_cast<int>(feature.size());
+  if (size_ == 0 && dim_ == 0) dim_ = dim;
+  const bool valid = dim == dim_;
+  float norm = valid ? std::sqrt(DotProduct(feature.data(), feature.data(), dim)) : 0.f;
+  const size_t slot = NewRow();
+  if (precision_ == FeaturePrecision::FLOAT32) {
+    float *row = data_.data() + slot * dim_;
+    if (norm > 0) {
+      for (int i = 0; i < dim_; ++i) row[i] = feature[i] / norm;
+    } else {
+      std::fill(row, row + dim_, 0.f);
+    }
+  } else {
+    int8_t *row = qdata_.data() + slot * dim_;
+    float max_abs = 0.f;
+    if (norm > 0) {
+      for (int i = 0; i < dim_; ++i) max_abs = std::max(max_abs, std::fabs(feature[i]));
+    }
+    if (max_abs > 0) {
+      // the normalized feature is quantized to [-127, 127] by its largest element
+      const float scale = 127.f / max_abs;
+      for (int i = 0; i < dim_; ++i) row[i] = static_cast<int8_t>(std::lround(feature[i] * scale));
+      scales_[slot] = max_abs / (127.f * norm);
+    } else {
+      std::fill(row, row + dim_, 0);
+      scales_[slot] = 0.f;
+    }
+  }
+  return valid || dim == 0;
+}
+
+bool FeatureGallery::Append(const FeatureGallery &other, size_t row) {
+  if (precision_ != other.precision_ || row >= other.size_) return false;
+  if (size_ == 0 && dim_ == 0) dim_ = other.dim_;
+  if (dim_ != other.dim_) return false;
+  const size_t src_slot = other.Slot(row);
+  const size_t slot = NewRow();
+  if (precision_ == FeaturePrecision::FLOAT32) {
+    const float *src = other.data_.data() + src_slot * dim_;
+    std::copy(src, src + dim_, data_.data() + slot * dim_);
+  } else {
+    const int8_t *src = other.qdata_.data() + src_slot * dim_;
+    std::copy(src, src + dim_, qdata_.data() + slot * dim_);
+    scales_[slot] = other.scales_[src_slot];
+  }
+  return true;
+}
+
+void FeatureGallery::PopFront(size_t num) {
+  num = std::min(num, size_);
+  size_ -= num;
+  if (capacity_) {
+    head_ = (head_ + num) % capacity_;
+  } else if (precision_ == FeaturePrecision::FLOAT32) {
+    data_.erase(data_.begin(), data_.begin() + num * dim_);
+  } else {
+    qdata_.erase(qdata_.begin(), qdata_.begin() + num * dim_);
+    scales_.erase(scales_.begin(), scales_.begin() + num);
+  }
+}
+
+float FeatureGallery::MaxSimilarity(const FeatureGallery &other, size_t row) const {
+  if (precision_ != other.precision_ || dim_ != other.dim_ || row >= other.size_) return 0.f;
+  const size_t other_slot = other.Slot(row);
+  float max_simi = 0.f;
+  if (precision_ == FeaturePrecision::FLOAT32) {
+    const float *feature = other.data_.data() + other_slot * dim_;
+    for (size_t k = 0; k < size_; ++k) {
+      max_simi = std::max(max_simi, DotProduct(data_.data() + Slot(k) * dim_, feature, dim_));
+    }
+  } else {
+    const int8_t *feature = other.qdata_.data() + other_slot * dim_;
+    for (size_t k = 0; k < size_; ++k) {
+      const size_t slot = Slot(k);
+      max_simi = std::max(max_simi, DotProduct(qdata_.data() + slot * dim_, feature, dim_) * scales_[slot]);
+    }
+    max_simi *= other.scales_[other_slot];
+  }
+  return std::min(max_simi, 1.f);
+}
+
+void FeatureGallery::MaxSimilarity(const FeatureGallery &other, const std::vector<int> &rows,
+                                   std::vector<float> *similarities) const {
+  similarities->assign(rows.size(), 0.f);
+  if (precision_ != other.precision_ || dim_ != other.dim_) return;
+  float *simi = similarities->data();
+  // each row of the gallery is loaded once and compared with all the rows of other, which stay in cache
+  for (size_t k = 0; k < size_; ++k) {
+    const size_t slot = Slot(k);
+    if (precision_ == FeaturePrecision::FLOAT32) {
+      const float *feature = data_.data() + slot * dim_;
+      for (size_t j = 0; j < rows.size(); ++j) {
+        simi[j] = std::max(simi[j], DotProduct(feature, other.data_.data() + other.Slot(rows[j]) * dim_, dim_));
+      }
+    } else {
+      const int8_t *feature = qdata_.data() + slot * dim_;
+      for (size_t j = 0; j < rows.size(); ++j) {
+        const size_t other_slot = other.Slot(rows[j]);
+        float dot = DotProduct(feature, other.qdata_.data() + other_slot * dim_, dim_) * scales_[slot];
+        simi[j] = std::max(simi[j], dot * other.scales_[other_slot]);
+      }
+    }
+  }
+  for (size_t j = 0; j < rows.size(); ++j) simi[j] = std::min(simi[j], 1.f);
+}
+
+}  // namespace cnstream
@@ -0,0 +1,130 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+/**
+ * @file feature_gallery.h
+ *
+ * This file contains a declaration of the FeatureGallery class, and the dot product kernels of the features.
+ */
+
+#ifndef EASYTRACK_FEATURE_GALLERY_H_
+#define EASYTRACK_FEATURE_GALLERY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../include/easy_track.h"
+
+namespace cnstream {
+
+/**
+ * @brief Dot product of two float vectors, vectorized with AVX2 or NEON when the CPU supports it.
+ */
+float DotProduct(const float *a, const float *b, int dim);
+
+/**
+ * @brief Dot product of two int8 vectors, accumulated in int32.
+ */
+int32_t DotProduct(const int8_t *a, const int8_t *b, int dim);
+
+/**
+ * @brief Features normalized to unit L2 norm on ingest, stored contiguously row by row.
+ *
+ * The cosine similarity of two features is the dot product of their rows, so that comparing a feature with a gallery
+ * is a matrix-vector product. In INT8 precision, each row is quantized symmetrically with its own scale, which cuts
+ * the memory traffic by 4, and the similarity is the int32 dot product of the rows times both scales. Zero features
+ * are stored as zero rows, of which the similarity to any feature is 0.
+ *
+ * A gallery of a capacity is a ring buffer of capacity rows allocated once: when it is full, a new feature overwrites
+ * the oldest one in place.
+ */
+class FeatureGallery {
+ public:
+  explicit FeatureGallery(FeaturePrecision precision = FeaturePrecision::FLOAT32) : precision_(precision) {}
+
+  FeaturePrecision Precision() const { return precision_; }
+  int Dim() const { return dim_; }
+  size_t Size() const { return size_; }
+  bool Empty() const { return size_ == 0; }
+  size_t Capacity() const { return capacity_; }
+
+  /**
+   * @brief Set the largest number of features, 0 for no limit. The newest features are kept.
+   */
+  void SetCapacity(size_t capacity);
+
+  /**
+   * @brief Remove all the features, and set the dimension of the features, 0 to take that of the next feature.
+   */
+  void Clear(int dim = 0);
+
+  /**
+   * @brief Normalize a feature and append it, the oldest row is dropped if the gallery is full.
+   *
+   * An empty feature is appended as a zero row.
+   *
+   * @return Returns false if the dimension of the feature differs from the others, a zero row is appended then.
+   */
+  bool Add(const std::vector<float> &feature);
+
+  /**
+   * @brief Append a row of another gallery of the same precision, the oldest row is dropped if the gallery is full.
+   *
+   * @return Returns false if the dimensions or the precisions differ, nothing is appended then.
+   */
+  bool Append(const FeatureGallery &other, size_t row);
+
+  /**
+   * @brief Remove the oldest num rows.
+   */
+  void PopFront(size_t num);
+
+  /**
+   * @brief The largest cosine similarity of the features with a row of another gallery, clipped to [0, 1].
+   */
+  float MaxSimilarity(const FeatureGallery &other, size_t row) const;
+
+  /**
+   * @brief MaxSimilarity of several rows of another gallery, as a product of the two galleries.
+   *
+   * @param similarities The similarities, one for each of rows.
+   */
+  void MaxSimilarity(const FeatureGallery &other, const std::vector<int> &rows, std::vector<float> *similarities) const;
+
+ private:
+  // the slot of a new row, which overwrites the oldest one if full
+  size_t NewRow();
+  // the slot of the row-th oldest row
+  size_t Slot(size_t row) const { return capacity_ ? (head_ + row) % capacity_ : row; }
+
+  FeaturePrecision precision_;
+  int dim_ = 0;
+  size_t size_ = 0;
+  size_t capacity_ = 0;
+  size_t head_ = 0;  // the slot of the oldest row
+  std::vector<float> data_;    // slots of FLOAT32
+  std::vector<int8_t> qdata_;  // slots of INT8
+  std::vector<float> scales_;  // scale of each slot of INT8
+};  // class FeatureGallery
+
+}  // namespace cnstream
+
+#endif  // EASYTRACK_FEATURE_GALLERY_H_
@@ -0,0 +1,172 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+/**
+ * @file fixed_matrix.h
+ *
+ * This file contains a declaration of the FixedMatrix class, a matrix of the dimensions known at compile time.
+ */
+
+#ifndef EASYTRACK_FIXED_MATRIX_H_
+#define EASYTRACK_FIXED_MATRIX_H_
+
+#include <cmath>
+
+namespace cnstream {
+
+/**
+ * @brief Matrix of float with the dimensions known at compile time, stored in row major order without heap
+ *        allocation. Loops are of constant trip counts, which are unrolled and vectorized by the compiler.
+ */
+template <int Rows, int Cols>
+class FixedMatrix {
+ public:
+  static constexpr int kRows = Rows;
+  static constexpr int kCols = Cols;
+  static constexpr int kSize = Rows * Cols;
+
+  /**
+   * Constructor, initialized as zero matrix
+   */
+  FixedMatrix() { Fill(0.f); }
+
+  static FixedMatrix Identity() {
+    static_assert(Rows == Cols, "Identity matrix must be square");
+    FixedMatrix m;
+    for (int i = 0; i < Rows; ++i) m(i, i) = 1.f;
+    return m;
+  }
+
+  void Fill(float element) {
+    for (int i = 0; i < kSize; ++i) data_[i] = element;
+  }
+
+  const float &operator()(int row, int col) const { return data_[row * Cols + col]; }
+  float &operator()(int row, int col) { return data_[row * Cols + col]; }
+
+  const float *Data() const { return data_; }
+  float *Data() { return data_; }
+
+  FixedMatrix<Cols, Rows> Trans() const {
+    FixedMatrix<Cols, Rows> ret;
+    for (int i = 0; i < Rows; ++i) {
+      for (int j = 0; j < Cols; ++j) ret(j, i) = (*this)(i, j);
+    }
+    return ret;
+  }
+
+  FixedMatrix &operator+=(const FixedMatrix &m) {
+    for (int i = 0; i < kSize; ++i) data_[i] += m.data_[i];
+    return *this;
+  }
+
+  FixedMatrix &operator-=(const FixedMatrix &m) {
+    for (int i = 0; i < kSize; ++i) data_[i] -= m.data_[i];
+    return *this;
+  }
+
+ private:
+  alignas(16) float data_[kSize];
+};  // class FixedMatrix
+
+template <int Rows, int Cols>
+FixedMatrix<Rows, Cols> operator+(FixedMatrix<Rows, Cols> lhs, const FixedMatrix<Rows, Cols> &rhs) {
+  lhs += rhs;
+  return lhs;
+}
+
+template <int Rows, int Cols>
+FixedMatrix<Rows, Cols> operator-(FixedMatrix<Rows, Cols> lhs, const FixedMatrix<Rows, Cols> &rhs) {
+  lhs -= rhs;
+  return lhs;
+}
+
+/**
+ * Matrix multiplication, products are accumulated in double as Matrix does.
+ */
+template <int Rows, int K, int Cols>
+FixedMatrix<Rows, Cols> operator*(const FixedMatrix<Rows, K> &lhs, const FixedMatrix<K, Cols> &rhs) {
+  FixedMatrix<Rows, Cols> m;
+  for (int i = 0; i < Rows; ++i) {
+    for (int j = 0; j < Cols; ++j) {
+      double sum = 0.0;
+      for (int k = 0; k < K; ++k) sum += lhs(i, k) * rhs(k, j);
+      m(i, j) = sum;
+    }
+  }
+  return m;
+}
+
+/**
+ * @brief Cholesky decomposition of a symmetric positive definite matrix, a = l * l^T, in double.
+ *
+ * Only the lower triangle of `a` is read. Non-positive pivots are clamped to a tiny value, so that a degenerate
+ * covariance yields large distances instead of NaN.
+ */
+template <int N>
+void CholeskyDecompose(const FixedMatrix<N, N> &a, double l[N][N]) {
+  for (int j = 0; j < N; ++j) {
+    double diag = a(j, j);
+    for (int k = 0; k < j; ++k) diag -= l[j][k] * l[j][k];
+    diag = std::sqrt(diag > 1e-12 ? diag : 1e-12);
+    l[j][j] = diag;
+    for (int i = j + 1; i < N; ++i) {
+      double sum = a(i, j);
+      for (int k = 0; k < j; ++k) sum -= l[i][k] * l[j][k];
+      l[i][j] = sum / diag;
+    }
+    for (int i = 0; i < j; ++i) l[i][j] = 0;
+  }
+}
+
+/**
+ * @brief Solves l * l^T * x = b in place with the Cholesky factor l.
+ */
+template <int N>
+void CholeskySolve(const double l[N][N], double b[N]) {
+  for (int i = 0; i < N; ++i) {
+    for (int k = 0; k < i; ++k) b[i] -= l[i][k] * b[k];
+    b[i] /= l[i][i];
+  }
+  for (int i = N - 1; i >= 0; --i) {
+    for (int k = i + 1; k < N; ++k) b[i] -= l[k][i] * b[k];
+    b[i] /= l[i][i];
+  }
+}
+
+/**
+ * @brief Computes the squared mahalanobis distance d^T * (l * l^T)^-1 * d with the Cholesky factor l.
+ */
+template <int N>
+double CholeskyMahalanobis(const double l[N][N], const double d[N]) {
+  double y[N];
+  double dist = 0;
+  for (int i = 0; i < N; ++i) {
+    double sum = d[i];
+    for (int k = 0; k < i; ++k) sum -= l[i][k] * y[k];
+    y[i] = sum / l[i][i];
+    dist += y[i] * y[i];
+  }
+  return dist;
+}
+
+}  // namespace cnstream
+
+#endif  // EASYTRACK_FIXED_MATRIX_H_
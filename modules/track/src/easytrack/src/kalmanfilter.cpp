@@ -24,129 +24,340 @@
 
 namespace cnstream {
 
-const Matrix KalmanFilter::motion_mat_{
-    std::vector<float>{1, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 1,
-                       0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 1},
-    8u, 8u};
-const Matrix KalmanFilter::update_mat_{
-    std::vector<float>{1, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0},
-    4u, 8u};
+namespace {
 
-const Matrix KalmanFilter::update_mat_trans_{KalmanFilter::update_mat_.Trans()};
-const Matrix KalmanFilter::motion_mat_trans_{KalmanFilter::motion_mat_.Trans()};
+constexpr float kStdWeightPosition = 1. / 20;
+constexpr float kStdWeightVelocity = 1. / 160;
 
-KalmanFilter::KalmanFilter()
-    : mean_(1, 8), covariance_(8, 8), std_weight_position_(1. / 20), std_weight_velocity_(1. / 160) {}
+// index of (row, col) in the lower triangle of a 4x4 matrix, stored row by row
+constexpr int Tri(int row, int col) { return row * (row + 1) / 2 + col; }
 
-void KalmanFilter::Initiate(const BoundingBox &measurement) {
+void InitiateState(const BoundingBox &measurement, KalmanFilter::Mean *mean, KalmanFilter::Covariance *covariance) {
   // initial state X(k-1|k-1)
-  mean_(0, 0) = measurement.x;
-  mean_(0, 1) = measurement.y;
-  mean_(0, 2) = measurement.width;
-  mean_(0, 3) = measurement.height;
+  (*mean)(0, 0) = measurement.x;
+  (*mean)(0, 1) = measurement.y;
+  (*mean)(0, 2) = measurement.width;
+  (*mean)(0, 3) = measurement.height;
   for (int i = 4; i < 8; ++i) {
-    mean_(0, i) = 0;
+    (*mean)(0, i) = 0;
   }
 
-  std::vector<float> std(8, 0);
+  float std[8];
   std[2] = 1e-2;
-  std[0] = std[1] = std[3] = 2 * std_weight_position_ * measurement.height;
+  std[0] = std[1] = std[3] = 2 * kStdWeightPosition * measurement.height;
 
   std[6] = 1e-5;
-  std[4] = std[5] = std[7] = 10 * std_weight_velocity_ * measurement.height;
+  std[4] = std[5] = std[7] = 10 * kStdWeightVelocity * measurement.height;
 
   // init MMSE P(k-1|k-1)
-  for (int i = 0; i < 8; ++i) covariance_(i, i) = std[i] * std[i];
+  covariance->Fill(0.f);
+  for (int i = 0; i < 8; ++i) (*covariance)(i, i) = std[i] * std[i];
 }
 
-void KalmanFilter::Predict() {
-  std::vector<float> std(8, 0);
-  Matrix motion_cov(8, 8);
+void UpdateState(const double project_chol[4][4], const FixedMatrix<1, 4> &project_mean, const BoundingBox &bbox,
+                 KalmanFilter::Mean *mean, KalmanFilter::Covariance *covariance) {
+  const double innovation[4] = {bbox.x - project_mean(0, 0), bbox.y - project_mean(0, 1),
+                                bbox.width - project_mean(0, 2), bbox.height - project_mean(0, 3)};
 
-  // process noise covariance Q
+  // formula 3: Kg = P(k|k-1) * H^T * (H*P(k|k-1)*H^T + R)^(-1), solved row by row as the inverse is symmetric
+  double kalman_gain[8][4];
+  for (int i = 0; i < 8; ++i) {
+    for (int k = 0; k < 4; ++k) kalman_gain[i][k] = (*covariance)(i, k);
+    CholeskySolve<4>(project_chol, kalman_gain[i]);
+  }
 
+  // formula 4: x(k|k) = x(k|k-1) + Kg * (m - H * x(k|k-1))
+  for (int i = 0; i < 8; ++i) {
+    double sum = 0.0;
+    for (int k = 0; k < 4; ++k) sum += innovation[k] * static_cast<float>(kalman_gain[i][k]);
+    (*mean)(0, i) += static_cast<float>(sum);
+  }
+
+  // formula 5: P(k|k) = P(k|k-1) - Kg * H * P(k|k-1), H * P(k|k-1) is the first 4 rows
+  KalmanFilter::Covariance correction;
+  for (int i = 0; i < 8; ++i) {
+    for (int j = 0; j < 8; ++j) {
+      double sum = 0.0;
+      for (int k = 0; k < 4; ++k) sum += static_cast<float>(kalman_gain[i][k]) * (*covariance)(k, j);
+      correction(i, j) = sum;
+    }
+  }
+  *covariance -= correction;
+}
+
+template <typename T>
+void Compact(const std::vector<uint8_t> &keep, std::vector<T> *values) {
+  size_t kept = 0;
+  for (size_t i = 0; i < values->size(); ++i) {
+    if (keep[i]) (*values)[kept++] = (*values)[i];
+  }
+  values->resize(kept);
+}
+
+}  // namespace
+
+KalmanFilter::KalmanFilter() : std_weight_position_(kStdWeightPosition), std_weight_velocity_(kStdWeightVelocity) {}
+
+void KalmanFilter::Initiate(const BoundingBox &measurement) {
+  InitiateState(measurement, &mean_, &covariance_);
+  need_recalc_project_ = true;
+}
+
+void KalmanFilter::Predict() {
+  // process noise covariance Q
+  float std[8];
   std[2] = 1e-2;
   std[0] = std[1] = std[3] = std_weight_position_ * mean_(0, 3);
   std[6] = 1e-5;
   std[4] = std[5] = std[7] = std_weight_velocity_ * mean_(0, 3);
 
+  // A = [I I; 0 I], the products are additions of the blocks in the same order as the general product
+  // formula 1：x(k|k-1)=A*x(k-1|k-1)
+  for (int i = 0; i < 4; ++i) mean_(0, i) += mean_(0, i + 4);
+  // formula 2：P(k|k-1)=A*P(k-1|k-1)A^T +Q, A*P first
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 8; ++j) covariance_(i, j) += covariance_(i + 4, j);
+  }
   for (int i = 0; i < 8; ++i) {
-    motion_cov(i, i) = std[i] * std[i];
+    for (int j = 0; j < 4; ++j) covariance_(i, j) += covariance_(i, j + 4);
   }
+  for (int i = 0; i < 8; ++i) covariance_(i, i) += std[i] * std[i];
 
-  // formula 1：x(k|k-1)=A*x(k-1|k-1)
-  // mean_ = (motion_mat_ * mean_.Trans()).Trans();
-  Matrix mean1 = mean_ * motion_mat_trans_;
-  // formula 2：P(k|k-1)=A*P(k-1|k-1)A^T +Q
-  Matrix covariance1 = motion_mat_ * covariance_ * motion_mat_trans_ + motion_cov;
-
-  mean_ = std::move(mean1);
-  covariance_ = std::move(covariance1);
   need_recalc_project_ = true;
 }
 
-void KalmanFilter::Project(const Matrix &mean, const Matrix &covariance) {
+void KalmanFilter::Project() {
   if (!need_recalc_project_) return;
   float cov_val1 = 1e-1 * 1e-1;
-  float cov_val2 = std_weight_position_ * mean(0, 3);
+  float cov_val2 = std_weight_position_ * mean_(0, 3);
   cov_val2 *= cov_val2;
 
-  // measurement noise R
-  Matrix innovation_cov(4, 4);
+  // H = [I 0], project_mean_ = H*x(k|k-1)
+  for (int i = 0; i < 4; ++i) project_mean_(0, i) = mean_(0, i);
 
-  innovation_cov(0, 0) = cov_val2;
-  innovation_cov(1, 1) = cov_val2;
-  innovation_cov(3, 3) = cov_val2;
-
-  innovation_cov(2, 2) = cov_val1;
-
-  // project_mean_ = (update_mat_ * mean_.Trans()).Trans();
-  project_mean_ = mean_ * update_mat_trans_;
+  // part of formula 3：(H*P(k|k-1)*H^T + R), R is the measurement noise
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 4; ++j) project_covariance_(i, j) = covariance_(i, j);
+  }
+  project_covariance_(0, 0) += cov_val2;
+  project_covariance_(1, 1) += cov_val2;
+  project_covariance_(2, 2) += cov_val1;
+  project_covariance_(3, 3) += cov_val2;
 
-  // part of formula 3：(H*P(k|k-1)*H^T + R)
-  project_covariance_ = update_mat_ * covariance * update_mat_trans_ + innovation_cov;
+  CholeskyDecompose<4>(project_covariance_, project_chol_);
   need_recalc_project_ = false;
 }
 
 void KalmanFilter::Update(const BoundingBox &bbox) {
-  Project(mean_, covariance_);
+  Project();
+  UpdateState(project_chol_, project_mean_, bbox, &mean_, &covariance_);
+  need_recalc_project_ = true;
+}
 
-  Matrix measurement(1, 4);
-  measurement(0, 0) = bbox.x;
-  measurement(0, 1) = bbox.y;
-  measurement(0, 2) = bbox.width;
-  measurement(0, 3) = bbox.height;
+void KalmanFilter::GatingDistance(const std::vector<BoundingBox> &measurements, std::vector<float> *distances) {
+  Project();
+  distances->resize(measurements.size());
+  for (size_t i = 0; i < measurements.size(); i++) {
+    const double d[4] = {measurements[i].x - project_mean_(0, 0), measurements[i].y - project_mean_(0, 1),
+                         measurements[i].width - project_mean_(0, 2), measurements[i].height - project_mean_(0, 3)};
+    (*distances)[i] = CholeskyMahalanobis<4>(project_chol_, d);
+  }
+}
 
-  // formula 3: Kg = P(k|k-1) * H^T * (H*P(k|k-1)*H^T + R)^(-1)
-  Matrix kalman_gain = covariance_ * update_mat_trans_ * project_covariance_.Inv();
-  // formula 4: x(k|k) = x(k|k-1) + Kg * (m - H * x(k|k-1))
-  mean_ += (measurement - project_mean_) * kalman_gain.Trans();
-  // formula 5: P(k|k) = P(k|k-1) - Kg * H * P(k|k-1)
-  covariance_ = covariance_ - kalman_gain * update_mat_ * covariance_;
-  // covariance_ = covariance_ - kalman_gain * projected_cov * kalman_gain.Trans();
+BoundingBox KalmanFilter::GetCurPos() { return {mean_(0, 0), mean_(0, 1), mean_(0, 2), mean_(0, 3)}; }
 
-  need_recalc_project_ = true;
+KalmanFilterBatch::KalmanFilterBatch()
+    : std_weight_position_(kStdWeightPosition), std_weight_velocity_(kStdWeightVelocity) {}
+
+void KalmanFilterBatch::Initiate(const BoundingBox &measurement) {
+  KalmanFilter::Mean mean;
+  KalmanFilter::Covariance covariance;
+  InitiateState(measurement, &mean, &covariance);
+  for (int i = 0; i < 8; ++i) mean_[i].push_back(mean(0, i));
+  for (int i = 0; i < 64; ++i) covariance_[i].push_back(covariance.Data()[i]);
+  for (int i = 0; i < 4; ++i) project_mean_[i].push_back(0.f);
+  for (int i = 0; i < kCholSize; ++i) project_chol_[i].push_back(0.0);
+  projected_.push_back(0);
 }
 
-Matrix KalmanFilter::GatingDistance(const std::vector<BoundingBox> &measurements) {
-  Project(mean_, covariance_);
-  Matrix const &mean1 = project_mean_;
-  Matrix covariance1_inv = project_covariance_.Inv();
+void KalmanFilterBatch::Retain(const std::vector<uint8_t> &keep) {
+  for (int i = 0; i < 8; ++i) Compact(keep, &mean_[i]);
+  for (int i = 0; i < 64; ++i) Compact(keep, &covariance_[i]);
+  for (int i = 0; i < 4; ++i) Compact(keep, &project_mean_[i]);
+  for (int i = 0; i < kCholSize; ++i) Compact(keep, &project_chol_[i]);
+  Compact(keep, &projected_);
+}
+
+void KalmanFilterBatch::Clear() {
+  std::vector<uint8_t> keep(Size(), 0);
+  Retain(keep);
+}
 
-  int num = measurements.size();
-  Matrix d(1, 4);
-  Matrix square_maha(1, num);
-  for (int i = 0; i < num; i++) {
-    d(0, 0) = measurements[i].x - mean1(0, 0);
-    d(0, 1) = measurements[i].y - mean1(0, 1);
-    d(0, 2) = measurements[i].width - mean1(0, 2);
-    d(0, 3) = measurements[i].height - mean1(0, 3);
+void KalmanFilterBatch::Predict() {
+  const size_t num = Size();
+  float *mean[8], *cov[64];
+  for (int i = 0; i < 8; ++i) mean[i] = mean_[i].data();
+  for (int i = 0; i < 64; ++i) cov[i] = covariance_[i].data();
 
-    square_maha(0, i) = (d * covariance1_inv * d.Trans())(0, 0);
+  // process noise covariance Q, from the height before the prediction
+  std_position_.resize(num);
+  std_velocity_.resize(num);
+  for (size_t t = 0; t < num; ++t) {
+    std_position_[t] = std_weight_position_ * mean[3][t];
+    std_velocity_[t] = std_weight_velocity_ * mean[3][t];
+  }
+
+  // the same block additions as KalmanFilter::Predict, each a loop over the tracks
+  for (int i = 0; i < 4; ++i) {
+    for (size_t t = 0; t < num; ++t) mean[i][t] += mean[i + 4][t];
+  }
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 8; ++j) {
+      float *dst = cov[i * 8 + j];
+      const float *src = cov[(i + 4) * 8 + j];
+      for (size_t t = 0; t < num; ++t) dst[t] += src[t];
+    }
+  }
+  for (int i = 0; i < 8; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      float *dst = cov[i * 8 + j];
+      const float *src = cov[i * 8 + j + 4];
+      for (size_t t = 0; t < num; ++t) dst[t] += src[t];
+    }
+  }
+  const float std_aspect = 1e-2, std_aspect_velocity = 1e-5;
+  for (int i = 0; i < 8; ++i) {
+    float *diag = cov[i * 9];
+    if (i == 2 || i == 6) {
+      const float std = i == 2 ? std_aspect : std_aspect_velocity;
+      for (size_t t = 0; t < num; ++t) diag[t] += std * std;
+    } else {
+      const float *std = i < 4 ? std_position_.data() : std_velocity_.data();
+      for (size_t t = 0; t < num; ++t) diag[t] += std[t] * std[t];
+    }
   }
-  return square_maha;
+
+  Project(0, num);
 }
 
-BoundingBox KalmanFilter::GetCurPos() { return {mean_(0, 0), mean_(0, 1), mean_(0, 2), mean_(0, 3)}; }
+void KalmanFilterBatch::Project(size_t begin, size_t end) {
+  const float cov_val1 = 1e-1 * 1e-1;
+  const float *height = mean_[3].data();
+  for (int i = 0; i < 4; ++i) {
+    for (size_t t = begin; t < end; ++t) project_mean_[i][t] = mean_[i][t];
+  }
+
+  // the lower triangle of H*P(k|k-1)*H^T + R, factorized in place
+  double *chol[kCholSize];
+  for (int i = 0; i < kCholSize; ++i) chol[i] = project_chol_[i].data();
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j <= i; ++j) {
+      double *dst = chol[Tri(i, j)];
+      const float *src = covariance_[i * 8 + j].data();
+      if (i != j) {
+        for (size_t t = begin; t < end; ++t) dst[t] = src[t];
+      } else if (i == 2) {
+        for (size_t t = begin; t < end; ++t) dst[t] = src[t] + cov_val1;
+      } else {
+        for (size_t t = begin; t < end; ++t) {
+          float cov_val2 = std_weight_position_ * height[t];
+          dst[t] = src[t] + cov_val2 * cov_val2;
+        }
+      }
+    }
+  }
+
+  // CholeskyDecompose<4>, each step a loop over the tracks
+  for (int j = 0; j < 4; ++j) {
+    double *diag = chol[Tri(j, j)];
+    for (int k = 0; k < j; ++k) {
+      const double *ljk = chol[Tri(j, k)];
+      for (size_t t = begin; t < end; ++t) diag[t] -= ljk[t] * ljk[t];
+    }
+    for (size_t t = begin; t < end; ++t) diag[t] = std::sqrt(diag[t] > 1e-12 ? diag[t] : 1e-12);
+    for (int i = j + 1; i < 4; ++i) {
+      double *lij = chol[Tri(i, j)];
+      for (int k = 0; k < j; ++k) {
+        const double *lik = chol[Tri(i, k)];
+        const double *ljk = chol[Tri(j, k)];
+        for (size_t t = begin; t < end; ++t) lij[t] -= lik[t] * ljk[t];
+      }
+      for (size_t t = begin; t < end; ++t) lij[t] /= diag[t];
+    }
+  }
+  for (size_t t = begin; t < end; ++t) projected_[t] = 1;
+}
+
+void KalmanFilterBatch::Update(size_t track, const BoundingBox &measurement) {
+  if (!projected_[track]) Project(track, track + 1);
+  KalmanFilter::Mean mean;
+  KalmanFilter::Covariance covariance;
+  FixedMatrix<1, 4> project_mean;
+  double project_chol[4][4];
+  for (int i = 0; i < 8; ++i) mean(0, i) = mean_[i][track];
+  for (int i = 0; i < 64; ++i) covariance.Data()[i] = covariance_[i][track];
+  for (int i = 0; i < 4; ++i) {
+    project_mean(0, i) = project_mean_[i][track];
+    for (int j = 0; j <= i; ++j) project_chol[i][j] = project_chol_[Tri(i, j)][track];
+  }
+
+  UpdateState(project_chol, project_mean, measurement, &mean, &covariance);
+
+  for (int i = 0; i < 8; ++i) mean_[i][track] = mean(0, i);
+  for (int i = 0; i < 64; ++i) covariance_[i][track] = covariance.Data()[i];
+  projected_[track] = 0;
+}
+
+void KalmanFilterBatch::GatingDistance(const std::vector<int> &tracks, const std::vector<BoundingBox> &measurements,
+                                       std::vector<float> *distances) {
+  const size_t num = measurements.size();
+  distances->resize(tracks.size() * num);
+  for (int i = 0; i < 4; ++i) measurement_[i].resize(num);
+  for (size_t j = 0; j < num; ++j) {
+    measurement_[0][j] = measurements[j].x;
+    measurement_[1][j] = measurements[j].y;
+    measurement_[2][j] = measurements[j].width;
+    measurement_[3][j] = measurements[j].height;
+  }
+  const float *mx = measurement_[0].data(), *my = measurement_[1].data();
+  const float *ma = measurement_[2].data(), *mh = measurement_[3].data();
+
+  for (size_t r = 0; r < tracks.size(); ++r) {
+    const size_t t = tracks[r];
+    if (!projected_[t]) Project(t, t + 1);
+    const float px = project_mean_[0][t], py = project_mean_[1][t];
+    const float pa = project_mean_[2][t], ph = project_mean_[3][t];
+    double l[kCholSize];
+    for (int i = 0; i < kCholSize; ++i) l[i] = project_chol_[i][t];
+    // divisions by the diagonal are hoisted out of the loop
+    for (int i = 0; i < 4; ++i) l[Tri(i, i)] = 1.0 / l[Tri(i, i)];
+    // CholeskyMahalanobis<4> unrolled, a loop over the measurements
+    float *dst = distances->data() + r * num;
+    for (size_t j = 0; j < num; ++j) {
+      const double d0 = mx[j] - px, d1 = my[j] - py, d2 = ma[j] - pa, d3 = mh[j] - ph;
+      const double y0 = d0 * l[Tri(0, 0)];
+      const double y1 = (d1 - l[Tri(1, 0)] * y0) * l[Tri(1, 1)];
+      const double y2 = (d2 - l[Tri(2, 0)] * y0 - l[Tri(2, 1)] * y1) * l[Tri(2, 2)];
+      const double y3 = (d3 - l[Tri(3, 0)] * y0 - l[Tri(3, 1)] * y1 - l[Tri(3, 2)] * y2) * l[Tri(3, 3)];
+      dst[j] = y0 * y0 + y1 * y1 + y2 * y2 + y3 * y3;
+    }
+  }
+}
+
+BoundingBox KalmanFilterBatch::GetCurPos(size_t track) const {
+  return {mean_[0][track], mean_[1][track], mean_[2][track], mean_[3][track]};
+}
+
+KalmanFilter::Mean KalmanFilterBatch::GetMean(size_t track) const {
+  KalmanFilter::Mean mean;
+  for (int i = 0; i < 8; ++i) mean(0, i) = mean_[i][track];
+  return mean;
+}
+
+KalmanFilter::Covariance KalmanFilterBatch::GetCovariance(size_t track) const {
+  KalmanFilter::Covariance covariance;
+  for (int i = 0; i < 64; ++i) covariance.Data()[i] = covariance_[i][track];
+  return covariance;
+}
 
 }  // namespace cnstream
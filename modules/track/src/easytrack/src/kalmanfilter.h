@@ -21,23 +21,28 @@
 #ifndef EASYTRACK_KALMANFILTER_H
 #define EASYTRACK_KALMANFILTER_H
 
-#include <utility>
+#include <cstdint>
 #include <vector>
 
 #include "../include/easy_track.h"
-#include "matrix.h"
+#include "fixed_matrix.h"
 
 namespace cnstream {
 
-using KalHData = std::pair<Matrix, Matrix>;
-
 /**
  * @brief Implementation of Kalman filter
+ *
+ * The state is (x, y, a, h, vx, vy, va, vh) of a constant velocity model, and the measurement is (x, y, a, h). The
+ * products with the motion and measurement matrices are written in closed form on fixed size matrices, and the
+ * innovation covariance is solved by its 4x4 Cholesky factor instead of being inverted.
  */
 class KalmanFilter {
  public:
+  using Mean = FixedMatrix<1, 8>;
+  using Covariance = FixedMatrix<8, 8>;
+
   /**
-   * @brief Initialize the state transition matrix and measurement matrix
+   * @brief Initialize the noise weights
    */
   KalmanFilter();
 
@@ -52,9 +57,9 @@ class KalmanFilter {
   void Predict();
 
   /**
-   * @brief Calculate measurement noise R
+   * @brief Project the state to the measurement space, H*x and H*P*H^T + R, and factorize the latter
    */
-  void Project(const Matrix& mean, const Matrix& covariance);
+  void Project();
 
   /**
    * @brief Calculate the Kalman gain and update the state and MMSE
@@ -62,22 +67,22 @@ class KalmanFilter {
   void Update(const BoundingBox& measurement);
 
   /**
-   * @brief Calculate the mahalanobis distance
+   * @brief Calculate the squared mahalanobis distances of the measurements, written to distances
    */
-  Matrix GatingDistance(const std::vector<BoundingBox>& measurements);
+  void GatingDistance(const std::vector<BoundingBox>& measurements, std::vector<float>* distances);
 
   BoundingBox GetCurPos();
 
+  const Mean& GetMean() const { return mean_; }
+  const Covariance& GetCovariance() const { return covariance_; }
+
  private:
-  static const Matrix motion_mat_;
-  static const Matrix update_mat_;
-  static const Matrix motion_mat_trans_;
-  static const Matrix update_mat_trans_;
-  Matrix mean_;
-  Matrix covariance_;
+  Mean mean_;
+  Covariance covariance_;
 
-  Matrix project_mean_;
-  Matrix project_covariance_;
+  FixedMatrix<1, 4> project_mean_;
+  FixedMatrix<4, 4> project_covariance_;
+  double project_chol_[4][4];
 
   float std_weight_position_;
   float std_weight_velocity_;
@@ -85,6 +90,71 @@ class KalmanFilter {
   bool need_recalc_project_{true};
 };  // class KalmanFilter
 
+/**
+ * @brief Kalman filters of a set of tracks, stored as structure of arrays
+ *
+ * Each element of the states, the covariances and the Cholesky factors of the projected covariances is an array over
+ * the tracks, so that the prediction of all the tracks is a sequence of vectorized loops over the tracks, and the
+ * gating of a track is a vectorized loop over the measurements. Tracks are indexed in the order they are initiated,
+ * and the results are those of KalmanFilter up to rounding.
+ */
+class KalmanFilterBatch {
+ public:
+  KalmanFilterBatch();
+
+  size_t Size() const { return projected_.size(); }
+
+  /**
+   * @brief Append a track initiated by the measurement
+   */
+  void Initiate(const BoundingBox& measurement);
+
+  /**
+   * @brief Remove the tracks of which keep is 0, the others are kept in order
+   */
+  void Retain(const std::vector<uint8_t>& keep);
+
+  void Clear();
+
+  /**
+   * @brief Predict all the tracks, and project them to the measurement space
+   */
+  void Predict();
+
+  void Update(size_t track, const BoundingBox& measurement);
+
+  /**
+   * @brief Calculate the squared mahalanobis distances of the measurements to the tracks
+   *
+   * @param distances The distances, a row of measurements.size() for each of the tracks, in the order of tracks
+   */
+  void GatingDistance(const std::vector<int>& tracks, const std::vector<BoundingBox>& measurements,
+                      std::vector<float>* distances);
+
+  BoundingBox GetCurPos(size_t track) const;
+  KalmanFilter::Mean GetMean(size_t track) const;
+  KalmanFilter::Covariance GetCovariance(size_t track) const;
+
+ private:
+  static constexpr int kCholSize = 10;  // the lower triangle of 4x4
+
+  void Project(size_t begin, size_t end);
+
+  std::vector<float> mean_[8];
+  std::vector<float> covariance_[64];
+  std::vector<float> project_mean_[4];
+  std::vector<double> project_chol_[kCholSize];
+  std::vector<uint8_t> projected_;
+
+  // buffers reused across calls
+  std::vector<float> std_position_;
+  std::vector<float> std_velocity_;
+  std::vector<float> measurement_[4];
+
+  float std_weight_position_;
+  float std_weight_velocity_;
+};  // class KalmanFilterBatch
+
 }  // namespace cnstream
 
 #endif  // EASYTRACK_KALMANFILTER_H
@@ -29,30 +29,13 @@
 
 namespace cnstream {
 
-static float CosineDistance(const std::vector<Feature>& track_feats, const Feature& det) {
-  float cos_simi, x_y, y_mold, x_mold;
-  float max_simi = 0.f;
-
-  x_mold = det.mold < 0 ? L2Norm(det.vec) : det.mold;
-  det.mold = det.mold < 0 ? x_mold : det.mold;
-  for (const auto& track : track_feats) {
-    track.mold = track.mold < 0 ? L2Norm(track.vec) : track.mold;
-    y_mold = track.mold;
-    x_y = InnerProduct(track.vec, det.vec);
-    if (x_mold == 0.f || y_mold == 0.f) {
-      cos_simi = -1;
-    } else {
-      cos_simi = x_y / (x_mold * y_mold);
-    }
-    max_simi = std::max(cos_simi, max_simi);
-  }
-
-  if (max_simi > 1) max_simi = 1;
-  return 1 - max_simi;
+// the features are normalized, the cosine similarity is their dot product
+static void CosineDistance(const FeatureGallery& track_feats, const FeatureGallery& det_feats,
+                           const std::vector<int>& det_indices, std::vector<float>* distances) {
+  track_feats.MaxSimilarity(det_feats, det_indices, distances);
+  for (auto& dist : *distances) dist = 1 - dist;
 }
 
-thread_local detail::HungarianWorkspace MatchAlgorithm::workspace_;
-
 MatchAlgorithm* MatchAlgorithm::Instance(const std::string& func) {
   static std::map<std::string, MatchAlgorithm> algos{{"Cosine", MatchAlgorithm(CosineDistance)}};
   return &(algos.at(func));
@@ -53,17 +53,29 @@ inline BoundingBox Rect2BoundingBox(const Rect &rect) {
   return bbox;
 }
 
+// center x, center y, aspect ratio, height, as the state of the Kalman filter
+inline BoundingBox to_xyah(const BoundingBox &bbox) {
+  BoundingBox xyah;
+  xyah.x = bbox.x + bbox.width / 2;
+  xyah.y = bbox.y + bbox.height / 2;
+  xyah.width = bbox.width / bbox.height;
+  xyah.height = bbox.height;
+  return xyah;
+}
+
+inline BoundingBox to_tlwh(const BoundingBox &xyah) {
+  BoundingBox tlwh;
+  tlwh.width = xyah.width * xyah.height;
+  tlwh.height = xyah.height;
+  tlwh.x = xyah.x - tlwh.width / 2;
+  tlwh.y = xyah.y - tlwh.height / 2;
+  return tlwh;
+}
+
 enum class TrackState { TENTATIVE, CONFIRMED, DELETED };
 
 using MatchData = std::pair<int, int>;
 
-struct Feature {
-  Feature(const std::vector<float>& _vec, float _mold) : vec(_vec), mold(_mold) {}
-  std::vector<float> vec;
-  mutable float mold;
-  Feature() = delete;
-};
-
 struct MatchResult {
   std::vector<MatchData> matches;
   std::vector<int> unmatched_tracks;
@@ -27,7 +27,9 @@
 #include <vector>
 
 #include "../include/easy_track.h"
+#include "assignment.h"
 #include "cnstream_logging.hpp"
+#include "feature_gallery.h"
 #include "kalmanfilter.h"
 #include "match.h"
 #include "matrix.h"
@@ -38,29 +40,10 @@
 // chi2inv95 at 4 degree of freedom
 constexpr const float gating_threshold = 9.4877;
 
-static cnstream::BoundingBox to_xyah(const cnstream::BoundingBox &bbox) {
-  cnstream::BoundingBox xyah;
-  xyah.x = bbox.x + bbox.width / 2;
-  xyah.y = bbox.y + bbox.height / 2;
-  xyah.width = bbox.width / bbox.height;
-  xyah.height = bbox.height;
-  return xyah;
-}
-
-static cnstream::BoundingBox to_tlwh(const cnstream::BoundingBox &xyah) {
-  cnstream::BoundingBox tlwh;
-  tlwh.width = xyah.width * xyah.height;
-  tlwh.height = xyah.height;
-  tlwh.x = xyah.x - tlwh.width / 2;
-  tlwh.y = xyah.y - tlwh.height / 2;
-  return tlwh;
-}
-
 namespace cnstream {
 
 struct FeatureMatchTrackObject {
-  KalmanFilter kf;
-  std::vector<Feature> features;
+  FeatureGallery features;
   Rect pos;
   int class_id;
   int track_id = -1;
@@ -85,19 +68,30 @@ class FeatureMatchPrivate {
   }
   void MatchCascade();
   void MatchIou(const std::vector<int> &detect_matrices, const std::vector<int> &track_matrices);
-  void InitNewTrack(const DetectObject &obj);
+  void InitNewTrack(const DetectObject &obj, int detect_idx);
   void MarkMiss(FeatureMatchTrackObject *track);
   void UpdateFrame(const Objects &detects, Objects *tracks);
 
   FeatureMatchTrack *fm_;
 
   MatchAlgorithm *match_algo_;
+  std::unique_ptr<AssignmentSolver> solver_;
+  AssignmentMethod solver_method_ = AssignmentMethod::HUNGARIAN;
   std::vector<FeatureMatchTrackObject> tracks_;
+  // states of the Kalman filters, indexed as tracks_
+  KalmanFilterBatch kf_;
   std::vector<int> unconfirmed_track_;
   std::vector<int> confirmed_track_;
   std::vector<int> assignments_;
+  // normalized features of the detections of the frame
+  FeatureGallery det_features_;
+  std::vector<float> feature_dist_;
+  std::vector<BoundingBox> measurements_;
+  std::vector<float> gating_dist_;
+  std::vector<uint8_t> keep_;
   MatchResult res_feature_;
   MatchResult res_iou_;
+  MatchStats match_stats_;
   const Objects *detects_ = nullptr;
 
   uint64_t next_id_ = 0;
@@ -137,18 +131,22 @@ void FeatureMatchPrivate::MatchCascade() {
 
   if (confirmed_track_.empty() || det_objs.empty()) return;
 
-  for (auto &det_obj : det_objs) {
-    det_obj.feat_mold = L2Norm(det_obj.feature);
-  }
-
   std::set<int> remained_detections;
   remained_detections.insert(res.unmatched_detections.begin(), res.unmatched_detections.end());
   VLOG5(TRACK) << "MatchCascade) Match scale, detects " << det_objs.size() << " tracks " << confirmed_track_.size();
 
-  std::map<int, std::vector<int>> age_track_indices;
+  // gating distances of all confirmed tracks to all detections, a row for each of confirmed_track_
+  measurements_.clear();
+  for (auto &det_obj : det_objs) {
+    measurements_.emplace_back(to_xyah(det_obj.bbox));
+  }
+  kf_.GatingDistance(confirmed_track_, measurements_, &gating_dist_);
+
+  // rows of the confirmed tracks of each age
+  std::map<int, std::vector<int>> age_track_rows;
   for (size_t t = 0; t < confirmed_track_.size(); ++t) {
     int age = tracks_[confirmed_track_[t]].time_since_last_update - 1;
-    age_track_indices[age].push_back(confirmed_track_[t]);
+    age_track_rows[age].push_back(t);
   }
 
   for (int age = 0; age < fm_->max_age_; ++age) {
@@ -157,29 +155,26 @@ void FeatureMatchPrivate::MatchCascade() {
     if (remained_detections.empty() || confirmed_track_.empty()) break;
 
     // get all confirmed tracks with same age
-    auto track_indices_iter = age_track_indices.find(age);
-    if (track_indices_iter == age_track_indices.end()) {
+    auto track_rows_iter = age_track_rows.find(age);
+    if (track_rows_iter == age_track_rows.end()) {
       VLOG5(TRACK) << "Cascade: No tracks for age " << age << " round, continue";
       continue;
     }
-    std::vector<int> &track_indices = track_indices_iter->second;
+    std::vector<int> track_indices;
+    for (int row : track_rows_iter->second) track_indices.push_back(confirmed_track_[row]);
     size_t det_num = res.unmatched_detections.size();
     size_t tra_num = track_indices.size();
     cost_matrix.Resize(tra_num, det_num);
 
     // calculate cost matrix
-    std::vector<BoundingBox> measurements;
-    measurements.reserve(det_num);
-    for (size_t i = 0; i < det_num; ++i) {
-      measurements.emplace_back(to_xyah(det_objs[res.unmatched_detections[i]].bbox));
-    }
     for (size_t i = 0; i < tra_num; ++i) {
-      Matrix gating_dist = tracks_[track_indices[i]].kf.GatingDistance(measurements);
+      const float *gating_dist = gating_dist_.data() + track_rows_iter->second[i] * det_objs.size();
+      match_algo_->Distance(tracks_[track_indices[i]].features, det_features_, res.unmatched_detections,
+                            &feature_dist_);
       for (size_t j = 0; j < det_num; ++j) {
-        auto &det = det_objs[res.unmatched_detections[j]];
-        cost_matrix(i, j) =
-            match_algo_->Distance(tracks_[track_indices[i]].features, Feature(det.feature, det.feat_mold));
-        if (cost_matrix(i, j) > fm_->max_cosine_distance_ || gating_dist(0, j) > gating_threshold) {
+        cost_matrix(i, j) = feature_dist_[j];
+        if (cost_matrix(i, j) > fm_->max_cosine_distance_ ||
+            gating_dist[res.unmatched_detections[j]] > gating_threshold) {
           VLOG5(TRACK) << "object " << i << " - " << j << " feature distance is larger than max_cosine_distance";
           cost_matrix(i, j) = fm_->max_cosine_distance_ + 1e-5;
         }
@@ -187,7 +182,7 @@ void FeatureMatchPrivate::MatchCascade() {
     }
 
     // min cost match
-    match_algo_->HungarianMatch(cost_matrix, &assignments_);
+    solver_->Assign(cost_matrix, &assignments_, &match_stats_);
 
     // arrange match result
     for (size_t i = 0; i < assignments_.size(); ++i) {
@@ -198,7 +193,7 @@ void FeatureMatchPrivate::MatchCascade() {
         remained_detections.erase(res.unmatched_detections[assignments_[i]]);
       }
     }
-    age_track_indices.erase(track_indices_iter);
+    age_track_rows.erase(track_rows_iter);
     res.unmatched_detections.clear();
     res.unmatched_detections.insert(res.unmatched_detections.end(), remained_detections.begin(),
                                     remained_detections.end());
@@ -237,7 +232,7 @@ void FeatureMatchPrivate::MatchIou(const std::vector<int> &detect_indices, const
     tra_rects.emplace_back(tracks_[idx].pos);
   }
   Matrix cost_matrix = match_algo_->IoUCost(tra_rects, det_rects);
-  match_algo_->HungarianMatch(cost_matrix, &assignments_);
+  solver_->Assign(cost_matrix, &assignments_, &match_stats_);
 
   for (size_t i = 0; i < assignments_.size(); ++i) {
     if (assignments_[i] < 0 || cost_matrix(i, assignments_[i]) > fm_->max_iou_distance_) {
@@ -252,8 +247,11 @@ void FeatureMatchPrivate::MatchIou(const std::vector<int> &detect_indices, const
                                   remained_detections.end());
 }
 
-void FeatureMatchPrivate::InitNewTrack(const DetectObject &det) {
+void FeatureMatchPrivate::InitNewTrack(const DetectObject &det, int detect_idx) {
   FeatureMatchTrackObject obj;
+  obj.features = FeatureGallery(fm_->feature_precision_);
+  // the latest nn_budget features, in a ring buffer
+  obj.features.SetCapacity(fm_->nn_budget_);
   obj.age = 1;
   obj.class_id = det.label;
   obj.score = det.score;
@@ -263,12 +261,12 @@ void FeatureMatchPrivate::InitNewTrack(const DetectObject &det) {
     for (auto &val : det.feature) {
       if (val != 0) {
         obj.has_feature = true;
-        obj.features.emplace_back(det.feature, det.feat_mold);
+        obj.features.Append(det_features_, detect_idx);
         break;
       }
     }
   }
-  obj.kf.Initiate(to_xyah(det.bbox));
+  kf_.Initiate(to_xyah(det.bbox));
   tracks_.emplace_back(std::move(obj));
 }
 
@@ -279,9 +277,24 @@ void FeatureMatchPrivate::MarkMiss(FeatureMatchTrackObject *track) {
 }
 
 void FeatureMatchPrivate::UpdateFrame(const Objects &detects, Objects *tracks) {
-  // set feat_mold to -1 means mold has not been computed
+  // normalize the features of the detections once
+  int feature_dim = 0;
   for (auto &obj : detects) {
-    obj.feat_mold = -1;
+    if (!obj.feature.empty()) {
+      feature_dim = obj.feature.size();
+      break;
+    }
+  }
+  if (det_features_.Precision() != fm_->feature_precision_) det_features_ = FeatureGallery(fm_->feature_precision_);
+  if (!solver_ || solver_method_ != fm_->assignment_method_) {
+    solver_method_ = fm_->assignment_method_;
+    solver_ = AssignmentSolver::Create(solver_method_);
+  }
+  det_features_.Clear(feature_dim);
+  for (auto &obj : detects) {
+    if (!det_features_.Add(obj.feature)) {
+      LOGE(TRACK) << "feature dimension " << obj.feature.size() << " differs from " << feature_dim << ", ignored";
+    }
   }
 
   uint32_t detect_num = detects.size();
@@ -291,7 +304,7 @@ void FeatureMatchPrivate::UpdateFrame(const Objects &detects, Objects *tracks) {
   if (tracks_.empty()) {
     tracks_.reserve(detect_num);
     for (size_t i = 0; i < detect_num; ++i) {
-      InitNewTrack(detects[i]);
+      InitNewTrack(detects[i], i);
       tracks->emplace_back(detects[i]);
       tracks->rbegin()->track_id = -1;
       tracks->rbegin()->detect_id = i;
@@ -300,6 +313,7 @@ void FeatureMatchPrivate::UpdateFrame(const Objects &detects, Objects *tracks) {
     detects_ = &detects;
     unconfirmed_track_.clear();
     confirmed_track_.clear();
+    kf_.Predict();
     for (size_t i = 0; i < track_num; ++i) {
       // update track indices
       if (tracks_[i].state == TrackState::CONFIRMED && tracks_[i].has_feature) {
@@ -308,8 +322,7 @@ void FeatureMatchPrivate::UpdateFrame(const Objects &detects, Objects *tracks) {
         unconfirmed_track_.push_back(i);
       }
       tracks_[i].time_since_last_update++;
-      tracks_[i].kf.Predict();
-      tracks_[i].pos = BoundingBox2Rect(to_tlwh(tracks_[i].kf.GetCurPos()));
+      tracks_[i].pos = BoundingBox2Rect(to_tlwh(kf_.GetCurPos(i)));
     }
 
     // match with features
@@ -344,7 +357,7 @@ void FeatureMatchPrivate::UpdateFrame(const Objects &detects, Objects *tracks) {
     for (auto &pair : res_feature_.matches) {
       ptrack_obj = &(tracks_[pair.second]);
       pdetect_obj = &detects[pair.first];
-      ptrack_obj->kf.Update(to_xyah(pdetect_obj->bbox));
+      kf_.Update(pair.second, to_xyah(pdetect_obj->bbox));
 
       // fill the output
       tracks->emplace_back(*pdetect_obj);
@@ -352,10 +365,7 @@ void FeatureMatchPrivate::UpdateFrame(const Objects &detects, Objects *tracks) {
       tracks->rbegin()->detect_id = pair.first;
 
       if (ptrack_obj->has_feature) {
-        ptrack_obj->features.emplace_back(pdetect_obj->feature, pdetect_obj->feat_mold);
-        if (ptrack_obj->features.size() > fm_->nn_budget_) {
-          ptrack_obj->features.erase(ptrack_obj->features.begin());
-        }
+        ptrack_obj->features.Append(det_features_, pair.first);
       }
 
       ptrack_obj->time_since_last_update = 0;
@@ -369,7 +379,7 @@ void FeatureMatchPrivate::UpdateFrame(const Objects &detects, Objects *tracks) {
 
     // unmatched detections: init new track
     for (auto &idx : res_iou_.unmatched_detections) {
-      InitNewTrack(detects[idx]);
+      InitNewTrack(detects[idx], idx);
       tracks->emplace_back(detects[idx]);
       tracks->rbegin()->track_id = tracks_.rbegin()->track_id;
       tracks->rbegin()->detect_id = idx;
@@ -381,15 +391,20 @@ void FeatureMatchPrivate::UpdateFrame(const Objects &detects, Objects *tracks) {
       MarkMiss(&(tracks_[idx]));
     }
 
-    // erase dead track object
-    for (auto iter = tracks_.begin(); iter != tracks_.end();) {
-      if (iter->state == TrackState::DELETED || iter->time_since_last_update > fm_->max_age_) {
-        VLOG4(TRACK) << "delete track: " << iter->track_id;
-        iter = tracks_.erase(iter);
-      } else {
-        iter++;
+    // erase dead track object, and its Kalman filter
+    keep_.resize(tracks_.size());
+    size_t kept = 0;
+    for (size_t i = 0; i < tracks_.size(); ++i) {
+      keep_[i] = tracks_[i].state != TrackState::DELETED && tracks_[i].time_since_last_update <= fm_->max_age_;
+      if (!keep_[i]) {
+        VLOG4(TRACK) << "delete track: " << tracks_[i].track_id;
+        continue;
       }
+      if (kept != i) tracks_[kept] = std::move(tracks_[i]);
+      ++kept;
     }
+    tracks_.erase(tracks_.begin() + kept, tracks_.end());
+    kf_.Retain(keep_);
   }
 }
 
@@ -400,4 +415,6 @@ void FeatureMatchTrack::UpdateFrame(const Objects &detects, Objects *tracks) {
   fm_p_->UpdateFrame(detects, tracks);
 }
 
+MatchStats FeatureMatchTrack::GetMatchStats() const { return fm_p_->match_stats_; }
+
 }  // namespace cnstream
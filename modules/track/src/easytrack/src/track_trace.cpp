@@ -0,0 +1,203 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "track_trace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "cnstream_logging.hpp"
+
+namespace cnstream {
+
+namespace {
+
+constexpr char kTraceMagic[8] = {'C', 'N', 'T', 'R', 'A', 'C', 'E', '\0'};
+constexpr uint32_t kTraceVersion = 1;
+// a bound of the sizes read, against corrupted traces
+constexpr uint32_t kMaxObjectNum = 1 << 16;
+constexpr uint32_t kMaxFeatureDim = 1 << 16;
+
+struct ObjectRecord {
+  int32_t label;
+  float score;
+  float x, y, width, height;
+  int32_t track_id;
+  uint32_t feature_dim;
+};
+
+template <typename T>
+void WritePod(std::ofstream *file, const T &value) {
+  file->write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T>
+bool ReadPod(std::ifstream *file, T *value) {
+  return static_cast<bool>(file->read(reinterpret_cast<char *>(value), sizeof(T)));
+}
+
+}  // namespace
+
+bool TraceWriter::Open(const std::string &path) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  if (file_.is_open()) file_.close();
+  file_.open(path, std::ios::binary | std::ios::trunc);
+  if (!file_) {
+    LOGE(TRACK) << "TraceWriter: open " << path << " failed";
+    return false;
+  }
+  file_.write(kTraceMagic, sizeof(kTraceMagic));
+  WritePod(&file_, kTraceVersion);
+  WritePod(&file_, static_cast<uint32_t>(0));
+  return static_cast<bool>(file_);
+}
+
+bool TraceWriter::Write(const TraceFrame &frame) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  if (!file_.is_open()) return false;
+  WritePod(&file_, frame.stream_index);
+  WritePod(&file_, static_cast<uint32_t>(frame.objects.size()));
+  WritePod(&file_, frame.timestamp);
+  for (auto &obj : frame.objects) {
+    ObjectRecord record;
+    record.label = obj.label;
+    record.score = obj.score;
+    record.x = obj.bbox.x;
+    record.y = obj.bbox.y;
+    record.width = obj.bbox.width;
+    record.height = obj.bbox.height;
+    record.track_id = obj.track_id;
+    record.feature_dim = obj.feature.size();
+    WritePod(&file_, record);
+    if (!obj.feature.empty()) {
+      file_.write(reinterpret_cast<const char *>(obj.feature.data()), obj.feature.size() * sizeof(float));
+    }
+  }
+  return static_cast<bool>(file_);
+}
+
+void TraceWriter::Close() {
+  std::lock_guard<std::mutex> lk(mutex_);
+  if (file_.is_open()) file_.close();
+}
+
+bool TraceReader::Open(const std::string &path) {
+  if (file_.is_open()) file_.close();
+  file_.open(path, std::ios::binary);
+  char magic[sizeof(kTraceMagic)];
+  uint32_t version = 0, reserved = 0;
+  if (!file_ || !file_.read(magic, sizeof(magic)) || !ReadPod(&file_, &version) || !ReadPod(&file_, &reserved)) {
+    LOGE(TRACK) << "TraceReader: open " << path << " failed";
+    return false;
+  }
+  if (memcmp(magic, kTraceMagic, sizeof(magic)) || version != kTraceVersion) {
+    LOGE(TRACK) << "TraceReader: " << path << " is not a detection trace of version " << kTraceVersion;
+    return false;
+  }
+  return true;
+}
+
+bool TraceReader::Read(TraceFrame *frame) {
+  uint32_t object_num = 0;
+  if (!ReadPod(&file_, &frame->stream_index)) return false;
+  if (!ReadPod(&file_, &object_num) || !ReadPod(&file_, &frame->timestamp) || object_num > kMaxObjectNum) {
+    LOGE(TRACK) << "TraceReader: truncated or corrupted frame";
+    return false;
+  }
+  frame->objects.resize(object_num);
+  for (uint32_t i = 0; i < object_num; ++i) {
+    ObjectRecord record;
+    if (!ReadPod(&file_, &record) || record.feature_dim > kMaxFeatureDim) {
+      LOGE(TRACK) << "TraceReader: truncated or corrupted frame";
+      return false;
+    }
+    DetectObject &obj = frame->objects[i];
+    obj.label = record.label;
+    obj.score = record.score;
+    obj.bbox = {record.x, record.y, record.width, record.height};
+    obj.track_id = record.track_id;
+    obj.detect_id = i;
+    obj.feature.resize(record.feature_dim);
+    if (record.feature_dim &&
+        !file_.read(reinterpret_cast<char *>(obj.feature.data()), record.feature_dim * sizeof(float))) {
+      LOGE(TRACK) << "TraceReader: truncated or corrupted frame";
+      return false;
+    }
+  }
+  return true;
+}
+
+void MotEvaluator::Update(const Objects &detects, const Objects &tracks) {
+  ++metrics_.frames;
+  track_of_detect_.assign(detects.size(), -1);
+  for (auto &obj : tracks) {
+    if (obj.detect_id >= 0 && static_cast<size_t>(obj.detect_id) < detects.size()) {
+      track_of_detect_[obj.detect_id] = obj.track_id;
+    }
+  }
+  for (size_t i = 0; i < detects.size(); ++i) {
+    int identity = detects[i].track_id;
+    int track_id = track_of_detect_[i];
+    if (track_id >= 0) ++metrics_.tracked;
+    if (identity < 0) {
+      if (track_id >= 0) ++metrics_.false_positives;
+      continue;
+    }
+    ++metrics_.objects;
+    Identity &state = identities_[identity];
+    if (track_id < 0) {
+      ++metrics_.misses;
+      if (state.track_id >= 0) state.missed = true;
+      continue;
+    }
+    if (state.track_id >= 0 && state.track_id != track_id) ++metrics_.id_switches;
+    if (state.missed) {
+      ++metrics_.fragmentations;
+      state.missed = false;
+    }
+    state.track_id = track_id;
+    ++pairs_[static_cast<uint64_t>(static_cast<uint32_t>(identity)) << 32 | static_cast<uint32_t>(track_id)];
+  }
+}
+
+MotMetrics MotEvaluator::Get() const {
+  MotMetrics metrics = metrics_;
+  std::vector<std::pair<uint64_t, uint64_t>> pairs(pairs_.begin(), pairs_.end());
+  std::sort(pairs.begin(), pairs.end(),
+            [](const std::pair<uint64_t, uint64_t> &a, const std::pair<uint64_t, uint64_t> &b) {
+              return a.second != b.second ? a.second > b.second : a.first < b.first;
+            });
+  std::unordered_set<uint32_t> identities, tracks;
+  metrics.id_true_positives = 0;
+  for (auto &pair : pairs) {
+    uint32_t identity = pair.first >> 32, track = pair.first & 0xffffffffu;
+    if (identities.count(identity) || tracks.count(track)) continue;
+    identities.insert(identity);
+    tracks.insert(track);
+    metrics.id_true_positives += pair.second;
+  }
+  return metrics;
+}
+
+}  // namespace cnstream
@@ -0,0 +1,149 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+/**
+ * @file track_trace.h
+ *
+ * This file contains the recording and the replay of detection traces, and the MOT metrics of their tracking, so
+ * that the trackers are benchmarked offline without the pipeline.
+ */
+
+#ifndef EASYTRACK_TRACK_TRACE_H_
+#define EASYTRACK_TRACK_TRACE_H_
+
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../include/easy_track.h"
+
+namespace cnstream {
+
+/**
+ * @brief The detections of a frame of a trace.
+ *
+ * The track_id of each object is its reference identity, the ground truth, or the track assigned by the tracker
+ * recording the trace, -1 if unknown. The MOT metrics of a replay are computed against it.
+ */
+struct TraceFrame {
+  uint32_t stream_index = 0;
+  uint64_t timestamp = 0;
+  Objects objects;
+};
+
+/**
+ * @brief Writes a detection trace, a header followed by the frames in the order written, in host byte order:
+ *
+ *   header: "CNTRACE\0", uint32 version, uint32 reserved
+ *   frame:  uint32 stream_index, uint32 object_num, uint64 timestamp, objects
+ *   object: int32 label, float score, float x, y, width, height, int32 track_id, uint32 feature_dim,
+ *           float feature[feature_dim]
+ *
+ * The frames of the streams are interleaved, those of a stream in order. Write is thread safe.
+ */
+class TraceWriter {
+ public:
+  ~TraceWriter() { Close(); }
+
+  bool Open(const std::string &path);
+  bool Write(const TraceFrame &frame);
+  void Close();
+
+ private:
+  std::mutex mutex_;
+  std::ofstream file_;
+};  // class TraceWriter
+
+/**
+ * @brief Reads a detection trace written by TraceWriter.
+ */
+class TraceReader {
+ public:
+  bool Open(const std::string &path);
+
+  /**
+   * @brief Reads the next frame.
+   *
+   * @return Returns false at the end of the trace, or on a truncated or corrupted frame.
+   */
+  bool Read(TraceFrame *frame);
+
+ private:
+  std::ifstream file_;
+};  // class TraceReader
+
+/**
+ * @brief MOT metrics of the tracks of a stream against the reference identities of the detections.
+ *
+ * The trackers output detections only, so a detection of reference identity is missed if it is not tracked, and a
+ * detection without reference identity is a false positive if it is tracked.
+ */
+struct MotMetrics {
+  uint64_t frames = 0;
+  uint64_t objects = 0;          ///< detections of reference identity
+  uint64_t tracked = 0;          ///< detections tracked
+  uint64_t misses = 0;
+  uint64_t false_positives = 0;
+  uint64_t id_switches = 0;      ///< changes of the track of an identity
+  uint64_t fragmentations = 0;   ///< identities tracked again after being missed
+  uint64_t id_true_positives = 0;  ///< detections tracked by the track matched to their identity
+
+  double Mota() const {
+    return objects ? 1.0 - static_cast<double>(misses + false_positives + id_switches) / objects : 0;
+  }
+  double Idf1() const { return objects + tracked ? 2.0 * id_true_positives / (objects + tracked) : 0; }
+};
+
+/**
+ * @brief Accumulates the MOT metrics of a stream frame by frame.
+ *
+ * The identities are matched to the tracks one to one for IDF1 greedily, the pairs seen together most often first,
+ * which approximates the optimal matching closely when the tracks are mostly right.
+ */
+class MotEvaluator {
+ public:
+  /**
+   * @brief Accounts the tracks of a frame.
+   *
+   * @param detects The detections, with their reference identity in track_id.
+   * @param tracks The tracks output by the tracker for the detections.
+   */
+  void Update(const Objects &detects, const Objects &tracks);
+
+  MotMetrics Get() const;
+
+ private:
+  struct Identity {
+    int track_id = -1;
+    bool missed = false;
+  };
+  MotMetrics metrics_;
+  std::unordered_map<int, Identity> identities_;
+  // the frames each identity is tracked by each track, keyed by (identity << 32 | track)
+  std::unordered_map<uint64_t, uint64_t> pairs_;
+  std::vector<int> track_of_detect_;
+};  // class MotEvaluator
+
+}  // namespace cnstream
+
+#endif  // EASYTRACK_TRACK_TRACE_H_
@@ -20,11 +20,21 @@
 
 #include "feature_extractor.hpp"
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define TRACK_FEATURE_SSE2 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define TRACK_FEATURE_NEON 1
+#endif
+
+#include "opencv2/core/core.hpp"
 #include "opencv2/features2d/features2d.hpp"
 #include "opencv2/highgui/highgui.hpp"
 #include "opencv2/imgproc/imgproc.hpp"
@@ -171,29 +181,27 @@ bool FeatureExtractor::ExtractFeatureOnCpu(const CNFrameInfoPtr& info) {
     CNInferObjsPtr objs_holder = info->collection.Get<CNInferObjsPtr>(kCNInferObjsTag);
     std::unique_lock<std::mutex> guard(objs_holder->mutex_);
 
-    const cv::Mat image = frame->ImageBGR();
-    for (uint32_t num = 0; num < objs_holder->objs_.size(); ++num) {
-      auto& obj = objs_holder->objs_[num];
-      cv::Rect rect = cv::Rect(obj->bbox.x * image.cols, obj->bbox.y * image.rows, obj->bbox.w * image.cols,
-                               obj->bbox.h * image.rows);
-      cv::Mat obj_img(image, rect);
-#if (CV_MAJOR_VERSION == 2)  // NOLINT
-      cv::Ptr<cv::ORB> processer = new cv::ORB(kFeatureSizeForCpu);
-#elif (CV_MAJOR_VERSION >= 3)  //  NOLINT
-      cv::Ptr<cv::ORB> processer = cv::ORB::create(kFeatureSizeForCpu);
-#endif
-
+    // ORB works on the gray image, the luma plane is used as is instead of converting the whole frame to BGR
+    cv::Mat gray;
+    auto fmt = frame->buf_surf->GetColorFormat();
+    if (fmt == CNEDK_BUF_COLOR_FORMAT_NV12 || fmt == CNEDK_BUF_COLOR_FORMAT_NV21) {
+      CnedkBufSurfaceSyncForCpu(frame->buf_surf->GetBufSurface(), -1, -1);
+      gray = cv::Mat(frame->buf_surf->GetHeight() & ~1, frame->buf_surf->GetWidth(), CV_8UC1,
+                     frame->buf_surf->GetHostData(0), frame->buf_surf->GetStride(0));
+    } else {
+      cv::cvtColor(frame->ImageBGR(), gray, cv::COLOR_BGR2GRAY);
+    }
 
-      std::vector<cv::KeyPoint> keypoints;
-      processer->detect(obj_img, keypoints);
-      cv::Mat desc;
-      processer->compute(obj_img, keypoints, desc);
-      std::vector<float> feature;
-      feature.reserve(kFeatureSizeForCpu);
-      for (int i = 0; i < kFeatureSizeForCpu; i++) {
-        feature.push_back((i < desc.rows ? CalcFeatureOfRow(desc, i) : 0));
-      }
-      obj->AddFeature("track", std::move(feature));
+    std::vector<cv::Rect> rois;
+    rois.reserve(objs_holder->objs_.size());
+    for (auto& obj : objs_holder->objs_) {
+      rois.emplace_back(obj->bbox.x * gray.cols, obj->bbox.y * gray.rows, obj->bbox.w * gray.cols,
+                        obj->bbox.h * gray.rows);
+    }
+    std::vector<std::vector<float>> features;
+    ExtractFeaturesOnGray(gray, rois, cpu_thread_num_, &features);
+    for (uint32_t num = 0; num < objs_holder->objs_.size(); ++num) {
+      objs_holder->objs_[num]->AddFeature("track", std::move(features[num]));
     }
 
     guard.unlock();
@@ -203,13 +211,100 @@ bool FeatureExtractor::ExtractFeatureOnCpu(const CNFrameInfoPtr& info) {
   return true;
 }
 
-float FeatureExtractor::CalcFeatureOfRow(const cv::Mat& image, int n) {
-  float result = 0;
-  for (int i = 0; i < image.cols; i++) {
-    int grey = image.ptr<uchar>(n)[i];
-    result += grey > 127 ? static_cast<float>(grey) / 255 : -static_cast<float>(grey) / 255;
+namespace {
+
+// the ORB detector of each thread, created once
+cv::Ptr<cv::ORB> GetOrb() {
+  thread_local cv::Ptr<cv::ORB> orb;
+  if (orb.empty()) {
+#if (CV_MAJOR_VERSION == 2)  // NOLINT
+    orb = new cv::ORB(kFeatureSizeForCpu);
+#elif (CV_MAJOR_VERSION >= 3)  //  NOLINT
+    orb = cv::ORB::create(kFeatureSizeForCpu);
+#endif
+  }
+  return orb;
+}
+
+class OrbFeatureBody : public cv::ParallelLoopBody {
+ public:
+  OrbFeatureBody(const cv::Mat& gray, const std::vector<cv::Rect>& rois, std::vector<std::vector<float>>* features)
+      : gray_(gray), rois_(rois), features_(features) {}
+
+  void operator()(const cv::Range& range) const override {
+    cv::Ptr<cv::ORB> orb = GetOrb();
+    std::vector<cv::KeyPoint> keypoints;
+    cv::Mat desc;
+    const cv::Rect image_rect(0, 0, gray_.cols, gray_.rows);
+    for (int i = range.start; i < range.end; ++i) {
+      std::vector<float>& feature = (*features_)[i];
+      feature.assign(kFeatureSizeForCpu, 0.f);
+      cv::Rect rect = rois_[i] & image_rect;
+      if (rect.area() <= 0) continue;
+      cv::Mat obj_img(gray_, rect);
+      keypoints.clear();
+#if (CV_MAJOR_VERSION == 2)  // NOLINT
+      (*orb)(obj_img, cv::noArray(), keypoints, desc);
+#elif (CV_MAJOR_VERSION >= 3)  //  NOLINT
+      orb->detectAndCompute(obj_img, cv::noArray(), keypoints, desc);
+#endif
+      if (desc.empty()) continue;
+      FeatureExtractor::ReduceDescriptors(desc.ptr<uint8_t>(0), std::min(desc.rows, kFeatureSizeForCpu), desc.cols,
+                                          desc.step, feature.data());
+    }
+  }
+
+ private:
+  const cv::Mat& gray_;
+  const std::vector<cv::Rect>& rois_;
+  std::vector<std::vector<float>>* features_;
+};  // class OrbFeatureBody
+
+}  // namespace
+
+void FeatureExtractor::ExtractFeaturesOnGray(const cv::Mat& gray, const std::vector<cv::Rect>& rois, int thread_num,
+                                             std::vector<std::vector<float>>* features) {
+  features->resize(rois.size());
+  OrbFeatureBody body(gray, rois, features);
+  cv::Range range(0, rois.size());
+  if (thread_num > 1 && rois.size() > 1) {
+    cv::parallel_for_(range, body, std::min<int>(thread_num, rois.size()));
+  } else {
+    body(range);
+  }
+}
+
+void FeatureExtractor::ReduceDescriptors(const uint8_t* desc, int rows, int cols, size_t step, float* feature) {
+  for (int r = 0; r < rows; ++r) {
+    const uint8_t* row = desc + r * step;
+    int sum = 0;
+    int i = 0;
+#if defined(TRACK_FEATURE_SSE2)
+    // the bytes above 127 are negative as int8, their sums of absolute differences to 0 are taken apart
+    const __m128i zero = _mm_setzero_si128();
+    __m128i pos = zero, neg = zero;
+    for (; i + 16 <= cols; i += 16) {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+      __m128i high = _mm_cmplt_epi8(v, zero);
+      pos = _mm_add_epi64(pos, _mm_sad_epu8(_mm_and_si128(high, v), zero));
+      neg = _mm_add_epi64(neg, _mm_sad_epu8(_mm_andnot_si128(high, v), zero));
+    }
+    __m128i diff = _mm_sub_epi64(pos, neg);
+    sum = _mm_cvtsi128_si32(diff) + _mm_cvtsi128_si32(_mm_unpackhi_epi64(diff, diff));
+#elif defined(TRACK_FEATURE_NEON)
+    const uint8x16_t threshold = vdupq_n_u8(127);
+    uint32x4_t pos = vdupq_n_u32(0), neg = vdupq_n_u32(0);
+    for (; i + 16 <= cols; i += 16) {
+      uint8x16_t v = vld1q_u8(row + i);
+      uint8x16_t high = vcgtq_u8(v, threshold);
+      pos = vpadalq_u16(pos, vpaddlq_u8(vandq_u8(high, v)));
+      neg = vpadalq_u16(neg, vpaddlq_u8(vbicq_u8(v, high)));
+    }
+    sum = static_cast<int>(vaddvq_u32(pos)) - static_cast<int>(vaddvq_u32(neg));
+#endif
+    for (; i < cols; ++i) sum += row[i] > 127 ? row[i] : -row[i];
+    feature[r] = static_cast<float>(sum) / 255;
   }
-  return result;
 }
 
 int FeatureExtractor::OnTensorParams(const infer_server::CnPreprocTensorParams* params) {
@@ -41,7 +41,13 @@ using InferVideoPixelFmt = infer_server::NetworkInputFormat;
 
 class FeatureExtractor : public infer_server::IPreproc, public infer_server::IPostproc {
  public:
-  explicit FeatureExtractor(std::function<void(const CNFrameInfoPtr, bool)> callback) : callback_(callback) {}
+  /*******************************************************
+   * @brief extract features on CPU
+   * @param
+   *   cpu_thread_num[in] the number of threads extracting the features of the objects of a frame
+   * *****************************************************/
+  explicit FeatureExtractor(std::function<void(const CNFrameInfoPtr, bool)> callback, int cpu_thread_num = 1)
+      : callback_(callback), cpu_thread_num_(cpu_thread_num) {}
   FeatureExtractor(const std::shared_ptr<infer_server::ModelInfo>& model,
                    std::function<void(const CNFrameInfoPtr, bool)> callback, int device_id = 0);
   ~FeatureExtractor();
@@ -58,6 +64,13 @@ class FeatureExtractor : public infer_server::IPreproc, public infer_server::IPo
 
   void WaitTaskDone(const std::string& stream_id);
 
+  // Exposed for tests.
+  // Extracts the ORB features of the regions of a gray image, on thread_num threads at most.
+  static void ExtractFeaturesOnGray(const cv::Mat& gray, const std::vector<cv::Rect>& rois, int thread_num,
+                                    std::vector<std::vector<float>>* features);
+  // Reduces each row of the descriptors to the sum of its bytes above 127 minus the sum of the others, over 255.
+  static void ReduceDescriptors(const uint8_t* desc, int rows, int cols, size_t step, float* feature);
+
  private:
   int OnTensorParams(const infer_server::CnPreprocTensorParams* params) override;
   int OnPreproc(cnedk::BufSurfWrapperPtr src, cnedk::BufSurfWrapperPtr dst,
@@ -69,13 +82,13 @@ class FeatureExtractor : public infer_server::IPreproc, public infer_server::IPo
  private:
   bool ExtractFeatureOnMlu(const CNFrameInfoPtr& info);
   bool ExtractFeatureOnCpu(const CNFrameInfoPtr& info);
-  float CalcFeatureOfRow(const cv::Mat& image, int n);
 
   std::shared_ptr<infer_server::ModelInfo> model_{nullptr};
   std::unique_ptr<infer_server::InferServer> server_{nullptr};
   infer_server::Session_t session_{nullptr};
   std::function<void(const CNFrameInfoPtr, bool)> callback_{nullptr};
   int device_id_;
+  int cpu_thread_num_ = 1;
   bool is_initialized_ = false;
   CnPreprocNetworkInfo info_;
   std::vector<float> mean_{0.485, 0.456, 0.406};
@@ -18,18 +18,24 @@
  * THE SOFTWARE.
  *************************************************************************/
 
+#include <atomic>
 #include <memory>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "cnis/processor.h"
 #include "cnstream_frame_va.hpp"
 #include "easytrack/include/easy_track.h"
+#include "easytrack/src/track_trace.h"
 #include "feature_extractor.hpp"
 #include "profiler/module_profiler.hpp"
 #include "track.hpp"
+#include "track_pool.hpp"
 
 #include "private/cnstream_param.hpp"
+#include "rapidjson/document.h"
 
 #define CLIP(x) ((x) < 0 ? 0 : ((x) > 1 ? 1 : (x)))
 
@@ -37,6 +43,12 @@ namespace cnstream {
 
 int tracker_priority_ = -1;
 
+static constexpr char kTRACK_PROFILER_NAME[] = "TRACK";
+static constexpr char kDEFAULT_PROFILE_NAME[] = "default";
+// ByteTrack associates by motion only, it takes looser boxes and confirms a track on its first match
+static constexpr float kBYTE_TRACK_MAX_IOU_DISTANCE = 0.8;
+static constexpr uint32_t kBYTE_TRACK_N_INIT = 1;
+
 struct TrackerContext {
   std::unique_ptr<EasyTrack> processer_ = nullptr;
   TrackerContext() = default;
@@ -47,6 +59,103 @@ struct TrackerContext {
 
 thread_local std::unique_ptr<FeatureExtractor> g_feature_extractor;
 
+static bool CheckProfile(const std::string &name, const TrackProfile &profile) {
+  if (profile.max_cosine_distance <= 0 || profile.nn_budget == 0 || profile.max_iou_distance <= 0 ||
+      profile.max_iou_distance > 1) {
+    LOGE(TRACK) << "[Tracker] profile " << name << ": max_cosine_distance and nn_budget are expected to be positive, "
+                << "max_iou_distance in (0, 1].";
+    return false;
+  }
+  if (profile.low_score_thresh < 0 || profile.low_score_thresh > profile.high_score_thresh ||
+      profile.high_score_thresh > 1) {
+    LOGE(TRACK) << "[Tracker] profile " << name << ": 0 <= low_score_thresh <= high_score_thresh <= 1 is expected.";
+    return false;
+  }
+  return true;
+}
+
+// The hyperparameters shared by the trackers take the defaults of ByteTrack if they are not set.
+static void SetByteTrackDefaults(const ModuleParamSet &param_set, TrackParams *params) {
+  if (params->track_name != "ByteTrack") return;
+  if (!param_set.count("max_iou_distance")) params->max_iou_distance = kBYTE_TRACK_MAX_IOU_DISTANCE;
+  if (!param_set.count("n_init")) params->n_init = kBYTE_TRACK_N_INIT;
+}
+
+// Parses [profiles] and [stream_profiles]. The hyperparameters not set by a profile are the parameters of the module,
+// which are the default profile.
+static bool ParseProfiles(const TrackParams &params, std::unordered_map<std::string, TrackProfile> *profiles,
+                          std::unordered_map<std::string, std::string> *stream_profiles) {
+  TrackProfile base;
+  base.max_cosine_distance = params.max_cosine_distance;
+  base.nn_budget = params.nn_budget;
+  base.max_iou_distance = params.max_iou_distance;
+  base.max_age = params.max_age;
+  base.n_init = params.n_init;
+  base.high_score_thresh = params.high_score_thresh;
+  base.low_score_thresh = params.low_score_thresh;
+  if (!CheckProfile(kDEFAULT_PROFILE_NAME, base)) return false;
+  profiles->clear();
+  stream_profiles->clear();
+  (*profiles)[kDEFAULT_PROFILE_NAME] = base;
+
+  if (!params.profiles.empty()) {
+    rapidjson::Document doc;
+    if (doc.Parse(params.profiles.c_str()).HasParseError() || !doc.IsObject()) {
+      LOGE(TRACK) << "[Tracker] [profiles] : " << params.profiles << " is not a json object.";
+      return false;
+    }
+    for (auto member = doc.MemberBegin(); member != doc.MemberEnd(); ++member) {
+      std::string name = member->name.GetString();
+      if (!member->value.IsObject()) {
+        LOGE(TRACK) << "[Tracker] profile " << name << " is not a json object.";
+        return false;
+      }
+      TrackProfile profile = base;
+      for (auto field = member->value.MemberBegin(); field != member->value.MemberEnd(); ++field) {
+        std::string key = field->name.GetString();
+        const rapidjson::Value &value = field->value;
+        if (key == "max_cosine_distance" && value.IsNumber()) {
+          profile.max_cosine_distance = value.GetDouble();
+        } else if (key == "nn_budget" && value.IsUint()) {
+          profile.nn_budget = value.GetUint();
+        } else if (key == "max_iou_distance" && value.IsNumber()) {
+          profile.max_iou_distance = value.GetDouble();
+        } else if (key == "max_age" && value.IsUint()) {
+          profile.max_age = value.GetUint();
+        } else if (key == "n_init" && value.IsUint()) {
+          profile.n_init = value.GetUint();
+        } else if (key == "high_score_thresh" && value.IsNumber()) {
+          profile.high_score_thresh = value.GetDouble();
+        } else if (key == "low_score_thresh" && value.IsNumber()) {
+          profile.low_score_thresh = value.GetDouble();
+        } else {
+          LOGE(TRACK) << "[Tracker] profile " << name << ": unknown or invalid " << key << ".";
+          return false;
+        }
+      }
+      if (!CheckProfile(name, profile)) return false;
+      (*profiles)[name] = profile;
+    }
+  }
+
+  if (!params.stream_profiles.empty()) {
+    rapidjson::Document doc;
+    if (doc.Parse(params.stream_profiles.c_str()).HasParseError() || !doc.IsObject()) {
+      LOGE(TRACK) << "[Tracker] [stream_profiles] : " << params.stream_profiles << " is not a json object.";
+      return false;
+    }
+    for (auto member = doc.MemberBegin(); member != doc.MemberEnd(); ++member) {
+      if (!member->value.IsString() || !profiles->count(member->value.GetString())) {
+        LOGE(TRACK) << "[Tracker] [stream_profiles] : the profile of stream " << member->name.GetString()
+                    << " is not found.";
+        return false;
+      }
+      (*stream_profiles)[member->name.GetString()] = member->value.GetString();
+    }
+  }
+  return true;
+}
+
 Tracker::Tracker(const std::string &name) : ModuleEx(name) {
   param_register_.SetModuleDesc(
       "Tracker is a module for realtime tracking.");
@@ -86,6 +195,15 @@ Tracker::Tracker(const std::string &name) : ModuleEx(name) {
       "Usually, it could be set to the core number of the device / the core number of the model.",
       PARAM_OPTIONAL, OFFSET(TrackParams, engine_num), ModuleParamParser<uint32_t>::Parser, "uint32_t"},
 
+    {"track_thread_num", "0", "Optional. The number of threads tracking the streams. 0 means the frames are tracked "
+      "on the threads of the module, where the streams on the same thread are tracked one by one. Otherwise the "
+      "streams are tracked concurrently on the threads of the tracker, the frames of each stream in order.",
+      PARAM_OPTIONAL, OFFSET(TrackParams, track_thread_num), ModuleParamParser<uint32_t>::Parser, "uint32_t"},
+
+    {"cpu_thread_num", "1", "Optional. The number of threads extracting the features of the objects of a frame, "
+      "when the features are extracted on CPU.",
+      PARAM_OPTIONAL, OFFSET(TrackParams, cpu_thread_num), ModuleParamParser<uint32_t>::Parser, "uint32_t"},
+
     {"batch_timeout", "300", "The batching timeout. unit[ms].", PARAM_OPTIONAL, OFFSET(TrackParams, batch_timeout),
       ModuleParamParser<uint32_t>::Parser, "uint32_t"},
 
@@ -97,13 +215,64 @@ Tracker::Tracker(const std::string &name) : ModuleEx(name) {
     {"model_path", "", "The path of the offline model.", PARAM_OPTIONAL, OFFSET(TrackParams, model_path),
       ModuleParamParser<std::string>::Parser, "string"},
 
-    {"track_name", "FeatureMatch", "Track algorithm name. Choose from FeatureMatch and IoUMatch.",
+    {"track_name", "FeatureMatch", "Track algorithm name. Choose from FeatureMatch, IoUMatch and ByteTrack. "
+      "ByteTrack tracks by motion only, and matches the detections of low score to the tracks left.",
       PARAM_OPTIONAL, OFFSET(TrackParams, track_name),
       ModuleParamParser<std::string>::Parser, "string"},
 
     {"max_cosine_distance", "0.2", "Threshold of cosine distance.",
       PARAM_OPTIONAL, OFFSET(TrackParams, max_cosine_distance),
-      ModuleParamParser<float>::Parser, "float"}
+      ModuleParamParser<float>::Parser, "float"},
+
+    {"nn_budget", "100", "Optional. For FeatureMatch, the number of the latest features kept by each track and "
+      "matched with the detections. A smaller budget costs fewer distance computations.",
+      PARAM_OPTIONAL, OFFSET(TrackParams, nn_budget), ModuleParamParser<uint32_t>::Parser, "uint32_t"},
+
+    {"max_iou_distance", "0.7", "Optional. Threshold of IoU distance, in (0, 1]. For ByteTrack, of the first "
+      "association, 0.8 by default.",
+      PARAM_OPTIONAL, OFFSET(TrackParams, max_iou_distance), ModuleParamParser<float>::Parser, "float"},
+
+    {"max_age", "30", "Optional. The number of frames a track is kept after it is lost. A smaller age keeps fewer "
+      "tracks to match.",
+      PARAM_OPTIONAL, OFFSET(TrackParams, max_age), ModuleParamParser<uint32_t>::Parser, "uint32_t"},
+
+    {"n_init", "3", "Optional. The number of frames a track is matched in a row before it is confirmed. For "
+      "ByteTrack, 1 by default.",
+      PARAM_OPTIONAL, OFFSET(TrackParams, n_init), ModuleParamParser<uint32_t>::Parser, "uint32_t"},
+
+    {"high_score_thresh", "0.5", "Optional. For ByteTrack, the detections of score above it are matched first and "
+      "may start new tracks, the others are matched to the tracks left.",
+      PARAM_OPTIONAL, OFFSET(TrackParams, high_score_thresh), ModuleParamParser<float>::Parser, "float"},
+
+    {"low_score_thresh", "0.1", "Optional. For ByteTrack, the detections of score below it are ignored. "
+      "0 <= low_score_thresh <= high_score_thresh <= 1.",
+      PARAM_OPTIONAL, OFFSET(TrackParams, low_score_thresh), ModuleParamParser<float>::Parser, "float"},
+
+    {"profiles", "", "Optional. Named profiles of the hyperparameters of the tracker, in json, "
+      "e.g. {\"crowd\": {\"nn_budget\": 30, \"max_age\": 10}}. The hyperparameters are max_cosine_distance, "
+      "nn_budget, max_iou_distance, max_age, n_init, high_score_thresh and low_score_thresh, those not set are the "
+      "parameters of the module, which are the profile named default. A profile is selected for a stream by "
+      "[stream_profiles] or Tracker::SetStreamProfile.",
+      PARAM_OPTIONAL, OFFSET(TrackParams, profiles), ModuleParamParser<std::string>::Parser, "string"},
+
+    {"record_trace", "", "Optional. The path of the detection trace recorded, the detections and the features of each "
+      "frame with the tracks assigned, to be replayed by the track_replay tool. Empty to disable.",
+      PARAM_OPTIONAL, OFFSET(TrackParams, record_trace), ModuleParamParser<std::string>::Parser, "string"},
+
+    {"stream_profiles", "", "Optional. The profiles of the streams, in json, {stream_id: profile}. The other "
+      "streams use the default profile.",
+      PARAM_OPTIONAL, OFFSET(TrackParams, stream_profiles), ModuleParamParser<std::string>::Parser, "string"},
+
+    {"feature_precision", "float32", "Optional. The precision of the features stored by the tracks. "
+      "float32 and int8 are supported, int8 cuts the memory traffic of feature matching.",
+      PARAM_OPTIONAL, OFFSET(TrackParams, feature_precision),
+      ModuleParamParser<std::string>::Parser, "string"},
+
+    {"assignment_method", "hungarian", "Optional. The solver of the assignments of the detections to the tracks. "
+      "hungarian, lapjv and greedy are supported. lapjv finds the same optimal assignments as hungarian, several "
+      "times faster. greedy is not optimal, for very large scenes.",
+      PARAM_OPTIONAL, OFFSET(TrackParams, assignment_method),
+      ModuleParamParser<std::string>::Parser, "string"}
   };
 
   param_helper_->Register(register_param, &param_register_);
@@ -113,11 +282,11 @@ Tracker::~Tracker() { Close(); }
 
 bool Tracker::InitFeatureExtractor(const CNFrameInfoPtr &data) {
   if (!g_feature_extractor) {
+    auto params = param_helper_->GetParams();
     if (!model_) {
       LOGI(TRACK) << "[Track] FeatureExtract model not set, extract feature on CPU";
-      g_feature_extractor.reset(new FeatureExtractor(match_func_));
+      g_feature_extractor.reset(new FeatureExtractor(match_func_, params.cpu_thread_num));
     } else {
-      auto params = param_helper_->GetParams();
       if (!infer_server::SetCurrentDevice(params.device_id)) return false;
       g_feature_extractor.reset(new FeatureExtractor(model_, match_func_, params.device_id));
       if (!g_feature_extractor->Init(params.input_format, params.engine_num, params.batch_timeout, params.priority)) {
@@ -131,23 +300,89 @@ bool Tracker::InitFeatureExtractor(const CNFrameInfoPtr &data) {
 }
 
 TrackerContext *Tracker::GetContext(const CNFrameInfoPtr &data) {
-  TrackerContext *ctx = nullptr;
-  std::unique_lock<std::mutex> guard(mutex_);
-  auto search = contexts_.find(data->GetStreamIndex());
-  if (search != contexts_.end()) {
-    // context exists
-    ctx = search->second;
+  std::atomic<TrackerContext *> &slot = contexts_[data->GetStreamIndex()];
+  TrackerContext *ctx = slot.load(std::memory_order_acquire);
+  if (ctx) return ctx;
+
+  ctx = new TrackerContext;
+  auto params = param_helper_->GetParams();
+  TrackProfile profile;
+  {
+    std::lock_guard<std::mutex> lk(profile_mutex_);
+    auto iter = stream_profiles_.find(data->stream_id);
+    if (iter != stream_profiles_.end()) {
+      LOGI(TRACK) << "[" << GetName() << "] stream " << data->stream_id << " is tracked with profile "
+                  << iter->second << ".";
+    }
+    profile = profiles_[iter == stream_profiles_.end() ? kDEFAULT_PROFILE_NAME : iter->second];
+  }
+  if (params.track_name == "ByteTrack") {
+    ByteTrack *track = new ByteTrack;
+    track->SetParams(profile.high_score_thresh, profile.low_score_thresh, profile.max_iou_distance, profile.max_age,
+                     profile.n_init);
+    ctx->processer_.reset(track);
   } else {
-    ctx = new TrackerContext;
-    auto params = param_helper_->GetParams();
     FeatureMatchTrack *track = new FeatureMatchTrack;
-    track->SetParams(params.max_cosine_distance, 100, 0.7, 30, 3);
+    track->SetParams(profile.max_cosine_distance, profile.nn_budget, profile.max_iou_distance, profile.max_age,
+                     profile.n_init);
+    track->SetFeaturePrecision(params.feature_precision == "int8" ? FeaturePrecision::INT8
+                                                                  : FeaturePrecision::FLOAT32);
+    if (params.assignment_method == "lapjv") {
+      track->SetAssignmentMethod(AssignmentMethod::LAPJV);
+    } else if (params.assignment_method == "greedy") {
+      track->SetAssignmentMethod(AssignmentMethod::GREEDY);
+    }
     ctx->processer_.reset(track);
-    contexts_[data->GetStreamIndex()] = ctx;
+  }
+  // the frames of a stream come one by one, the context is installed once in case of a race anyway
+  TrackerContext *expected = nullptr;
+  if (!slot.compare_exchange_strong(expected, ctx, std::memory_order_acq_rel)) {
+    delete ctx;
+    ctx = expected;
   }
   return ctx;
 }
 
+void Tracker::TrackFrame(const CNFrameInfoPtr &data) {
+  CNInferObjsPtr objs_holder = data->collection.Get<CNInferObjsPtr>(kCNInferObjsTag);
+
+  std::vector<DetectObject> in, out;
+  std::unique_lock<std::mutex> guard(objs_holder->mutex_);
+  in.reserve(objs_holder->objs_.size());
+
+  // CNDataFramePtr dataframe = data->collection.Get<CNDataFramePtr>(kCNDataFrameTag);
+  for (size_t i = 0; i < objs_holder->objs_.size(); i++) {
+    DetectObject obj;
+    obj.label = std::stoi(objs_holder->objs_[i]->id);
+    obj.score = objs_holder->objs_[i]->score;
+    obj.bbox.x = objs_holder->objs_[i]->bbox.x;
+    obj.bbox.y = objs_holder->objs_[i]->bbox.y;
+    obj.bbox.width = objs_holder->objs_[i]->bbox.w;
+    obj.bbox.height = objs_holder->objs_[i]->bbox.h;
+    obj.feature = objs_holder->objs_[i]->GetFeature("track");
+    in.emplace_back(obj);
+  }
+  GetContext(data)->processer_->UpdateFrame(in, &out);
+  for (size_t i = 0; i < out.size(); i++) {
+    objs_holder->objs_[out[i].detect_id]->track_id = std::to_string(out[i].track_id);
+  }
+
+  guard.unlock();
+  if (trace_writer_) {
+    // the tracks assigned are the reference identities of the replays
+    TraceFrame trace_frame;
+    trace_frame.stream_index = data->GetStreamIndex();
+    trace_frame.timestamp = data->timestamp;
+    trace_frame.objects.swap(in);
+    for (auto &obj : trace_frame.objects) obj.track_id = -1;
+    for (auto &obj : out) trace_frame.objects[obj.detect_id].track_id = obj.track_id;
+    trace_writer_->Write(trace_frame);
+  }
+  ModuleProfiler *profiler = GetProfiler();
+  if (profiler) profiler->RecordProcessEnd(kTRACK_PROFILER_NAME, std::make_pair(data->stream_id, data->timestamp));
+  TransmitData(data);
+}
+
 bool Tracker::Open(ModuleParamSet param_set) {
   if (false == CheckParamSet(param_set)) {
     return false;
@@ -172,36 +407,54 @@ bool Tracker::Open(ModuleParamSet param_set) {
 
   need_feature_ = (params.track_name == "FeatureMatch");
 
+  SetByteTrackDefaults(param_set, &params);
+  {
+    std::lock_guard<std::mutex> lk(profile_mutex_);
+    if (!ParseProfiles(params, &profiles_, &stream_profiles_)) return false;
+  }
+
+  if (!contexts_) {
+    // sized once, so that the contexts are looked up without locking
+    context_num_ = GetMaxStreamNumber();
+    contexts_.reset(new std::atomic<TrackerContext *>[context_num_]);
+    for (uint32_t i = 0; i < context_num_; ++i) contexts_[i].store(nullptr, std::memory_order_relaxed);
+  }
+
+  if (track_pool_) track_pool_->Stop();
+  track_pool_.reset();
+  trace_writer_.reset();
+  if (!params.record_trace.empty()) {
+    trace_writer_.reset(new TraceWriter);
+    if (!trace_writer_->Open(params.record_trace)) {
+      LOGE(TRACK) << "[" << GetName() << "] open the trace " << params.record_trace << " failed.";
+      trace_writer_.reset();
+      return false;
+    }
+  }
+  if (params.track_thread_num) {
+    TrackPool::Params pool_params;
+    pool_params.thread_num = params.track_thread_num;
+    track_pool_.reset(new TrackPool(pool_params, context_num_));
+    track_pool_->Start();
+  }
+
+  // the latency of tracking of each stream, from the frame ready to track to the frame tracked
+  ModuleProfiler *profiler = GetProfiler();
+  if (profiler) profiler->RegisterProcessName(kTRACK_PROFILER_NAME);
+
   match_func_ = [this](const CNFrameInfoPtr data, bool valid) {
     if (!valid) {
       PostEvent(EventType::EVENT_ERROR, "Extract feature failed");
       return;
     }
-    CNInferObjsPtr objs_holder = data->collection.Get<CNInferObjsPtr>(kCNInferObjsTag);
-
-    std::vector<DetectObject> in, out;
-    std::unique_lock<std::mutex> guard(objs_holder->mutex_);
-    in.reserve(objs_holder->objs_.size());
-
-    // CNDataFramePtr dataframe = data->collection.Get<CNDataFramePtr>(kCNDataFrameTag);
-    for (size_t i = 0; i < objs_holder->objs_.size(); i++) {
-      DetectObject obj;
-      obj.label = std::stoi(objs_holder->objs_[i]->id);
-      obj.score = objs_holder->objs_[i]->score;
-      obj.bbox.x = objs_holder->objs_[i]->bbox.x;
-      obj.bbox.y = objs_holder->objs_[i]->bbox.y;
-      obj.bbox.width = objs_holder->objs_[i]->bbox.w;
-      obj.bbox.height = objs_holder->objs_[i]->bbox.h;
-      obj.feature = objs_holder->objs_[i]->GetFeature("track");
-      in.emplace_back(obj);
-    }
-    GetContext(data)->processer_->UpdateFrame(in, &out);
-    for (size_t i = 0; i < out.size(); i++) {
-      objs_holder->objs_[out[i].detect_id]->track_id = std::to_string(out[i].track_id);
+    ModuleProfiler *profiler = GetProfiler();
+    if (profiler) profiler->RecordProcessStart(kTRACK_PROFILER_NAME, std::make_pair(data->stream_id, data->timestamp));
+    if (track_pool_) {
+      // the frames of a stream are tracked in order, the streams concurrently
+      track_pool_->Submit(data->GetStreamIndex(), [this, data] { TrackFrame(data); });
+    } else {
+      TrackFrame(data);
     }
-
-    guard.unlock();
-    TransmitData(data);
   };
 
   tracker_priority_ = this->GetPriority();
@@ -209,13 +462,33 @@ bool Tracker::Open(ModuleParamSet param_set) {
 }
 
 void Tracker::Close() {
-  for (auto &pair : contexts_) {
-    delete pair.second;
+  // the frames waiting are tracked before the contexts are released
+  if (track_pool_) {
+    track_pool_->Stop();
+    if (param_helper_->GetParams().show_stats) {
+      auto stats = track_pool_->GetStats();
+      LOGI(TRACK) << "[" << GetName() << "] tracking threads: " << stats.jobs << " frames, max queue depth "
+                  << stats.max_queue_depth << ".";
+    }
+    track_pool_.reset();
+  }
+  trace_writer_.reset();
+  for (uint32_t i = 0; i < context_num_; ++i) {
+    delete contexts_[i].exchange(nullptr);
   }
-  contexts_.clear();
   g_feature_extractor.reset();
 }
 
+bool Tracker::SetStreamProfile(const std::string &stream_id, const std::string &profile) {
+  std::lock_guard<std::mutex> lk(profile_mutex_);
+  if (!profiles_.count(profile)) {
+    LOGE(TRACK) << "[" << GetName() << "] profile " << profile << " is not found.";
+    return false;
+  }
+  stream_profiles_[stream_id] = profile;
+  return true;
+}
+
 int Tracker::Process(std::shared_ptr<CNFrameInfo> data) {
   if (!data) {
     LOGE(TRACK) << "Process input data is nulltpr!";
@@ -225,6 +498,11 @@ int Tracker::Process(std::shared_ptr<CNFrameInfo> data) {
     if (need_feature_) {
       g_feature_extractor->WaitTaskDone(data->stream_id);
     }
+    if (track_pool_) track_pool_->WaitStream(data->GetStreamIndex());
+    if (data->GetStreamIndex() < context_num_) {
+      // a stream added again on the index is tracked from scratch, with the profile selected then
+      delete contexts_[data->GetStreamIndex()].exchange(nullptr, std::memory_order_acq_rel);
+    }
     TransmitData(data);
     return 0;
   }
@@ -288,11 +566,29 @@ bool Tracker::CheckParamSet(const ModuleParamSet& param_set) const {
     ret = false;
   }
 
-  if (params.track_name != "FeatureMatch" && params.track_name != "IoUMatch") {
+  if (params.track_name != "FeatureMatch" && params.track_name != "IoUMatch" && params.track_name != "ByteTrack") {
     LOGE(TRACK) << "Unsupported track type: " << params.track_name;
     ret = false;
   }
 
+  if (params.feature_precision != "float32" && params.feature_precision != "int8") {
+    LOGE(TRACK) << "Unsupported feature precision: " << params.feature_precision;
+    ret = false;
+  }
+
+  if (params.assignment_method != "hungarian" && params.assignment_method != "lapjv" &&
+      params.assignment_method != "greedy") {
+    LOGE(TRACK) << "Unsupported assignment method: " << params.assignment_method;
+    ret = false;
+  }
+
+  SetByteTrackDefaults(param_set, &params);
+  std::unordered_map<std::string, TrackProfile> profiles;
+  std::unordered_map<std::string, std::string> stream_profiles;
+  if (!ParseProfiles(params, &profiles, &stream_profiles)) {
+    ret = false;
+  }
+
   return ret;
 }
 
@@ -0,0 +1,170 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_TRACK_TRACK_POOL_HPP_
+#define MODULES_TRACK_TRACK_POOL_HPP_
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace cnstream {
+
+/**
+ * TrackPool runs the tracking of the streams on its own threads. The jobs of a stream run one at a time in the order
+ * submitted, so that the frames of a stream are tracked and transmitted in order, while the jobs of different streams
+ * run concurrently on the threads free, whichever conveyor the streams came from.
+ *
+ * The streams are indexed from 0 to stream_num - 1. Submit blocks while max_queue jobs of the stream are waiting,
+ * which holds back that stream only.
+ */
+class TrackPool {
+ public:
+  using Job = std::function<void()>;
+
+  struct Params {
+    uint32_t thread_num = 1;  // streams tracked at the same time at most
+    uint32_t max_queue = 8;   // jobs waiting of each stream before Submit blocks for it
+  };
+
+  struct Stats {
+    uint64_t jobs = 0;             // jobs done
+    uint32_t max_queue_depth = 0;  // jobs waiting of a stream at most
+  };
+
+  TrackPool(const Params &params, uint32_t stream_num) : params_(params), streams_(stream_num) {
+    params_.thread_num = std::max(params_.thread_num, 1u);
+    params_.max_queue = std::max(params_.max_queue, 1u);
+  }
+
+  ~TrackPool() { Stop(); }
+
+  void Start() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (running_) return;
+    running_ = true;
+    for (uint32_t i = 0; i < params_.thread_num; ++i) workers_.emplace_back(&TrackPool::WorkLoop, this);
+  }
+
+  // Drains the streams scheduled, still one job of a stream at a time, then joins the threads. Submit after Stop
+  // runs the job on the calling thread once the jobs of the stream left on the pool are done, so it stays in order.
+  void Stop() {
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      if (!running_) return;
+      running_ = false;
+    }
+    not_empty_.notify_all();
+    not_full_.notify_all();
+    for (auto &worker : workers_) worker.join();
+    workers_.clear();
+  }
+
+  // Queues the job behind the jobs of the stream. The stream is scheduled if it has no job waiting or running, so a
+  // stream takes one thread at most. A stream index out of range is tracked on the calling thread.
+  void Submit(uint32_t stream_index, Job job) {
+    std::unique_lock<std::mutex> lk(mutex_);
+    if (stream_index >= streams_.size()) {
+      lk.unlock();
+      job();
+      return;
+    }
+    StreamQueue &stream = streams_[stream_index];
+    not_full_.wait(lk, [&] { return stream.jobs.size() < params_.max_queue || !running_; });
+    if (!running_) {
+      done_.wait(lk, [&] { return !stream.scheduled; });  // behind the jobs of the stream drained by Stop
+      lk.unlock();
+      job();
+      return;
+    }
+    stream.jobs.push_back(std::move(job));
+    stats_.max_queue_depth = std::max<uint32_t>(stats_.max_queue_depth, stream.jobs.size());
+    if (!stream.scheduled) {
+      stream.scheduled = true;
+      ready_.push_back(stream_index);
+      not_empty_.notify_one();
+    }
+  }
+
+  // Waits until the jobs of a stream submitted are done.
+  void WaitStream(uint32_t stream_index) {
+    std::unique_lock<std::mutex> lk(mutex_);
+    if (stream_index >= streams_.size()) return;
+    StreamQueue &stream = streams_[stream_index];
+    done_.wait(lk, [&] { return !stream.scheduled; });
+  }
+
+  Stats GetStats() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return stats_;
+  }
+
+ private:
+  struct StreamQueue {
+    std::deque<Job> jobs;
+    bool scheduled = false;  // ready or running
+  };
+
+  void WorkLoop() {
+    std::unique_lock<std::mutex> lk(mutex_);
+    while (true) {
+      not_empty_.wait(lk, [this] { return !ready_.empty() || !running_; });
+      if (ready_.empty()) return;
+      uint32_t stream_index = ready_.front();
+      ready_.pop_front();
+      StreamQueue &stream = streams_[stream_index];
+      Job job = std::move(stream.jobs.front());
+      stream.jobs.pop_front();
+      not_full_.notify_all();
+      lk.unlock();
+      job();
+      lk.lock();
+      ++stats_.jobs;
+      // one job at a time, the stream is queued again behind the others
+      if (!stream.jobs.empty()) {
+        ready_.push_back(stream_index);
+      } else {
+        stream.scheduled = false;
+        done_.notify_all();
+      }
+    }
+  }
+
+  Params params_;
+  bool running_ = false;
+  std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+  std::condition_variable done_;
+  std::vector<StreamQueue> streams_;
+  std::deque<uint32_t> ready_;  // streams with jobs waiting and none running
+  std::vector<std::thread> workers_;
+  Stats stats_;
+};  // class TrackPool
+
+}  // namespace cnstream
+
+#endif  // MODULES_TRACK_TRACK_POOL_HPP_
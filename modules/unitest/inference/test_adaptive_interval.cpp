@@ -0,0 +1,135 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "adaptive_interval.hpp"
+
+namespace cnstream {
+
+namespace {
+
+constexpr int kWidth = 640;
+constexpr int kHeight = 360;
+constexpr int kStride = 704;
+
+// a static background with sensor noise, and a bright box at x if x >= 0
+void DrawFrame(int x, std::mt19937 *rng, std::vector<uint8_t> *luma) {
+  std::uniform_int_distribution<int> noise(-2, 2);
+  luma->assign(kStride * kHeight, 0);
+  for (int r = 0; r < kHeight; ++r) {
+    for (int c = 0; c < kWidth; ++c) {
+      int v = 60 + c / 8 + r / 8 + noise(*rng);
+      if (x >= 0 && c >= x && c < x + 120 && r >= 120 && r < 240) v = 200 + noise(*rng);
+      (*luma)[r * kStride + c] = std::min(255, std::max(0, v));
+    }
+  }
+}
+
+}  // namespace
+
+TEST(AdaptiveInterval, Thumbnail) {
+  std::vector<uint8_t> luma(kStride * kHeight, 0);
+  for (int r = 0; r < kHeight; ++r) {
+    for (int c = 0; c < kWidth; ++c) luma[r * kStride + c] = c < kWidth / 2 ? 10 : 250;
+  }
+  std::vector<uint8_t> thumbnail;
+  int thumbnail_height = 0;
+  AdaptiveInterval::MakeThumbnail(luma.data(), kWidth, kHeight, kStride, 64, &thumbnail, &thumbnail_height);
+  ASSERT_EQ(thumbnail_height, 36);
+  ASSERT_EQ(thumbnail.size(), 64u * 36);
+  EXPECT_EQ(thumbnail[0], 10);
+  EXPECT_EQ(thumbnail[63], 250);
+  EXPECT_EQ(thumbnail[35 * 64 + 31], 10);
+  EXPECT_EQ(thumbnail[35 * 64 + 32], 250);
+
+  std::vector<uint8_t> a = {0, 10, 20, 30}, b = {4, 6, 20, 40};
+  EXPECT_FLOAT_EQ(AdaptiveInterval::MeanAbsDiff(a.data(), b.data(), a.size()), 4.5f);
+}
+
+TEST(AdaptiveInterval, StaticSceneBacksOff) {
+  AdaptiveInterval::Params params;
+  params.min_interval = 1;
+  params.max_interval = 8;
+  AdaptiveInterval controller(params);
+  std::mt19937 rng(0);
+  std::vector<uint8_t> luma;
+  std::vector<int> inferred;
+  for (int i = 0; i < 64; ++i) {
+    DrawFrame(-1, &rng, &luma);
+    if (controller.ShouldInfer("0", luma.data(), kWidth, kHeight, kStride)) inferred.push_back(i);
+  }
+  // 0, 1, 3, 7, 15, then every 8 frames
+  ASSERT_GE(inferred.size(), 5u);
+  EXPECT_EQ(inferred[0], 0);
+  EXPECT_EQ(inferred[4] - inferred[3], 8);
+  EXPECT_LE(inferred.size(), 12u);
+  EXPECT_EQ(controller.GetStats("0").interval, 8u);
+
+  // more objects detected
+  controller.OnResult("0", 2);
+  EXPECT_EQ(controller.GetStats("0").interval, 1u);
+}
+
+TEST(AdaptiveInterval, Clip) {
+  AdaptiveInterval::Params params;
+  params.min_interval = 1;
+  params.max_interval = 10;
+  AdaptiveInterval controller(params);
+  controller.SetStreamBounds("fixed", 2, 2);
+  std::mt19937 rng(0);
+  std::vector<uint8_t> luma;
+  // static for 200 frames, a box crossing the scene for 100 frames, static for 200 frames
+  int last_inferred = -1, max_gap_in_motion = 0, static_inferred = 0, moving_inferred = 0, fixed_inferred = 0;
+  for (int i = 0; i < 500; ++i) {
+    bool moving = i >= 200 && i < 300;
+    DrawFrame(moving ? (i - 200) * 5 : -1, &rng, &luma);
+    if (controller.ShouldInfer("0", luma.data(), kWidth, kHeight, kStride)) {
+      if (moving) {
+        max_gap_in_motion = std::max(max_gap_in_motion, i - std::max(last_inferred, 200));
+        ++moving_inferred;
+      } else {
+        ++static_inferred;
+      }
+      last_inferred = i;
+    }
+    if (controller.ShouldInfer("fixed", nullptr, 0, 0, 0)) ++fixed_inferred;
+  }
+  // the moving box is never left uninferred for long
+  EXPECT_LE(max_gap_in_motion, 3);
+  EXPECT_GE(moving_inferred, 50);
+  // most static frames are skipped
+  EXPECT_LT(static_inferred, 400 / 6);
+  auto stats = controller.GetStats("0");
+  EXPECT_EQ(stats.frames, 500u);
+  EXPECT_EQ(stats.inferred, static_cast<uint64_t>(static_inferred + moving_inferred));
+  // no luma, the motion is unknown and the minimum interval is used
+  EXPECT_EQ(fixed_inferred, 250);
+
+  controller.RemoveStream("0");
+  EXPECT_EQ(controller.GetStats("0").frames, 0u);
+}
+
+}  // namespace cnstream
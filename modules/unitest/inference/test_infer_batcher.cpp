@@ -0,0 +1,310 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "infer_batcher.hpp"
+
+namespace cnstream {
+
+using TestBatcher = InferBatcher<int>;
+
+class InferBatcherRecorder {
+ public:
+  TestBatcher::ProcessFunc Process(int sleep_ms = 0) {
+    return [this, sleep_ms](const std::vector<TestBatcher::Item> &batch) {
+      int cur = ++concurrency_;
+      {
+        std::lock_guard<std::mutex> lk(mutex_);
+        batch_sizes_.push_back(batch.size());
+        batches_.emplace_back();
+        for (auto &item : batch) batches_.back().push_back(item.task->payload);
+        max_concurrency_ = std::max(max_concurrency_, cur);
+      }
+      if (sleep_ms) std::this_thread::sleep_for(std::chrono::milliseconds(sleep_ms));
+      --concurrency_;
+    };
+  }
+  // a fixed cost curve of a backend, base_ms + item_ms * batch size
+  TestBatcher::ProcessFunc Process(double base_ms, double item_ms) {
+    return [this, base_ms, item_ms](const std::vector<TestBatcher::Item> &batch) {
+      {
+        std::lock_guard<std::mutex> lk(mutex_);
+        batch_sizes_.push_back(batch.size());
+      }
+      double cost_ms = base_ms + item_ms * batch.size();
+      std::this_thread::sleep_for(std::chrono::microseconds(static_cast<int>(cost_ms * 1e3)));
+    };
+  }
+  TestBatcher::ResponseFunc Response() {
+    return [this](const TestBatcher::TaskPtr &task) {
+      std::lock_guard<std::mutex> lk(mutex_);
+      responses_.push_back(task->payload);
+    };
+  }
+
+  std::mutex mutex_;
+  std::vector<size_t> batch_sizes_;
+  std::vector<std::vector<int>> batches_;
+  std::vector<int> responses_;
+  std::atomic<int> concurrency_{0};
+  int max_concurrency_ = 0;
+};
+
+TEST(InferBatcher, StaticBatch) {
+  InferBatcherRecorder recorder;
+  TestBatcher::Params params;
+  params.policy = TestBatcher::Policy::STATIC;
+  params.batch_size = 4;
+  TestBatcher batcher(params, recorder.Process(), recorder.Response());
+  batcher.Start();
+  EXPECT_TRUE(batcher.Submit("0", 0, 6));
+  EXPECT_TRUE(batcher.Submit("0", 1, 1));
+  batcher.WaitTaskDone("0");
+  batcher.Stop();
+  // requests are never merged
+  EXPECT_EQ(recorder.batch_sizes_, std::vector<size_t>({4, 2, 1}));
+  EXPECT_EQ(recorder.responses_, std::vector<int>({0, 1}));
+  EXPECT_FALSE(batcher.Submit("0", 2, 1));
+}
+
+TEST(InferBatcher, DynamicBatch) {
+  InferBatcherRecorder recorder;
+  TestBatcher::Params params;
+  params.policy = TestBatcher::Policy::DYNAMIC;
+  params.batch_size = 4;
+  params.batch_timeout = 10000;
+  TestBatcher batcher(params, recorder.Process(), recorder.Response());
+  batcher.Start();
+  for (int i = 0; i < 8; ++i) batcher.Submit(std::to_string(i % 2), i, 1);
+  batcher.WaitTaskDone("0");
+  batcher.WaitTaskDone("1");
+  EXPECT_EQ(recorder.batch_sizes_, std::vector<size_t>({4, 4}));
+  auto stats = batcher.GetStats();
+  EXPECT_EQ(stats.batches, 2u);
+  EXPECT_EQ(stats.full_batches, 2u);
+  batcher.Stop();
+}
+
+TEST(InferBatcher, DynamicBatchTimeout) {
+  InferBatcherRecorder recorder;
+  TestBatcher::Params params;
+  params.batch_size = 4;
+  params.batch_timeout = 50;
+  TestBatcher batcher(params, recorder.Process(), recorder.Response());
+  batcher.Start();
+  auto start = std::chrono::steady_clock::now();
+  batcher.Submit("0", 0, 1);
+  batcher.Submit("0", 1, 2);
+  batcher.WaitTaskDone("0");
+  double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  EXPECT_GE(elapsed, 45);
+  EXPECT_EQ(recorder.batch_sizes_, std::vector<size_t>({3}));
+  batcher.Stop();
+}
+
+TEST(InferBatcher, StopFlushes) {
+  InferBatcherRecorder recorder;
+  TestBatcher::Params params;
+  params.batch_size = 4;
+  params.batch_timeout = 100000;
+  TestBatcher batcher(params, recorder.Process(), recorder.Response());
+  batcher.Start();
+  batcher.Submit("0", 0, 1);
+  batcher.Stop();
+  EXPECT_EQ(recorder.responses_, std::vector<int>({0}));
+}
+
+TEST(InferBatcher, OrderAndEngineNum) {
+  InferBatcherRecorder recorder;
+  TestBatcher::Params params;
+  params.batch_size = 2;
+  params.batch_timeout = 5;
+  params.engine_num = 3;
+  TestBatcher batcher(params, recorder.Process(10), recorder.Response());
+  batcher.Start();
+  std::vector<int> expected;
+  for (int i = 0; i < 30; ++i) {
+    // requests without data are responded in order too
+    batcher.Submit("0", i, i % 5 == 0 ? 0 : i % 3 + 1);
+    expected.push_back(i);
+  }
+  batcher.WaitTaskDone("0");
+  batcher.Stop();
+  EXPECT_EQ(recorder.responses_, expected);
+  EXPECT_GT(recorder.max_concurrency_, 1);
+  EXPECT_LE(recorder.max_concurrency_, 3);
+  for (auto size : recorder.batch_sizes_) EXPECT_LE(size, 2u);
+}
+
+TEST(InferBatcher, Discard) {
+  InferBatcherRecorder recorder;
+  TestBatcher::Params params;
+  params.batch_size = 4;
+  params.batch_timeout = 100;
+  TestBatcher batcher(params, recorder.Process(), recorder.Response());
+  batcher.Start();
+  batcher.Submit("0", 0, 2);
+  batcher.Submit("1", 1, 1);
+  batcher.Discard("0");
+  batcher.WaitTaskDone("0");
+  batcher.WaitTaskDone("1");
+  batcher.Stop();
+  // discarded requests are still responded
+  EXPECT_EQ(recorder.responses_, std::vector<int>({0, 1}));
+  EXPECT_EQ(recorder.batch_sizes_, std::vector<size_t>({1}));
+  EXPECT_EQ(batcher.GetStats().discarded_items, 2u);
+}
+
+TEST(InferBatcher, DeadlineBatchFull) {
+  InferBatcherRecorder recorder;
+  TestBatcher::Params params;
+  params.policy = TestBatcher::Policy::DEADLINE;
+  params.batch_size = 4;
+  params.batch_timeout = 100;
+  TestBatcher batcher(params, recorder.Process(2, 0.5), recorder.Response());
+  batcher.Start();
+  // two streams at 500 fps, batches are expected to be full long before the deadline
+  for (int i = 0; i < 40; ++i) {
+    batcher.Submit(std::to_string(i % 2), i, 1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  batcher.WaitTaskDone("0");
+  batcher.WaitTaskDone("1");
+  batcher.Stop();
+  auto stats = batcher.GetStats();
+  EXPECT_EQ(stats.items, 40u);
+  EXPECT_GE(stats.FillRatio(), 0.9);
+  EXPECT_EQ(stats.late_items, 0u);
+  EXPECT_LT(stats.max_queue_ms, 50);
+}
+
+TEST(InferBatcher, DeadlineAdaptsToArrivalRate) {
+  // frames arrive every 40 ms, waiting for a full batch is useless
+  auto run = [](TestBatcher::Policy policy) {
+    InferBatcherRecorder recorder;
+    TestBatcher::Params params;
+    params.policy = policy;
+    params.batch_size = 8;
+    params.batch_timeout = 30;
+    TestBatcher batcher(params, recorder.Process(2, 0.5), recorder.Response());
+    batcher.Start();
+    for (int i = 0; i < 10; ++i) {
+      batcher.Submit("0", i, 1);
+      std::this_thread::sleep_for(std::chrono::milliseconds(40));
+    }
+    batcher.WaitTaskDone("0");
+    batcher.Stop();
+    return batcher.GetStats();
+  };
+  auto dynamic = run(TestBatcher::Policy::DYNAMIC);
+  auto deadline = run(TestBatcher::Policy::DEADLINE);
+  EXPECT_EQ(deadline.items, 10u);
+  // the first frame waits until its deadline as the arrival rate is unknown
+  EXPECT_LE(deadline.late_items, 1u);
+  // dynamic waits batch_timeout for each frame, deadline sends them once the arrival rate is known
+  EXPECT_GT(dynamic.AverageQueueMs(), 25);
+  EXPECT_LT(deadline.AverageQueueMs(), dynamic.AverageQueueMs() / 2);
+}
+
+TEST(InferBatcher, DeadlinePriority) {
+  InferBatcherRecorder recorder;
+  TestBatcher::Params params;
+  params.policy = TestBatcher::Policy::DEADLINE;
+  params.batch_size = 4;
+  params.batch_timeout = 1000;
+  TestBatcher batcher(params, recorder.Process(), recorder.Response());
+  batcher.Start();
+  batcher.Submit("low", 0, 3, 0);
+  batcher.Submit("high", 1, 3, 1);
+  batcher.WaitTaskDone("low");
+  batcher.WaitTaskDone("high");
+  batcher.Stop();
+  ASSERT_EQ(recorder.batches_.size(), 2u);
+  // the data of the high priority request are batched first, the responses are still in order
+  EXPECT_EQ(recorder.batches_[0], std::vector<int>({1, 1, 1, 0}));
+  EXPECT_EQ(recorder.batches_[1], std::vector<int>({0, 0}));
+  EXPECT_EQ(recorder.responses_, std::vector<int>({0, 1}));
+}
+
+TEST(InferBatcher, RoiBatchingAcrossFrames) {
+  // secondary inference, each frame of 3 streams has 0 to 2 objects
+  auto run = [](TestBatcher::Policy policy, std::vector<int> *processed, std::vector<int> *responses) {
+    std::mutex mutex;
+    TestBatcher::Params params;
+    params.policy = policy;
+    params.batch_size = 4;
+    params.batch_timeout = 20;
+    TestBatcher batcher(
+        params,
+        [&](const std::vector<TestBatcher::Item> &batch) {
+          std::lock_guard<std::mutex> lk(mutex);
+          // the result of each object is scattered back by the request and the index of the object
+          for (auto &item : batch) processed->push_back(item.task->payload * 10 + item.index);
+        },
+        [&](const TestBatcher::TaskPtr &task) {
+          std::lock_guard<std::mutex> lk(mutex);
+          responses->push_back(task->payload);
+        });
+    batcher.Start();
+    for (int frame = 0; frame < 30; ++frame) {
+      for (int stream = 0; stream < 3; ++stream) {
+        batcher.Submit(std::to_string(stream), frame * 3 + stream, (frame + stream) % 3);
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    for (int stream = 0; stream < 3; ++stream) batcher.WaitTaskDone(std::to_string(stream));
+    batcher.Stop();
+    return batcher.GetStats();
+  };
+
+  std::vector<int> expected_processed, expected_responses;
+  for (int request = 0; request < 90; ++request) {
+    expected_responses.push_back(request);
+    for (int i = 0; i < (request / 3 + request % 3) % 3; ++i) expected_processed.push_back(request * 10 + i);
+  }
+  std::vector<int> processed, responses;
+  auto per_frame = run(TestBatcher::Policy::STATIC, &processed, &responses);
+  EXPECT_EQ(per_frame.items, 90u);
+  EXPECT_EQ(responses, expected_responses);
+
+  processed.clear();
+  responses.clear();
+  auto per_roi = run(TestBatcher::Policy::DYNAMIC, &processed, &responses);
+  EXPECT_EQ(per_roi.items, 90u);
+  // each object is processed once, frames are responded in order once all their objects are processed
+  std::sort(processed.begin(), processed.end());
+  EXPECT_EQ(processed, expected_processed);
+  EXPECT_EQ(responses, expected_responses);
+  // frames with 1 or 2 objects fill half of the batches, objects of many frames fill them
+  EXPECT_LT(per_frame.FillRatio(), 0.5);
+  EXPECT_GT(per_roi.FillRatio(), 0.9);
+  EXPECT_LE(per_roi.batches, 24u);
+}
+
+}  // namespace cnstream
@@ -115,6 +115,15 @@ TEST(Inferencer, CheckParamSet) {
     EXPECT_TRUE(infer->CheckParamSet(param));
   }
 
+  // postprocessing threads and queue size must be numbers
+  param["postproc"] = "name=empty_postproc;thread_num=no_number";
+  EXPECT_FALSE(infer->CheckParamSet(param));
+  param["postproc"] = "name=empty_postproc;thread_num=2;queue_size=no_number";
+  EXPECT_FALSE(infer->CheckParamSet(param));
+  param["postproc"] = "name=empty_postproc;thread_num=2;queue_size=4";
+  EXPECT_TRUE(infer->CheckParamSet(param));
+  param["postproc"] = "name=empty_postproc";
+
   // TODO(dmh): test mean and std
 }
 
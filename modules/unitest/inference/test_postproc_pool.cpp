@@ -0,0 +1,196 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "postproc_pool.hpp"
+
+namespace cnstream {
+
+namespace {
+
+struct TestFrame {
+  std::string stream_id;
+  int index;
+  std::atomic<int> results{0};
+};
+
+using TestFramePtr = std::shared_ptr<TestFrame>;
+using TestPool = PostprocPool<TestFrame>;
+
+// Batches of `batch_size` frames of the streams in turn, as responded by the backend: each batch is postprocessed,
+// then its frames are done. A synthetic postprocessing sleeps for postproc_ms.
+double RunBatches(TestPool *pool, int streams, int frames_per_stream, int batch_size, int postproc_ms,
+                  std::vector<std::vector<int>> *transmitted) {
+  std::vector<TestFramePtr> frames;
+  for (int i = 0; i < frames_per_stream; ++i) {
+    for (int s = 0; s < streams; ++s) {
+      TestFramePtr frame = std::make_shared<TestFrame>();
+      frame->stream_id = std::to_string(s);
+      frame->index = i;
+      frames.push_back(frame);
+    }
+  }
+  std::mt19937 rng(0);
+  auto start = std::chrono::steady_clock::now();
+  for (size_t b = 0; b < frames.size(); b += batch_size) {
+    std::vector<TestFramePtr> batch(frames.begin() + b, frames.begin() + std::min(frames.size(), b + batch_size));
+    int sleep_ms = postproc_ms ? postproc_ms + static_cast<int>(rng() % 3) - 1 : 0;
+    auto job = [batch, sleep_ms]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(sleep_ms));
+      for (auto &frame : batch) ++frame->results;
+    };
+    if (pool) {
+      pool->Submit(batch, job);
+      for (auto &frame : batch) pool->Done(frame->stream_id, frame);
+    } else {
+      job();
+      for (auto &frame : batch) (*transmitted)[std::stoi(frame->stream_id)].push_back(frame->index);
+    }
+  }
+  if (pool) {
+    for (int s = 0; s < streams; ++s) pool->WaitStream(std::to_string(s));
+  }
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+TEST(PostprocPool, OrderPerStream) {
+  std::mutex mutex;
+  std::vector<std::vector<int>> transmitted(3);
+  TestPool::Params params;
+  params.thread_num = 4;
+  params.max_queue = 4;
+  TestPool pool(params, [&](const TestFramePtr &frame) {
+    // the results are written before the frame is transmitted
+    EXPECT_EQ(frame->results.load(), 1);
+    std::lock_guard<std::mutex> lk(mutex);
+    transmitted[std::stoi(frame->stream_id)].push_back(frame->index);
+  });
+  std::atomic<int> started{0}, ended{0};
+  pool.SetFrameCallbacks([&](const TestFramePtr &) { ++started; }, [&](const TestFramePtr &) { ++ended; });
+  pool.Start();
+  RunBatches(&pool, 3, 40, 4, 2, nullptr);
+  for (auto &indexes : transmitted) {
+    ASSERT_EQ(indexes.size(), 40u);
+    for (int i = 0; i < 40; ++i) EXPECT_EQ(indexes[i], i);
+  }
+  EXPECT_EQ(started.load(), 120);
+  EXPECT_EQ(ended.load(), 120);
+  auto stats = pool.GetStats();
+  EXPECT_EQ(stats.jobs, 30u);
+  EXPECT_EQ(stats.queue_depth, 0u);
+  EXPECT_EQ(stats.pending_frames, 0u);
+  EXPECT_LE(stats.max_queue_depth, 4u);
+}
+
+TEST(PostprocPool, FrameOfSeveralJobs) {
+  // the objects of a frame are postprocessed in two batches, the second one finishes first
+  std::vector<int> transmitted;
+  TestPool::Params params;
+  params.thread_num = 2;
+  TestPool pool(params, [&](const TestFramePtr &frame) { transmitted.push_back(frame->index); });
+  pool.Start();
+  TestFramePtr frame = std::make_shared<TestFrame>();
+  frame->stream_id = "0";
+  frame->index = 0;
+  TestFramePtr next = std::make_shared<TestFrame>();
+  next->stream_id = "0";
+  next->index = 1;
+  std::atomic<bool> release{false};
+  pool.Submit({frame, frame}, [&]() {
+    while (!release) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    ++frame->results;
+  });
+  pool.Submit({frame, next}, [&]() { ++next->results; });
+  pool.Done("0", frame);
+  pool.Done("0", next);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_TRUE(transmitted.empty());
+  EXPECT_EQ(pool.GetStats().pending_frames, 2u);
+  release = true;
+  pool.WaitStream("0");
+  ASSERT_EQ(transmitted.size(), 2u);
+  EXPECT_EQ(transmitted[0], 0);
+  EXPECT_EQ(transmitted[1], 1);
+}
+
+TEST(PostprocPool, StopRunsJobs) {
+  std::atomic<int> transmitted{0};
+  TestPool::Params params;
+  params.thread_num = 1;
+  params.max_queue = 16;
+  TestPool pool(params, [&](const TestFramePtr &) { ++transmitted; });
+  pool.Start();
+  std::vector<TestFramePtr> frames;
+  for (int i = 0; i < 8; ++i) {
+    TestFramePtr frame = std::make_shared<TestFrame>();
+    frame->stream_id = "0";
+    frame->index = i;
+    frames.push_back(frame);
+    pool.Submit({frame}, [frame]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+      ++frame->results;
+    });
+    pool.Done("0", frame);
+  }
+  pool.Stop();
+  for (auto &frame : frames) EXPECT_EQ(frame->results.load(), 1);
+  EXPECT_EQ(transmitted.load(), 8);
+  // run by the calling thread after stopped
+  TestFramePtr frame = std::make_shared<TestFrame>();
+  frame->stream_id = "0";
+  pool.Submit({frame}, [frame]() { ++frame->results; });
+  EXPECT_EQ(frame->results.load(), 1);
+  pool.Done("0", frame);
+  EXPECT_EQ(transmitted.load(), 9);
+}
+
+TEST(PostprocPool, SlowPostproc) {
+  // 4 streams, batches of 4 frames, a postprocessing of 8ms per batch
+  const int streams = 4, frames = 24, batch_size = 4, postproc_ms = 8;
+  std::vector<std::vector<int>> sync_transmitted(streams);
+  double sync_ms = RunBatches(nullptr, streams, frames, batch_size, postproc_ms, &sync_transmitted);
+
+  std::atomic<int> transmitted{0};
+  TestPool::Params params;
+  params.thread_num = 4;
+  params.max_queue = 8;
+  TestPool pool(params, [&](const TestFramePtr &) { ++transmitted; });
+  pool.Start();
+  double async_ms = RunBatches(&pool, streams, frames, batch_size, postproc_ms, nullptr);
+  EXPECT_EQ(transmitted.load(), streams * frames);
+  std::cout << "postprocessing on the response path: " << sync_ms << " ms, on 4 threads: " << async_ms << " ms, "
+            << "max queue depth " << pool.GetStats().max_queue_depth << std::endl;
+  EXPECT_LT(async_ms, sync_ms * 0.6);
+}
+
+}  // namespace cnstream
@@ -0,0 +1,240 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "cnstream_preproc.hpp"
+#include "tensor_buffer_pool.hpp"
+
+namespace cnstream {
+
+static std::vector<uint8_t> MakeNV12(int w, int h, int stride) {
+  std::vector<uint8_t> img(stride * h * 3 / 2);
+  srand(w * h);
+  // smooth gradients with some noise
+  for (int r = 0; r < h; ++r) {
+    for (int c = 0; c < w; ++c) img[r * stride + c] = static_cast<uint8_t>(16 + (r + c) * 200 / (w + h) + rand() % 8);
+  }
+  uint8_t *uv = img.data() + stride * h;
+  for (int r = 0; r < h / 2; ++r) {
+    for (int c = 0; c < w / 2; ++c) {
+      uv[r * stride + 2 * c] = static_cast<uint8_t>(64 + c * 128 / w + rand() % 8);
+      uv[r * stride + 2 * c + 1] = static_cast<uint8_t>(192 - r * 128 / h - rand() % 8);
+    }
+  }
+  return img;
+}
+
+// Straightforward float implementation: bilinear resize of each plane, then BT.601 convertion. HWC RGB output.
+static std::vector<float> Reference(const uint8_t *y, const uint8_t *uv, int src_w, int src_h, int stride, int dst_w,
+                                    int dst_h) {
+  auto sample = [](const uint8_t *plane, int w, int h, int stride, int step, int offset, float sx, float sy) {
+    sx = std::max(sx, 0.f);
+    sy = std::max(sy, 0.f);
+    int x0 = std::min(static_cast<int>(sx), w - 1), y0 = std::min(static_cast<int>(sy), h - 1);
+    int x1 = std::min(x0 + 1, w - 1), y1 = std::min(y0 + 1, h - 1);
+    float fx = sx - x0, fy = sy - y0;
+    auto at = [&](int x, int yy) { return static_cast<float>(plane[yy * stride + x * step + offset]); };
+    return (at(x0, y0) * (1 - fx) + at(x1, y0) * fx) * (1 - fy) + (at(x0, y1) * (1 - fx) + at(x1, y1) * fx) * fy;
+  };
+  std::vector<float> out(dst_w * dst_h * 3);
+  float scale_x = static_cast<float>(src_w) / dst_w, scale_y = static_cast<float>(src_h) / dst_h;
+  for (int r = 0; r < dst_h; ++r) {
+    for (int c = 0; c < dst_w; ++c) {
+      // pixel centers are aligned in both luma and chroma planes
+      float sx = (c + 0.5f) * scale_x - 0.5f, sy = (r + 0.5f) * scale_y - 0.5f;
+      float csx = (c + 0.5f) * scale_x / 2 - 0.5f, csy = (r + 0.5f) * scale_y / 2 - 0.5f;
+      float yf = sample(y, src_w, src_h, stride, 1, 0, sx, sy);
+      float uf = sample(uv, src_w / 2, src_h / 2, stride, 2, 0, csx, csy);
+      float vf = sample(uv, src_w / 2, src_h / 2, stride, 2, 1, csx, csy);
+      yf = 1.164383f * (yf - 16.f);
+      uf -= 128.f;
+      vf -= 128.f;
+      float rgb[3] = {yf + 1.596027f * vf, yf - 0.391762f * uf - 0.812968f * vf, yf + 2.017232f * uf};
+      for (int k = 0; k < 3; ++k) out[(r * dst_w + c) * 3 + k] = std::min(std::max(rgb[k], 0.f), 255.f);
+    }
+  }
+  return out;
+}
+
+TEST(InferencerPreprocCpu, InvalidParams) {
+  std::vector<uint8_t> img = MakeNV12(32, 32, 32);
+  std::vector<float> dst(16 * 16 * 3);
+  CpuPreprocParams params;
+  EXPECT_EQ(YUV420spToTensorCpu(nullptr, img.data(), 32, 32, 32, 32, CNEDK_BUF_COLOR_FORMAT_NV12, dst.data(), 16, 16,
+                                params), -1);
+  EXPECT_EQ(YUV420spToTensorCpu(img.data(), img.data() + 1024, 32, 32, 32, 32, CNEDK_BUF_COLOR_FORMAT_RGB, dst.data(),
+                                16, 16, params), -1);
+  params.dst_fmt = CNEDK_BUF_COLOR_FORMAT_NV12;
+  EXPECT_EQ(YUV420spToTensorCpu(img.data(), img.data() + 1024, 32, 32, 32, 32, CNEDK_BUF_COLOR_FORMAT_NV12, dst.data(),
+                                16, 16, params), -1);
+  params.dst_fmt = CNEDK_BUF_COLOR_FORMAT_BGR;
+  params.mean_std = true;
+  params.std[1] = 0;
+  EXPECT_EQ(YUV420spToTensorCpu(img.data(), img.data() + 1024, 32, 32, 32, 32, CNEDK_BUF_COLOR_FORMAT_NV12, dst.data(),
+                                16, 16, params), -1);
+}
+
+TEST(InferencerPreprocCpu, Accuracy) {
+  struct Case {
+    int src_w, src_h, stride, dst_w, dst_h;
+  };
+  std::vector<Case> cases = {{64, 48, 64, 64, 48}, {320, 240, 384, 416, 416}, {1920, 1080, 1920, 640, 640},
+                             {100, 62, 128, 33, 17}};
+  for (const auto &c : cases) {
+    std::vector<uint8_t> img = MakeNV12(c.src_w, c.src_h, c.stride);
+    const uint8_t *y = img.data(), *uv = img.data() + c.stride * c.src_h;
+    std::vector<float> ref = Reference(y, uv, c.src_w, c.src_h, c.stride, c.dst_w, c.dst_h);
+
+    CpuPreprocParams params;
+    params.keep_aspect_ratio = false;
+    std::vector<float> simd(ref.size()), scalar(ref.size());
+    ASSERT_EQ(YUV420spToTensorCpu(y, uv, c.src_w, c.src_h, c.stride, c.stride, CNEDK_BUF_COLOR_FORMAT_NV12,
+                                  simd.data(), c.dst_w, c.dst_h, params), 0);
+    params.use_simd = false;
+    ASSERT_EQ(YUV420spToTensorCpu(y, uv, c.src_w, c.src_h, c.stride, c.stride, CNEDK_BUF_COLOR_FORMAT_NV12,
+                                  scalar.data(), c.dst_w, c.dst_h, params), 0);
+
+    double max_simd_diff = 0, sum_ref_diff = 0, max_ref_diff = 0;
+    for (size_t i = 0; i < ref.size(); ++i) {
+      max_simd_diff = std::max<double>(max_simd_diff, std::fabs(simd[i] - scalar[i]));
+      double diff = std::fabs(scalar[i] - ref[i]);
+      sum_ref_diff += diff;
+      max_ref_diff = std::max(max_ref_diff, diff);
+    }
+    // the SIMD paths differ from the scalar one by rounding only
+    EXPECT_LE(max_simd_diff, 1.0);
+    // fixed point interpolation and rounding of the intermediate yuv values
+    EXPECT_LE(sum_ref_diff / ref.size(), 1.0);
+    EXPECT_LE(max_ref_diff, 4.0);
+  }
+}
+
+TEST(InferencerPreprocCpu, NV21AndBGR) {
+  const int w = 64, h = 32;
+  std::vector<uint8_t> nv12 = MakeNV12(w, h, w);
+  std::vector<uint8_t> nv21 = nv12;
+  for (int i = w * h; i < w * h * 3 / 2; i += 2) std::swap(nv21[i], nv21[i + 1]);
+
+  CpuPreprocParams params;
+  params.dtype = infer_server::DataType::UINT8;
+  std::vector<uint8_t> rgb(32 * 32 * 3), bgr(32 * 32 * 3);
+  ASSERT_EQ(YUV420spToTensorCpu(nv12.data(), nv12.data() + w * h, w, h, w, w, CNEDK_BUF_COLOR_FORMAT_NV12, rgb.data(),
+                                32, 32, params), 0);
+  params.dst_fmt = CNEDK_BUF_COLOR_FORMAT_BGR;
+  ASSERT_EQ(YUV420spToTensorCpu(nv21.data(), nv21.data() + w * h, w, h, w, w, CNEDK_BUF_COLOR_FORMAT_NV21, bgr.data(),
+                                32, 32, params), 0);
+  for (size_t i = 0; i < rgb.size(); i += 3) {
+    ASSERT_EQ(rgb[i], bgr[i + 2]);
+    ASSERT_EQ(rgb[i + 1], bgr[i + 1]);
+    ASSERT_EQ(rgb[i + 2], bgr[i]);
+  }
+}
+
+TEST(InferencerPreprocCpu, LetterboxAndNormalize) {
+  // 2:1 source into a square, the rows above and below are padded
+  const int w = 128, h = 64, dst_w = 64, dst_h = 64;
+  std::vector<uint8_t> img = MakeNV12(w, h, w);
+  CpuPreprocParams params;
+  params.pad_value = 114;
+  params.mean_std = true;
+  params.mean[0] = 100.f, params.mean[1] = 110.f, params.mean[2] = 120.f;
+  params.std[0] = 50.f, params.std[1] = 60.f, params.std[2] = 70.f;
+
+  std::vector<float> hwc(dst_w * dst_h * 3), chw(dst_w * dst_h * 3);
+  ASSERT_EQ(YUV420spToTensorCpu(img.data(), img.data() + w * h, w, h, w, w, CNEDK_BUF_COLOR_FORMAT_NV12, hwc.data(),
+                                dst_w, dst_h, params), 0);
+  params.planar = true;
+  ASSERT_EQ(YUV420spToTensorCpu(img.data(), img.data() + w * h, w, h, w, w, CNEDK_BUF_COLOR_FORMAT_NV12, chw.data(),
+                                dst_w, dst_h, params), 0);
+
+  CnedkTransformRect roi = KeepAspectRatio(w, h, dst_w, dst_h);
+  ASSERT_EQ(roi.top, 16u);
+  ASSERT_EQ(roi.height, 32u);
+  for (int r = 0; r < dst_h; ++r) {
+    bool pad = r < static_cast<int>(roi.top) || r >= static_cast<int>(roi.top + roi.height);
+    for (int c = 0; c < dst_w; ++c) {
+      for (int k = 0; k < 3; ++k) {
+        float v = hwc[(r * dst_w + c) * 3 + k];
+        ASSERT_FLOAT_EQ(v, chw[(k * dst_h + r) * dst_w + c]);
+        if (pad) {
+          ASSERT_NEAR(v, (114.f - params.mean[k]) / params.std[k], 1e-5f);
+        } else {
+          ASSERT_GE(v, -params.mean[k] / params.std[k] - 1e-5f);
+          ASSERT_LE(v, (255.f - params.mean[k]) / params.std[k] + 1e-5f);
+        }
+      }
+    }
+  }
+}
+
+TEST(InferencerPreprocCpu, NoAllocationPerCall) {
+  const int w = 1280, h = 720, dst_w = 416, dst_h = 416;
+  std::vector<uint8_t> img = MakeNV12(w, h, w);
+  std::vector<float> dst(dst_w * dst_h * 3);
+  CpuPreprocParams params;
+  params.keep_aspect_ratio = true;
+  TensorBufferPool &pool = TensorBufferPool::Instance();
+  // warm up, the scratch buffers of both layouts are allocated once
+  for (bool planar : {false, true}) {
+    params.planar = planar;
+    ASSERT_EQ(YUV420spToTensorCpu(img.data(), img.data() + w * h, w, h, w, w, CNEDK_BUF_COLOR_FORMAT_NV12,
+                                  dst.data(), dst_w, dst_h, params), 0);
+  }
+  pool.ResetStats();
+  for (int i = 0; i < 50; ++i) {
+    params.planar = i % 2;
+    ASSERT_EQ(YUV420spToTensorCpu(img.data(), img.data() + w * h, w, h, w, w, CNEDK_BUF_COLOR_FORMAT_NV12,
+                                  dst.data(), dst_w, dst_h, params), 0);
+  }
+  TensorPoolStats stats = pool.GetStats();
+  EXPECT_EQ(stats.borrows, 50u);
+  EXPECT_EQ(stats.allocations, 0u);
+  EXPECT_EQ(stats.reuses, 50u);
+}
+
+TEST(InferencerPreprocCpu, Throughput) {
+  const int w = 1920, h = 1080, dst_w = 640, dst_h = 640, loop = 20;
+  std::vector<uint8_t> img = MakeNV12(w, h, w);
+  std::vector<float> dst(dst_w * dst_h * 3);
+  CpuPreprocParams params;
+  params.mean_std = true;
+  params.std[0] = params.std[1] = params.std[2] = 255.f;
+  for (bool simd : {false, true}) {
+    params.use_simd = simd;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < loop; ++i) {
+      ASSERT_EQ(YUV420spToTensorCpu(img.data(), img.data() + w * h, w, h, w, w, CNEDK_BUF_COLOR_FORMAT_NV12,
+                                    dst.data(), dst_w, dst_h, params), 0);
+    }
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "NV12 " << w << "x" << h << " -> RGB float " << dst_w << "x" << dst_h << " ("
+              << (simd ? GetCpuPreprocIsa() : "c") << "): " << us / loop << " us" << std::endl;
+  }
+}
+
+}  // namespace cnstream
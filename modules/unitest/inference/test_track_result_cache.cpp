@@ -0,0 +1,120 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "track_result_cache.hpp"
+
+namespace cnstream {
+
+using TestCache = TrackResultCache<int>;
+
+TEST(TrackResultCache, Refresh) {
+  TestCache::Params params;
+  params.refresh_interval = 10;
+  params.size_growth = 0.2f;
+  params.score_drop = 0.2f;
+  TestCache cache(params);
+  int result = 0;
+
+  // inferred until the first result is stored
+  EXPECT_FALSE(cache.Lookup("0", "1", 0, 0.1f, 0.9f, &result));
+  EXPECT_FALSE(cache.Lookup("0", "1", 1, 0.1f, 0.9f, &result));
+  cache.Update("0", "1", 7);
+  EXPECT_TRUE(cache.Lookup("0", "1", 2, 0.1f, 0.9f, &result));
+  EXPECT_EQ(result, 7);
+  // refreshed refresh_interval frames after the inference requested last
+  EXPECT_TRUE(cache.Lookup("0", "1", 10, 0.1f, 0.9f, &result));
+  EXPECT_FALSE(cache.Lookup("0", "1", 11, 0.1f, 0.9f, &result));
+  // the result cached is used while the refresh is inferred
+  EXPECT_TRUE(cache.Lookup("0", "1", 12, 0.1f, 0.9f, &result));
+  EXPECT_EQ(result, 7);
+  cache.Update("0", "1", 8);
+  EXPECT_TRUE(cache.Lookup("0", "1", 13, 0.11f, 0.9f, &result));
+  EXPECT_EQ(result, 8);
+  // the box grows
+  EXPECT_FALSE(cache.Lookup("0", "1", 14, 0.13f, 0.9f, &result));
+  EXPECT_TRUE(cache.Lookup("0", "1", 15, 0.14f, 0.9f, &result));
+  // the detection score drops
+  EXPECT_FALSE(cache.Lookup("0", "1", 16, 0.14f, 0.6f, &result));
+  EXPECT_TRUE(cache.Lookup("0", "1", 17, 0.14f, 0.6f, &result));
+
+  // tracks are per stream
+  EXPECT_FALSE(cache.Lookup("1", "1", 17, 0.14f, 0.6f, &result));
+  auto stats = cache.GetStats("0");
+  EXPECT_EQ(stats.lookups, 11u);
+  EXPECT_EQ(stats.hits, 6u);
+}
+
+TEST(TrackResultCache, EvictLostTracks) {
+  TestCache::Params params;
+  params.max_lost = 5;
+  TestCache cache(params);
+  int result = 0;
+  cache.Lookup("0", "1", 0, 0.1f, 0.9f, &result);
+  cache.Lookup("0", "2", 0, 0.1f, 0.9f, &result);
+  cache.Update("0", "1", 1);
+  cache.Update("0", "2", 2);
+  for (uint64_t frame = 1; frame <= 6; ++frame) {
+    cache.Lookup("0", "1", frame, 0.1f, 0.9f, &result);
+    cache.Evict("0", frame);
+  }
+  // track 2 is lost
+  EXPECT_EQ(cache.Size("0"), 1u);
+  EXPECT_EQ(cache.GetStats("0").evicted, 1u);
+  cache.Update("0", "2", 2);
+  EXPECT_FALSE(cache.Lookup("0", "2", 7, 0.1f, 0.9f, &result));
+
+  cache.RemoveStream("0");
+  EXPECT_EQ(cache.Size("0"), 0u);
+}
+
+TEST(TrackResultCache, DenseScene) {
+  // 30 vehicles, each tracked for 150 frames, approaching slowly, the results arrive 2 frames later
+  TestCache::Params params;
+  TestCache cache(params);
+  uint64_t inferred = 0, objects = 0;
+  for (uint64_t frame = 0; frame < 640; ++frame) {
+    for (int vehicle = 0; vehicle < 30; ++vehicle) {
+      uint64_t start = vehicle * 15;
+      if (frame < start || frame >= start + 150) continue;
+      std::string track_id = std::to_string(vehicle);
+      float area = 0.01f * (1 + (frame - start) / 150.f);
+      int result = 0;
+      ++objects;
+      if (!cache.Lookup("0", track_id, frame, area, 0.9f, &result)) {
+        ++inferred;
+        if (frame >= start + 2) cache.Update("0", track_id, vehicle);
+      } else {
+        EXPECT_EQ(result, vehicle);
+      }
+    }
+    cache.Evict("0", frame);
+  }
+  // most of the objects are not inferred
+  EXPECT_LT(inferred * 5, objects);
+  EXPECT_NEAR(cache.GetStats("0").HitRate(), 1 - static_cast<double>(inferred) / objects, 1e-6);
+  EXPECT_EQ(cache.GetStats("0").evicted, 30u);
+  EXPECT_EQ(cache.Size("0"), 0u);
+}
+
+}  // namespace cnstream
@@ -20,10 +20,12 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <chrono>
 #include <memory>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include "cnrt.h"
 #include "cnstream_source.hpp"
@@ -53,7 +55,7 @@ TEST(SourceFrController, Control) {
   // return directly
   EXPECT_NO_THROW(fr_controller.Control());
 
-  // reset frame rate to 10
+  // reset frame rate to 10, frames are scheduled at start + n / frame_rate
   frame_rate = 10;
   fr_controller.SetFrameRate(frame_rate);
   auto start = std::chrono::steady_clock::now();
@@ -61,27 +63,118 @@ TEST(SourceFrController, Control) {
 
   std::chrono::duration<double, std::milli> diff;
   uint32_t loop_num = 10;
-  while (loop_num--) {
+  for (uint32_t i = 1; i <= loop_num; ++i) {
     fr_controller.Control();
-    auto end = std::chrono::steady_clock::now();
-    diff = end - start;
-
-    EXPECT_TRUE(diff.count() >= static_cast<double>(1000) / static_cast<double>(frame_rate));
-    start = end;
+    diff = std::chrono::steady_clock::now() - start;
+    EXPECT_GE(diff.count(), 1000.0 * i / frame_rate);
+    EXPECT_LT(diff.count(), 1000.0 * i / frame_rate + 10);  // jitter of one wake-up, not accumulated
   }
 
   // reset frame rate to 30
   frame_rate = 30;
+  start = std::chrono::steady_clock::now();
   fr_controller.SetFrameRate(frame_rate);
 
   loop_num = 20;
-  while (loop_num--) {
+  for (uint32_t i = 1; i <= loop_num; ++i) {
     fr_controller.Control();
-    auto end = std::chrono::steady_clock::now();
-    diff = end - start;
-    EXPECT_TRUE(diff.count() >= static_cast<double>(1000) / static_cast<double>(frame_rate));
-    start = end;
+    diff = std::chrono::steady_clock::now() - start;
+    EXPECT_GE(diff.count(), 1000.0 * i / frame_rate);
+    EXPECT_LT(diff.count(), 1000.0 * i / frame_rate + 10);  // jitter of one wake-up, not accumulated
+  }
+}
+
+// pts in 90khz, returns the average pacing error in milliseconds
+static double PaceByPts(double speed, double fps, uint32_t frame_num, bool variable_frame_rate) {
+  FrController fr_controller;
+  fr_controller.SetSpeed(speed);
+  fr_controller.Start();
+  uint64_t pts = 90000;
+  fr_controller.Control(pts);  // anchor
+  auto start = std::chrono::steady_clock::now();
+  uint64_t start_pts = pts;
+  double total_error = 0;
+  for (uint32_t i = 0; i < frame_num; ++i) {
+    double gap = 90000 / fps;
+    if (variable_frame_rate) gap *= (i % 3) ? 0.5 : 2;
+    pts += static_cast<uint64_t>(gap);
+    fr_controller.Control(pts);
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    double expected = (pts - start_pts) / 90.0 / speed;
+    // never earlier than the timestamp
+    EXPECT_GE(elapsed.count(), expected);
+    total_error += elapsed.count() - expected;
+  }
+  return total_error / frame_num;
+}
+
+TEST(SourceFrController, ControlByPts) {
+  FrController fr_controller;
+  EXPECT_EQ(fr_controller.GetSpeed(), 0);
+  // as fast as possible
+  auto start = std::chrono::steady_clock::now();
+  for (uint64_t pts = 0; pts < 90000 * 10; pts += 3600) {
+    fr_controller.Control(pts);
   }
+  std::chrono::duration<double, std::milli> diff = std::chrono::steady_clock::now() - start;
+  EXPECT_LT(diff.count(), 10);
+
+  EXPECT_LT(PaceByPts(1, 25, 50, false), 1);  // realtime
+  EXPECT_LT(PaceByPts(4, 25, 100, false), 1);  // 4x speed
+  EXPECT_LT(PaceByPts(1, 25, 50, true), 1);  // variable frame rate
+}
+
+TEST(SourceFrController, ControlByPtsLongRun) {
+  // several streams share the pacing timer, 10s or more for each stream, the error does not accumulate
+  std::vector<std::thread> threads;
+  std::vector<double> errors(8, 0);
+  for (size_t i = 0; i < errors.size(); ++i) {
+    threads.emplace_back([&errors, i]() { errors[i] = PaceByPts(1, 25 + 5 * i, 250 + 50 * i, i % 2); });
+  }
+  for (auto &thread : threads) thread.join();
+  for (auto error : errors) {
+    EXPECT_LT(error, 1);
+  }
+}
+
+TEST(SourceFrController, ControlByPtsDecodeOrder) {
+  // packets of a stream with B-frames, in decode order, IPBB: 0 3 1 2 6 4 5 ..., 25fps at realtime
+  FrController fr_controller;
+  fr_controller.SetSpeed(1);
+  const uint64_t gap = 3600;
+  const uint64_t start_pts = 90000;
+  fr_controller.Control(start_pts);  // anchor
+  auto start = std::chrono::steady_clock::now();
+  uint64_t max_pts = start_pts;
+  double total_error = 0;
+  const uint32_t frame_num = 75;
+  for (uint32_t i = 1; i <= frame_num; ++i) {
+    uint32_t index = i % 3 == 1 ? i + 2 : i - 1;
+    uint64_t pts = start_pts + index * gap;
+    fr_controller.Control(pts);
+    max_pts = std::max(max_pts, pts);
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    // paced by the latest timestamp, not re-anchored by the B-frames
+    double expected = (max_pts - start_pts) / 90.0;
+    EXPECT_GE(elapsed.count(), expected);
+    total_error += elapsed.count() - expected;
+  }
+  EXPECT_LT(total_error / frame_num, 1);
+}
+
+TEST(SourceFrController, ControlByPtsJump) {
+  FrController fr_controller;
+  fr_controller.SetSpeed(1);
+  fr_controller.Control(90000 * 100);
+  auto start = std::chrono::steady_clock::now();
+  // backward and far forward jumps are re-anchored instead of waiting
+  fr_controller.Control(0);
+  fr_controller.Control(90000 * 1000);
+  std::chrono::duration<double, std::milli> diff = std::chrono::steady_clock::now() - start;
+  EXPECT_LT(diff.count(), 10);
+  fr_controller.Control(90000 * 1000 + 9000);
+  diff = std::chrono::steady_clock::now() - start;
+  EXPECT_GE(diff.count(), 100);
 }
 
 }  // namespace cnstream
@@ -22,6 +22,8 @@
 
 #include <chrono>
 #include <fstream>
+#include <iostream>
+#include <iterator>
 #include <memory>
 #include <string>
 #include <thread>
@@ -184,18 +186,25 @@ class SourceObserver : public IModuleObserver {
   void Reset() {
     get_eos.store(false);
     count.store(0);
+    ordered.store(true);
+    last_timestamp.store(-1);
   }
+  bool IsOrdered() { return ordered.load(); }
 
  private:
   void Notify(std::shared_ptr<CNFrameInfo> data) override {
     if (!data->IsEos()) {
       count++;
+      if (data->timestamp <= last_timestamp.load()) ordered = false;
+      last_timestamp.store(data->timestamp);
     } else {
       get_eos = true;
     }
   }
   std::atomic<int> count{0};
   std::atomic<bool> get_eos{false};
+  std::atomic<bool> ordered{true};
+  std::atomic<int64_t> last_timestamp{-1};
 };
 
 
@@ -295,6 +304,115 @@ TEST(DataHandlerFile, ProcessMlu) {
   }
 }
 
+TEST(DataHandlerFile, SampleBeforeDecode) {
+  SourceObserver observer;
+  ModuleParamSet param;
+  param["device_id"] = "0";
+  param["interval"] = "1";
+  DataSource src(gname);
+  src.SetObserver(&observer);
+  ASSERT_TRUE(src.Open(param));
+  std::string car_path = GetExePath() + "../../modules/unitest/data/cars_short.mp4";
+  std::string hevc_path = GetExePath() + "../../modules/unitest/data/265.mp4";
+
+  for (auto &path : {car_path, hevc_path}) {
+    double base_ms = 0;
+    int base_cnt = 0;
+    for (uint32_t stride : {1, 2, 3, 5}) {
+      FileSourceParam file_param;
+      file_param.filename = path;
+      file_param.framerate = 0;  // as fast as possible
+      file_param.max_res.width = 1920;
+      file_param.max_res.height = 1080;
+      file_param.sample_interval = stride;
+      auto handler = CreateSource(&src, "0", file_param);
+      auto start = std::chrono::steady_clock::now();
+      EXPECT_EQ(src.AddSource(handler), 0);
+      observer.Wait();
+      std::chrono::duration<double, std::milli> dura = std::chrono::steady_clock::now() - start;
+      src.RemoveSource(handler);
+      int cnt = observer.GetCnt();
+      observer.Reset();
+      if (stride == 1) {
+        base_ms = dura.count();
+        base_cnt = cnt;
+      } else {
+        // about one frame every `stride` frames
+        EXPECT_GT(cnt, 0);
+        EXPECT_LE(cnt, base_cnt / static_cast<int>(stride) + 1);
+      }
+      std::cout << "[ SAMPLE   ] " << path << " stride " << stride << ": " << cnt << " frames, " << dura.count()
+                << " ms (" << (base_ms > 0 ? dura.count() / base_ms : 1.0) << "x of stride 1)" << std::endl;
+    }
+  }
+  src.Close();
+}
+
+TEST(DataHandlerFile, PlaybackRange) {
+  SourceObserver observer;
+  ModuleParamSet param;
+  param["device_id"] = "0";
+  param["interval"] = "1";
+  DataSource src(gname);
+  src.SetObserver(&observer);
+  ASSERT_TRUE(src.Open(param));
+  std::string car_path = GetExePath() + "../../modules/unitest/data/cars_short.mp4";
+
+  auto run = [&](const FileSourceParam &file_param) {
+    auto handler = CreateSource(&src, "0", file_param);
+    EXPECT_EQ(src.AddSource(handler), 0);
+    observer.Wait();
+    src.RemoveSource(handler);
+    int cnt = observer.GetCnt();
+    observer.Reset();
+    return cnt;
+  };
+
+  FileSourceParam file_param;
+  file_param.filename = car_path;
+  file_param.framerate = 0;
+  file_param.max_res.width = 1920;
+  file_param.max_res.height = 1080;
+  int total = run(file_param);
+  EXPECT_EQ(total, 11);
+
+  {  // frames before start_frame are decoded but not sent
+    FileSourceParam range_param = file_param;
+    range_param.start_frame = 5;
+    EXPECT_EQ(run(range_param), total - 5);
+  }
+  {  // frames after end_frame are not sent
+    FileSourceParam range_param = file_param;
+    range_param.end_frame = 3;
+    EXPECT_EQ(run(range_param), 4);
+  }
+  {  // start time after the end of the file
+    FileSourceParam range_param = file_param;
+    range_param.start_time = 3600 * 1000;
+    EXPECT_EQ(run(range_param), 0);
+  }
+  {  // runtime seek
+    EXPECT_EQ(src.Seek("0", 0), -1);
+    FileSourceParam seek_param = file_param;
+    seek_param.framerate = 5;
+    seek_param.loop = true;
+    auto handler = CreateSource(&src, "0", seek_param);
+    EXPECT_EQ(src.AddSource(handler), 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    EXPECT_EQ(src.Seek("0", 100), 0);
+    EXPECT_EQ(src.Seek("0", -1), -1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    EXPECT_GT(observer.GetCnt(), 0);
+    EXPECT_EQ(src.Seek("0", 0), 0);  // seek backward
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    src.RemoveSource(handler);
+    observer.Wait();
+    EXPECT_TRUE(observer.IsOrdered());  // no pre-seek frame is sent and the timestamps keep increasing
+    observer.Reset();
+  }
+  src.Close();
+}
+
 static std::shared_ptr<SourceHandler> CreateRtspHandle(DataSource* src,
                                                        std::string rtsp_url,
                                                        std::string stream_id = "0",
@@ -330,6 +448,11 @@ TEST(DataHandlerRtsp, ProcessMlu) {
     auto handler = CreateRtspHandle(&src, rtsp_url, "0", 30, false, false);
     EXPECT_EQ(src.AddSource(handler), 0);
     std::this_thread::sleep_for(std::chrono::milliseconds(2000));
+    RtspStats stats;
+    EXPECT_EQ(GetRtspStats(handler, &stats), 0);
+    EXPECT_GE(stats.frames_received, stats.frames_dropped);
+    EXPECT_EQ(stats.decoder_recreate_count, 0u);
+    EXPECT_NE(GetRtspStats(handler, nullptr), 0);
     src.RemoveSource(handler);
     observer.Wait();
     handler->Stop();
@@ -723,6 +846,121 @@ TEST(DataHandlerEsJpegMem, ProcessMlu) {
   }
 }
 
+TEST(DataHandlerImageDir, ProcessMlu) {
+  ModuleParamSet param;
+  param["device_id"] = "0";
+  param["interval"] = "1";
+  SourceObserver observer;
+  DataSource src(gname);
+  ASSERT_TRUE(src.Open(param));
+  src.SetObserver(&observer);
+  std::string image_dir = GetExePath() + "../../data/images";
+
+  {  // frames are sent in the order of the files
+    ImageDirSourceParam dir_param;
+    dir_param.dir = image_dir;
+    dir_param.decode_threads = 4;
+    dir_param.out_res.width = 1280;
+    dir_param.out_res.height = 720;
+    auto handler = CreateSource(&src, "0", dir_param);
+    ASSERT_NE(handler, nullptr);
+    EXPECT_EQ(src.AddSource(handler), 0);
+    observer.Wait();
+    EXPECT_GT(observer.GetCnt(), 0);
+    EXPECT_TRUE(observer.IsOrdered());
+    src.RemoveSource(handler);
+    observer.Reset();
+  }
+  {  // file list, the resolution of the first image
+    ImageDirSourceParam dir_param;
+    dir_param.files = {image_dir + "/0.jpg", image_dir + "/not_exist.jpg", image_dir + "/1.jpg"};
+    auto handler = CreateSource(&src, "0", dir_param);
+    EXPECT_EQ(src.AddSource(handler), 0);
+    observer.Wait();
+    EXPECT_EQ(observer.GetCnt(), 2);
+    EXPECT_TRUE(observer.IsOrdered());
+    src.RemoveSource(handler);
+    observer.Reset();
+  }
+  {  // no image found
+    ImageDirSourceParam dir_param;
+    dir_param.dir = image_dir;
+    dir_param.suffix = ".no_such_suffix";
+    auto handler = CreateSource(&src, "0", dir_param);
+    EXPECT_NE(src.AddSource(handler), 0);
+  }
+  {  // empty directory
+    ImageDirSourceParam dir_param;
+    EXPECT_EQ(CreateSource(&src, "0", dir_param), nullptr);
+  }
+  src.Close();
+}
+
+TEST(DataHandlerImageDir, Throughput) {
+  ModuleParamSet param;
+  param["device_id"] = "0";
+  param["interval"] = "1";
+  SourceObserver observer;
+  DataSource src(gname);
+  ASSERT_TRUE(src.Open(param));
+  src.SetObserver(&observer);
+  std::string image_dir = GetExePath() + "../../data/images";
+  std::vector<std::string> files;
+  for (int i = 0; i < 20; ++i) files.push_back(image_dir + "/" + std::to_string(i) + ".jpg");
+  Resolution out_res;
+  out_res.width = 1280;
+  out_res.height = 720;
+
+  // baseline: read files in the feeding thread and decode them one by one
+  double jpeg_mem_fps = 0;
+  {
+    ESJpegMemSourceParam jpeg_param;
+    jpeg_param.max_res.width = 8192;
+    jpeg_param.max_res.height = 4320;
+    jpeg_param.out_res = out_res;
+    auto handler = CreateSource(&src, "0", jpeg_param);
+    ASSERT_EQ(src.AddSource(handler), 0);
+    auto start = std::chrono::steady_clock::now();
+    uint64_t pts = 0;
+    for (auto &file : files) {
+      std::ifstream in_stream(file, std::ifstream::binary);
+      std::vector<char> buf((std::istreambuf_iterator<char>(in_stream)), std::istreambuf_iterator<char>());
+      ESJpegPacket pkt;
+      pkt.data = reinterpret_cast<unsigned char *>(buf.data());
+      pkt.size = buf.size();
+      pkt.pts = pts++;
+      EXPECT_EQ(Write(handler, &pkt), 0);
+    }
+    ESJpegPacket pkt;
+    pkt.data = nullptr;
+    Write(handler, &pkt);
+    observer.Wait();
+    std::chrono::duration<double> dura = std::chrono::steady_clock::now() - start;
+    jpeg_mem_fps = observer.GetCnt() / dura.count();
+    src.RemoveSource(handler);
+    observer.Reset();
+  }
+
+  for (uint32_t threads : {1, 2, 4, 8}) {
+    ImageDirSourceParam dir_param;
+    dir_param.files = files;
+    dir_param.decode_threads = threads;
+    dir_param.out_res = out_res;
+    auto handler = CreateSource(&src, "0", dir_param);
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_EQ(src.AddSource(handler), 0);
+    observer.Wait();
+    std::chrono::duration<double> dura = std::chrono::steady_clock::now() - start;
+    EXPECT_EQ(observer.GetCnt(), static_cast<int>(files.size()));
+    EXPECT_TRUE(observer.IsOrdered());
+    std::cout << "[ IMAGES   ] image dir, " << threads << " decoding threads: " << observer.GetCnt() / dura.count()
+              << " images/s (esjpegmem: " << jpeg_mem_fps << " images/s)" << std::endl;
+    src.RemoveSource(handler);
+    observer.Reset();
+  }
+  src.Close();
+}
+
 static cnedk::BufSurfWrapperPtr GenerateBufsurface(std::string img_path, int device_id,
                           CnedkBufSurfaceColorFormat corlor_format = CNEDK_BUF_COLOR_FORMAT_NV21,
                           CnedkBufSurfaceMemType mem_type = CNEDK_BUF_MEM_DEVICE) {
@@ -0,0 +1,124 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "data_handler_util.hpp"
+
+namespace cnstream {
+
+static bool PushFrame(EsJitterBuffer *buffer, uint64_t pts, bool key) {
+  static std::vector<uint8_t> data = {0x00, 0x00, 0x00, 0x01, 0x65, 0x88};
+  ESPacket pkt;
+  pkt.data = data.data();
+  pkt.size = data.size();
+  pkt.pts = pts;
+  pkt.flags = key ? static_cast<size_t>(ESPacket::FLAG::FLAG_KEY_FRAME) : 0;
+  return buffer->Push(&pkt);
+}
+
+static VideoInfo MakeInfo(AVCodecID codec_id) {
+  VideoInfo info;
+  info.codec_id = codec_id;
+  info.progressive = 1;
+  info.extra_data = {0x00, 0x00, 0x00, 0x01, 0x67};
+  return info;
+}
+
+TEST(SourceJitterBuffer, StartFromKeyFrame) {
+  EsJitterBuffer buffer(8);
+  buffer.NewSession(MakeInfo(AV_CODEC_ID_H264));
+  EXPECT_FALSE(PushFrame(&buffer, 0, false));
+  EXPECT_TRUE(PushFrame(&buffer, 3600, true));
+  EXPECT_TRUE(PushFrame(&buffer, 7200, false));
+  EXPECT_EQ(buffer.Size(), 2u);
+  EXPECT_EQ(buffer.GetDroppedCount(), 1u);
+
+  EsJitterBuffer::Entry entry;
+  ASSERT_TRUE(buffer.Pop(10, &entry));
+  EXPECT_EQ(entry.pkt->pkt_.pts, 3600u);
+  // the stream info comes with the first packet of the session only
+  ASSERT_TRUE(entry.info != nullptr);
+  EXPECT_EQ(entry.info->codec_id, AV_CODEC_ID_H264);
+  ASSERT_TRUE(buffer.Pop(10, &entry));
+  EXPECT_EQ(entry.pkt->pkt_.pts, 7200u);
+  EXPECT_TRUE(entry.info == nullptr);
+  EXPECT_FALSE(buffer.Pop(10, &entry));
+}
+
+TEST(SourceJitterBuffer, DropUntilKeyFrameWhenFull) {
+  EsJitterBuffer buffer(4);
+  buffer.NewSession(MakeInfo(AV_CODEC_ID_H264));
+  EXPECT_TRUE(PushFrame(&buffer, 0, true));
+  for (uint64_t i = 1; i < 4; ++i) {
+    EXPECT_TRUE(PushFrame(&buffer, i, false));
+  }
+  // full, the push never blocks
+  EXPECT_FALSE(PushFrame(&buffer, 4, false));
+
+  EsJitterBuffer::Entry entry;
+  ASSERT_TRUE(buffer.Pop(10, &entry));
+  // there is room again, but the frames are dropped until the next key frame to keep the stream decodable
+  EXPECT_FALSE(PushFrame(&buffer, 5, false));
+  EXPECT_TRUE(PushFrame(&buffer, 6, true));
+  EXPECT_EQ(buffer.GetDroppedCount(), 2u);
+
+  uint64_t last_pts = 0;
+  while (buffer.Pop(10, &entry)) last_pts = entry.pkt->pkt_.pts;
+  EXPECT_EQ(last_pts, 6u);
+}
+
+TEST(SourceJitterBuffer, EosIsNeverDropped) {
+  EsJitterBuffer buffer(1);
+  EXPECT_TRUE(PushFrame(&buffer, 0, true));
+  ESPacket eos;
+  eos.flags = static_cast<size_t>(ESPacket::FLAG::FLAG_EOS);
+  EXPECT_TRUE(buffer.Push(&eos));
+
+  EsJitterBuffer::Entry entry;
+  ASSERT_TRUE(buffer.Pop(10, &entry));
+  ASSERT_TRUE(buffer.Pop(10, &entry));
+  EXPECT_TRUE(entry.pkt->pkt_.flags & static_cast<size_t>(ESPacket::FLAG::FLAG_EOS));
+}
+
+TEST(SourceJitterBuffer, NewSession) {
+  EsJitterBuffer buffer(8);
+  buffer.NewSession(MakeInfo(AV_CODEC_ID_H264));
+  EXPECT_TRUE(PushFrame(&buffer, 0, true));
+  EXPECT_TRUE(PushFrame(&buffer, 1, false));
+
+  // reconnected, the new session waits for its key frame and carries its own stream info
+  buffer.NewSession(MakeInfo(AV_CODEC_ID_HEVC));
+  EXPECT_FALSE(PushFrame(&buffer, 2, false));
+  EXPECT_TRUE(PushFrame(&buffer, 3, true));
+
+  EsJitterBuffer::Entry entry;
+  std::vector<AVCodecID> infos;
+  while (buffer.Pop(10, &entry)) {
+    if (entry.info) infos.push_back(entry.info->codec_id);
+  }
+  ASSERT_EQ(infos.size(), 2u);
+  EXPECT_EQ(infos[0], AV_CODEC_ID_H264);
+  EXPECT_EQ(infos[1], AV_CODEC_ID_HEVC);
+}
+
+}  // namespace cnstream
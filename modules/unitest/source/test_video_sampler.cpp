@@ -0,0 +1,160 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "video_sampler.hpp"
+
+namespace cnstream {
+
+// first_mb_in_slice = 0, slice_type = 7 (I), 5 (P), 6 (B)
+static std::vector<uint8_t> kH264Idr = {0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0x00, 0x1e,
+                                        0x00, 0x00, 0x00, 0x01, 0x68, 0xce, 0x38, 0x80,
+                                        0x00, 0x00, 0x00, 0x01, 0x65, 0x88, 0x84, 0x00};
+static std::vector<uint8_t> kH264RefP = {0x00, 0x00, 0x00, 0x01, 0x41, 0x98, 0x21, 0x00};
+static std::vector<uint8_t> kH264NonRefB = {0x00, 0x00, 0x00, 0x01, 0x01, 0x9c, 0x42, 0x00};
+
+// nal header: (type << 1), (layer id = 0, temporal_id_plus1)
+static std::vector<uint8_t> kH265Sps = {0x00, 0x00, 0x00, 0x01, 0x42, 0x01, 0x03, 0x01};  // max_sub_layers = 2
+static std::vector<uint8_t> kH265Idr = {0x00, 0x00, 0x01, 0x26, 0x01, 0xaf, 0x00};           // IDR_W_RADL
+static std::vector<uint8_t> kH265TrailR = {0x00, 0x00, 0x01, 0x02, 0x01, 0xd0, 0x00};        // TRAIL_R, tid 0
+static std::vector<uint8_t> kH265TrailNTid0 = {0x00, 0x00, 0x01, 0x00, 0x01, 0xd0, 0x00};    // TRAIL_N, tid 0
+static std::vector<uint8_t> kH265TrailNTid1 = {0x00, 0x00, 0x01, 0x00, 0x02, 0xd0, 0x00};    // TRAIL_N, tid 1
+
+TEST(SourceVideoSampler, ParseH264) {
+  EsFrameInfo info;
+  EXPECT_TRUE(VideoSampler::ParseH264(kH264Idr.data(), kH264Idr.size(), &info));
+  EXPECT_TRUE(info.has_vcl);
+  EXPECT_TRUE(info.has_param_set);
+  EXPECT_TRUE(info.is_idr);
+  EXPECT_TRUE(info.is_intra);
+
+  info = EsFrameInfo();
+  EXPECT_TRUE(VideoSampler::ParseH264(kH264RefP.data(), kH264RefP.size(), &info));
+  EXPECT_TRUE(info.is_reference);
+  EXPECT_FALSE(info.is_intra);
+
+  info = EsFrameInfo();
+  EXPECT_TRUE(VideoSampler::ParseH264(kH264NonRefB.data(), kH264NonRefB.size(), &info));
+  EXPECT_FALSE(info.is_reference);
+  EXPECT_FALSE(info.is_intra);
+  EXPECT_FALSE(info.has_param_set);
+
+  info = EsFrameInfo();
+  EXPECT_FALSE(VideoSampler::ParseH264(nullptr, 0, &info));
+}
+
+TEST(SourceVideoSampler, ParseH265) {
+  EsFrameInfo info;
+  EXPECT_TRUE(VideoSampler::ParseH265(kH265Sps.data(), kH265Sps.size(), &info));
+  EXPECT_TRUE(info.has_param_set);
+  EXPECT_EQ(info.max_temporal_id, 1);
+
+  info = EsFrameInfo();
+  EXPECT_TRUE(VideoSampler::ParseH265(kH265Idr.data(), kH265Idr.size(), &info));
+  EXPECT_TRUE(info.is_idr);
+  EXPECT_TRUE(info.is_reference);
+
+  info = EsFrameInfo();
+  EXPECT_TRUE(VideoSampler::ParseH265(kH265TrailNTid1.data(), kH265TrailNTid1.size(), &info));
+  EXPECT_FALSE(info.is_reference);
+  EXPECT_EQ(info.temporal_id, 1);
+}
+
+TEST(SourceVideoSampler, Disabled) {
+  VideoSampler sampler;
+  sampler.SetCodec(AV_CODEC_ID_H264);
+  sampler.SetInterval(1);
+  EXPECT_FALSE(sampler.Enabled());
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(sampler.Sample(kH264NonRefB.data(), kH264NonRefB.size()), VideoSampler::Decision::DECODE);
+  }
+  EXPECT_FALSE(sampler.SetFramerate(0, 25));
+}
+
+TEST(SourceVideoSampler, StrideH264) {
+  for (uint32_t stride : {2, 3, 5}) {
+    VideoSampler sampler;
+    sampler.SetCodec(AV_CODEC_ID_H264);
+    sampler.SetInterval(stride);
+    ASSERT_TRUE(sampler.Enabled());
+    // I P B B P B B ... in decoding order
+    uint32_t total = 300;
+    uint32_t decoded = 0;
+    for (uint32_t i = 0; i < total; ++i) {
+      const std::vector<uint8_t> &au = (i % 30 == 0) ? kH264Idr : (i % 3 == 1 ? kH264RefP : kH264NonRefB);
+      VideoSampler::Decision decision = sampler.Sample(au.data(), au.size());
+      if (&au != &kH264NonRefB) {
+        // reference frames are never dropped
+        EXPECT_NE(decision, VideoSampler::Decision::DROP);
+      }
+      if (i == 0) {
+        EXPECT_EQ(decision, VideoSampler::Decision::DECODE);
+      }
+      if (decision != VideoSampler::Decision::DROP) ++decoded;
+    }
+    EXPECT_NEAR(sampler.GetSampledCount(), total / stride, 1);
+    EXPECT_EQ(sampler.GetSampledCount() + sampler.GetDecodeOnlyCount() + sampler.GetDroppedCount(), total);
+    EXPECT_EQ(decoded, sampler.GetSampledCount() + sampler.GetDecodeOnlyCount());
+    // all reference frames (1/3) plus part of the sampled ones
+    EXPECT_LT(decoded, total);
+    EXPECT_GE(decoded, total / 3);
+  }
+}
+
+TEST(SourceVideoSampler, Framerate) {
+  VideoSampler sampler;
+  sampler.SetCodec(AV_CODEC_ID_H264);
+  ASSERT_TRUE(sampler.SetFramerate(5, 25));
+  uint32_t total = 250;
+  for (uint32_t i = 0; i < total; ++i) {
+    const std::vector<uint8_t> &au = (i % 2) ? kH264NonRefB : kH264RefP;
+    sampler.Sample(au.data(), au.size());
+  }
+  EXPECT_NEAR(sampler.GetSampledCount(), 50, 1);
+}
+
+TEST(SourceVideoSampler, TemporalLayersH265) {
+  VideoSampler sampler;
+  sampler.SetCodec(AV_CODEC_ID_HEVC);
+  sampler.SetInterval(4);
+  std::vector<uint8_t> first = kH265Sps;
+  first.insert(first.end(), kH265Idr.begin(), kH265Idr.end());
+  EXPECT_EQ(sampler.Sample(first.data(), first.size()), VideoSampler::Decision::DECODE);
+  for (int i = 0; i < 40; ++i) {
+    // a sub-layer non-reference picture of the lower sub-layer is referenced by the higher sub-layer
+    EXPECT_NE(sampler.Sample(kH265TrailNTid0.data(), kH265TrailNTid0.size()), VideoSampler::Decision::DROP);
+    sampler.Sample(kH265TrailR.data(), kH265TrailR.size());
+    sampler.Sample(kH265TrailNTid1.data(), kH265TrailNTid1.size());
+  }
+  EXPECT_GT(sampler.GetDroppedCount(), 0u);
+}
+
+TEST(SourceVideoSampler, Discard) {
+  VideoSampler sampler;
+  sampler.MarkDiscard(3003);
+  EXPECT_FALSE(sampler.CheckDiscard(6006));
+  EXPECT_TRUE(sampler.CheckDiscard(3003));
+  EXPECT_FALSE(sampler.CheckDiscard(3003));
+}
+
+}  // namespace cnstream
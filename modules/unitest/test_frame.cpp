@@ -117,6 +117,12 @@ TEST(CoreFrame, InferObjGetAttribute) {
   EXPECT_EQ(infer_attr.id, value.id);
   EXPECT_EQ(infer_attr.value, value.value);
   EXPECT_EQ(infer_attr.score, value.score);
+
+  // get all attributes
+  auto attributes = infer_obj.GetAttributes();
+  ASSERT_EQ(attributes.size(), 1u);
+  EXPECT_EQ(attributes[0].first, key);
+  EXPECT_EQ(attributes[0].second.score, value.score);
 }
 
 TEST(CoreFrame, InferObjAddExtraAttribute) {
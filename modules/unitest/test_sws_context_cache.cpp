@@ -0,0 +1,128 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <libswscale/swscale.h>
+#ifdef __cplusplus
+}
+#endif
+
+#include "sws_context_cache.hpp"
+
+namespace cnstream {
+
+TEST(SwsContextCache, HitAndEvict) {
+  SwsContextCache &cache = SwsContextCache::Instance();
+  cache.Clear();
+  cache.SetCapacity(2);
+  SwsContextCache::ResetStats();
+
+  SwsContext *a = cache.Get(64, 64, AV_PIX_FMT_NV12, 32, 32, AV_PIX_FMT_BGR24, SWS_BILINEAR);
+  ASSERT_NE(a, nullptr);
+  EXPECT_EQ(cache.Get(64, 64, AV_PIX_FMT_NV12, 32, 32, AV_PIX_FMT_BGR24, SWS_BILINEAR), a);
+  // flags are part of the key
+  SwsContext *b = cache.Get(64, 64, AV_PIX_FMT_NV12, 32, 32, AV_PIX_FMT_BGR24, SWS_FAST_BILINEAR);
+  ASSERT_NE(b, nullptr);
+  EXPECT_NE(a, b);
+  EXPECT_EQ(cache.Size(), 2u);
+
+  // a is the most recently used one, b is evicted
+  EXPECT_EQ(cache.Get(64, 64, AV_PIX_FMT_NV12, 32, 32, AV_PIX_FMT_BGR24, SWS_BILINEAR), a);
+  ASSERT_NE(cache.Get(128, 64, AV_PIX_FMT_NV12, 32, 32, AV_PIX_FMT_BGR24, SWS_BILINEAR), nullptr);
+  EXPECT_EQ(cache.Size(), 2u);
+  EXPECT_EQ(cache.Get(64, 64, AV_PIX_FMT_NV12, 32, 32, AV_PIX_FMT_BGR24, SWS_BILINEAR), a);
+
+  SwsCacheStats stats = SwsContextCache::GetStats();
+  EXPECT_EQ(stats.hits, 3u);
+  EXPECT_EQ(stats.misses, 3u);
+  EXPECT_EQ(stats.evictions, 1u);
+
+  EXPECT_EQ(cache.Get(0, 0, AV_PIX_FMT_NV12, 32, 32, AV_PIX_FMT_BGR24, SWS_BILINEAR), nullptr);
+  cache.SetCapacity(SwsContextCache::kDefaultCapacity);
+  cache.Clear();
+}
+
+TEST(SwsContextCache, PerThread) {
+  SwsContext *main_ctx = SwsContextCache::Instance().Get(64, 64, AV_PIX_FMT_NV12, 32, 32, AV_PIX_FMT_BGR24,
+                                                         SWS_BILINEAR);
+  SwsContext *thread_ctx = nullptr;
+  std::thread t([&]() {
+    thread_ctx = SwsContextCache::Instance().Get(64, 64, AV_PIX_FMT_NV12, 32, 32, AV_PIX_FMT_BGR24, SWS_BILINEAR);
+    EXPECT_EQ(SwsContextCache::Instance().Size(), 1u);
+  });
+  t.join();
+  EXPECT_NE(main_ctx, nullptr);
+  EXPECT_NE(thread_ctx, nullptr);
+  EXPECT_NE(main_ctx, thread_ctx);
+  SwsContextCache::Instance().Clear();
+}
+
+// Compares the conversion with a new context for each call against the cached context.
+TEST(SwsContextCache, Benchmark) {
+  struct Case {
+    int src_w, src_h, dst_w, dst_h;
+  };
+  std::vector<Case> cases = {{64, 128, 32, 64}, {256, 256, 128, 128}, {1920, 1080, 416, 416}, {1920, 1080, 1920, 1080}};
+  for (const auto &c : cases) {
+    std::vector<uint8_t> src(c.src_w * c.src_h * 3 / 2, 128);
+    std::vector<uint8_t> dst(c.dst_w * c.dst_h * 3);
+    uint8_t *src_data[4] = {src.data(), src.data() + c.src_w * c.src_h, nullptr, nullptr};
+    int src_linesize[4] = {c.src_w, c.src_w, 0, 0};
+    uint8_t *dst_data[4] = {dst.data(), nullptr, nullptr, nullptr};
+    int dst_linesize[4] = {c.dst_w * 3, 0, 0, 0};
+    int loop = c.src_w * c.src_h > 1000000 ? 20 : 200;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < loop; ++i) {
+      SwsContext *ctx = sws_getContext(c.src_w, c.src_h, AV_PIX_FMT_NV12, c.dst_w, c.dst_h, AV_PIX_FMT_BGR24,
+                                       SWS_BILINEAR, nullptr, nullptr, nullptr);
+      ASSERT_NE(ctx, nullptr);
+      sws_scale(ctx, src_data, src_linesize, 0, c.src_h, dst_data, dst_linesize);
+      sws_freeContext(ctx);
+    }
+    double uncached = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < loop; ++i) {
+      SwsContext *ctx = SwsContextCache::Instance().Get(c.src_w, c.src_h, AV_PIX_FMT_NV12, c.dst_w, c.dst_h,
+                                                        AV_PIX_FMT_BGR24, SWS_BILINEAR);
+      ASSERT_NE(ctx, nullptr);
+      sws_scale(ctx, src_data, src_linesize, 0, c.src_h, dst_data, dst_linesize);
+    }
+    double cached = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "NV12 " << c.src_w << "x" << c.src_h << " -> BGR24 " << c.dst_w << "x" << c.dst_h
+              << ": uncached " << uncached / loop << " us, cached " << cached / loop << " us" << std::endl;
+  }
+  SwsCacheStats stats = SwsContextCache::GetStats();
+  std::cout << "SwsContextCache hits " << stats.hits << ", misses " << stats.misses << std::endl;
+  SwsContextCache::Instance().Clear();
+}
+
+}  // namespace cnstream
@@ -0,0 +1,161 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "tensor_buffer_pool.hpp"
+
+namespace cnstream {
+
+TEST(TensorBufferPool, BucketSize) {
+  EXPECT_EQ(TensorBufferPool::BucketSize(0), TensorBufferPool::kMinBlockSize);
+  EXPECT_EQ(TensorBufferPool::BucketSize(4096), 4096u);
+  EXPECT_EQ(TensorBufferPool::BucketSize(4097), 5120u);
+  EXPECT_EQ(TensorBufferPool::BucketSize(8192), 8192u);
+  // 640 x 640 x 3 float
+  EXPECT_EQ(TensorBufferPool::BucketSize(4915200), 5242880u);
+  for (size_t size = 1; size < (64 << 20); size = size * 3 / 2 + 1) {
+    size_t bucket = TensorBufferPool::BucketSize(size);
+    EXPECT_GE(bucket, size);
+    if (size > TensorBufferPool::kMinBlockSize) {
+      EXPECT_LE(bucket, size + size / 4 + 1);
+    }
+  }
+}
+
+TEST(TensorBufferPool, Reuse) {
+  TensorBufferPool pool;
+  {
+    TensorBuffer a = pool.Borrow(1000);
+    ASSERT_TRUE(a);
+    EXPECT_EQ(a.Size(), 1000u);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(a.Data()) % TensorBufferPool::kAlignment, 0u);
+    TensorBuffer b = std::move(a);
+    EXPECT_FALSE(a);
+    ASSERT_TRUE(b);
+  }
+  // the same bucket, the block returned is borrowed again
+  for (int i = 0; i < 100; ++i) {
+    TensorBuffer buffer = pool.Borrow(4000);
+    ASSERT_TRUE(buffer);
+    memset(buffer.Data(), i, buffer.Size());
+  }
+  TensorPoolStats stats = pool.GetStats();
+  EXPECT_EQ(stats.borrows, 101u);
+  EXPECT_EQ(stats.allocations, 1u);
+  EXPECT_EQ(stats.reuses, 100u);
+  EXPECT_EQ(stats.cached_bytes, 4096u);
+  EXPECT_EQ(stats.owned_bytes, 4096u);
+
+  pool.Trim();
+  stats = pool.GetStats();
+  EXPECT_EQ(stats.cached_bytes, 0u);
+  EXPECT_EQ(stats.owned_bytes, 0u);
+}
+
+TEST(TensorBufferPool, SteadyStateBatches) {
+  TensorBufferPool pool;
+  pool.Reserve(640 * 640 * 3 * 4, 2);
+  pool.ResetStats();
+  // batches of a pipeline of depth 2 with a varying number of objects, only the first scratch buffer is allocated
+  std::vector<TensorBuffer> in_flight;
+  for (int batch = 0; batch < 200; ++batch) {
+    in_flight.push_back(pool.Borrow(640 * 640 * 3 * 4));
+    for (int obj = 0; obj < batch % 8; ++obj) {
+      TensorBuffer scratch = pool.Borrow(6 * (224 + 224) * 4 + 3 * 224 * 4 + 3 * 224);
+      ASSERT_TRUE(scratch);
+    }
+    if (in_flight.size() == 2) in_flight.erase(in_flight.begin());
+  }
+  in_flight.clear();
+  TensorPoolStats stats = pool.GetStats();
+  EXPECT_EQ(stats.allocations, 1u);
+  EXPECT_EQ(stats.borrows, stats.reuses + stats.allocations);
+}
+
+TEST(TensorBufferPool, MaxCachedBytes) {
+  TensorBufferPool::Params params;
+  params.max_cached_bytes = 8192;
+  TensorBufferPool pool(params);
+  {
+    std::vector<TensorBuffer> buffers;
+    for (int i = 0; i < 4; ++i) buffers.push_back(pool.Borrow(4096));
+  }
+  TensorPoolStats stats = pool.GetStats();
+  EXPECT_EQ(stats.allocations, 4u);
+  EXPECT_EQ(stats.cached_bytes, 8192u);
+  EXPECT_EQ(stats.owned_bytes, 8192u);
+}
+
+TEST(TensorBufferPool, ReturnedByAnotherThread) {
+  TensorBufferPool pool;
+  TensorBuffer buffer = pool.Borrow(1 << 20);
+  void *data = buffer.Data();
+  std::thread t([&buffer]() { buffer.Reset(); });
+  t.join();
+  EXPECT_EQ(pool.Borrow(1 << 20).Data(), data);
+}
+
+TEST(TensorBufferPool, HugePage) {
+  TensorBufferPool::Params params;
+  params.hugepage = true;
+  TensorBufferPool pool(params);
+  // huge pages are not reserved on most hosts, then transparent huge pages are used
+  TensorBuffer buffer = pool.Borrow(3 << 20);
+  ASSERT_TRUE(buffer);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(buffer.Data()) % TensorBufferPool::kAlignment, 0u);
+  memset(buffer.Data(), 1, buffer.Size());
+  buffer.Reset();
+  // small blocks are never backed by huge pages
+  TensorBuffer small = pool.Borrow(4096);
+  ASSERT_TRUE(small);
+  EXPECT_LE(pool.GetStats().hugepage_allocations, 1u);
+}
+
+TEST(TensorArena, Layout) {
+  TensorBufferPool pool;
+  TensorArena nchw(4, 3, 8, 16, sizeof(float), TensorArena::Layout::NCHW, &pool);
+  ASSERT_TRUE(nchw.Valid());
+  EXPECT_EQ(nchw.ItemSize(), 3u * 8 * 16 * sizeof(float));
+  EXPECT_EQ(nchw.Size(), nchw.ItemSize() * 4);
+  EXPECT_EQ(static_cast<uint8_t *>(nchw.Item(2)) - static_cast<uint8_t *>(nchw.Data()),
+            static_cast<ptrdiff_t>(nchw.ItemSize() * 2));
+  EXPECT_EQ(nchw.Offset(1, 2, 3, 4), ((1u * 3 + 2) * 8 + 3) * 16 + 4);
+
+  TensorArena nhwc(4, 3, 8, 16, sizeof(uint8_t), TensorArena::Layout::NHWC, &pool);
+  ASSERT_TRUE(nhwc.Valid());
+  EXPECT_EQ(nhwc.Offset(1, 2, 3, 4), ((1u * 8 + 3) * 16 + 4) * 3 + 2);
+  EXPECT_EQ(nhwc.Offset(1, 0, 0, 0) * sizeof(uint8_t), nhwc.ItemSize());
+
+  // the arena of the next batch reuses the block
+  nchw = TensorArena(4, 3, 8, 16, sizeof(float), TensorArena::Layout::NCHW, &pool);
+  EXPECT_EQ(pool.GetStats().allocations, 3u);
+  TensorArena next(4, 3, 8, 16, sizeof(float), TensorArena::Layout::NCHW, &pool);
+  EXPECT_EQ(pool.GetStats().allocations, 3u);
+}
+
+}  // namespace cnstream
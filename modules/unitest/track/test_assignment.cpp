@@ -0,0 +1,129 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "easytrack/src/assignment.h"
+
+namespace cnstream {
+
+namespace {
+
+// costs in [0, 1), entries above gate replaced by the sentinel gate + 1e-5 as the tracker does
+Matrix RandomCost(int rows, int cols, float gate, bool integral, std::mt19937 *rng) {
+  std::uniform_real_distribution<float> dist(0.f, 1.f);
+  Matrix cost(rows, cols);
+  for (int r = 0; r < rows; ++r) {
+    for (int c = 0; c < cols; ++c) {
+      float v = integral ? static_cast<int>(dist(*rng) * 8) / 8.f : dist(*rng);
+      cost(r, c) = v > gate ? gate + 1e-5f : v;
+    }
+  }
+  return cost;
+}
+
+// checks the assignment is complete and one-to-one, returns its cost
+double CheckAssignment(const Matrix &cost, const std::vector<int> &assignment) {
+  EXPECT_EQ(assignment.size(), cost.Rows());
+  std::vector<int> col_used(cost.Cols(), 0);
+  double sum = 0;
+  uint32_t assigned = 0;
+  for (uint32_t r = 0; r < assignment.size(); ++r) {
+    if (assignment[r] < 0) continue;
+    EXPECT_LT(assignment[r], static_cast<int>(cost.Cols()));
+    EXPECT_EQ(col_used[assignment[r]]++, 0);
+    sum += cost(r, assignment[r]);
+    ++assigned;
+  }
+  EXPECT_EQ(assigned, std::min(cost.Rows(), cost.Cols()));
+  return sum;
+}
+
+}  // namespace
+
+TEST(Assignment, SameCostAsHungarian) {
+  std::mt19937 rng(7);
+  auto hungarian = AssignmentSolver::Create(AssignmentMethod::HUNGARIAN);
+  auto lapjv = AssignmentSolver::Create(AssignmentMethod::LAPJV);
+  auto greedy = AssignmentSolver::Create(AssignmentMethod::GREEDY);
+  std::uniform_int_distribution<int> size_dist(1, 40);
+  std::vector<int> expected, assignment;
+  for (int i = 0; i < 300; ++i) {
+    int rows = size_dist(rng);
+    int cols = i % 3 ? size_dist(rng) : rows;
+    float gate = i % 2 ? 0.3f : 2.f;
+    Matrix cost = RandomCost(rows, cols, gate, i % 5 == 0, &rng);
+    hungarian->Solve(cost, &expected);
+    double optimal = CheckAssignment(cost, expected);
+    lapjv->Solve(cost, &assignment);
+    EXPECT_NEAR(CheckAssignment(cost, assignment), optimal, 1e-4) << rows << "x" << cols;
+    greedy->Solve(cost, &assignment);
+    EXPECT_GE(CheckAssignment(cost, assignment), optimal - 1e-4);
+  }
+
+  // unique optimum
+  Matrix cost(3, 4);
+  float values[3][4] = {{4, 1, 3, 9}, {2, 0, 5, 9}, {3, 2, 2, 9}};
+  for (int r = 0; r < 3; ++r) {
+    for (int c = 0; c < 4; ++c) cost(r, c) = values[r][c];
+  }
+  lapjv->Solve(cost, &assignment);
+  EXPECT_EQ(assignment, std::vector<int>({1, 0, 2}));
+  // the greedy takes the pair of cost 0 first
+  greedy->Solve(cost, &assignment);
+  EXPECT_EQ(assignment, std::vector<int>({0, 1, 2}));
+
+  Matrix empty(0, 4);
+  lapjv->Solve(empty, &assignment);
+  EXPECT_TRUE(assignment.empty());
+}
+
+TEST(Assignment, Benchmark) {
+  // 300 tracks and 300 detections, most pairs gated
+  constexpr int kSize = 300;
+  constexpr int kRounds = 5;
+  std::mt19937 rng(11);
+  Matrix cost = RandomCost(kSize, kSize, 0.2f, false, &rng);
+  using Clock = std::chrono::steady_clock;
+  const AssignmentMethod methods[] = {AssignmentMethod::HUNGARIAN, AssignmentMethod::LAPJV, AssignmentMethod::GREEDY};
+  const char *names[] = {"hungarian", "lapjv", "greedy"};
+  double costs[3], ms[3];
+  std::vector<int> assignment;
+  for (int m = 0; m < 3; ++m) {
+    auto solver = AssignmentSolver::Create(methods[m]);
+    auto start = Clock::now();
+    for (int i = 0; i < kRounds; ++i) solver->Solve(cost, &assignment);
+    ms[m] = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / kRounds;
+    costs[m] = CheckAssignment(cost, assignment);
+  }
+  EXPECT_NEAR(costs[1], costs[0], 1e-3);
+  EXPECT_GE(costs[2], costs[0] - 1e-3);
+  for (int m = 0; m < 3; ++m) {
+    std::cout << "[ Assignment ] " << kSize << "x" << kSize << " " << names[m] << ": " << ms[m] << " ms, cost "
+              << costs[m] << std::endl;
+  }
+}
+
+}  // namespace cnstream
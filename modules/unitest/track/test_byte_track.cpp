@@ -0,0 +1,161 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "easytrack/include/easy_track.h"
+
+namespace cnstream {
+
+namespace {
+
+DetectObject MakeDetection(float x, float y, float score) {
+  DetectObject det;
+  det.label = 0;
+  det.score = score;
+  det.bbox = {x, y, 0.04f, 0.1f};
+  det.track_id = -1;
+  det.detect_id = -1;
+  return det;
+}
+
+// a trace of objects moving linearly, missed on 5% of the frames and of low score on 10%, objects id in track_id
+std::vector<Objects> MakeTrace(int object_num, int frame_num) {
+  std::mt19937 rng(3);
+  std::uniform_real_distribution<float> u(0.f, 1.f);
+  std::normal_distribution<float> n(0.f, 0.001f);
+  struct Motion { float x, y, vx, vy; };
+  std::vector<Motion> motions(object_num);
+  for (auto &m : motions) m = {u(rng) * 0.9f, u(rng) * 0.85f, (u(rng) - 0.5f) * 0.004f, (u(rng) - 0.5f) * 0.004f};
+  std::vector<Objects> trace(frame_num);
+  for (auto &frame : trace) {
+    for (int i = 0; i < object_num; ++i) {
+      Motion &m = motions[i];
+      m.x += m.vx;
+      m.y += m.vy;
+      float p = u(rng);
+      if (p < 0.05f) continue;
+      frame.push_back(MakeDetection(m.x + n(rng), m.y + n(rng), p < 0.15f ? 0.3f : 0.9f));
+      frame.back().track_id = i;
+    }
+  }
+  return trace;
+}
+
+// the detections of score above thresh, as a detector with a higher threshold
+std::vector<Objects> FilterTrace(const std::vector<Objects> &trace, float thresh) {
+  std::vector<Objects> filtered(trace.size());
+  for (size_t i = 0; i < trace.size(); ++i) {
+    for (auto &det : trace[i]) {
+      if (det.score >= thresh) filtered[i].push_back(det);
+    }
+  }
+  return filtered;
+}
+
+// replays the trace, returns ms/frame, and the number of switches of the track of an object
+double Replay(EasyTrack *tracker, const std::vector<Objects> &trace, int *id_switches, int *tracked) {
+  std::map<int, int> track_of_object;
+  *id_switches = 0;
+  *tracked = 0;
+  double total = 0;
+  for (auto &detects : trace) {
+    Objects tracks;
+    auto start = std::chrono::steady_clock::now();
+    tracker->UpdateFrame(detects, &tracks);
+    total += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    for (auto &obj : tracks) {
+      if (obj.track_id < 0) continue;
+      ++*tracked;
+      int object = detects[obj.detect_id].track_id;
+      auto iter = track_of_object.find(object);
+      if (iter != track_of_object.end() && iter->second != obj.track_id) ++*id_switches;
+      track_of_object[object] = obj.track_id;
+    }
+  }
+  return total / trace.size();
+}
+
+}  // namespace
+
+TEST(ByteTrack, LowScoreDetections) {
+  ByteTrack tracker;
+  tracker.SetParams(0.5, 0.1, 0.8, 30, 1);
+  Objects tracks;
+  // confirmed on the second frame
+  tracker.UpdateFrame({MakeDetection(0.1f, 0.1f, 0.9f)}, &tracks);
+  ASSERT_EQ(tracks.size(), 1u);
+  EXPECT_EQ(tracks[0].track_id, -1);
+  tracks.clear();
+  tracker.UpdateFrame({MakeDetection(0.101f, 0.1f, 0.9f)}, &tracks);
+  ASSERT_EQ(tracks.size(), 1u);
+  int track_id = tracks[0].track_id;
+  EXPECT_GE(track_id, 0);
+
+  // occluded, of low score, kept by the second association, and a new object of low score not tracked
+  for (int i = 2; i < 10; ++i) {
+    tracks.clear();
+    tracker.UpdateFrame({MakeDetection(0.1f + 0.001f * i, 0.1f, 0.3f), MakeDetection(0.6f, 0.6f, 0.3f)}, &tracks);
+    ASSERT_EQ(tracks.size(), 2u);
+    EXPECT_EQ(tracks[0].track_id, track_id);
+    EXPECT_EQ(tracks[0].detect_id, 0);
+    EXPECT_EQ(tracks[1].track_id, -1);
+  }
+  tracks.clear();
+  tracker.UpdateFrame({MakeDetection(0.11f, 0.1f, 0.9f)}, &tracks);
+  EXPECT_EQ(tracks[0].track_id, track_id);
+
+  // lost for a few frames, recovered by the first association
+  for (int i = 0; i < 3; ++i) {
+    tracks.clear();
+    tracker.UpdateFrame({}, &tracks);
+    EXPECT_TRUE(tracks.empty());
+  }
+  tracks.clear();
+  tracker.UpdateFrame({MakeDetection(0.11f, 0.1f, 0.9f)}, &tracks);
+  EXPECT_EQ(tracks[0].track_id, track_id);
+}
+
+TEST(ByteTrack, Benchmark) {
+  // 200 objects on 300 frames, the trace replayed by ByteTrack, and by FeatureMatchTrack without features as
+  // IoUMatch, which is fed the detections of high score only
+  auto trace = MakeTrace(200, 300);
+  int byte_switches = 0, byte_tracked = 0, iou_switches = 0, iou_tracked = 0;
+  ByteTrack byte_track;
+  double byte_ms = Replay(&byte_track, trace, &byte_switches, &byte_tracked);
+  FeatureMatchTrack iou_track;
+  iou_track.SetParams(0.2, 100, 0.7, 30, 3);
+  double iou_ms = Replay(&iou_track, FilterTrace(trace, 0.5), &iou_switches, &iou_tracked);
+
+  // the low score detections are tracked as well
+  EXPECT_GT(byte_tracked, iou_tracked);
+  EXPECT_LT(byte_switches, 200);
+  std::cout << "[ ByteTrack ] 200 objects: ByteTrack " << byte_ms << " ms/frame, " << byte_switches
+            << " id switches, " << byte_tracked << " tracked; IoUMatch " << iou_ms << " ms/frame, " << iou_switches
+            << " id switches, " << iou_tracked << " tracked" << std::endl;
+}
+
+}  // namespace cnstream
@@ -0,0 +1,259 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "easytrack/src/feature_gallery.h"
+
+namespace cnstream {
+
+namespace {
+
+std::vector<float> RandomFeature(int dim, std::mt19937 *rng) {
+  std::normal_distribution<float> dist(0.f, 1.f);
+  std::vector<float> feature(dim);
+  for (auto &v : feature) v = dist(*rng);
+  return feature;
+}
+
+// the cosine similarity formerly computed for each pair of features
+float ReferenceSimilarity(const std::vector<float> &a, const std::vector<float> &b) {
+  double ab = 0, aa = 0, bb = 0;
+  for (size_t i = 0; i < a.size(); ++i) {
+    ab += a[i] * b[i];
+    aa += a[i] * a[i];
+    bb += b[i] * b[i];
+  }
+  if (aa == 0 || bb == 0) return 0;
+  return std::min(1.0, std::max(0.0, ab / std::sqrt(aa * bb)));
+}
+
+}  // namespace
+
+TEST(FeatureGallery, DotProduct) {
+  std::mt19937 rng(1);
+  std::uniform_int_distribution<int> int8_dist(-127, 127);
+  for (int dim : {1, 7, 8, 15, 16, 17, 33, 128, 255, 512}) {
+    std::vector<float> a = RandomFeature(dim, &rng), b = RandomFeature(dim, &rng);
+    double expected = 0;
+    for (int i = 0; i < dim; ++i) expected += a[i] * b[i];
+    EXPECT_NEAR(DotProduct(a.data(), b.data(), dim), expected, 1e-4 * dim);
+
+    std::vector<int8_t> qa(dim), qb(dim);
+    int32_t qexpected = 0;
+    for (int i = 0; i < dim; ++i) {
+      qa[i] = int8_dist(rng);
+      qb[i] = int8_dist(rng);
+      qexpected += qa[i] * qb[i];
+    }
+    EXPECT_EQ(DotProduct(qa.data(), qb.data(), dim), qexpected);
+  }
+}
+
+TEST(FeatureGallery, Similarity) {
+  std::mt19937 rng(2);
+  for (auto precision : {FeaturePrecision::FLOAT32, FeaturePrecision::INT8}) {
+    const float tol = precision == FeaturePrecision::FLOAT32 ? 1e-5f : 2e-2f;
+    std::vector<std::vector<float>> features;
+    FeatureGallery dets(precision);
+    for (int i = 0; i < 6; ++i) {
+      features.push_back(RandomFeature(128, &rng));
+      // similar to the previous one
+      if (i % 2) {
+        for (size_t k = 0; k < 128; ++k) features[i][k] = features[i - 1][k] + 0.3f * features[i][k];
+      }
+      ASSERT_TRUE(dets.Add(features.back()));
+    }
+    // a zero feature and an empty feature are zero rows, a feature of another dimension is rejected
+    EXPECT_TRUE(dets.Add(std::vector<float>(128, 0.f)));
+    EXPECT_TRUE(dets.Add(std::vector<float>()));
+    EXPECT_FALSE(dets.Add(std::vector<float>(64, 1.f)));
+    ASSERT_EQ(dets.Size(), 9u);
+    EXPECT_EQ(dets.Dim(), 128);
+
+    FeatureGallery track(precision);
+    EXPECT_TRUE(track.Append(dets, 0));
+    EXPECT_TRUE(track.Append(dets, 2));
+    EXPECT_FALSE(track.Append(FeatureGallery(precision == FeaturePrecision::INT8 ? FeaturePrecision::FLOAT32
+                                                                                 : FeaturePrecision::INT8),
+                              0));
+    std::vector<int> rows(dets.Size());
+    std::iota(rows.begin(), rows.end(), 0);
+    std::vector<float> similarities;
+    track.MaxSimilarity(dets, rows, &similarities);
+    ASSERT_EQ(similarities.size(), rows.size());
+    for (size_t j = 0; j < rows.size(); ++j) {
+      float expected = j < 6 ? std::max(ReferenceSimilarity(features[0], features[j]),
+                                        ReferenceSimilarity(features[2], features[j]))
+                             : 0.f;
+      EXPECT_NEAR(similarities[j], expected, tol) << j;
+      EXPECT_FLOAT_EQ(similarities[j], track.MaxSimilarity(dets, j));
+    }
+    EXPECT_NEAR(similarities[0], 1.f, tol);
+    EXPECT_GT(similarities[1], 0.8f);
+
+    // the oldest feature is dropped
+    track.PopFront(1);
+    ASSERT_EQ(track.Size(), 1u);
+    EXPECT_NEAR(track.MaxSimilarity(dets, 2), 1.f, tol);
+    EXPECT_LT(track.MaxSimilarity(dets, 0), 0.5f);
+  }
+}
+
+TEST(FeatureGallery, RingBuffer) {
+  std::mt19937 rng(4);
+  for (auto precision : {FeaturePrecision::FLOAT32, FeaturePrecision::INT8}) {
+    const float tol = precision == FeaturePrecision::FLOAT32 ? 1e-5f : 2e-2f;
+    FeatureGallery dets(precision);
+    for (int i = 0; i < 8; ++i) dets.Add(RandomFeature(64, &rng));
+    FeatureGallery track(precision);
+    track.SetCapacity(3);
+    for (int i = 0; i < 5; ++i) EXPECT_TRUE(track.Append(dets, i));
+    // 0 and 1 are overwritten
+    EXPECT_EQ(track.Size(), 3u);
+    for (int i = 0; i < 5; ++i) {
+      if (i < 2) {
+        EXPECT_LT(track.MaxSimilarity(dets, i), 0.6f) << i;
+      } else {
+        EXPECT_NEAR(track.MaxSimilarity(dets, i), 1.f, tol) << i;
+      }
+    }
+    // the rows of a ring buffer can be appended to another gallery in order
+    FeatureGallery copy(precision);
+    for (size_t i = 0; i < track.Size(); ++i) copy.Append(track, i);
+    EXPECT_NEAR(copy.MaxSimilarity(dets, 2), 1.f, tol);
+    EXPECT_NEAR(track.MaxSimilarity(copy, 0), 1.f, tol);
+
+    track.PopFront(1);
+    EXPECT_EQ(track.Size(), 2u);
+    EXPECT_LT(track.MaxSimilarity(dets, 2), 0.6f);
+    EXPECT_TRUE(track.Append(dets, 5));
+    EXPECT_TRUE(track.Append(dets, 6));
+    EXPECT_EQ(track.Size(), 3u);
+    EXPECT_LT(track.MaxSimilarity(dets, 3), 0.6f);
+
+    // shrinking keeps the newest
+    track.SetCapacity(1);
+    EXPECT_EQ(track.Size(), 1u);
+    EXPECT_NEAR(track.MaxSimilarity(dets, 6), 1.f, tol);
+    EXPECT_LT(track.MaxSimilarity(dets, 5), 0.6f);
+  }
+}
+
+TEST(FeatureGallery, RingBufferBenchmark) {
+  // a track matched on each of 10000 frames, keeping the latest 100 features of 512-dim
+  constexpr int kDim = 512;
+  constexpr int kBudget = 100;
+  constexpr int kFrames = 10000;
+  std::mt19937 rng(5);
+  FeatureGallery dets;
+  dets.Add(RandomFeature(kDim, &rng));
+  using Clock = std::chrono::steady_clock;
+
+  auto start = Clock::now();
+  std::vector<std::vector<float>> features;
+  for (int i = 0; i < kFrames; ++i) {
+    features.emplace_back(kDim, 0.f);
+    if (features.size() > kBudget) features.erase(features.begin());
+  }
+  double vector_us = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / kFrames;
+
+  start = Clock::now();
+  FeatureGallery track;
+  track.SetCapacity(kBudget);
+  for (int i = 0; i < kFrames; ++i) track.Append(dets, 0);
+  double ring_us = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / kFrames;
+
+  EXPECT_EQ(track.Size(), static_cast<size_t>(kBudget));
+  std::cout << "[ FeatureGallery ] update with eviction: ring buffer " << ring_us << " us, vector erase " << vector_us
+            << " us" << std::endl;
+}
+
+TEST(FeatureGallery, Benchmark) {
+  // cost matrix of 200 tracks, each with 8 features, and 200 detections of 512-dim features
+  constexpr int kDim = 512;
+  constexpr int kTracks = 200;
+  constexpr int kDetections = 200;
+  constexpr int kGallery = 8;
+  std::mt19937 rng(3);
+  std::vector<std::vector<float>> det_features;
+  for (int j = 0; j < kDetections; ++j) det_features.push_back(RandomFeature(kDim, &rng));
+  std::vector<std::vector<std::vector<float>>> track_features(kTracks);
+  for (auto &track : track_features) {
+    for (int k = 0; k < kGallery; ++k) track.push_back(RandomFeature(kDim, &rng));
+  }
+  std::vector<int> rows(kDetections);
+  std::iota(rows.begin(), rows.end(), 0);
+  using Clock = std::chrono::steady_clock;
+  float sink = 0;
+
+  // the features compared as they come, the norms computed on each pair
+  auto start = Clock::now();
+  for (auto &track : track_features) {
+    for (auto &det : det_features) {
+      float max_simi = 0;
+      for (auto &feature : track) {
+        float ab = 0, aa = 0, bb = 0;
+        for (int i = 0; i < kDim; ++i) ab += feature[i] * det[i];
+        for (int i = 0; i < kDim; ++i) aa += feature[i] * feature[i];
+        for (int i = 0; i < kDim; ++i) bb += det[i] * det[i];
+        max_simi = std::max(max_simi, ab / std::sqrt(aa * bb));
+      }
+      sink += max_simi;
+    }
+  }
+  double pairwise_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+  for (auto precision : {FeaturePrecision::FLOAT32, FeaturePrecision::INT8}) {
+    start = Clock::now();
+    FeatureGallery dets(precision);
+    for (auto &det : det_features) dets.Add(det);
+    std::vector<FeatureGallery> tracks(kTracks, FeatureGallery(precision));
+    FeatureGallery track_dets(precision);
+    for (int t = 0; t < kTracks; ++t) {
+      track_dets.Clear();
+      for (auto &feature : track_features[t]) track_dets.Add(feature);
+      for (int k = 0; k < kGallery; ++k) tracks[t].Append(track_dets, k);
+    }
+    double ingest_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    start = Clock::now();
+    std::vector<float> similarities;
+    for (auto &track : tracks) {
+      track.MaxSimilarity(dets, rows, &similarities);
+      sink += similarities[0];
+    }
+    double gallery_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    std::cout << "[ FeatureGallery ] " << (precision == FeaturePrecision::FLOAT32 ? "float32" : "int8")
+              << " cost matrix " << gallery_ms << " ms (ingest " << ingest_ms << " ms), pairwise " << pairwise_ms
+              << " ms" << std::endl;
+  }
+  EXPECT_FALSE(std::isnan(sink));
+}
+
+}  // namespace cnstream
@@ -20,6 +20,7 @@
 
 #include <gtest/gtest.h>
 
+#include <cstdio>
 #include <memory>
 #include <string>
 #include <vector>
@@ -33,6 +34,7 @@
 #include "cnis/processor.h"
 #include "cnstream_frame_va.hpp"
 #include "cnstream_module.hpp"
+#include "easytrack/src/track_trace.h"
 #include "test_base.hpp"
 #include "track.hpp"
 
@@ -89,6 +91,44 @@ TEST(Tracker, CheckParamSet) {
 
   param["engine_num"] = "1";
   EXPECT_TRUE(track->CheckParamSet(param));
+
+  param["nn_budget"] = "0";
+  EXPECT_FALSE(track->CheckParamSet(param));
+  param["nn_budget"] = "30";
+  param["max_iou_distance"] = "1.5";
+  EXPECT_FALSE(track->CheckParamSet(param));
+  param["max_iou_distance"] = "0.5";
+  param["max_age"] = "10";
+  param["n_init"] = "1";
+  EXPECT_TRUE(track->CheckParamSet(param));
+
+  param["low_score_thresh"] = "0.6";
+  EXPECT_FALSE(track->CheckParamSet(param));
+  param["high_score_thresh"] = "0.7";
+  EXPECT_TRUE(track->CheckParamSet(param));
+  param["high_score_thresh"] = "1.5";
+  EXPECT_FALSE(track->CheckParamSet(param));
+  param.erase("high_score_thresh");
+  param.erase("low_score_thresh");
+
+  param["profiles"] = "{\"crowd\": {\"nn_budget\": 10, \"max_age\": 5}}";
+  param["stream_profiles"] = "{\"0\": \"crowd\", \"1\": \"default\"}";
+  EXPECT_TRUE(track->CheckParamSet(param));
+  param["stream_profiles"] = "{\"0\": \"no_such_profile\"}";
+  EXPECT_FALSE(track->CheckParamSet(param));
+  param.erase("stream_profiles");
+  param["profiles"] = "{\"crowd\": {\"no_such_key\": 10}}";
+  EXPECT_FALSE(track->CheckParamSet(param));
+  param["profiles"] = "{\"crowd\": {\"max_iou_distance\": 0}}";
+  EXPECT_FALSE(track->CheckParamSet(param));
+  param["profiles"] = "{\"crowd\": {\"high_score_thresh\": 0.6, \"low_score_thresh\": 0.2}}";
+  EXPECT_TRUE(track->CheckParamSet(param));
+  param["profiles"] = "{\"crowd\": {\"low_score_thresh\": 0.9}}";
+  EXPECT_FALSE(track->CheckParamSet(param));
+  param["profiles"] = "not json";
+  EXPECT_FALSE(track->CheckParamSet(param));
+  param.erase("profiles");
+
   param["no_such_param"] = "no_such_value";
   EXPECT_FALSE(track->CheckParamSet(param));
 }
@@ -116,6 +156,23 @@ TEST(Tracker, OpenClose) {
   param["track_name"] = "no_such_track_name";
   EXPECT_FALSE(track->Open(param));
 
+  param["track_name"] = ds_track;
+  param["feature_precision"] = "int8";
+  EXPECT_TRUE(track->Open(param));
+  param["feature_precision"] = "fp64";
+  EXPECT_FALSE(track->Open(param));
+  param.erase("feature_precision");
+  param["assignment_method"] = "lapjv";
+  EXPECT_TRUE(track->Open(param));
+  param["assignment_method"] = "auction";
+  EXPECT_FALSE(track->Open(param));
+  param.erase("assignment_method");
+  param["track_thread_num"] = "2";
+  EXPECT_TRUE(track->Open(param));
+  param["track_thread_num"] = "two";
+  EXPECT_FALSE(track->Open(param));
+  param.erase("track_thread_num");
+
   param["track_name"] = ds_track;
   param["model_input_pixel_format"] = "BGR24";
   EXPECT_TRUE(track->Open(param));
@@ -437,4 +494,145 @@ TEST(Tracker, ProcessCpuIoUMatch) {
   EXPECT_EQ(track->Process(data), 0);
 }
 
+TEST(Tracker, ProcessTrackThreads) {
+  std::shared_ptr<Module> track = std::make_shared<Tracker>(gname);
+  ModuleParamSet param;
+  param["track_name"] = "IoUMatch";
+  param["track_thread_num"] = "2";
+  ASSERT_TRUE(track->Open(param));
+
+  std::vector<std::shared_ptr<CNFrameInfo>> frames;
+  for (int n = 0; n < 4; ++n) {
+    for (int stream = 0; stream < 2; ++stream) {
+      auto data = GenTestImageData();
+      data->SetStreamIndex(stream);
+      EXPECT_EQ(track->Process(data), 0);
+      frames.push_back(data);
+    }
+  }
+  // eos waits for the frames of the stream tracked
+  for (int stream = 0; stream < 2; ++stream) {
+    auto eos = cnstream::CNFrameInfo::Create(std::to_string(stream), true);
+    eos->SetStreamIndex(stream);
+    EXPECT_EQ(track->Process(eos), 0);
+  }
+  for (auto &data : frames) {
+    CNInferObjsPtr objs_holder = data->collection.Get<CNInferObjsPtr>(kCNInferObjsTag);
+    for (auto &obj : objs_holder->objs_) EXPECT_FALSE(obj->track_id.empty());
+  }
+  track->Close();
+}
+
+// a frame of the stream, with the object of GenTestImageData or without objects
+static std::shared_ptr<CNFrameInfo> GenStreamData(const std::string &stream_id, uint32_t stream_index, bool with_obj) {
+  cv::Mat img = cv::imread(GetExePath() + img_path, cv::IMREAD_COLOR);
+  auto data = cnstream::CNFrameInfo::Create(stream_id);
+  data->SetStreamIndex(stream_index);
+  data->timestamp = 1000;
+  std::shared_ptr<CNInferObjs> objs_holder = std::make_shared<CNInferObjs>();
+  if (with_obj) {
+    auto obj = std::make_shared<CNInferObject>();
+    obj->id = std::to_string(1);
+    obj->bbox = CnInferBbox(0.2, 0.2, 0.6, 0.6);
+    objs_holder->objs_.push_back(obj);
+  }
+  std::shared_ptr<CNDataFrame> frame = GenerateCNDataFrame(img, g_dev_id);
+  data->collection.Add(kCNDataFrameTag, frame);
+  data->collection.Add(kCNInferObjsTag, objs_holder);
+  return data;
+}
+
+// Tracks an object confirmed, lost for 5 frames and seen again, returns whether it keeps its track
+static bool KeepTrackAfterLoss(Tracker *track, uint32_t stream_index) {
+  auto process = [&](bool with_obj) -> std::string {
+    auto data = GenStreamData(std::to_string(stream_index), stream_index, with_obj);
+    EXPECT_EQ(track->Process(data), 0);
+    CNInferObjsPtr objs_holder = data->collection.Get<CNInferObjsPtr>(kCNInferObjsTag);
+    return objs_holder->objs_.empty() ? std::string() : objs_holder->objs_[0]->track_id;
+  };
+  std::string track_id;
+  for (int n = 0; n < 3; ++n) track_id = process(true);
+  EXPECT_NE(track_id, "-1");
+  for (int n = 0; n < 5; ++n) process(false);
+  return process(true) == track_id;
+}
+
+TEST(Tracker, ProcessStreamProfile) {
+  std::shared_ptr<Tracker> track = std::make_shared<Tracker>(gname);
+  ModuleParamSet param;
+  param["track_name"] = "IoUMatch";
+  param["n_init"] = "1";
+  param["profiles"] = "{\"short\": {\"max_age\": 2}}";
+  EXPECT_FALSE(track->SetStreamProfile("1", "short"));
+  ASSERT_TRUE(track->Open(param));
+  EXPECT_FALSE(track->SetStreamProfile("1", "no_such_profile"));
+  // selected before the first frame of the stream, stream 0 keeps the default max_age of 30
+  EXPECT_TRUE(track->SetStreamProfile("1", "short"));
+  EXPECT_TRUE(KeepTrackAfterLoss(track.get(), 0));
+  EXPECT_FALSE(KeepTrackAfterLoss(track.get(), 1));  // dropped at the max_age of the profile
+  track->Close();
+}
+
+TEST(Tracker, ProcessStreamReadded) {
+  std::shared_ptr<Tracker> track = std::make_shared<Tracker>(gname);
+  ModuleParamSet param;
+  param["track_name"] = "IoUMatch";
+  param["n_init"] = "1";
+  param["profiles"] = "{\"short\": {\"max_age\": 2}}";
+  ASSERT_TRUE(track->Open(param));
+  EXPECT_TRUE(KeepTrackAfterLoss(track.get(), 0));
+
+  // the tracker of the stream is released on EOS, the stream added again on the index uses the new profile
+  auto eos = cnstream::CNFrameInfo::Create("0", true);
+  eos->SetStreamIndex(0);
+  EXPECT_EQ(track->Process(eos), 0);
+  EXPECT_TRUE(track->SetStreamProfile("0", "short"));
+  EXPECT_FALSE(KeepTrackAfterLoss(track.get(), 0));
+  track->Close();
+}
+
+TEST(Tracker, ProcessRecordTrace) {
+  const std::string path = "_test_tracker_trace_.bin";
+  std::shared_ptr<Module> track = std::make_shared<Tracker>(gname);
+  ModuleParamSet param;
+  param["track_name"] = "IoUMatch";
+  param["record_trace"] = "no_such_dir/trace.bin";
+  EXPECT_FALSE(track->Open(param));
+  param["record_trace"] = path;
+  ASSERT_TRUE(track->Open(param));
+  for (int n = 0; n < 4; ++n) EXPECT_EQ(track->Process(GenTestImageData()), 0);
+  track->Close();
+
+  // the detections of each frame with the tracks assigned
+  TraceReader reader;
+  ASSERT_TRUE(reader.Open(path));
+  TraceFrame frame;
+  int frame_num = 0;
+  while (reader.Read(&frame)) {
+    EXPECT_EQ(frame.stream_index, static_cast<uint32_t>(g_channel_id));
+    ASSERT_EQ(frame.objects.size(), 1u);
+    EXPECT_FLOAT_EQ(frame.objects[0].bbox.x, 0.2f);
+    ++frame_num;
+  }
+  EXPECT_EQ(frame_num, 4);
+  remove(path.c_str());
+}
+
+TEST(Tracker, ProcessCpuByteTrack) {
+  std::shared_ptr<Module> track = std::make_shared<Tracker>(gname);
+  ModuleParamSet param;
+  param["track_name"] = "ByteTrack";
+  ASSERT_TRUE(track->Open(param));
+  auto data = GenTestImageData();
+  EXPECT_EQ(track->Process(data), 0);
+  track->Close();
+
+  param["high_score_thresh"] = "0.6";
+  param["low_score_thresh"] = "0.2";
+  param["max_age"] = "10";
+  ASSERT_TRUE(track->Open(param));
+  EXPECT_EQ(track->Process(GenTestImageData()), 0);
+  track->Close();
+}
+
 }  // namespace cnstream
@@ -0,0 +1,146 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "track_pool.hpp"
+
+namespace cnstream {
+
+namespace {
+
+// Frames of the streams in turn, each tracked for track_us. Returns the time to track all of them, in ms.
+double RunStreams(TrackPool *pool, int streams, int frames_per_stream, int track_us,
+                  std::vector<std::vector<int>> *tracked) {
+  std::mutex mutex;
+  tracked->assign(streams, std::vector<int>());
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < frames_per_stream; ++i) {
+    for (int s = 0; s < streams; ++s) {
+      auto job = [&mutex, tracked, s, i, track_us]() {
+        std::this_thread::sleep_for(std::chrono::microseconds(track_us + (i * 7 + s * 13) % 300));
+        std::lock_guard<std::mutex> lk(mutex);
+        (*tracked)[s].push_back(i);
+      };
+      if (pool) {
+        pool->Submit(s, job);
+      } else {
+        job();
+      }
+    }
+  }
+  if (pool) {
+    for (int s = 0; s < streams; ++s) pool->WaitStream(s);
+  }
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+TEST(TrackPool, OrderPerStream) {
+  TrackPool::Params params;
+  params.thread_num = 4;
+  params.max_queue = 2;
+  TrackPool pool(params, 6);
+  pool.Start();
+  std::vector<std::vector<int>> tracked;
+  RunStreams(&pool, 6, 30, 100, &tracked);
+  for (auto &frames : tracked) {
+    ASSERT_EQ(frames.size(), 30u);
+    for (int i = 0; i < 30; ++i) EXPECT_EQ(frames[i], i);
+  }
+  auto stats = pool.GetStats();
+  EXPECT_EQ(stats.jobs, 180u);
+  EXPECT_LE(stats.max_queue_depth, 2u);
+}
+
+TEST(TrackPool, OneJobOfStreamAtATime) {
+  TrackPool::Params params;
+  params.thread_num = 4;
+  TrackPool pool(params, 2);
+  pool.Start();
+  std::atomic<int> running{0};
+  std::atomic<bool> overlapped{false};
+  for (int i = 0; i < 50; ++i) {
+    pool.Submit(1, [&]() {
+      if (running++) overlapped = true;
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+      --running;
+    });
+  }
+  pool.WaitStream(1);
+  EXPECT_FALSE(overlapped);
+  EXPECT_EQ(pool.GetStats().jobs, 50u);
+}
+
+TEST(TrackPool, StopRunsJobs) {
+  TrackPool::Params params;
+  params.thread_num = 1;
+  params.max_queue = 16;
+  TrackPool pool(params, 1);
+  pool.Start();
+  std::atomic<int> done{0};
+  for (int i = 0; i < 10; ++i) {
+    pool.Submit(0, [&]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      ++done;
+    });
+  }
+  pool.Stop();
+  EXPECT_EQ(done, 10);
+  // run by the calling thread after stopped, and for streams out of range
+  pool.Submit(0, [&]() { ++done; });
+  pool.Submit(5, [&]() { ++done; });
+  EXPECT_EQ(done, 12);
+}
+
+TEST(TrackPool, Benchmark) {
+  // 8 streams of 2 ms tracking on 2 threads of the module, each thread tracking its streams one by one, against the
+  // tracking threads of the pool
+  constexpr int kStreams = 8;
+  constexpr int kFrames = 20;
+  std::vector<std::vector<int>> tracked;
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> conveyors;
+  std::vector<std::vector<std::vector<int>>> conveyor_tracked(2);
+  for (int c = 0; c < 2; ++c) {
+    conveyors.emplace_back([&, c]() { RunStreams(nullptr, kStreams / 2, kFrames, 2000, &conveyor_tracked[c]); });
+  }
+  for (auto &conveyor : conveyors) conveyor.join();
+  double serial_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+  TrackPool::Params params;
+  params.thread_num = 8;
+  TrackPool pool(params, kStreams);
+  pool.Start();
+  double pool_ms = RunStreams(&pool, kStreams, kFrames, 2000, &tracked);
+  EXPECT_LT(pool_ms, serial_ms);
+  std::cout << "[ TrackPool ] " << kStreams << " streams: on 2 threads of the module " << serial_ms
+            << " ms, on 8 tracking threads " << pool_ms << " ms" << std::endl;
+}
+
+}  // namespace cnstream
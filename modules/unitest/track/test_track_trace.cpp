@@ -0,0 +1,195 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "easytrack/include/easy_track.h"
+#include "easytrack/src/track_trace.h"
+
+namespace cnstream {
+
+namespace {
+
+DetectObject MakeObject(float x, float y, int identity, int feature_dim) {
+  DetectObject obj;
+  obj.label = 0;
+  obj.score = 0.9f;
+  obj.bbox = {x, y, 0.04f, 0.1f};
+  obj.track_id = identity;
+  obj.detect_id = -1;
+  obj.feature.assign(feature_dim, 0.f);
+  if (feature_dim) obj.feature[identity % feature_dim] = 1.f;
+  return obj;
+}
+
+// the tracks output for the detections, the tracks given by track_ids, -1 for none
+Objects MakeTracks(const Objects &detects, const std::vector<int> &track_ids) {
+  Objects tracks;
+  for (size_t i = 0; i < detects.size(); ++i) {
+    tracks.push_back(detects[i]);
+    tracks.back().track_id = track_ids[i];
+    tracks.back().detect_id = i;
+  }
+  return tracks;
+}
+
+}  // namespace
+
+TEST(TrackTrace, WriteRead) {
+  const std::string path = "_test_track_trace_.bin";
+  std::vector<TraceFrame> frames(3);
+  frames[0].stream_index = 0;
+  frames[0].timestamp = 100;
+  frames[0].objects = {MakeObject(0.1f, 0.2f, 0, 8), MakeObject(0.5f, 0.5f, -1, 0)};
+  frames[1].stream_index = 1;
+  frames[1].timestamp = 100;
+  frames[2].stream_index = 0;
+  frames[2].timestamp = 140;
+  frames[2].objects = {MakeObject(0.11f, 0.2f, 3, 8)};
+
+  TraceWriter writer;
+  ASSERT_TRUE(writer.Open(path));
+  for (auto &frame : frames) EXPECT_TRUE(writer.Write(frame));
+  writer.Close();
+  EXPECT_FALSE(writer.Write(frames[0]));
+
+  TraceReader reader;
+  ASSERT_TRUE(reader.Open(path));
+  TraceFrame frame;
+  for (auto &expected : frames) {
+    ASSERT_TRUE(reader.Read(&frame));
+    EXPECT_EQ(frame.stream_index, expected.stream_index);
+    EXPECT_EQ(frame.timestamp, expected.timestamp);
+    ASSERT_EQ(frame.objects.size(), expected.objects.size());
+    for (size_t i = 0; i < frame.objects.size(); ++i) {
+      EXPECT_EQ(frame.objects[i].track_id, expected.objects[i].track_id);
+      EXPECT_EQ(frame.objects[i].detect_id, static_cast<int>(i));
+      EXPECT_FLOAT_EQ(frame.objects[i].bbox.x, expected.objects[i].bbox.x);
+      EXPECT_FLOAT_EQ(frame.objects[i].score, expected.objects[i].score);
+      EXPECT_EQ(frame.objects[i].feature, expected.objects[i].feature);
+    }
+  }
+  EXPECT_FALSE(reader.Read(&frame));
+
+  // truncated in the middle of a frame
+  std::ifstream in(path, std::ios::binary);
+  std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  in.close();
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(content.data(), content.size() - 4);
+  out.close();
+  ASSERT_TRUE(reader.Open(path));
+  EXPECT_TRUE(reader.Read(&frame));
+  EXPECT_TRUE(reader.Read(&frame));
+  EXPECT_FALSE(reader.Read(&frame));
+
+  // not a trace
+  out.open(path, std::ios::binary | std::ios::trunc);
+  out << "not a detection trace";
+  out.close();
+  EXPECT_FALSE(reader.Open(path));
+  remove(path.c_str());
+  EXPECT_FALSE(reader.Open(path));
+}
+
+TEST(TrackTrace, MotMetrics) {
+  MotEvaluator evaluator;
+  // identities 0 and 1, and a detection without identity
+  Objects detects = {MakeObject(0.1f, 0.1f, 0, 0), MakeObject(0.5f, 0.5f, 1, 0), MakeObject(0.8f, 0.8f, -1, 0)};
+  evaluator.Update(detects, MakeTracks(detects, {-1, -1, -1}));
+  evaluator.Update(detects, MakeTracks(detects, {10, 11, -1}));
+  // identity 0 missed, the clutter tracked
+  evaluator.Update(detects, MakeTracks(detects, {-1, 11, 12}));
+  // identity 0 tracked again by a new track, identity 1 lost by the detector
+  Objects partial = {detects[0]};
+  evaluator.Update(partial, MakeTracks(partial, {13}));
+  evaluator.Update(partial, MakeTracks(partial, {13}));
+
+  MotMetrics metrics = evaluator.Get();
+  EXPECT_EQ(metrics.frames, 5u);
+  EXPECT_EQ(metrics.objects, 8u);
+  EXPECT_EQ(metrics.tracked, 6u);
+  EXPECT_EQ(metrics.misses, 3u);
+  EXPECT_EQ(metrics.false_positives, 1u);
+  EXPECT_EQ(metrics.id_switches, 1u);
+  EXPECT_EQ(metrics.fragmentations, 1u);
+  // 0 - 13 twice, 1 - 11 twice
+  EXPECT_EQ(metrics.id_true_positives, 4u);
+  EXPECT_DOUBLE_EQ(metrics.Mota(), 1.0 - 5.0 / 8);
+  EXPECT_DOUBLE_EQ(metrics.Idf1(), 8.0 / 14);
+}
+
+TEST(TrackTrace, Replay) {
+  // 50 objects moving linearly for 100 frames, recorded and replayed
+  const std::string path = "_test_track_trace_replay_.bin";
+  std::mt19937 rng(5);
+  std::uniform_real_distribution<float> u(0.f, 1.f);
+  std::vector<float> x(50), y(50), vx(50), vy(50);
+  for (int i = 0; i < 50; ++i) {
+    x[i] = u(rng) * 0.9f;
+    y[i] = u(rng) * 0.85f;
+    vx[i] = (u(rng) - 0.5f) * 0.004f;
+    vy[i] = (u(rng) - 0.5f) * 0.004f;
+  }
+  TraceWriter writer;
+  ASSERT_TRUE(writer.Open(path));
+  for (int f = 0; f < 100; ++f) {
+    TraceFrame frame;
+    frame.timestamp = f;
+    for (int i = 0; i < 50; ++i) {
+      if (u(rng) < 0.05f) continue;
+      frame.objects.push_back(MakeObject(x[i] + vx[i] * f, y[i] + vy[i] * f, i, 0));
+    }
+    ASSERT_TRUE(writer.Write(frame));
+  }
+  writer.Close();
+
+  TraceReader reader;
+  ASSERT_TRUE(reader.Open(path));
+  FeatureMatchTrack tracker;
+  tracker.SetAssignmentMethod(AssignmentMethod::LAPJV);
+  MotEvaluator evaluator;
+  TraceFrame frame;
+  while (reader.Read(&frame)) {
+    Objects tracks;
+    tracker.UpdateFrame(frame.objects, &tracks);
+    evaluator.Update(frame.objects, tracks);
+  }
+  remove(path.c_str());
+
+  MotMetrics metrics = evaluator.Get();
+  EXPECT_EQ(metrics.frames, 100u);
+  EXPECT_GT(metrics.Mota(), 0.9);
+  EXPECT_GT(metrics.Idf1(), 0.9);
+  MatchStats stats = tracker.GetMatchStats();
+  EXPECT_GE(stats.solves, 99u);
+  EXPECT_GE(stats.max_rows, 40u);
+  EXPECT_GE(stats.max_cols, 40u);
+  EXPECT_GT(stats.cost_elements, stats.solves);
+  EXPECT_GT(stats.solve_ms, 0);
+}
+
+}  // namespace cnstream
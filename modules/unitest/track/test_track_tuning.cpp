@@ -0,0 +1,144 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "easytrack/include/easy_track.h"
+
+namespace cnstream {
+
+namespace {
+
+constexpr int kFeatureDim = 128;
+
+// a trace of objects moving linearly, missed on 5% of the frames and occluded for 20 frames now and then, with the
+// feature of each object perturbed by noise, objects id in track_id
+std::vector<Objects> MakeFeatureTrace(int object_num, int frame_num) {
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<float> u(0.f, 1.f);
+  std::normal_distribution<float> n(0.f, 1.f);
+  struct Object {
+    float x, y, vx, vy;
+    int occluded;
+    std::vector<float> feature;
+  };
+  std::vector<Object> objects(object_num);
+  for (auto &obj : objects) {
+    obj.x = u(rng) * 0.9f;
+    obj.y = u(rng) * 0.85f;
+    obj.vx = (u(rng) - 0.5f) * 0.004f;
+    obj.vy = (u(rng) - 0.5f) * 0.004f;
+    obj.occluded = 0;
+    obj.feature.resize(kFeatureDim);
+    for (auto &v : obj.feature) v = n(rng);
+  }
+  std::vector<Objects> trace(frame_num);
+  for (auto &frame : trace) {
+    for (int i = 0; i < object_num; ++i) {
+      Object &obj = objects[i];
+      obj.x += obj.vx;
+      obj.y += obj.vy;
+      if (obj.occluded > 0 || u(rng) < 0.01f) {
+        obj.occluded = obj.occluded > 0 ? obj.occluded - 1 : 20;
+        continue;
+      }
+      if (u(rng) < 0.05f) continue;
+      DetectObject det;
+      det.label = 0;
+      det.score = 0.9f;
+      det.bbox = {obj.x + n(rng) * 0.001f, obj.y + n(rng) * 0.001f, 0.04f, 0.1f};
+      det.track_id = i;
+      det.detect_id = -1;
+      det.feature.resize(kFeatureDim);
+      float norm = 0;
+      for (int d = 0; d < kFeatureDim; ++d) {
+        det.feature[d] = obj.feature[d] + n(rng) * 0.3f;
+        norm += det.feature[d] * det.feature[d];
+      }
+      norm = std::sqrt(norm);
+      for (auto &v : det.feature) v /= norm;
+      frame.push_back(det);
+    }
+  }
+  return trace;
+}
+
+// replays the trace, returns ms/frame, and the number of switches of the track of an object
+double Replay(EasyTrack *tracker, const std::vector<Objects> &trace, int *id_switches) {
+  std::map<int, int> track_of_object;
+  *id_switches = 0;
+  double total = 0;
+  for (auto &detects : trace) {
+    Objects tracks;
+    auto start = std::chrono::steady_clock::now();
+    tracker->UpdateFrame(detects, &tracks);
+    total += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    for (auto &obj : tracks) {
+      if (obj.track_id < 0) continue;
+      int object = detects[obj.detect_id].track_id;
+      auto iter = track_of_object.find(object);
+      if (iter != track_of_object.end() && iter->second != obj.track_id) ++*id_switches;
+      track_of_object[object] = obj.track_id;
+    }
+  }
+  return total / trace.size();
+}
+
+}  // namespace
+
+TEST(TrackTuning, Benchmark) {
+  // the hyperparameters of the profiles of the Tracker module, the first is the default
+  struct Profile {
+    const char *name;
+    int nn_budget;
+    float max_iou_distance;
+    int max_age;
+    int n_init;
+  };
+  const std::vector<Profile> profiles = {{"default", 100, 0.7f, 30, 3}, {"budget 30", 30, 0.7f, 30, 3},
+                                         {"budget 10", 10, 0.7f, 30, 3}, {"age 10", 100, 0.7f, 10, 3},
+                                         {"budget 10 age 10", 10, 0.7f, 10, 1}};
+  auto trace = MakeFeatureTrace(100, 300);
+  std::vector<double> ms(profiles.size());
+  std::vector<int> id_switches(profiles.size());
+  for (size_t i = 0; i < profiles.size(); ++i) {
+    const Profile &profile = profiles[i];
+    FeatureMatchTrack tracker;
+    tracker.SetParams(0.2, profile.nn_budget, profile.max_iou_distance, profile.max_age, profile.n_init);
+    ms[i] = Replay(&tracker, trace, &id_switches[i]);
+    std::cout << "[ TrackTuning ] " << profile.name << ": " << ms[i] << " ms/frame, " << id_switches[i]
+              << " id switches" << std::endl;
+  }
+  // distinct features, a small budget matches fewer features at about the same accuracy
+  EXPECT_LT(ms[2], ms[0]);
+  EXPECT_LE(id_switches[2], id_switches[0] + 10);
+  // the tracks of the objects occluded for 20 frames are lost at a small age
+  EXPECT_GT(id_switches[3], id_switches[0]);
+}
+
+}  // namespace cnstream
@@ -0,0 +1,80 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_UTIL_INCLUDE_SWS_CONTEXT_CACHE_HPP_
+#define MODULES_UTIL_INCLUDE_SWS_CONTEXT_CACHE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+
+struct SwsContext;
+
+namespace cnstream {
+
+struct SwsCacheStats {
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t evictions = 0;
+};
+
+/**
+ * SwsContextCache keeps the recently used SwsContexts of the calling thread, so that the filter tables are not
+ * computed for every conversion. The contexts are keyed by (src w/h/fmt, dst w/h/fmt, flags) and evicted in LRU order.
+ *
+ * The contexts are owned by the cache and must only be used by the calling thread, do not free them.
+ */
+class SwsContextCache {
+ public:
+  static constexpr size_t kDefaultCapacity = 16;
+
+  /* Returns the cache of the calling thread */
+  static SwsContextCache &Instance();
+
+  ~SwsContextCache();
+
+  /* Returns nullptr if sws_getContext failed. src_fmt and dst_fmt are AVPixelFormat. */
+  SwsContext *Get(int src_w, int src_h, int src_fmt, int dst_w, int dst_h, int dst_fmt, int flags);
+  void SetCapacity(size_t capacity);
+  size_t Size() const { return entries_.size(); }
+  void Clear();
+
+  /* Statistics of all threads */
+  static SwsCacheStats GetStats();
+  static void ResetStats();
+
+ private:
+  SwsContextCache() = default;
+  SwsContextCache(const SwsContextCache &) = delete;
+  SwsContextCache &operator=(const SwsContextCache &) = delete;
+
+  struct Entry {
+    int src_w, src_h, src_fmt;
+    int dst_w, dst_h, dst_fmt;
+    int flags;
+    SwsContext *ctx;
+  };
+  std::list<Entry> entries_;  // most recently used first
+  size_t capacity_ = kDefaultCapacity;
+};  // class SwsContextCache
+
+}  // namespace cnstream
+
+#endif  // MODULES_UTIL_INCLUDE_SWS_CONTEXT_CACHE_HPP_
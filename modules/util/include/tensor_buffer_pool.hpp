@@ -0,0 +1,167 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_UTIL_INCLUDE_TENSOR_BUFFER_POOL_HPP_
+#define MODULES_UTIL_INCLUDE_TENSOR_BUFFER_POOL_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace cnstream {
+
+struct TensorPoolStats {
+  uint64_t borrows = 0;
+  uint64_t reuses = 0;                /* borrows served by the cached blocks */
+  uint64_t allocations = 0;           /* blocks allocated from the system */
+  uint64_t hugepage_allocations = 0;  /* blocks backed by huge pages, among allocations */
+  uint64_t cached_bytes = 0;          /* bytes of the blocks cached, not borrowed */
+  uint64_t owned_bytes = 0;           /* bytes of all the blocks alive */
+};
+
+class TensorBufferPool;
+
+/**
+ * TensorBuffer is a block borrowed from TensorBufferPool, returned to the pool on destruction. It may be returned
+ * by another thread than the one borrowed it.
+ */
+class TensorBuffer {
+ public:
+  TensorBuffer() = default;
+  TensorBuffer(TensorBuffer &&other) noexcept { *this = std::move(other); }
+  TensorBuffer &operator=(TensorBuffer &&other) noexcept;
+  ~TensorBuffer() { Reset(); }
+
+  void *Data() const { return data_; }
+  /* The size requested, the block may be larger */
+  size_t Size() const { return size_; }
+  explicit operator bool() const { return data_ != nullptr; }
+  /* Returns the block to the pool */
+  void Reset();
+
+ private:
+  friend class TensorBufferPool;
+  TensorBuffer(const TensorBuffer &) = delete;
+  TensorBuffer &operator=(const TensorBuffer &) = delete;
+
+  TensorBufferPool *pool_ = nullptr;
+  void *data_ = nullptr;
+  size_t size_ = 0;
+  size_t capacity_ = 0;
+  bool mmapped_ = false;
+};  // class TensorBuffer
+
+/**
+ * TensorBufferPool caches the blocks of the tensors and scratch buffers used by preprocessing, so that they are not
+ * allocated and page faulted again for each batch. Sizes are rounded up to buckets of a quarter of a power of two, at
+ * least 4KB, and blocks are 64 bytes aligned.
+ *
+ * With hugepage, blocks of 2MB and more are mapped from the huge page pool, or advised to transparent huge pages if
+ * the pool is empty.
+ */
+class TensorBufferPool {
+ public:
+  struct Params {
+    size_t max_cached_bytes = 256 << 20;  /* blocks returned beyond are freed */
+    bool hugepage = false;
+  };
+
+  static constexpr size_t kMinBlockSize = 4096;
+  static constexpr size_t kAlignment = 64;
+  static constexpr size_t kHugePageSize = 2 << 20;
+
+  /* Returns the pool shared by all threads */
+  static TensorBufferPool &Instance();
+
+  TensorBufferPool() = default;
+  explicit TensorBufferPool(const Params &params) : params_(params) {}
+  ~TensorBufferPool();
+
+  /* Parameters apply to the blocks allocated later */
+  void SetParams(const Params &params);
+  /* Returns an empty buffer if the allocation failed */
+  TensorBuffer Borrow(size_t size);
+  /* Allocates and touches `count` blocks of `size` in advance */
+  void Reserve(size_t size, uint32_t count);
+  /* Frees the blocks cached */
+  void Trim();
+
+  TensorPoolStats GetStats();
+  void ResetStats();
+
+  static size_t BucketSize(size_t size);
+
+ private:
+  TensorBufferPool(const TensorBufferPool &) = delete;
+  TensorBufferPool &operator=(const TensorBufferPool &) = delete;
+
+  struct Block {
+    void *data;
+    bool mmapped;
+  };
+  friend class TensorBuffer;
+  void Return(void *data, size_t capacity, bool mmapped);
+  bool Allocate(size_t capacity, Block *block);
+  static void Free(const Block &block, size_t capacity);
+
+  Params params_;
+  std::mutex mutex_;
+  std::unordered_map<size_t, std::vector<Block>> free_blocks_;  // keyed by bucket size
+  TensorPoolStats stats_;
+};  // class TensorBufferPool
+
+/**
+ * TensorArena is a contiguous batch tensor of [n, c, h, w] elements laid out as NCHW or NHWC, as the input of a
+ * model, borrowed from a TensorBufferPool. Items are packed, item i starts at ItemSize() * i bytes.
+ */
+class TensorArena {
+ public:
+  enum class Layout { NCHW, NHWC };
+
+  TensorArena() = default;
+  TensorArena(uint32_t n, uint32_t c, uint32_t h, uint32_t w, size_t elem_size, Layout layout,
+              TensorBufferPool *pool = &TensorBufferPool::Instance());
+
+  bool Valid() const { return static_cast<bool>(buffer_); }
+  void *Data() const { return buffer_.Data(); }
+  size_t Size() const { return item_size_ * n_; }
+  size_t ItemSize() const { return item_size_; }
+  uint32_t BatchSize() const { return n_; }
+  Layout GetLayout() const { return layout_; }
+  void *Item(uint32_t i) const { return static_cast<uint8_t *>(buffer_.Data()) + item_size_ * i; }
+  /* Offset of an element in elements */
+  size_t Offset(uint32_t n, uint32_t c, uint32_t y, uint32_t x) const {
+    if (layout_ == Layout::NCHW) return ((static_cast<size_t>(n) * c_ + c) * h_ + y) * w_ + x;
+    return ((static_cast<size_t>(n) * h_ + y) * w_ + x) * c_ + c;
+  }
+
+ private:
+  TensorBuffer buffer_;
+  uint32_t n_ = 0, c_ = 0, h_ = 0, w_ = 0;
+  size_t item_size_ = 0;
+  Layout layout_ = Layout::NCHW;
+};  // class TensorArena
+
+}  // namespace cnstream
+
+#endif  // MODULES_UTIL_INCLUDE_TENSOR_BUFFER_POOL_HPP_
@@ -0,0 +1,101 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "sws_context_cache.hpp"
+
+#include <atomic>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <libswscale/swscale.h>
+#ifdef __cplusplus
+}
+#endif
+
+namespace cnstream {
+
+namespace {
+std::atomic<uint64_t> g_hits{0};
+std::atomic<uint64_t> g_misses{0};
+std::atomic<uint64_t> g_evictions{0};
+}  // namespace
+
+constexpr size_t SwsContextCache::kDefaultCapacity;
+
+SwsContextCache &SwsContextCache::Instance() {
+  static thread_local SwsContextCache cache;
+  return cache;
+}
+
+SwsContextCache::~SwsContextCache() { Clear(); }
+
+SwsContext *SwsContextCache::Get(int src_w, int src_h, int src_fmt, int dst_w, int dst_h, int dst_fmt, int flags) {
+  for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+    if (it->src_w == src_w && it->src_h == src_h && it->src_fmt == src_fmt && it->dst_w == dst_w &&
+        it->dst_h == dst_h && it->dst_fmt == dst_fmt && it->flags == flags) {
+      if (it != entries_.begin()) entries_.splice(entries_.begin(), entries_, it);
+      g_hits.fetch_add(1, std::memory_order_relaxed);
+      return entries_.front().ctx;
+    }
+  }
+
+  g_misses.fetch_add(1, std::memory_order_relaxed);
+  SwsContext *ctx = sws_getContext(src_w, src_h, static_cast<AVPixelFormat>(src_fmt), dst_w, dst_h,
+                                   static_cast<AVPixelFormat>(dst_fmt), flags, nullptr, nullptr, nullptr);
+  if (!ctx) return nullptr;
+  while (entries_.size() >= capacity_) {
+    sws_freeContext(entries_.back().ctx);
+    entries_.pop_back();
+    g_evictions.fetch_add(1, std::memory_order_relaxed);
+  }
+  entries_.push_front({src_w, src_h, src_fmt, dst_w, dst_h, dst_fmt, flags, ctx});
+  return ctx;
+}
+
+void SwsContextCache::SetCapacity(size_t capacity) {
+  capacity_ = capacity ? capacity : 1;
+  while (entries_.size() > capacity_) {
+    sws_freeContext(entries_.back().ctx);
+    entries_.pop_back();
+    g_evictions.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void SwsContextCache::Clear() {
+  for (auto &entry : entries_) sws_freeContext(entry.ctx);
+  entries_.clear();
+}
+
+SwsCacheStats SwsContextCache::GetStats() {
+  SwsCacheStats stats;
+  stats.hits = g_hits.load(std::memory_order_relaxed);
+  stats.misses = g_misses.load(std::memory_order_relaxed);
+  stats.evictions = g_evictions.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void SwsContextCache::ResetStats() {
+  g_hits.store(0);
+  g_misses.store(0);
+  g_evictions.store(0);
+}
+
+}  // namespace cnstream
@@ -0,0 +1,197 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "tensor_buffer_pool.hpp"
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace cnstream {
+
+constexpr size_t TensorBufferPool::kMinBlockSize;
+constexpr size_t TensorBufferPool::kAlignment;
+constexpr size_t TensorBufferPool::kHugePageSize;
+
+namespace {
+inline size_t HugePageAligned(size_t size) {
+  constexpr size_t kPage = TensorBufferPool::kHugePageSize;
+  return (size + kPage - 1) / kPage * kPage;
+}
+}  // namespace
+
+TensorBuffer &TensorBuffer::operator=(TensorBuffer &&other) noexcept {
+  if (this == &other) return *this;
+  Reset();
+  pool_ = other.pool_;
+  data_ = other.data_;
+  size_ = other.size_;
+  capacity_ = other.capacity_;
+  mmapped_ = other.mmapped_;
+  other.pool_ = nullptr;
+  other.data_ = nullptr;
+  other.size_ = other.capacity_ = 0;
+  return *this;
+}
+
+void TensorBuffer::Reset() {
+  if (pool_ && data_) pool_->Return(data_, capacity_, mmapped_);
+  pool_ = nullptr;
+  data_ = nullptr;
+  size_ = capacity_ = 0;
+}
+
+TensorBufferPool &TensorBufferPool::Instance() {
+  static TensorBufferPool pool;
+  return pool;
+}
+
+TensorBufferPool::~TensorBufferPool() { Trim(); }
+
+void TensorBufferPool::SetParams(const Params &params) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  params_ = params;
+}
+
+size_t TensorBufferPool::BucketSize(size_t size) {
+  if (size <= kMinBlockSize) return kMinBlockSize;
+  // a quarter of the highest power of two below size, wastes 25% at most
+  size_t step = (static_cast<size_t>(1) << (63 - __builtin_clzll(static_cast<uint64_t>(size - 1)))) / 4;
+  return (size + step - 1) / step * step;
+}
+
+bool TensorBufferPool::Allocate(size_t capacity, Block *block) {
+  block->mmapped = false;
+  if (params_.hugepage && capacity >= kHugePageSize) {
+#ifdef MAP_HUGETLB
+    void *data = mmap(nullptr, HugePageAligned(capacity), PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (data != MAP_FAILED) {
+      block->data = data;
+      block->mmapped = true;
+      ++stats_.hugepage_allocations;
+      return true;
+    }
+#endif
+    // no huge page reserved, falls back to transparent huge pages
+    if (posix_memalign(&block->data, kHugePageSize, capacity) != 0) return false;
+#ifdef MADV_HUGEPAGE
+    if (madvise(block->data, capacity, MADV_HUGEPAGE) == 0) ++stats_.hugepage_allocations;
+#endif
+    return true;
+  }
+  return posix_memalign(&block->data, kAlignment, capacity) == 0;
+}
+
+void TensorBufferPool::Free(const Block &block, size_t capacity) {
+  if (block.mmapped) {
+    munmap(block.data, HugePageAligned(capacity));
+  } else {
+    free(block.data);
+  }
+}
+
+TensorBuffer TensorBufferPool::Borrow(size_t size) {
+  TensorBuffer buffer;
+  size_t capacity = BucketSize(size);
+  Block block = {nullptr, false};
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    ++stats_.borrows;
+    auto iter = free_blocks_.find(capacity);
+    if (iter != free_blocks_.end() && !iter->second.empty()) {
+      block = iter->second.back();
+      iter->second.pop_back();
+      stats_.cached_bytes -= capacity;
+      ++stats_.reuses;
+    } else {
+      if (!Allocate(capacity, &block)) return buffer;
+      ++stats_.allocations;
+      stats_.owned_bytes += capacity;
+    }
+  }
+  buffer.pool_ = this;
+  buffer.data_ = block.data;
+  buffer.size_ = size;
+  buffer.capacity_ = capacity;
+  buffer.mmapped_ = block.mmapped;
+  return buffer;
+}
+
+void TensorBufferPool::Return(void *data, size_t capacity, bool mmapped) {
+  Block block = {data, mmapped};
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (stats_.cached_bytes + capacity <= params_.max_cached_bytes) {
+      free_blocks_[capacity].push_back(block);
+      stats_.cached_bytes += capacity;
+      return;
+    }
+    stats_.owned_bytes -= capacity;
+  }
+  Free(block, capacity);
+}
+
+void TensorBufferPool::Reserve(size_t size, uint32_t count) {
+  std::vector<TensorBuffer> buffers;
+  buffers.reserve(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    TensorBuffer buffer = Borrow(size);
+    if (!buffer) break;
+    // page faults are taken here, not on the first batch
+    memset(buffer.Data(), 0, BucketSize(size));
+    buffers.push_back(std::move(buffer));
+  }
+}
+
+void TensorBufferPool::Trim() {
+  std::unordered_map<size_t, std::vector<Block>> blocks;
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    blocks.swap(free_blocks_);
+    stats_.owned_bytes -= stats_.cached_bytes;
+    stats_.cached_bytes = 0;
+  }
+  for (auto &bucket : blocks) {
+    for (auto &block : bucket.second) Free(block, bucket.first);
+  }
+}
+
+TensorPoolStats TensorBufferPool::GetStats() {
+  std::lock_guard<std::mutex> lk(mutex_);
+  return stats_;
+}
+
+void TensorBufferPool::ResetStats() {
+  std::lock_guard<std::mutex> lk(mutex_);
+  stats_.borrows = stats_.reuses = stats_.allocations = stats_.hugepage_allocations = 0;
+}
+
+TensorArena::TensorArena(uint32_t n, uint32_t c, uint32_t h, uint32_t w, size_t elem_size, Layout layout,
+                         TensorBufferPool *pool)
+    : n_(n), c_(c), h_(h), w_(w), item_size_(static_cast<size_t>(c) * h * w * elem_size), layout_(layout) {
+  if (pool && Size()) buffer_ = pool->Borrow(Size());
+}
+
+}  // namespace cnstream
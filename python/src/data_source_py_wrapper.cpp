@@ -48,9 +48,16 @@ void DataHandlerWrapper(py::module &m) {  // NOLINT
       .def(py::init())
       .def_readwrite("filename", &FileSourceParam::filename)
       .def_readwrite("framerate", &FileSourceParam::framerate)
+      .def_readwrite("speed", &FileSourceParam::speed)
       .def_readwrite("loop", &FileSourceParam::loop)
       .def_readwrite("max_res", &FileSourceParam::max_res)
       .def_readwrite("only_key_frame", &FileSourceParam::only_key_frame)
+      .def_readwrite("sample_interval", &FileSourceParam::sample_interval)
+      .def_readwrite("sample_framerate", &FileSourceParam::sample_framerate)
+      .def_readwrite("start_time", &FileSourceParam::start_time)
+      .def_readwrite("end_time", &FileSourceParam::end_time)
+      .def_readwrite("start_frame", &FileSourceParam::start_frame)
+      .def_readwrite("end_frame", &FileSourceParam::end_frame)
       .def_readwrite("out_res", &FileSourceParam::out_res);
 
   py::class_<RtspSourceParam, std::shared_ptr<RtspSourceParam>>(m, "RtspSourceParam")
@@ -61,8 +68,25 @@ void DataHandlerWrapper(py::module &m) {  // NOLINT
       .def_readwrite("reconnect", &RtspSourceParam::reconnect)
       .def_readwrite("interval", &RtspSourceParam::interval)
       .def_readwrite("only_key_frame", &RtspSourceParam::only_key_frame)
+      .def_readwrite("sample_interval", &RtspSourceParam::sample_interval)
+      .def_readwrite("sample_framerate", &RtspSourceParam::sample_framerate)
       .def_readwrite("callback", &RtspSourceParam::callback)
-      .def_readwrite("out_res", &RtspSourceParam::out_res);
+      .def_readwrite("out_res", &RtspSourceParam::out_res)
+      .def_readwrite("buffer_size", &RtspSourceParam::buffer_size)
+      .def_readwrite("reorder_time", &RtspSourceParam::reorder_time)
+      .def_readwrite("reconnect_min_interval", &RtspSourceParam::reconnect_min_interval)
+      .def_readwrite("reconnect_max_interval", &RtspSourceParam::reconnect_max_interval);
+
+  py::class_<RtspStats, std::shared_ptr<RtspStats>>(m, "RtspStats")
+      .def(py::init())
+      .def_readwrite("reconnect_count", &RtspStats::reconnect_count)
+      .def_readwrite("decoder_recreate_count", &RtspStats::decoder_recreate_count)
+      .def_readwrite("last_reconnect_time", &RtspStats::last_reconnect_time)
+      .def_readwrite("max_reconnect_time", &RtspStats::max_reconnect_time)
+      .def_readwrite("packets_received", &RtspStats::packets_received)
+      .def_readwrite("packets_lost", &RtspStats::packets_lost)
+      .def_readwrite("frames_received", &RtspStats::frames_received)
+      .def_readwrite("frames_dropped", &RtspStats::frames_dropped);
 
   py::enum_<ESMemSourceParam::DataType>(m, "ESMemSourceParamDataType")
       .value("INVALID", ESMemSourceParam::DataType::INVALID)
@@ -85,6 +109,17 @@ void DataHandlerWrapper(py::module &m) {  // NOLINT
       .def(py::init())
       .def_readwrite("out_res", &ImageFrameSourceParam::out_res);
 
+  py::class_<ImageDirSourceParam, std::shared_ptr<ImageDirSourceParam>>(m, "ImageDirSourceParam")
+      .def(py::init())
+      .def_readwrite("dir", &ImageDirSourceParam::dir)
+      .def_readwrite("suffix", &ImageDirSourceParam::suffix)
+      .def_readwrite("files", &ImageDirSourceParam::files)
+      .def_readwrite("loop", &ImageDirSourceParam::loop)
+      .def_readwrite("framerate", &ImageDirSourceParam::framerate)
+      .def_readwrite("decode_threads", &ImageDirSourceParam::decode_threads)
+      .def_readwrite("prefetch", &ImageDirSourceParam::prefetch)
+      .def_readwrite("out_res", &ImageDirSourceParam::out_res);
+
   m.def("create_source", [](DataSource *module, const std::string &stream_id, const FileSourceParam &param) {
       return CreateSource(module, stream_id, param);
   });
@@ -109,6 +144,10 @@ void DataHandlerWrapper(py::module &m) {  // NOLINT
       return CreateSource(module, stream_id, param);
   });
 
+  m.def("create_source", [](DataSource *module, const std::string &stream_id, const ImageDirSourceParam &param) {
+      return CreateSource(module, stream_id, param);
+  });
+
   m.def("write_mem_package",
       [](std::shared_ptr<SourceHandler>handler, std::vector<unsigned char> data, int size,
          uint64_t pts, bool is_eos) {
@@ -140,6 +179,13 @@ void DataHandlerWrapper(py::module &m) {  // NOLINT
         return Write(handler, &pkt);
       });
 
+  m.def("get_rtsp_stats",
+      [](std::shared_ptr<SourceHandler>handler) -> py::object {
+        RtspStats stats;
+        if (GetRtspStats(handler, &stats) != 0) return py::none();
+        return py::cast(stats);
+      });
+
   py::class_<DataSourceParam>(m, "DataSourceParam")
       .def(py::init())
       .def_readwrite("interval", &DataSourceParam::interval)
@@ -149,7 +195,8 @@ void DataHandlerWrapper(py::module &m) {  // NOLINT
   py::class_<DataSource, std::shared_ptr<DataSource>, SourceModule>(m, "DataSource")
       .def(py::init<const std::string&>())
       .def("check_param_set", &DataSource::CheckParamSet)
-      .def("get_source_param", &DataSource::GetSourceParam);
+      .def("get_source_param", &DataSource::GetSourceParam)
+      .def("seek", &DataSource::Seek);
 }
 
 }  // namespace cnstream
@@ -32,6 +32,7 @@
 #endif
 
 #include "cnstream_postproc.hpp"
+#include "cnstream_postproc_utils.hpp"
 
 #define CLIP(x) ((x) < 0 ? 0 : ((x) > 1 ? 1 : (x)))
 
@@ -68,7 +69,10 @@ int PostprocSSDLpd::Execute(const cnstream::NetOutputs& net_outputs, const infer
   int bbox_size = pred_dims[1];
   if (bbox_size != 7) return 0;
 
-  for (int i = 0; i < bbox_num; i++) {
+  // boxes with low score are pruned before being parsed
+  std::vector<int> indices;
+  cnstream::postproc::PruneByScore(preds, bbox_num, bbox_size, 2, threshold_, &indices);
+  for (int i : indices) {
     float* bbox_data = preds + i * bbox_size;
     size_t batch_idx = static_cast<size_t>(bbox_data[0]);
     if (batch_idx >= packages.size()) continue;  // FIXME
@@ -78,7 +82,6 @@ int PostprocSSDLpd::Execute(const cnstream::NetOutputs& net_outputs, const infer
       continue;
     }
     float score = bbox_data[2];
-    if (score < threshold_) continue;
 
     auto package = packages[batch_idx];
     auto parent = objects[batch_idx];
@@ -22,8 +22,7 @@
 #include <vector>
 
 #include "cnstream_postproc.hpp"
-
-#define CLIP(x) ((x) < 0 ? 0 : ((x) > 1 ? 1 : (x)))
+#include "cnstream_postproc_utils.hpp"
 
 class PostprocYolov5 : public cnstream::Postproc {
  public:
@@ -70,13 +69,8 @@ int PostprocYolov5::Execute(const cnstream::NetOutputs& net_outputs, const infer
     return -1;
   }
 
-  auto range_0_w = [model_input_w](float num) {
-    return std::max(.0f, std::min(static_cast<float>(model_input_w), num));
-  };
-  auto range_0_h = [model_input_h](float num) {
-    return std::max(.0f, std::min(static_cast<float>(model_input_h), num));
-  };
-
+  std::vector<cnstream::postproc::Detection> dets;
+  std::vector<int> indices;
   for (size_t batch_idx = 0; batch_idx < packages.size(); batch_idx++) {
     float* data = static_cast<float*>(output0->GetHostData(0, batch_idx));
     int box_num = static_cast<int*>(output1->GetHostData(0, batch_idx))[0];
@@ -102,41 +96,31 @@ int PostprocYolov5::Execute(const cnstream::NetOutputs& net_outputs, const infer
     scaling_factor_w = scaling_w / scaling;
     scaling_factor_h = scaling_h / scaling;
 
-    std::lock_guard<std::mutex> lk(objs_holder->mutex_);
-    for (int bi = 0; bi < box_num; ++bi) {
-      if (threshold_ > 0 && data[2] < threshold_) {
-        data += 7;
-        continue;
-      }
-
-      float l = range_0_w(data[3]);
-      float t = range_0_h(data[4]);
-      float r = range_0_w(data[5]);
-      float b = range_0_h(data[6]);
-      l = CLIP((l / model_input_w - 0.5f) * scaling_factor_w + 0.5f);
-      t = CLIP((t / model_input_h - 0.5f) * scaling_factor_h + 0.5f);
-      r = CLIP((r / model_input_w - 0.5f) * scaling_factor_w + 0.5f);
-      b = CLIP((b / model_input_h - 0.5f) * scaling_factor_h + 0.5f);
-      if (r <= l || b <= t) {
-        data += 7;
-        continue;
-      }
+    cnstream::postproc::DetectionOutputParams decode_params;
+    decode_params.threshold = threshold_;
+    decode_params.input_w = model_input_w;
+    decode_params.input_h = model_input_h;
+    decode_params.letterbox_w = scaling_factor_w;
+    decode_params.letterbox_h = scaling_factor_h;
+    dets.clear();
+    cnstream::postproc::DecodeDetectionOutput(data, box_num, decode_params, &dets, &indices);
 
+    std::lock_guard<std::mutex> lk(objs_holder->mutex_);
+    for (const auto& det : dets) {
       auto obj = std::make_shared<cnstream::CNInferObject>();
-      uint32_t id = static_cast<uint32_t>(data[1]);
+      uint32_t id = static_cast<uint32_t>(det.label);
       obj->id = std::to_string(id);
-      obj->score = data[2];
-      obj->bbox.x = l;
-      obj->bbox.y = t;
-      obj->bbox.w = std::min(1.0f - l, r - l);
-      obj->bbox.h = std::min(1.0f - t, b - t);
+      obj->score = det.score;
+      obj->bbox.x = det.x0;
+      obj->bbox.y = det.y0;
+      obj->bbox.w = std::min(1.0f - det.x0, det.x1 - det.x0);
+      obj->bbox.h = std::min(1.0f - det.y0, det.y1 - det.y0);
 
       if (!labels.empty() && id < labels[0].size()) {
         obj->AddExtraAttribute("Category", labels[0][id]);
       }
 
       objs_holder->objs_.push_back(obj);
-      data += 7;
     }
   }  // for(batch_idx)
   return 0;
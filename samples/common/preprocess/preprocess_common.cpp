@@ -90,8 +90,8 @@ CnedkBufSurfaceColorFormat GetBufSurfaceColorFormat(infer_server::NetworkInputFo
 int PreprocessTransform(cnedk::BufSurfWrapperPtr src, cnedk::BufSurfWrapperPtr dst,
                         const std::vector<CnedkTransformRect> &src_rects,
                         const cnstream::CnPreprocNetworkInfo &info, infer_server::NetworkInputFormat pix_fmt,
-                        bool keep_aspect_ratio, int pad_value, bool mean_std, std::vector<float> mean,
-                        std::vector<float> std) {
+                        bool keep_aspect_ratio, int pad_value, bool mean_std, const std::vector<float> &mean,
+                        const std::vector<float> &std) {
   if (src_rects.size() && src_rects.size() != src->GetNumFilled()) {
     return -1;
   }
@@ -176,8 +176,8 @@ int PreprocessTransform(cnedk::BufSurfWrapperPtr src, cnedk::BufSurfWrapperPtr d
 int PreprocessCpu(cnedk::BufSurfWrapperPtr src, cnedk::BufSurfWrapperPtr dst,
                   const std::vector<CnedkTransformRect> &src_rects,
                   const cnstream::CnPreprocNetworkInfo &info, infer_server::NetworkInputFormat pix_fmt,
-                  bool keep_aspect_ratio, int pad_value, bool mean_std, std::vector<float> mean,
-                  std::vector<float> std) {
+                  bool keep_aspect_ratio, int pad_value, bool mean_std, const std::vector<float> &mean,
+                  const std::vector<float> &std) {
   if (src_rects.size() && src_rects.size() != src->GetNumFilled()) {
     return -1;
   }
@@ -190,15 +190,34 @@ int PreprocessCpu(cnedk::BufSurfWrapperPtr src, cnedk::BufSurfWrapperPtr dst,
     return -1;
   }
 
-  if (info.dtype == infer_server::DataType::UINT8 && mean_std) {
+  if (info.c != 3 || (info.dtype != infer_server::DataType::UINT8 && info.dtype != infer_server::DataType::FLOAT32)) {
+    LOGE(PREPROC) << "[PreprocessCpu] Only support 3 channels UINT8 or FLOAT32 network input";
+    return -1;
+  }
+
+  cnstream::CpuPreprocParams params;
+  params.dst_fmt = GetBufSurfaceColorFormat(pix_fmt);
+  params.dtype = info.dtype;
+  params.planar = false;
+  params.keep_aspect_ratio = keep_aspect_ratio;
+  params.pad_value = pad_value;
+  if (mean_std && info.dtype == infer_server::DataType::FLOAT32) {
+    if (mean.size() < info.c || std.size() < info.c) {
+      LOGE(PREPROC) << "[PreprocessCpu] The size of mean and std should be equal to the channel of network input";
+      return -1;
+    }
+    params.mean_std = true;
+    for (uint32_t c_i = 0; c_i < info.c; c_i++) {
+      params.mean[c_i] = mean[c_i];
+      params.std[c_i] = std[c_i];
+    }
+  } else if (mean_std) {
     LOGW(PREPROC) << "[PreprocessCpu] not support uint8 with mean std.";
   }
 
   uint32_t batch_size = src->GetNumFilled();
 
   CnedkBufSurfaceSyncForCpu(src_buf, -1, -1);
-  size_t img_size = info.w * info.h * info.c;
-  std::unique_ptr<uint8_t[]> img_tmp = nullptr;
 
   for (uint32_t batch_idx = 0; batch_idx < batch_size; ++batch_idx) {
     uint8_t *y_plane = static_cast<uint8_t *>(src->GetHostData(0, batch_idx));
@@ -223,62 +242,15 @@ int PreprocessCpu(cnedk::BufSurfWrapperPtr src, cnedk::BufSurfWrapperPtr dst,
     int y_stride = src_buf->surface_list[batch_idx].plane_params.pitch[0];
     int uv_stride = src_buf->surface_list[batch_idx].plane_params.pitch[1];
     CnedkBufSurfaceColorFormat src_fmt = src_buf->surface_list[batch_idx].color_format;
-    CnedkBufSurfaceColorFormat dst_fmt = GetBufSurfaceColorFormat(pix_fmt);
 
     y_plane += src_bbox.left + src_bbox.top * y_stride;
     uv_plane += src_bbox.left + src_bbox.top / 2 * uv_stride;
 
-    void *dst_img = dst->GetHostData(0, batch_idx);
-
-    uint8_t *dst_img_u8, *dst_img_roi;
-    CnedkTransformRect dst_bbox;
-    if (info.dtype == infer_server::DataType::UINT8) {
-      dst_img_u8 = reinterpret_cast<uint8_t *>(dst_img);
-    } else if (info.dtype == infer_server::DataType::FLOAT32) {
-      img_tmp.reset(new uint8_t[img_size]);
-      dst_img_u8 = img_tmp.get();
-    } else {
+    // color convertion, resizing, padding and normalization are fused, the tensor is written only once
+    if (cnstream::YUV420spToTensorCpu(y_plane, uv_plane, src_bbox.width, src_bbox.height, y_stride, uv_stride,
+                                      src_fmt, dst->GetHostData(0, batch_idx), info.w, info.h, params) != 0) {
       return -1;
     }
-
-    memset(dst_img_u8, pad_value, img_size);
-    if (keep_aspect_ratio) {
-      dst_bbox = cnstream::KeepAspectRatio(src_bbox.width, src_bbox.height, info.w, info.h);
-      // validate bbox
-      dst_bbox.left -= dst_bbox.left & 1;
-      dst_bbox.top -= dst_bbox.top & 1;
-      dst_bbox.width -= dst_bbox.width & 1;
-      dst_bbox.height -= dst_bbox.height & 1;
-
-      while (dst_bbox.left + dst_bbox.width > info.w) dst_bbox.width -= 2;
-      while (dst_bbox.top + dst_bbox.height > info.h) dst_bbox.height -= 2;
-
-      dst_img_roi = dst_img_u8 + dst_bbox.left * info.c + dst_bbox.top * info.w * info.c;
-    } else {
-      dst_bbox.left = 0;
-      dst_bbox.top = 0;
-      dst_bbox.width = info.w;
-      dst_bbox.height = info.h;
-      dst_img_roi = dst_img_u8;
-    }
-
-    cnstream::YUV420spToRGBx(y_plane, uv_plane, src_bbox.width, src_bbox.height, y_stride, uv_stride, src_fmt,
-                             dst_img_roi, dst_bbox.width, dst_bbox.height, info.w * info.c, dst_fmt);
-
-    if (info.dtype == infer_server::DataType::FLOAT32) {
-      float *dst_img_fp32 = reinterpret_cast<float *>(dst_img);
-      if (mean_std) {
-        for (uint32_t i = 0; i < info.w * info.h; i++) {
-          for (uint32_t c_i = 0; c_i < info.c; c_i++) {
-            dst_img_fp32[i * info.c + c_i] = (dst_img_u8[i * info.c + c_i] - mean[c_i]) / std[c_i];
-          }
-        }
-      } else {
-        for (uint32_t i = 0; i < img_size; i++) {
-          dst_img_fp32[i] = static_cast<float>(dst_img_u8[i]);
-        }
-      }
-    }
     dst->SyncHostToDevice(-1, batch_idx);
   }
   return 0;
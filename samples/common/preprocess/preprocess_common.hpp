@@ -27,13 +27,13 @@ int PreprocessTransform(cnedk::BufSurfWrapperPtr src, cnedk::BufSurfWrapperPtr d
                         const std::vector<CnedkTransformRect> &src_rects,
                         const cnstream::CnPreprocNetworkInfo &info, infer_server::NetworkInputFormat pix_fmt,
                         bool keep_aspect_ratio = true, int pad_value = 0, bool mean_std = false,
-                        std::vector<float> mean = {}, std::vector<float> std = {});
+                        const std::vector<float> &mean = {}, const std::vector<float> &std = {});
 
 int PreprocessCpu(cnedk::BufSurfWrapperPtr src, cnedk::BufSurfWrapperPtr dst,
                   const std::vector<CnedkTransformRect> &src_rects,
                   const cnstream::CnPreprocNetworkInfo &info, infer_server::NetworkInputFormat pix_fmt,
                   bool keep_aspect_ratio = true, int pad_value = 0, bool mean_std = false,
-                  std::vector<float> mean = {}, std::vector<float> std = {});
+                  const std::vector<float> &mean = {}, const std::vector<float> &std = {});
 
 void SaveResult(const std::string &filename, int count, uint32_t batch_size, cnedk::BufSurfWrapperPtr dst,
                 const cnstream::CnPreprocNetworkInfo &info);
@@ -0,0 +1,163 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gflags/gflags.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "easytrack/include/easy_track.h"
+#include "easytrack/src/track_trace.h"
+
+DEFINE_string(trace, "", "path of the detection trace, recorded by the record_trace parameter of Tracker");
+DEFINE_string(track_name, "FeatureMatch", "FeatureMatch, IoUMatch or ByteTrack");
+DEFINE_string(assignment_method, "hungarian", "hungarian, lapjv or greedy, for FeatureMatch and IoUMatch");
+DEFINE_string(feature_precision, "float32", "float32 or int8, for FeatureMatch");
+DEFINE_double(max_cosine_distance, 0.2, "threshold of cosine distance");
+DEFINE_int32(nn_budget, 100, "the latest features kept by each track");
+DEFINE_double(max_iou_distance, 0.7, "threshold of IoU distance, 0.8 by default for ByteTrack");
+DEFINE_int32(max_age, 30, "frames a track is kept after it is lost");
+DEFINE_int32(n_init, 3, "frames a track is matched before confirmed, 1 by default for ByteTrack");
+DEFINE_double(high_score_thresh, 0.5, "for ByteTrack, detections above it are matched first and may start tracks");
+DEFINE_double(low_score_thresh, 0.1, "for ByteTrack, detections below it are ignored");
+DEFINE_int32(repeat, 1, "times the trace is replayed, by new trackers each time");
+
+namespace {
+
+struct StreamReplay {
+  std::unique_ptr<cnstream::EasyTrack> tracker;
+  cnstream::MotEvaluator evaluator;
+  double track_ms = 0;
+};
+
+std::unique_ptr<cnstream::EasyTrack> CreateTracker() {
+  if (FLAGS_track_name == "ByteTrack") {
+    // the shared flags not set take the defaults of ByteTrack, as the Tracker module does
+    double max_iou_distance =
+        gflags::GetCommandLineFlagInfoOrDie("max_iou_distance").is_default ? 0.8 : FLAGS_max_iou_distance;
+    int n_init = gflags::GetCommandLineFlagInfoOrDie("n_init").is_default ? 1 : FLAGS_n_init;
+    std::unique_ptr<cnstream::ByteTrack> track(new cnstream::ByteTrack);
+    track->SetParams(FLAGS_high_score_thresh, FLAGS_low_score_thresh, max_iou_distance, FLAGS_max_age, n_init);
+    return std::unique_ptr<cnstream::EasyTrack>(track.release());
+  }
+  std::unique_ptr<cnstream::FeatureMatchTrack> track(new cnstream::FeatureMatchTrack);
+  track->SetParams(FLAGS_max_cosine_distance, FLAGS_nn_budget, FLAGS_max_iou_distance, FLAGS_max_age, FLAGS_n_init);
+  track->SetFeaturePrecision(FLAGS_feature_precision == "int8" ? cnstream::FeaturePrecision::INT8
+                                                               : cnstream::FeaturePrecision::FLOAT32);
+  if (FLAGS_assignment_method == "lapjv") {
+    track->SetAssignmentMethod(cnstream::AssignmentMethod::LAPJV);
+  } else if (FLAGS_assignment_method == "greedy") {
+    track->SetAssignmentMethod(cnstream::AssignmentMethod::GREEDY);
+  }
+  return std::unique_ptr<cnstream::EasyTrack>(track.release());
+}
+
+void PrintReport(const std::string &name, uint64_t frames, double track_ms, const cnstream::MatchStats &match,
+                 const cnstream::MotMetrics &mot) {
+  std::cout << std::fixed << std::setprecision(3) << "[" << name << "] frames " << frames << ", objects "
+            << mot.objects << ", " << (frames ? track_ms / frames : 0) << " ms/frame\n"
+            << "  assignments " << match.solves << ", mean cost matrix "
+            << (match.solves ? static_cast<double>(match.cost_elements) / match.solves : 0) << " elements, max "
+            << match.max_rows << " x " << match.max_cols << ", solver " << match.solve_ms << " ms\n"
+            << "  MOTA " << mot.Mota() << ", IDF1 " << mot.Idf1() << ", id switches " << mot.id_switches
+            << ", fragmentations " << mot.fragmentations << ", misses " << mot.misses << ", false positives "
+            << mot.false_positives << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  gflags::SetUsageMessage("Replays a detection trace into easytrack at full speed, and reports the time of tracking, "
+                          "the sizes of the assignments and the MOT metrics against the identities of the trace.");
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  if (FLAGS_trace.empty()) {
+    std::cout << "usage: track_replay -trace path [-track_name FeatureMatch] [-assignment_method lapjv] ..."
+              << std::endl;
+    return 1;
+  }
+  if (FLAGS_track_name != "FeatureMatch" && FLAGS_track_name != "IoUMatch" && FLAGS_track_name != "ByteTrack") {
+    std::cout << "unsupported track_name " << FLAGS_track_name << std::endl;
+    return 1;
+  }
+  if (FLAGS_low_score_thresh < 0 || FLAGS_low_score_thresh > FLAGS_high_score_thresh || FLAGS_high_score_thresh > 1) {
+    std::cout << "0 <= low_score_thresh <= high_score_thresh <= 1 is expected" << std::endl;
+    return 1;
+  }
+
+  // loaded first, so that the replay is not bound by reading the trace
+  cnstream::TraceReader reader;
+  if (!reader.Open(FLAGS_trace)) return 1;
+  std::vector<cnstream::TraceFrame> frames;
+  cnstream::TraceFrame frame;
+  while (reader.Read(&frame)) {
+    // IoUMatch is FeatureMatch without features
+    if (FLAGS_track_name == "IoUMatch") {
+      for (auto &obj : frame.objects) obj.feature.clear();
+    }
+    frames.push_back(frame);
+  }
+  std::cout << "trace " << FLAGS_trace << ": " << frames.size() << " frames" << std::endl;
+
+  for (int round = 0; round < FLAGS_repeat; ++round) {
+    std::map<uint32_t, StreamReplay> streams;
+    for (auto &trace_frame : frames) {
+      StreamReplay &stream = streams[trace_frame.stream_index];
+      if (!stream.tracker) stream.tracker = CreateTracker();
+      cnstream::Objects tracks;
+      auto start = std::chrono::steady_clock::now();
+      stream.tracker->UpdateFrame(trace_frame.objects, &tracks);
+      stream.track_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+      stream.evaluator.Update(trace_frame.objects, tracks);
+    }
+
+    uint64_t total_frames = 0;
+    double total_ms = 0;
+    cnstream::MatchStats total_match;
+    cnstream::MotMetrics total_mot;
+    for (auto &it : streams) {
+      cnstream::MatchStats match = it.second.tracker->GetMatchStats();
+      cnstream::MotMetrics mot = it.second.evaluator.Get();
+      PrintReport("stream " + std::to_string(it.first), mot.frames, it.second.track_ms, match, mot);
+      total_frames += mot.frames;
+      total_ms += it.second.track_ms;
+      total_match.solves += match.solves;
+      total_match.cost_elements += match.cost_elements;
+      total_match.max_rows = std::max(total_match.max_rows, match.max_rows);
+      total_match.max_cols = std::max(total_match.max_cols, match.max_cols);
+      total_match.solve_ms += match.solve_ms;
+      total_mot.frames += mot.frames;
+      total_mot.objects += mot.objects;
+      total_mot.tracked += mot.tracked;
+      total_mot.misses += mot.misses;
+      total_mot.false_positives += mot.false_positives;
+      total_mot.id_switches += mot.id_switches;
+      total_mot.fragmentations += mot.fragmentations;
+      total_mot.id_true_positives += mot.id_true_positives;
+    }
+    PrintReport("round " + std::to_string(round) + " total", total_frames, total_ms, total_match, total_mot);
+  }
+  return 0;
+}
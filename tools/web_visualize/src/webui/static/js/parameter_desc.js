@@ -45,8 +45,14 @@ PARAM_DESC["cnstream::Osd"] = {
 PARAM_DESC["cnstream::Tracker"] = {
     custom_params: {
         model_path: "Optional. <br> Desc: path of offline model",
-        track_name: "Optional. <br> Default value: [FeatureMatch] <br> Optional values: [FeatureMatch] [IoUMatch] <br> Desc: Track algorithm name.",
+        track_name: "Optional. <br> Default value: [FeatureMatch] <br> Optional values: [FeatureMatch] [IoUMatch] [ByteTrack] <br> Desc: Track algorithm name. ByteTrack tracks by motion only, and matches the detections of low score to the tracks left.",
         max_cosine_distance: "Optional. <br> Default value: [0.2] <br> Optional values: float <br> Desc: Threshold of cosine distance.",
+        nn_budget: "Optional. <br> Default value: [100] <br> Optional values: integer <br> Desc: The number of the latest features kept by each track of FeatureMatch.",
+        max_iou_distance: "Optional. <br> Default value: [0.7], [0.8] for ByteTrack <br> Optional values: float in (0, 1] <br> Desc: Threshold of IoU distance.",
+        max_age: "Optional. <br> Default value: [30] <br> Optional values: integer <br> Desc: The number of frames a track is kept after it is lost.",
+        n_init: "Optional. <br> Default value: [3], [1] for ByteTrack <br> Optional values: integer <br> Desc: The number of frames a track is matched before it is confirmed.",
+        high_score_thresh: "Optional. <br> Default value: [0.5] <br> Optional values: float in [0, 1] <br> Desc: For ByteTrack, the detections of score above it are matched first and may start new tracks.",
+        low_score_thresh: "Optional. <br> Default value: [0.1] <br> Optional values: float in [0, high_score_thresh] <br> Desc: For ByteTrack, the detections of score below it are ignored.",
         engine_num: "Optional. <br> Default value: [1] <br> Optional values: integer <br> Desc: Infer server engine number. Increase the engine number to improve performance.",
         batch_timeout: "Optional. <br> Default value: [300] <br> Optional values: integer <br> Desc: The batching timeout. unit[ms].",
         model_input_pixel_format: "Optional. <br> Default value: [RGBA32] <br> Optional value: RGB24/BGR24/TENSOR are supported. <br> Desc: The pixel format of the model input image.",